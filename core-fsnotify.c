@@ -0,0 +1,240 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-fsnotify.h"
+
+#if defined(HAVE_LIB_PTHREAD)
+
+/*
+ *  stress_fsnotify_scale_writer()
+ *	open, modify and close random files, each close generates a
+ *	close write event, the close time is stamped for latency
+ *	measurement unless an earlier event for the file is still unread
+ */
+static void *stress_fsnotify_scale_writer(void *arg)
+{
+	static void *nowt = NULL;
+	stress_fsnotify_writer_t *writer = (stress_fsnotify_writer_t *)arg;
+	stress_fsnotify_scale_t *scale = writer->scale;
+	const char ch = 'x';
+
+	while (!scale->stop && stress_continue_flag()) {
+		size_t idx;
+		char name[32];
+		int fd;
+
+		writer->rnd ^= writer->rnd << 13;
+		writer->rnd ^= writer->rnd >> 7;
+		writer->rnd ^= writer->rnd << 17;
+		idx = writer->first + (size_t)(writer->rnd % writer->count);
+
+		(void)snprintf(name, sizeof(name), "f%zu", idx % STRESS_FSNOTIFY_PER_DIR);
+		fd = openat(scale->dir_fds[idx / STRESS_FSNOTIFY_PER_DIR], name, O_WRONLY);
+		if (UNLIKELY(fd < 0)) {
+			if ((errno == EMFILE) || (errno == ENFILE) || (errno == EINTR))
+				continue;
+			writer->err = errno;
+			break;
+		}
+		VOID_RET(ssize_t, pwrite(fd, &ch, sizeof(ch), 0));
+		(void)pthread_mutex_lock(&scale->lock);
+		if (scale->stamps[idx] == 0)
+			scale->stamps[idx] = stress_time_now_ns();
+		(void)pthread_mutex_unlock(&scale->lock);
+		(void)close(fd);
+		writer->writes++;
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_fsnotify_scale_init()
+ *	allocate the stamps of n_files files and the latency
+ *	samples, returns 0 on success, -1 if out of memory
+ */
+int stress_fsnotify_scale_init(stress_fsnotify_scale_t *scale, const size_t n_files)
+{
+	(void)shim_memset(scale, 0, sizeof(*scale));
+	scale->stamps = (uint64_t *)calloc(n_files, sizeof(*scale->stamps));
+	scale->latencies = (double *)calloc(STRESS_FSNOTIFY_SAMPLES, sizeof(*scale->latencies));
+	if (!scale->stamps || !scale->latencies) {
+		free(scale->latencies);
+		free(scale->stamps);
+		scale->latencies = NULL;
+		scale->stamps = NULL;
+		return -1;
+	}
+	(void)pthread_mutex_init(&scale->lock, NULL);
+	return 0;
+}
+
+/*
+ *  stress_fsnotify_scale_free()
+ *	free the state allocated by stress_fsnotify_scale_init()
+ */
+void stress_fsnotify_scale_free(stress_fsnotify_scale_t *scale)
+{
+	if (!scale->stamps)
+		return;
+	(void)pthread_mutex_destroy(&scale->lock);
+	free(scale->latencies);
+	free(scale->stamps);
+	scale->latencies = NULL;
+	scale->stamps = NULL;
+}
+
+/*
+ *  stress_fsnotify_scale_start()
+ *	split n_files files between up to n_writers writer threads
+ *	and start them, returns the number of writers started
+ */
+size_t stress_fsnotify_scale_start(
+	stress_fsnotify_scale_t *scale,
+	const int *dir_fds,
+	const size_t n_files,
+	const size_t n_writers)
+{
+	const size_t n = STRESS_MINIMUM(STRESS_MINIMUM(n_writers, n_files),
+					(size_t)STRESS_FSNOTIFY_MAX_WRITERS);
+	size_t i;
+
+	scale->dir_fds = dir_fds;
+	scale->stop = false;
+	for (i = 0; i < n; i++) {
+		stress_fsnotify_writer_t *writer = &scale->writers[i];
+
+		writer->scale = scale;
+		writer->first = (n_files * i) / n;
+		writer->count = ((n_files * (i + 1)) / n) - writer->first;
+		writer->rnd = stress_mwc64() | 1;
+		writer->ret = pthread_create(&writer->pthread, NULL,
+			stress_fsnotify_scale_writer, (void *)writer);
+		if (writer->ret != 0)
+			break;
+		scale->started++;
+	}
+	return scale->started;
+}
+
+/*
+ *  stress_fsnotify_scale_event()
+ *	an event for file idx was read at time t_now, reservoir
+ *	sample the latency from the stamped write, the caller
+ *	counts the events and overflows
+ */
+void stress_fsnotify_scale_event(
+	stress_fsnotify_scale_t *scale,
+	const size_t idx,
+	const uint64_t t_now)
+{
+	uint64_t stamp;
+	double latency;
+
+	(void)pthread_mutex_lock(&scale->lock);
+	stamp = scale->stamps[idx];
+	scale->stamps[idx] = 0;
+	(void)pthread_mutex_unlock(&scale->lock);
+	if ((stamp == 0) || (stamp > t_now))
+		return;
+
+	latency = (double)(t_now - stamp) / STRESS_DBL_NANOSECOND;
+	scale->total_latency += latency;
+	if (scale->n_samples < STRESS_FSNOTIFY_SAMPLES) {
+		scale->latencies[scale->n_samples++] = latency;
+	} else {
+		const uint64_t r = stress_mwc64modn(scale->latency_count + 1);
+
+		if (r < STRESS_FSNOTIFY_SAMPLES)
+			scale->latencies[r] = latency;
+	}
+	scale->latency_count++;
+}
+
+/*
+ *  stress_fsnotify_scale_stop()
+ *	stop and reap the writers, report the delivery rate and
+ *	latency over duration seconds and return the exit status
+ */
+int stress_fsnotify_scale_stop(
+	stress_args_t *args,
+	stress_fsnotify_scale_t *scale,
+	const double duration)
+{
+	uint64_t writes = 0;
+	size_t i;
+	int err = 0;
+
+	scale->stop = true;
+	for (i = 0; i < scale->started; i++) {
+		stress_fsnotify_writer_t *writer = &scale->writers[i];
+
+		(void)pthread_join(writer->pthread, NULL);
+		writes += writer->writes;
+		if (writer->err && !err)
+			err = writer->err;
+	}
+
+	if (err) {
+		pr_fail("%s: writer failed, errno=%d (%s)\n", args->name, err, strerror(err));
+		return EXIT_FAILURE;
+	}
+	if (scale->started == 0) {
+		pr_inf_skip("%s: cannot create writer threads, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	if (duration > 0.0) {
+		const size_t n = scale->n_samples;
+		const double events = (double)scale->events;
+		const double delivered = writes ? 100.0 * events / (double)writes : 0.0;
+		const double mean = scale->latency_count ?
+			scale->total_latency / (double)scale->latency_count : 0.0;
+		double p50 = 0.0, p99 = 0.0, max = 0.0;
+
+		if (n > 0) {
+			qsort(scale->latencies, n, sizeof(*scale->latencies), stress_metrics_cmp_double);
+			p50 = scale->latencies[n / 2];
+			p99 = scale->latencies[STRESS_MINIMUM((n * 99) / 100, n - 1)];
+			max = scale->latencies[n - 1];
+		}
+		if (args->instance == 0) {
+			pr_block_begin();
+			pr_inf("%s: %.0f writes/s, %.0f events/s delivered (%.2f%% of writes), "
+				"%.2f queue overflows/s\n", args->name,
+				(double)writes / duration, events / duration,
+				delivered, (double)scale->overflows / duration);
+			pr_inf("%s: delivery latency mean %.2f, p50 %.2f, p99 %.2f, max %.2f usecs\n",
+				args->name, mean * STRESS_DBL_MICROSECOND, p50 * STRESS_DBL_MICROSECOND,
+				p99 * STRESS_DBL_MICROSECOND, max * STRESS_DBL_MICROSECOND);
+			pr_block_end();
+		}
+		stress_metrics_set(args, 0, "events per sec delivered",
+			events / duration, STRESS_HARMONIC_MEAN);
+		stress_metrics_set(args, 1, "% writes delivered as events",
+			delivered, STRESS_ARITHMETIC_MEAN);
+		stress_metrics_set(args, 2, "queue overflows per sec",
+			(double)scale->overflows / duration, STRESS_ARITHMETIC_MEAN);
+		stress_metrics_set(args, 3, "usec mean delivery latency",
+			mean * STRESS_DBL_MICROSECOND, STRESS_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 4, "usec p99 delivery latency",
+			p99 * STRESS_DBL_MICROSECOND, STRESS_GEOMETRIC_MEAN);
+	}
+	return EXIT_SUCCESS;
+}
+#endif
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_FSNOTIFY_H
+#define CORE_FSNOTIFY_H
+
+#include "core-pthread.h"
+
+/*
+ *  inotify and fanotify scalability modes, writer threads close-write
+ *  random files named fN in directories of STRESS_FSNOTIFY_PER_DIR
+ *  files and the stressor passes the file index of each event it
+ *  reads to stress_fsnotify_scale_event() to measure delivery latency
+ */
+#define STRESS_FSNOTIFY_PER_DIR		(1000)		/* files per directory */
+#define STRESS_FSNOTIFY_SAMPLES		(65536)		/* latency samples kept */
+#define STRESS_FSNOTIFY_MAX_WRITERS	(64)		/* maximum writer threads */
+
+#if defined(HAVE_LIB_PTHREAD)
+
+struct stress_fsnotify_scale;
+
+/* an event writer thread */
+typedef struct {
+	pthread_t pthread;		/* thread handle */
+	int ret;			/* pthread_create return */
+	struct stress_fsnotify_scale *scale; /* shared scale state */
+	size_t first;			/* first file of this writer */
+	size_t count;			/* number of files of this writer */
+	uint64_t writes;		/* writes (close write events) made */
+	uint64_t rnd;			/* xorshift state, mwc is not thread safe */
+	int err;			/* errno of a failed write */
+} stress_fsnotify_writer_t;
+
+/* scalability run state */
+typedef struct stress_fsnotify_scale {
+	stress_fsnotify_writer_t writers[STRESS_FSNOTIFY_MAX_WRITERS];
+	pthread_mutex_t lock;		/* protects stamps */
+	volatile bool stop;		/* stop writers flag */
+	const int *dir_fds;		/* directories of the files */
+	uint64_t *stamps;		/* per file ns time of last unseen write */
+	double *latencies;		/* reservoir of latency samples */
+	size_t started;			/* writer threads started */
+	size_t n_samples;		/* latency samples in reservoir */
+	uint64_t latency_count;		/* latencies measured */
+	double total_latency;		/* sum of latencies in seconds */
+	uint64_t events;		/* events read */
+	uint64_t overflows;		/* queue overflows */
+} stress_fsnotify_scale_t;
+
+extern int stress_fsnotify_scale_init(stress_fsnotify_scale_t *scale,
+	const size_t n_files);
+extern void stress_fsnotify_scale_free(stress_fsnotify_scale_t *scale);
+extern size_t stress_fsnotify_scale_start(stress_fsnotify_scale_t *scale,
+	const int *dir_fds, const size_t n_files, const size_t n_writers);
+extern void stress_fsnotify_scale_event(stress_fsnotify_scale_t *scale,
+	const size_t idx, const uint64_t t_now);
+extern int stress_fsnotify_scale_stop(stress_args_t *args,
+	stress_fsnotify_scale_t *scale, const double duration);
+
+#endif
+
+#endif
@@ -440,3 +440,70 @@ void stress_ftrace_stop(void)
 {
 }
 #endif
+
+#if defined(__linux__)
+/*
+ *  stress_ftrace_snapshot()
+ *	write an optional marker into the trace buffer, take a
+ *	snapshot of the ftrace ring buffer and save it to filename,
+ *	returns 0 on success, -1 on failure with errno set
+ */
+int stress_ftrace_snapshot(const char *marker, const char *filename)
+{
+	static const char * const tracing_paths[] = {
+		"/sys/kernel/tracing",
+		"/sys/kernel/debug/tracing",
+	};
+	char path[PATH_MAX], buffer[4096];
+	size_t i;
+	int fd_in, fd_out, saved_errno = ENOENT;
+	ssize_t n;
+
+	for (i = 0; i < SIZEOF_ARRAY(tracing_paths); i++) {
+		if (marker) {
+			(void)snprintf(path, sizeof(path), "%s/trace_marker", tracing_paths[i]);
+			VOID_RET(ssize_t, stress_system_write(path, marker, strlen(marker)));
+		}
+		(void)snprintf(path, sizeof(path), "%s/snapshot", tracing_paths[i]);
+		if (stress_system_write(path, "1", 1) >= 0)
+			break;
+		saved_errno = errno;
+	}
+	if (i == SIZEOF_ARRAY(tracing_paths)) {
+		errno = saved_errno;
+		return -1;
+	}
+
+	fd_in = open(path, O_RDONLY);
+	if (fd_in < 0)
+		return -1;
+	fd_out = open(filename, O_CREAT | O_WRONLY | O_TRUNC, S_IRUSR | S_IWUSR);
+	if (fd_out < 0) {
+		saved_errno = errno;
+		(void)close(fd_in);
+		errno = saved_errno;
+		return -1;
+	}
+	while ((n = read(fd_in, buffer, sizeof(buffer))) > 0) {
+		if (write(fd_out, buffer, (size_t)n) != n) {
+			n = -1;
+			break;
+		}
+	}
+	saved_errno = errno;
+	(void)close(fd_out);
+	(void)close(fd_in);
+	errno = saved_errno;
+
+	return (n < 0) ? -1 : 0;
+}
+#else
+int stress_ftrace_snapshot(const char *marker, const char *filename)
+{
+	(void)marker;
+	(void)filename;
+
+	errno = ENOSYS;
+	return -1;
+}
+#endif
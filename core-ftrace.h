@@ -24,5 +24,6 @@ extern int stress_ftrace_start(void);
 extern void stress_ftrace_stop(void);
 extern void stress_ftrace_free(void);
 extern void stress_ftrace_add_pid(const pid_t pid);
+extern int stress_ftrace_snapshot(const char *marker, const char *filename);
 
 #endif
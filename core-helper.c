@@ -4328,6 +4328,26 @@ void stress_yield_sleep_ms(void)
 	} while (stress_continue_flag());
 }
 
+/*
+ *  stress_bogo_pace()
+ *	throttle a bogo-op rate limited stressor, sleep for as
+ *	long as the bogo-op counter is ahead of the paced rate,
+ *	the sleep is cut short when the stressor is told to stop
+ */
+void stress_bogo_pace(stress_args_t *args)
+{
+	const double now = stress_time_now();
+	double ahead = ((double)stress_bogo_get(args) / args->ops_rate) -
+			(now - args->time_start);
+
+	if (ahead <= 0.0)
+		return;
+	if ((args->time_end > 0.0) && (ahead > args->time_end - now))
+		ahead = args->time_end - now;
+	if (ahead > 0.0)
+		(void)shim_nanosleep_uint64((uint64_t)(ahead * STRESS_DBL_NANOSECOND));
+}
+
 static void stress_dbg(const char *fmt, ...) FORMAT(printf, 1, 2);
 
 /*
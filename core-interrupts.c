@@ -67,6 +67,43 @@ static void stress_interrupts_counter_set(
 	counters[i].count_stop = value;
 }
 
+/*
+ *  stress_interrupts_sum()
+ *	sum the per CPU interrupt counts that follow
+ *	the interrupt type in a /proc/interrupts line
+ */
+static uint64_t stress_interrupts_sum(const char *ptr)
+{
+	uint64_t count = 0;
+
+	for (;;) {
+		uint64_t val = 0ULL;
+
+		/* skip spaces */
+		while (*ptr == ' ')
+			ptr++;
+		if (!*ptr)
+			break;
+
+		/* expecting number, bail otherwise */
+		if (!isdigit((int)*ptr))
+			break;
+
+		/* get count, sum it */
+		if (sscanf(ptr, "%" SCNu64, &val) == 1)
+			count += val;
+
+		/* scan over digits */
+		while (isdigit((int)*ptr))
+			ptr++;
+
+		/* bail if end of string */
+		if (!*ptr)
+			break;
+	}
+	return count;
+}
+
 /*
  *  stress_interrupts_count()
  *	count up all interrupts for all types
@@ -106,33 +143,7 @@ static void stress_interrupts_count(stress_interrupts_t *counters, const int whi
 			/* Find a match */
 			ptr = strstr(buffer, type);
 			if (ptr) {
-				count = 0;
-				ptr += strlen(type);
-				for (;;) {
-					uint64_t val = 0ULL;
-
-					/* skip spaces */
-					while (*ptr == ' ')
-						ptr++;
-					if (!*ptr)
-						break;
-
-					/* expecting number, bail otherwise */
-					if (!isdigit((int)*ptr))
-						break;
-
-					/* get count, sum it */
-					if (sscanf(ptr, "%" SCNu64, &val) == 1)
-						count += val;
-
-					/* scan over digits */
-					while (isdigit((int)*ptr))
-						ptr++;
-
-					/* bail if end of string */
-					if (!*ptr)
-						break;
-				}
+				count = stress_interrupts_sum(ptr + strlen(type));
 				stress_interrupts_counter_set(counters, i, count, which);
 				break;
 			}
@@ -141,6 +152,38 @@ static void stress_interrupts_count(stress_interrupts_t *counters, const int whi
 	(void)fclose(fp);
 }
 
+/*
+ *  stress_interrupts_type_count()
+ *	sum the counts over all CPUs of a /proc/interrupts
+ *	interrupt type, e.g. "TLB:", returns -1 if not found
+ */
+int stress_interrupts_type_count(const char *type, uint64_t *count)
+{
+	FILE *fp;
+	char buffer[4096];
+	int ret = -1;
+
+	*count = 0;
+	fp = fopen("/proc/interrupts", "r");
+	if (!fp)
+		return -1;
+
+	while (fgets(buffer, sizeof(buffer), fp)) {
+		const char *ptr = buffer;
+
+		while (*ptr == ' ')
+			ptr++;
+		if (!strncmp(ptr, type, strlen(type))) {
+			*count = stress_interrupts_sum(ptr + strlen(type));
+			ret = 0;
+			break;
+		}
+	}
+	(void)fclose(fp);
+
+	return ret;
+}
+
 /*
  *  stress_interrupts_start()
  *	count interrupts at start of run
@@ -24,5 +24,6 @@ extern void stress_interrupts_stop(stress_interrupts_t *counters);
 extern void stress_interrupts_check_failure(const char *name,
 	stress_interrupts_t *counters, uint32_t instance, int *rc);
 extern void stress_interrupts_dump(FILE *yaml, stress_stressor_t *stressors_list);
+extern int stress_interrupts_type_count(const char *type, uint64_t *count);
 
 #endif
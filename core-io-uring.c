@@ -17,9 +17,132 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
  *
  */
-#include "config.h"
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-io-uring.h"
 
-#if defined(__linux__) &&	\
-    defined(HAVE_LINUX_IO_URING_H)
-#include <linux/io_uring.h>
+/*
+ *  NOTE: the Makefile extracts the io-uring opcode enums from the
+ *  preprocessed output of this file to generate io-uring.h, so the
+ *  code below must not use any of the opcode names.
+ */
+
+#if defined(HAVE_STRESS_IO_URING_RING)
+
+/*
+ *  Avoid GCCism of void * pointer arithmetic by casting to
+ *  uint8_t *, doing the offset and then casting back to void *
+ */
+#define VOID_ADDR_OFFSET(addr, offset)	\
+	((void *)(((uint8_t *)addr) + offset))
+
+/*
+ *  stress_io_uring_ring_close()
+ *	unmap the rings and close the io uring
+ */
+void stress_io_uring_ring_close(stress_io_uring_submit_t *submit)
+{
+	if (submit->io_uring_fd >= 0) {
+		(void)close(submit->io_uring_fd);
+		submit->io_uring_fd = -1;
+	}
+
+	if (submit->sqes_mmap) {
+		(void)munmap((void *)submit->sqes_mmap, submit->sqes_size);
+		submit->sqes_mmap = NULL;
+	}
+
+	if (submit->cq_mmap && (submit->cq_mmap != submit->sq_mmap)) {
+		(void)munmap(submit->cq_mmap, submit->cq_size);
+		submit->cq_mmap = NULL;
+	}
+
+	if (submit->sq_mmap) {
+		(void)munmap(submit->sq_mmap, submit->sq_size);
+		submit->sq_mmap = NULL;
+	}
+}
+
+/*
+ *  stress_io_uring_ring_setup()
+ *	setup an io uring with entries submission queue entries
+ *	and map its rings, returns 0 on success or with errno set
+ *	STRESS_IO_URING_RING_SETUP_FAILED if io_uring_setup failed
+ *	and STRESS_IO_URING_RING_MMAP_FAILED if the rings could
+ *	not be mapped, the io uring is closed on failure
+ */
+int stress_io_uring_ring_setup(const uint32_t entries, stress_io_uring_submit_t *submit)
+{
+	stress_uring_io_sq_ring_t *sring = &submit->sq_ring;
+	stress_uring_io_cq_ring_t *cring = &submit->cq_ring;
+	struct io_uring_params p;
+	int saved_errno;
+
+	(void)shim_memset(submit, 0, sizeof(*submit));
+	(void)shim_memset(&p, 0, sizeof(p));
+	submit->io_uring_fd = shim_io_uring_setup(entries, &p);
+	if (submit->io_uring_fd < 0)
+		return STRESS_IO_URING_RING_SETUP_FAILED;
+
+	submit->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	submit->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		if (submit->cq_size > submit->sq_size)
+			submit->sq_size = submit->cq_size;
+		submit->cq_size = submit->sq_size;
+	}
+
+	submit->sq_mmap = stress_mmap_populate(NULL, submit->sq_size,
+		PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE,
+		submit->io_uring_fd, IORING_OFF_SQ_RING);
+	if (submit->sq_mmap == MAP_FAILED) {
+		submit->sq_mmap = NULL;
+		goto err;
+	}
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		submit->cq_mmap = submit->sq_mmap;
+	} else {
+		submit->cq_mmap = stress_mmap_populate(NULL, submit->cq_size,
+				PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE,
+				submit->io_uring_fd, IORING_OFF_CQ_RING);
+		if (submit->cq_mmap == MAP_FAILED) {
+			submit->cq_mmap = NULL;
+			goto err;
+		}
+	}
+
+	sring->head = VOID_ADDR_OFFSET(submit->sq_mmap, p.sq_off.head);
+	sring->tail = VOID_ADDR_OFFSET(submit->sq_mmap, p.sq_off.tail);
+	sring->ring_mask = VOID_ADDR_OFFSET(submit->sq_mmap, p.sq_off.ring_mask);
+	sring->ring_entries = VOID_ADDR_OFFSET(submit->sq_mmap, p.sq_off.ring_entries);
+	sring->flags = VOID_ADDR_OFFSET(submit->sq_mmap, p.sq_off.flags);
+	sring->array = VOID_ADDR_OFFSET(submit->sq_mmap, p.sq_off.array);
+
+	submit->sqes_entries = p.sq_entries;
+	submit->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	submit->sqes_mmap = stress_mmap_populate(NULL, submit->sqes_size,
+			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+			submit->io_uring_fd, IORING_OFF_SQES);
+	if (submit->sqes_mmap == MAP_FAILED) {
+		submit->sqes_mmap = NULL;
+		goto err;
+	}
+
+	cring->head = VOID_ADDR_OFFSET(submit->cq_mmap, p.cq_off.head);
+	cring->tail = VOID_ADDR_OFFSET(submit->cq_mmap, p.cq_off.tail);
+	cring->ring_mask = VOID_ADDR_OFFSET(submit->cq_mmap, p.cq_off.ring_mask);
+	cring->ring_entries = VOID_ADDR_OFFSET(submit->cq_mmap, p.cq_off.ring_entries);
+	cring->cqes = VOID_ADDR_OFFSET(submit->cq_mmap, p.cq_off.cqes);
+
+	return 0;
+
+err:
+	saved_errno = errno;
+	stress_io_uring_ring_close(submit);
+	errno = saved_errno;
+	return STRESS_IO_URING_RING_MMAP_FAILED;
+}
 #endif
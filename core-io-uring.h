@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2013-2021 Canonical, Ltd.
+ * Copyright (C) 2022-2024 Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#ifndef CORE_IO_URING_H
+#define CORE_IO_URING_H
+
+#if defined(HAVE_LINUX_IO_URING_H)
+#include <linux/io_uring.h>
+#endif
+
+#if defined(HAVE_LINUX_IO_URING_H) &&	\
+    defined(HAVE_SYSCALL) &&		\
+    defined(__NR_io_uring_enter) &&	\
+    defined(__NR_io_uring_setup) &&	\
+    defined(IORING_OFF_SQ_RING) &&	\
+    defined(IORING_OFF_CQ_RING) &&	\
+    defined(IORING_OFF_SQES)
+#define HAVE_STRESS_IO_URING_RING
+
+/*
+ * io uring submission queue info
+ */
+typedef struct {
+	unsigned *head;
+	unsigned *tail;
+	unsigned *ring_mask;
+	unsigned *ring_entries;
+	unsigned *flags;
+	unsigned *array;
+} stress_uring_io_sq_ring_t;
+
+/*
+ * io uring completion queue info
+ */
+typedef struct {
+	unsigned *head;
+	unsigned *tail;
+	unsigned *ring_mask;
+	unsigned *ring_entries;
+	struct io_uring_cqe *cqes;
+} stress_uring_io_cq_ring_t;
+
+/*
+ *  io uring submission info
+ */
+typedef struct {
+	stress_uring_io_sq_ring_t sq_ring;
+	stress_uring_io_cq_ring_t cq_ring;
+	struct io_uring_sqe *sqes_mmap;
+	void *sq_mmap;
+	void *cq_mmap;
+	int io_uring_fd;
+	size_t sq_size;
+	size_t cq_size;
+	size_t sqes_size;
+	size_t sqes_entries;
+} stress_io_uring_submit_t;
+
+/*
+ *  shim_io_uring_setup
+ *	wrapper for io_uring_setup()
+ */
+static inline int shim_io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+	return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+/*
+ *  shim_io_uring_enter
+ *	wrapper for io_uring_enter()
+ */
+static inline int shim_io_uring_enter(
+	int fd,
+	unsigned int to_submit,
+	unsigned int min_complete,
+	unsigned int flags)
+{
+	return (int)syscall(__NR_io_uring_enter, fd, to_submit,
+		min_complete, flags, NULL, 0);
+}
+
+#define STRESS_IO_URING_RING_SETUP_FAILED	(-1)	/* io_uring_setup failed */
+#define STRESS_IO_URING_RING_MMAP_FAILED	(-2)	/* ring mmap failed */
+
+extern int stress_io_uring_ring_setup(const uint32_t entries, stress_io_uring_submit_t *submit);
+extern void stress_io_uring_ring_close(stress_io_uring_submit_t *submit);
+#endif
+
+#endif
@@ -22,9 +22,22 @@
 #include "core-job.h"
 
 #define MAX_ARGS	(64)
+#define MAX_PHASES	(4096)
+#define MAX_REPEAT_DEPTH (8)
+#define MAX_RAMP_STEPS	(10)
 #define RUN_SEQUENTIAL	(0x01)
 #define RUN_PARALLEL	(0x02)
 
+typedef struct {
+	size_t phase_start;	/* index of first phase in repeat block */
+	uint32_t count;		/* number of times to repeat the block */
+} stress_job_repeat_t;
+
+static stress_job_phase_t job_phases[MAX_PHASES];
+static size_t job_phases_count;
+static stress_job_repeat_t job_repeats[MAX_REPEAT_DEPTH];
+static size_t job_repeats_depth;
+
 #define ISBLANK(ch)	isblank((int)(ch))
 
 /*
@@ -82,6 +95,225 @@ err:
 	return -1;
 }
 
+/*
+ *  stress_job_phase_add()
+ *	append a timed phase to the job phase list
+ */
+static int stress_job_phase_add(
+	const uint64_t duration,
+	const int32_t instances,
+	const uint64_t ops_rate)
+{
+	stress_job_phase_t *phase;
+
+	if (job_phases_count >= MAX_PHASES) {
+		(void)fprintf(stderr, "too many job phases, maximum is %d\n", MAX_PHASES);
+		return -1;
+	}
+	if (duration == 0) {
+		(void)fprintf(stderr, "job phase duration must be at least 1 second\n");
+		return -1;
+	}
+	phase = &job_phases[job_phases_count++];
+	phase->duration = duration;
+	phase->instances = instances;
+	phase->ops_rate = ops_rate;
+	return 0;
+}
+
+/*
+ *  stress_parse_phase_load()
+ *	parse the load type of a ramp or step directive, either
+ *	"instances" or "ops-rate", returns true for instances
+ */
+static int stress_parse_phase_load(const char *str, bool *instances)
+{
+	if (!strcmp(str, "instances")) {
+		*instances = true;
+		return 0;
+	}
+	if (!strcmp(str, "ops-rate")) {
+		*instances = false;
+		return 0;
+	}
+	(void)fprintf(stderr, "expected instances or ops-rate, got '%s'\n", str);
+	return -1;
+}
+
+/*
+ *  stress_parse_phase()
+ *	parse the job file load scenario directives:
+ *	  phase T [instances N] [ops-rate R]
+ *	  ramp T instances|ops-rate FROM TO [steps S]
+ *	  step T instances|ops-rate V1 V2 .. Vn
+ *	  repeat-begin N
+ *	  repeat-end
+ *	returns 1 if a directive was parsed, 0 if not a directive
+ *	and -1 on error
+ */
+static int stress_parse_phase(
+	int argc,
+	char **argv)
+{
+	uint64_t duration;
+	bool instances;
+	int i;
+
+	if (argc < 2)
+		return 0;
+
+	if (!strcmp(argv[1], "phase")) {
+		int32_t n = -1;
+		uint64_t ops_rate = 0;
+
+		if (argc < 3)
+			goto err_args;
+		duration = stress_get_uint64_time(argv[2]);
+		for (i = 3; i < argc; i += 2) {
+			if (i + 1 >= argc)
+				goto err_args;
+			if (stress_parse_phase_load(argv[i], &instances) < 0)
+				return -1;
+			if (instances) {
+				n = stress_get_int32(argv[i + 1]);
+				if (n < 0)
+					goto err_instances;
+			} else {
+				ops_rate = stress_get_uint64(argv[i + 1]);
+			}
+		}
+		return (stress_job_phase_add(duration, n, ops_rate) < 0) ? -1 : 1;
+	}
+
+	if (!strcmp(argv[1], "ramp")) {
+		uint64_t from, to, steps, step_duration;
+		uint64_t j;
+
+		if ((argc != 6) && (argc != 8))
+			goto err_args;
+		duration = stress_get_uint64_time(argv[2]);
+		if (stress_parse_phase_load(argv[3], &instances) < 0)
+			return -1;
+		from = stress_get_uint64(argv[4]);
+		to = stress_get_uint64(argv[5]);
+		steps = (duration < MAX_RAMP_STEPS) ? duration : MAX_RAMP_STEPS;
+		if (argc == 8) {
+			if (strcmp(argv[6], "steps"))
+				goto err_args;
+			steps = stress_get_uint64(argv[7]);
+		}
+		if ((steps < 2) || (steps > duration)) {
+			(void)fprintf(stderr, "ramp needs 2 to %" PRIu64 " steps\n", duration);
+			return -1;
+		}
+		if (instances && ((from > INT32_MAX) || (to > INT32_MAX)))
+			goto err_instances;
+
+		/*
+		 *  linear interpolation from start to end value, inclusive,
+		 *  the last step takes up any remainder of the duration
+		 */
+		step_duration = duration / steps;
+		for (j = 0; j < steps; j++) {
+			const double frac = (double)j / (double)(steps - 1);
+			const uint64_t val = (uint64_t)(((double)from +
+				((double)to - (double)from) * frac) + 0.5);
+
+			if (j == steps - 1)
+				step_duration += duration % steps;
+			if (stress_job_phase_add(step_duration,
+					instances ? (int32_t)val : -1,
+					instances ? 0 : val) < 0)
+				return -1;
+		}
+		return 1;
+	}
+
+	if (!strcmp(argv[1], "step")) {
+		if (argc < 5)
+			goto err_args;
+		duration = stress_get_uint64_time(argv[2]);
+		if (stress_parse_phase_load(argv[3], &instances) < 0)
+			return -1;
+		for (i = 4; i < argc; i++) {
+			const uint64_t val = stress_get_uint64(argv[i]);
+
+			if (instances && (val > INT32_MAX))
+				goto err_instances;
+			if (stress_job_phase_add(duration,
+					instances ? (int32_t)val : -1,
+					instances ? 0 : val) < 0)
+				return -1;
+		}
+		return 1;
+	}
+
+	if (!strcmp(argv[1], "repeat-begin")) {
+		stress_job_repeat_t *repeat;
+
+		if (argc != 3)
+			goto err_args;
+		if (job_repeats_depth >= MAX_REPEAT_DEPTH) {
+			(void)fprintf(stderr, "repeat blocks nested too deeply, maximum is %d\n",
+				MAX_REPEAT_DEPTH);
+			return -1;
+		}
+		repeat = &job_repeats[job_repeats_depth++];
+		repeat->phase_start = job_phases_count;
+		repeat->count = stress_get_uint32(argv[2]);
+		if (repeat->count < 1) {
+			(void)fprintf(stderr, "repeat count must be 1 or more\n");
+			return -1;
+		}
+		return 1;
+	}
+
+	if (!strcmp(argv[1], "repeat-end")) {
+		const stress_job_repeat_t *repeat;
+		size_t len;
+		uint32_t n;
+
+		if (argc != 2)
+			goto err_args;
+		if (job_repeats_depth == 0) {
+			(void)fprintf(stderr, "repeat-end without a matching repeat-begin\n");
+			return -1;
+		}
+		repeat = &job_repeats[--job_repeats_depth];
+		len = job_phases_count - repeat->phase_start;
+		for (n = 1; n < repeat->count; n++) {
+			size_t j;
+
+			for (j = 0; j < len; j++) {
+				const stress_job_phase_t *phase = &job_phases[repeat->phase_start + j];
+
+				if (stress_job_phase_add(phase->duration,
+						phase->instances, phase->ops_rate) < 0)
+					return -1;
+			}
+		}
+		return 1;
+	}
+	return 0;
+
+err_args:
+	(void)fprintf(stderr, "invalid arguments to %s directive\n", argv[1]);
+	return -1;
+err_instances:
+	(void)fprintf(stderr, "invalid number of instances\n");
+	return -1;
+}
+
+/*
+ *  stress_job_phases()
+ *	return number of job phases and the job phase list
+ */
+size_t stress_job_phases(const stress_job_phase_t **phases)
+{
+	*phases = job_phases;
+	return job_phases_count;
+}
+
 /*
  *  stress_parse_error()
  *	generic job error message
@@ -196,6 +428,16 @@ int stress_parse_jobfile(
 				continue;
 			}
 
+			/* Check for job load scenario directives */
+			rc = stress_parse_phase(new_argc, new_argv);
+			if (rc < 0) {
+				ret = -1;
+				stress_parse_error(lineno, txt);
+				goto err;
+			} else if (rc == 1) {
+				continue;
+			}
+
 			tmp = malloc(len);
 			if (!tmp) {
 				(void)fprintf(stderr, "Out of memory parsing '%s'\n", jobfile);
@@ -215,6 +457,17 @@ int stress_parse_jobfile(
 			new_argv[1] = NULL;
 		}
 	}
+	if (job_repeats_depth > 0) {
+		(void)fprintf(stderr, "repeat-begin without a matching repeat-end in jobfile %s\n",
+			jobfile ? jobfile : "");
+		goto err;
+	}
+	if (job_phases_count && (flag & RUN_SEQUENTIAL)) {
+		(void)fprintf(stderr, "Cannot use load scenario directives "
+			"with run sequential in jobfile %s\n",
+			jobfile ? jobfile : "");
+		goto err;
+	}
 	ret = 0;
 err:
 	(void)fclose(fp);
@@ -19,6 +19,14 @@
 #ifndef CORE_JOB_H
 #define CORE_JOB_H
 
+/* A timed load phase from a job file load scenario */
+typedef struct {
+	uint64_t duration;	/* phase duration in seconds */
+	int32_t instances;	/* instances per stressor, -1 = as specified */
+	uint64_t ops_rate;	/* bogo-ops/s per stressor, 0 = unlimited */
+} stress_job_phase_t;
+
+extern size_t stress_job_phases(const stress_job_phase_t **phases);
 extern int stress_parse_jobfile(const int argc, char **argv, const char *jobfile);
 
 #endif
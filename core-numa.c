@@ -247,3 +247,44 @@ int stress_set_mbind(const char *arg)
 	_exit(EXIT_FAILURE);
 }
 #endif
+
+#if defined(HAVE_SCHED_GETAFFINITY) &&	\
+    defined(HAVE_SCHED_SETAFFINITY)
+/*
+ *  stress_numa_node_cpus()
+ *	get the CPUs of a node, returns number of CPUs that
+ *	are also in the allowed CPU mask
+ */
+int stress_numa_node_cpus(
+	const unsigned long node_id,
+	const cpu_set_t *allowed,
+	cpu_set_t *mask)
+{
+	char filename[PATH_MAX], buffer[4096], *ptr, *token;
+
+	CPU_ZERO(mask);
+	(void)snprintf(filename, sizeof(filename),
+		"/sys/devices/system/node/node%lu/cpulist", node_id);
+	if (stress_system_read(filename, buffer, sizeof(buffer)) <= 0)
+		return 0;
+
+	for (ptr = buffer; (token = strtok(ptr, ",\n")) != NULL; ptr = NULL) {
+		int lo, hi, cpu;
+
+		switch (sscanf(token, "%d-%d", &lo, &hi)) {
+		case 1:
+			hi = lo;
+			break;
+		case 2:
+			break;
+		default:
+			continue;
+		}
+		for (cpu = lo; (cpu <= hi) && (cpu < CPU_SETSIZE); cpu++) {
+			if ((cpu >= 0) && CPU_ISSET(cpu, allowed))
+				CPU_SET(cpu, mask);
+		}
+	}
+	return CPU_COUNT(mask);
+}
+#endif
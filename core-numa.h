@@ -19,8 +19,15 @@
 #ifndef CORE_NUMA_H
 #define CORE_NUMA_H
 
+#include <sched.h>
+
 extern int stress_numa_count_mem_nodes(unsigned long *max_node);
 extern int stress_numa_nodes(void);
 extern int stress_set_mbind(const char *arg);
+#if defined(HAVE_SCHED_GETAFFINITY) &&	\
+    defined(HAVE_SCHED_SETAFFINITY)
+extern int stress_numa_node_cpus(const unsigned long node_id,
+	const cpu_set_t *allowed, cpu_set_t *mask);
+#endif
 
 #endif
@@ -42,6 +42,9 @@ const struct option stress_long_options[] = {
 	{ "aio-ops",		1,	0,	OPT_aio_ops },
 	{ "aio-requests",	1,	0,	OPT_aio_requests },
 	{ "aiol",		1,	0,	OPT_aiol},
+	{ "aiol-batch",		1,	0,	OPT_aiol_batch },
+	{ "aiol-bs",		1,	0,	OPT_aiol_bs },
+	{ "aiol-depth",		1,	0,	OPT_aiol_depth },
 	{ "aiol-ops",		1,	0,	OPT_aiol_ops },
 	{ "aiol-requests",	1,	0,	OPT_aiol_requests },
 	{ "alarm",		1,	0,	OPT_alarm },
@@ -98,6 +101,10 @@ const struct option stress_long_options[] = {
 	{ "cacheline-affinity",	0,	0,	OPT_cacheline_affinity },
 	{ "cacheline-method",	1,	0,	OPT_cacheline_method },
 	{ "cacheline-ops",	1,	0,	OPT_cacheline_ops },
+	{ "cachestat",		1,	0,	OPT_cachestat },
+	{ "cachestat-ops",	1,	0,	OPT_cachestat_ops },
+	{ "cachestat-pattern",	1,	0,	OPT_cachestat_pattern },
+	{ "cachestat-ratio",	1,	0,	OPT_cachestat_ratio },
 	{ "cap",		1,	0, 	OPT_cap },
 	{ "cap-ops",		1,	0, 	OPT_cap_ops },
 	{ "chattr",		1,	0, 	OPT_chattr },
@@ -127,6 +134,7 @@ const struct option stress_long_options[] = {
 	{ "context-ops",	1,	0,	OPT_context_ops },
 	{ "copy-file",		1,	0,	OPT_copy_file },
 	{ "copy-file-bytes",	1,	0,	OPT_copy_file_bytes },
+	{ "copy-file-method",	1,	0,	OPT_copy_file_method },
 	{ "copy-file-ops",	1,	0,	OPT_copy_file_ops },
 	{ "cpu",		1,	0,	OPT_cpu },
 	{ "cpu-ops",		1,	0,	OPT_cpu_ops },
@@ -144,10 +152,12 @@ const struct option stress_long_options[] = {
 	{ "cyclic-dist",	1,	0,	OPT_cyclic_dist },
 	{ "cyclic-method",	1,	0,	OPT_cyclic_method },
 	{ "cyclic-ops",		1,	0,	OPT_cyclic_ops },
+	{ "cyclic-percpu",	0,	0,	OPT_cyclic_percpu },
 	{ "cyclic-policy",	1,	0,	OPT_cyclic_policy },
 	{ "cyclic-prio",	1,	0,	OPT_cyclic_prio },
 	{ "cyclic-samples",	1,	0,	OPT_cyclic_samples },
 	{ "cyclic-sleep",	1,	0,	OPT_cyclic_sleep },
+	{ "cyclic-threshold",	1,	0,	OPT_cyclic_threshold },
 	{ "daemon",		1,	0,	OPT_daemon },
 	{ "daemon-ops",		1,	0,	OPT_daemon_ops },
 	{ "daemon-wait",	0,	0,	OPT_daemon_wait },
@@ -177,6 +187,9 @@ const struct option stress_long_options[] = {
 	{ "dirdeep-dirs",	1,	0,	OPT_dirdeep_dirs },
 	{ "dirdeep-files",	1,	0,	OPT_dirdeep_files },
 	{ "dirdeep-inodes",	1,	0,	OPT_dirdeep_inodes },
+	{ "dirdeep-lookup-depth",1,	0,	OPT_dirdeep_lookup_depth },
+	{ "dirdeep-lookup-method",1,	0,	OPT_dirdeep_lookup_method },
+	{ "dirdeep-lookup-threads",1,	0,	OPT_dirdeep_lookup_threads },
 	{ "dirdeep-ops",	1,	0,	OPT_dirdeep_ops },
 	{ "dirmany",		1,	0,	OPT_dirmany },
 	{ "dirmany-bytes",	1,	0,	OPT_dirmany_bytes },
@@ -199,10 +212,15 @@ const struct option stress_long_options[] = {
 	{ "env",		1,	0,	OPT_env },
 	{ "env-ops",		1,	0,	OPT_env_ops },
 	{ "epoll",		1,	0,	OPT_epoll },
+	{ "epoll-accept",	1,	0,	OPT_epoll_accept },
+	{ "epoll-busy-poll",	1,	0,	OPT_epoll_busy_poll },
+	{ "epoll-clients",	1,	0,	OPT_epoll_clients },
 	{ "epoll-domain",	1,	0,	OPT_epoll_domain },
 	{ "epoll-ops",		1,	0,	OPT_epoll_ops },
 	{ "epoll-port",		1,	0,	OPT_epoll_port },
 	{ "epoll-sockets",	1,	0,	OPT_epoll_sockets },
+	{ "epoll-threads",	1,	0,	OPT_epoll_threads },
+	{ "epoll-trigger",	1,	0,	OPT_epoll_trigger },
 	{ "eventfd",		1,	0,	OPT_eventfd },
 	{ "eventfd-nonblock",	0,	0,	OPT_eventfd_nonblock },
 	{ "eventfd-ops",	1,	0,	OPT_eventfd_ops },
@@ -222,12 +240,18 @@ const struct option stress_long_options[] = {
 	{ "fallocate-bytes",	1,	0,	OPT_fallocate_bytes },
 	{ "fallocate-ops",	1,	0,	OPT_fallocate_ops },
 	{ "fanotify",		1,	0,	OPT_fanotify },
+	{ "fanotify-files",	1,	0,	OPT_fanotify_files },
 	{ "fanotify-ops",	1,	0,	OPT_fanotify_ops },
+	{ "fanotify-writers",	1,	0,	OPT_fanotify_writers },
 	{ "far-branch",		1,	0,	OPT_far_branch },
 	{ "far-branch-ops",	1,	0,	OPT_far_branch_ops },
 	{ "far-branch-pages",	1,	0,	OPT_far_branch_pages },
 	{ "fault",		1,	0,	OPT_fault },
+	{ "fault-churn",	0,	0,	OPT_fault_churn },
+	{ "fault-mem",		1,	0,	OPT_fault_mem },
 	{ "fault-ops",		1,	0,	OPT_fault_ops },
+	{ "fault-shared",	0,	0,	OPT_fault_shared },
+	{ "fault-threads",	1,	0,	OPT_fault_threads },
 	{ "fcntl",		1,	0,	OPT_fcntl},
 	{ "fcntl-ops",		1,	0,	OPT_fcntl_ops },
 	{ "fd-fork",		1,	0,	OPT_fd_fork },
@@ -291,6 +315,7 @@ const struct option stress_long_options[] = {
 	{ "getrandom",		1,	0,	OPT_getrandom },
 	{ "getrandom-ops",	1,	0,	OPT_getrandom_ops },
 	{ "getdent",		1,	0,	OPT_getdent },
+	{ "getdent-entries",	1,	0,	OPT_getdent_entries },
 	{ "getdent-ops",	1,	0,	OPT_getdent_ops },
 	{ "goto",		1,	0,	OPT_goto },
 	{ "goto-direction", 	1,	0,	OPT_goto_direction },
@@ -337,6 +362,8 @@ const struct option stress_long_options[] = {
 	{ "inode-flags-ops",	1,	0,	OPT_inode_flags_ops },
 	{ "inotify",		1,	0,	OPT_inotify },
 	{ "inotify-ops",	1,	0,	OPT_inotify_ops },
+	{ "inotify-watches",	1,	0,	OPT_inotify_watches },
+	{ "inotify-writers",	1,	0,	OPT_inotify_writers },
 	{ "io",			1,	0,	OPT_io },
 	{ "io-ops",		1,	0,	OPT_io_ops },
 	{ "iomix",		1,	0,	OPT_iomix },
@@ -444,13 +471,16 @@ const struct option stress_long_options[] = {
 	{ "madvise-ops",	1,	0,	OPT_madvise_ops },
 	{ "madvise-hwpoison",	0,	0,	OPT_madvise_hwpoison },
 	{ "malloc",		1,	0,	OPT_malloc },
+	{ "malloc-allocator",	1,	0,	OPT_malloc_allocator },
 	{ "malloc-bytes",	1,	0,	OPT_malloc_bytes },
 	{ "malloc-max",		1,	0,	OPT_malloc_max },
 	{ "malloc-mlock",	0,	0,	OPT_malloc_mlock },
 	{ "malloc-ops",		1,	0,	OPT_malloc_ops },
+	{ "malloc-pattern",	1,	0,	OPT_malloc_pattern },
 	{ "malloc-pthreads",	1,	0,	OPT_malloc_pthreads },
 	{ "malloc-thresh",	1,	0,	OPT_malloc_threshold },
 	{ "malloc-touch",	0,	0,	OPT_malloc_touch },
+	{ "malloc-trace",	1,	0,	OPT_malloc_trace },
 	{ "malloc-trim",	0,	0,	OPT_malloc_trim },
 	{ "malloc-zerofree",	0,	0,	OPT_malloc_zerofree },
 	{ "matrix",		1,	0,	OPT_matrix },
@@ -498,7 +528,11 @@ const struct option stress_long_options[] = {
 	{ "mergesort-size",	1,	0,	OPT_mergesort_size },
 	{ "metamix",		1,	0,	OPT_metamix },
         { "metamix-ops",	1,	0,	OPT_metamix_ops },
+        { "metamix-bench",	0,	0,	OPT_metamix_bench },
         { "metamix-bytes",	1,	0,	OPT_metamix_bytes },
+        { "metamix-files",	1,	0,	OPT_metamix_files },
+        { "metamix-shared",	0,	0,	OPT_metamix_shared },
+        { "metamix-workers",	1,	0,	OPT_metamix_workers },
 	{ "metrics",		0,	0,	OPT_metrics },
 	{ "metrics-brief",	0,	0,	OPT_metrics_brief },
 	{ "mincore",		1,	0,	OPT_mincore },
@@ -543,6 +577,8 @@ const struct option stress_long_options[] = {
 	{ "mmapfork",		1,	0,	OPT_mmapfork },
 	{ "mmapfork-ops",	1,	0,	OPT_mmapfork_ops },
 	{ "mmaphuge",		1,	0,	OPT_mmaphuge },
+	{ "mmaphuge-bench",	0,	0,	OPT_mmaphuge_bench },
+	{ "mmaphuge-bench-bytes",1,	0,	OPT_mmaphuge_bench_bytes },
 	{ "mmaphuge-file",	0,	0,	OPT_mmaphuge_file },
 	{ "mmaphuge-mlock",	0,	0,	OPT_mmaphuge_mlock },
 	{ "mmaphuge-mmaps",	1,	0,	OPT_mmaphuge_mmaps },
@@ -611,6 +647,7 @@ const struct option stress_long_options[] = {
 	{ "null-write",		0,	0,	OPT_null_write },
 	{ "numa",		1,	0,	OPT_numa },
 	{ "numa-bytes",		1,	0,	OPT_numa_bytes },
+	{ "numa-matrix",	0,	0,	OPT_numa_matrix },
 	{ "numa-ops",		1,	0,	OPT_numa_ops },
 	{ "numa-shuffle-addr",	0,	0,	OPT_numa_shuffle_addr },
 	{ "numa-shuffle-node",	0,	0,	OPT_numa_shuffle_node },
@@ -623,9 +660,11 @@ const struct option stress_long_options[] = {
 	{ "opcode-method",	1,	0,	OPT_opcode_method },
 	{ "opcode-ops",		1,	0,	OPT_opcode_ops },
 	{ "open",		1,	0,	OPT_open },
+	{ "open-clone-files",	0,	0,	OPT_open_clone_files },
 	{ "open-fd",		0,	0,	OPT_open_fd },
 	{ "open-max",		1,	0,	OPT_open_max },
 	{ "open-ops",		1,	0,	OPT_open_ops },
+	{ "open-threads",	1,	0,	OPT_open_threads },
 	{ "page-in",		0,	0,	OPT_page_in },
 	{ "pagemove",		1,	0,	OPT_pagemove },
 	{ "pagemove-bytes",	1,	0,	OPT_pagemove_bytes },
@@ -739,6 +778,7 @@ const struct option stress_long_options[] = {
 	{ "readahead",		1,	0,	OPT_readahead },
 	{ "readahead-bytes",	1,	0,	OPT_readahead_bytes },
 	{ "readahead-ops",	1,	0,	OPT_readahead_ops },
+	{ "readahead-streams",	1,	0,	OPT_readahead_streams },
 	{ "reboot",		1,	0,	OPT_reboot },
 	{ "reboot-ops",		1,	0,	OPT_reboot_ops },
 	{ "regs",		1,	0,	OPT_regs },
@@ -749,6 +789,8 @@ const struct option stress_long_options[] = {
 	{ "remap-pages",	1,	0,	OPT_remap_pages },
 	{ "rename",		1,	0,	OPT_rename },
 	{ "rename-ops",		1,	0,	OPT_rename_ops },
+	{ "repeat",		1,	0,	OPT_repeat },
+	{ "repeat-warmup",	1,	0,	OPT_repeat_warmup },
 	{ "resched",		1,	0,	OPT_resched },
 	{ "resched-ops",	1,	0,	OPT_resched_ops },
 	{ "resources",		1,	0,	OPT_resources },
@@ -937,7 +979,11 @@ const struct option stress_long_options[] = {
 	{ "stream-mlock",	0,	0,	OPT_stream_mlock },
 	{ "stream-ops",		1,	0,	OPT_stream_ops },
 	{ "swap",		1,	0,	OPT_swap },
+	{ "swap-bytes",		1,	0,	OPT_swap_bytes },
+	{ "swap-compress",	1,	0,	OPT_swap_compress },
 	{ "swap-ops",		1,	0,	OPT_swap_ops },
+	{ "swap-pageout",	1,	0,	OPT_swap_pageout },
+	{ "swap-throughput",	0,	0,	OPT_swap_throughput },
 	{ "switch",		1,	0,	OPT_switch },
 	{ "switch-freq",	1,	0,	OPT_switch_freq },
 	{ "switch-method",	1,	0,	OPT_switch_method },
@@ -985,6 +1031,7 @@ const struct option stress_long_options[] = {
 	{ "time-warp",		1,	0,	OPT_time_warp },
 	{ "time-warp-ops",	1,	0,	OPT_time_warp_ops },
 	{ "tlb-shootdown",	1,	0,	OPT_tlb_shootdown },
+	{ "tlb-shootdown-measure",0,	0,	OPT_tlb_shootdown_measure },
 	{ "tlb-shootdown-ops",	1,	0,	OPT_tlb_shootdown_ops },
 	{ "tmpfs",		1,	0,	OPT_tmpfs },
 	{ "tmpfs-mmap-async",	0,	0,	OPT_tmpfs_mmap_async },
@@ -1017,12 +1064,17 @@ const struct option stress_long_options[] = {
 	{ "tun-tap",		0,	0,	OPT_tun_tap },
 	{ "tun-ops",		1,	0,	OPT_tun_ops },
 	{ "udp",		1,	0,	OPT_udp },
+	{ "udp-batch",		1,	0,	OPT_udp_batch },
 	{ "udp-domain",		1,	0,	OPT_udp_domain },
 	{ "udp-gro",		0,	0,	OPT_udp_gro },
+	{ "udp-gso",		0,	0,	OPT_udp_gso },
 	{ "udp-if",		1,	0,	OPT_udp_if },
 	{ "udp-lite",		0,	0,	OPT_udp_lite },
 	{ "udp-ops",		1,	0,	OPT_udp_ops },
 	{ "udp-port",		1,	0,	OPT_udp_port },
+	{ "udp-rcvbuf",		1,	0,	OPT_udp_rcvbuf },
+	{ "udp-sndbuf",		1,	0,	OPT_udp_sndbuf },
+	{ "udp-sockets",	1,	0,	OPT_udp_sockets },
 	{ "udp-flood",		1,	0,	OPT_udp_flood },
 	{ "udp-flood-domain",	1,	0,	OPT_udp_flood_domain },
 	{ "udp-flood-if",	1,	0,	OPT_udp_flood_if },
@@ -1036,7 +1088,11 @@ const struct option stress_long_options[] = {
 	{ "urandom",		1,	0,	OPT_urandom },
 	{ "urandom-ops",	1,	0,	OPT_urandom_ops },
 	{ "userfaultfd",	1,	0,	OPT_userfaultfd },
+	{ "userfaultfd-batch",	1,	0,	OPT_userfaultfd_batch },
 	{ "userfaultfd-bytes",	1,	0,	OPT_userfaultfd_bytes },
+	{ "userfaultfd-fault-threads",1,	0,	OPT_userfaultfd_fault_threads },
+	{ "userfaultfd-handler-threads",1,	0,	OPT_userfaultfd_handler_threads },
+	{ "userfaultfd-mode",	1,	0,	OPT_userfaultfd_mode },
 	{ "userfaultfd-ops",	1,	0,	OPT_userfaultfd_ops },
 	{ "usersyscall",	1,	0,	OPT_usersyscall },
 	{ "usersyscall-ops",	1,	0,	OPT_usersyscall_ops },
@@ -1082,12 +1138,15 @@ const struct option stress_long_options[] = {
 #if defined(MAP_POPULATE)
 	{ "vm-populate",	0,	0,	OPT_vm_mmap_populate },
 #endif
+	{ "vm-threads",		1,	0,	OPT_vm_threads },
 	{ "vm-addr",		1,	0,	OPT_vm_addr },
 	{ "vm-addr-method",	1,	0,	OPT_vm_addr_method },
 	{ "vm-addr-mlock",	0,	0,	OPT_vm_addr_mlock },
 	{ "vm-addr-ops",	1,	0,	OPT_vm_addr_ops },
 	{ "vm-rw",		1,	0,	OPT_vm_rw },
 	{ "vm-rw-bytes",	1,	0,	OPT_vm_rw_bytes },
+	{ "vm-rw-compare",	0,	0,	OPT_vm_rw_compare },
+	{ "vm-rw-iovecs",	1,	0,	OPT_vm_rw_iovecs },
 	{ "vm-rw-ops",		1,	0,	OPT_vm_rw_ops },
 	{ "vm-segv",		1,	0,	OPT_vm_segv },
 	{ "vm-segv-ops",	1,	0,	OPT_vm_segv_ops },
@@ -1105,6 +1164,13 @@ const struct option stress_long_options[] = {
 	{ "wait-ops",		1,	0,	OPT_wait_ops },
 	{ "waitcpu",		1,	0,	OPT_waitcpu },
 	{ "waitcpu-ops",	1,	0,	OPT_waitcpu_ops },
+	{ "wal",		1,	0,	OPT_wal },
+	{ "wal-files",		1,	0,	OPT_wal_files },
+	{ "wal-group-commit",	0,	0,	OPT_wal_group_commit },
+	{ "wal-method",		1,	0,	OPT_wal_method },
+	{ "wal-ops",		1,	0,	OPT_wal_ops },
+	{ "wal-record",		1,	0,	OPT_wal_record },
+	{ "wal-threads",		1,	0,	OPT_wal_threads },
 	{ "watchdog",		1,	0,	OPT_watchdog },
 	{ "watchdog-ops",	1,	0,	OPT_watchdog_ops },
 	{ "with",		1,	0,	OPT_with },
@@ -167,6 +167,9 @@ typedef enum {
 	OPT_aiol,
 	OPT_aiol_ops,
 	OPT_aiol_requests,
+	OPT_aiol_batch,
+	OPT_aiol_bs,
+	OPT_aiol_depth,
 
 	OPT_alarm,
 	OPT_alarm_ops,
@@ -234,6 +237,11 @@ typedef enum {
 	OPT_cacheline_affinity,
 	OPT_cacheline_method,
 
+	OPT_cachestat,
+	OPT_cachestat_ops,
+	OPT_cachestat_pattern,
+	OPT_cachestat_ratio,
+
 	OPT_cap,
 	OPT_cap_ops,
 
@@ -276,6 +284,7 @@ typedef enum {
 	OPT_copy_file,
 	OPT_copy_file_ops,
 	OPT_copy_file_bytes,
+	OPT_copy_file_method,
 
 	OPT_cpu_ops,
 	OPT_cpu_method,
@@ -295,10 +304,12 @@ typedef enum {
 	OPT_cyclic_ops,
 	OPT_cyclic_dist,
 	OPT_cyclic_method,
+	OPT_cyclic_percpu,
 	OPT_cyclic_policy,
 	OPT_cyclic_prio,
 	OPT_cyclic_samples,
 	OPT_cyclic_sleep,
+	OPT_cyclic_threshold,
 
 	OPT_daemon,
 	OPT_daemon_ops,
@@ -336,6 +347,9 @@ typedef enum {
 	OPT_dirdeep_dirs,
 	OPT_dirdeep_files,
 	OPT_dirdeep_inodes,
+	OPT_dirdeep_lookup_depth,
+	OPT_dirdeep_lookup_method,
+	OPT_dirdeep_lookup_threads,
 
 	OPT_dirmany,
 	OPT_dirmany_ops,
@@ -369,6 +383,11 @@ typedef enum {
 	OPT_epoll_port,
 	OPT_epoll_domain,
 	OPT_epoll_sockets,
+	OPT_epoll_threads,
+	OPT_epoll_clients,
+	OPT_epoll_accept,
+	OPT_epoll_trigger,
+	OPT_epoll_busy_poll,
 
 	OPT_eventfd,
 	OPT_eventfd_ops,
@@ -393,6 +412,8 @@ typedef enum {
 
 	OPT_fanotify,
 	OPT_fanotify_ops,
+	OPT_fanotify_files,
+	OPT_fanotify_writers,
 
 	OPT_far_branch,
 	OPT_far_branch_ops,
@@ -400,6 +421,10 @@ typedef enum {
 
 	OPT_fault,
 	OPT_fault_ops,
+	OPT_fault_churn,
+	OPT_fault_mem,
+	OPT_fault_shared,
+	OPT_fault_threads,
 
 	OPT_fcntl,
 	OPT_fcntl_ops,
@@ -487,6 +512,7 @@ typedef enum {
 
 	OPT_getdent,
 	OPT_getdent_ops,
+	OPT_getdent_entries,
 
 	OPT_goto,
 	OPT_goto_ops,
@@ -545,6 +571,8 @@ typedef enum {
 
 	OPT_inotify,
 	OPT_inotify_ops,
+	OPT_inotify_watches,
+	OPT_inotify_writers,
 
 	OPT_iomix,
 	OPT_iomix_bytes,
@@ -691,12 +719,15 @@ typedef enum {
 
 	OPT_malloc,
 	OPT_malloc_ops,
+	OPT_malloc_allocator,
 	OPT_malloc_bytes,
 	OPT_malloc_max,
 	OPT_malloc_mlock,
+	OPT_malloc_pattern,
 	OPT_malloc_pthreads,
 	OPT_malloc_threshold,
 	OPT_malloc_touch,
+	OPT_malloc_trace,
 	OPT_malloc_trim,
 	OPT_malloc_zerofree,
 
@@ -756,6 +787,10 @@ typedef enum {
 	OPT_metamix,
 	OPT_metamix_ops,
 	OPT_metamix_bytes,
+	OPT_metamix_bench,
+	OPT_metamix_files,
+	OPT_metamix_shared,
+	OPT_metamix_workers,
 
 	OPT_metrics_brief,
 
@@ -812,6 +847,8 @@ typedef enum {
 	OPT_mmapfork_ops,
 
 	OPT_mmaphuge,
+	OPT_mmaphuge_bench,
+	OPT_mmaphuge_bench_bytes,
 	OPT_mmaphuge_file,
 	OPT_mmaphuge_mlock,
 	OPT_mmaphuge_mmaps,
@@ -901,6 +938,7 @@ typedef enum {
 
 	OPT_numa,
 	OPT_numa_bytes,
+	OPT_numa_matrix,
 	OPT_numa_ops,
 	OPT_numa_shuffle_addr,
 	OPT_numa_shuffle_node,
@@ -919,6 +957,8 @@ typedef enum {
 	OPT_open_ops,
 	OPT_open_fd,
 	OPT_open_max,
+	OPT_open_threads,
+	OPT_open_clone_files,
 
 	OPT_page_in,
 	OPT_pathological,
@@ -1059,6 +1099,7 @@ typedef enum {
 	OPT_readahead,
 	OPT_readahead_ops,
 	OPT_readahead_bytes,
+	OPT_readahead_streams,
 
 	OPT_reboot,
 	OPT_reboot_ops,
@@ -1073,6 +1114,9 @@ typedef enum {
 
 	OPT_rename_ops,
 
+	OPT_repeat,
+	OPT_repeat_warmup,
+
 	OPT_resched,
 	OPT_resched_ops,
 
@@ -1287,6 +1331,10 @@ typedef enum {
 
 	OPT_swap,
 	OPT_swap_ops,
+	OPT_swap_bytes,
+	OPT_swap_compress,
+	OPT_swap_pageout,
+	OPT_swap_throughput,
 
 	OPT_switch_ops,
 	OPT_switch_freq,
@@ -1400,6 +1448,7 @@ typedef enum {
 	OPT_time_warp_ops,
 
 	OPT_tlb_shootdown,
+	OPT_tlb_shootdown_measure,
 	OPT_tlb_shootdown_ops,
 
 	OPT_tmpfs,
@@ -1441,6 +1490,11 @@ typedef enum {
 	OPT_udp_lite,
 	OPT_udp_gro,
 	OPT_udp_if,
+	OPT_udp_batch,
+	OPT_udp_gso,
+	OPT_udp_sockets,
+	OPT_udp_rcvbuf,
+	OPT_udp_sndbuf,
 
 	OPT_udp_flood,
 	OPT_udp_flood_ops,
@@ -1460,7 +1514,11 @@ typedef enum {
 
 	OPT_userfaultfd,
 	OPT_userfaultfd_ops,
+	OPT_userfaultfd_batch,
 	OPT_userfaultfd_bytes,
+	OPT_userfaultfd_fault_threads,
+	OPT_userfaultfd_handler_threads,
+	OPT_userfaultfd_mode,
 
 	OPT_usersyscall,
 	OPT_usersyscall_ops,
@@ -1510,6 +1568,7 @@ typedef enum {
 	OPT_vm_ops,
 	OPT_vm_madvise,
 	OPT_vm_method,
+	OPT_vm_threads,
 
 	OPT_vm_addr,
 	OPT_vm_addr_method,
@@ -1519,6 +1578,8 @@ typedef enum {
 	OPT_vm_rw,
 	OPT_vm_rw_ops,
 	OPT_vm_rw_bytes,
+	OPT_vm_rw_compare,
+	OPT_vm_rw_iovecs,
 
 	OPT_vm_segv,
 	OPT_vm_segv_ops,
@@ -1543,6 +1604,14 @@ typedef enum {
 	OPT_waitcpu,
 	OPT_waitcpu_ops,
 
+	OPT_wal,
+	OPT_wal_ops,
+	OPT_wal_files,
+	OPT_wal_group_commit,
+	OPT_wal_method,
+	OPT_wal_record,
+	OPT_wal_threads,
+
 	OPT_watchdog,
 	OPT_watchdog_ops,
 
@@ -631,6 +631,65 @@ out_ok:
 	return 0;
 }
 
+/*
+ *  stress_perf_event_open_by_label()
+ *	open and enable a single perf counter for the calling
+ *	process using the human readable label of the counter,
+ *	e.g. "Cache DTLB Read Miss", returns fd or -1 on failure.
+ *	If user_only is false kernel events are counted too and
+ *	the events of child processes are inherited.
+ */
+int stress_perf_event_open_by_label(const char *label, const bool user_only)
+{
+	struct perf_event_attr attr;
+	size_t i;
+
+	for (i = 0; (i < STRESS_PERF_MAX) && perf_info[i].label; i++) {
+		if (!strcmp(perf_info[i].label, label))
+			break;
+	}
+	if ((i >= STRESS_PERF_MAX) || !perf_info[i].label ||
+	    (perf_info[i].config == UNRESOLVED)) {
+		errno = ENOENT;
+		return -1;
+	}
+
+	(void)shim_memset(&attr, 0, sizeof(attr));
+	attr.type = perf_info[i].type;
+	attr.config = perf_info[i].config;
+	attr.disabled = 0;
+	attr.inherit = !user_only;
+	attr.exclude_kernel = user_only;
+	attr.exclude_hv = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+			   PERF_FORMAT_TOTAL_TIME_RUNNING;
+	attr.size = sizeof(attr);
+
+	return stress_sys_perf_event_open(&attr, 0, -1, -1, 0);
+}
+
+/*
+ *  stress_perf_event_read()
+ *	read a perf counter opened by stress_perf_event_open_by_label,
+ *	scaled for counter multiplexing
+ */
+int stress_perf_event_read(const int fd, uint64_t *counter)
+{
+	stress_perf_data_t data;
+	double scale;
+
+	(void)shim_memset(&data, 0, sizeof(data));
+	if (read(fd, &data, sizeof(data)) != sizeof(data))
+		return -1;
+	if (data.time_running == 0)
+		scale = (data.time_enabled == 0) ? 1.0 : 0.0;
+	else
+		scale = (double)data.time_enabled / (double)data.time_running;
+	*counter = (uint64_t)((double)data.counter * scale);
+
+	return 0;
+}
+
 /*
  *  stress_perf_stat_succeeded()
  *	did perf event open work OK?
@@ -2793,3 +2793,24 @@ unsigned char shim_dirent_type(const char *path, const struct dirent *d)
 	}
 	return SHIM_DT_UNKNOWN;
 }
+
+/*
+ *  shim_cachestat()
+ *	system call wrapper for Linux 6.5 cachestat
+ */
+int shim_cachestat(
+	int fd,
+	struct shim_cachestat_range *cstat_range,
+	struct shim_cachestat *cstat,
+	unsigned int flags)
+{
+#if defined(__NR_cachestat) &&	\
+    defined(HAVE_SYSCALL)
+	return (int)syscall(__NR_cachestat, (unsigned long)fd,
+			(unsigned long)cstat_range,
+			(unsigned long)cstat,
+			(unsigned long)flags);
+#else
+	return (int)shim_enosys(0, fd, cstat_range, cstat, flags);
+#endif
+}
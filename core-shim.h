@@ -142,6 +142,20 @@ struct shim_futex_waitv {
 	uint32_t reserved;
 };
 
+/* cachestat shim */
+struct shim_cachestat_range {
+	uint64_t off;
+	uint64_t len;
+};
+
+struct shim_cachestat {
+	uint64_t nr_cache;
+	uint64_t nr_dirty;
+	uint64_t nr_writeback;
+	uint64_t nr_evicted;
+	uint64_t nr_recently_evicted;
+};
+
 /*
  *  shim'd abstracted system or library calls
  *  that have a layer of OS abstraction
@@ -467,5 +481,7 @@ extern int shim_fstat(int fd, struct stat *statbuf);
 extern int shim_lstat(const char *pathname, struct stat *statbuf);
 extern int shim_stat(const char *pathname, struct stat *statbuf);
 extern unsigned char shim_dirent_type(const char *path, const struct dirent *d);
+extern int shim_cachestat(int fd, struct shim_cachestat_range *cstat_range,
+	struct shim_cachestat *cstat, unsigned int flags);
 
 #endif
@@ -45,6 +45,7 @@
 	MACRO(bsearch)		\
 	MACRO(cache)		\
 	MACRO(cacheline)	\
+	MACRO(cachestat)	\
 	MACRO(cap)		\
 	MACRO(cgroup)		\
 	MACRO(chattr)		\
@@ -344,6 +345,7 @@
 	MACRO(vnni)		\
 	MACRO(wait)		\
 	MACRO(waitcpu)		\
+	MACRO(wal)		\
 	MACRO(watchdog)		\
 	MACRO(wcs)		\
 	MACRO(workload)		\
@@ -109,6 +109,23 @@ double OPTIMIZE3 stress_time_now(void)
 	return -1.0;
 }
 
+/*
+ *  stress_time_now_ns()
+ *	monotonic time in nanoseconds, for timing short operations
+ *	where stress_time_now() is not fine grained enough
+ */
+uint64_t OPTIMIZE3 stress_time_now_ns(void)
+{
+#if defined(HAVE_CLOCK_GETTIME) &&	\
+    defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+
+	if (LIKELY(clock_gettime(CLOCK_MONOTONIC, &ts) == 0))
+		return ((uint64_t)ts.tv_sec * STRESS_NANOSECOND) + (uint64_t)ts.tv_nsec;
+#endif
+	return (uint64_t)(stress_time_now() * STRESS_DBL_NANOSECOND);
+}
+
 /*
  *  stress_format_time()
  *	format a unit of time into human readable format
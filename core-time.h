@@ -22,6 +22,7 @@
 extern double stress_timeval_to_double(const struct timeval *tv);
 extern double stress_timespec_to_double(const struct timespec *ts);
 extern double stress_time_now(void);
+extern uint64_t stress_time_now_ns(void);
 extern const char *stress_duration_to_str(const double duration, const bool int_secs);
 
 #endif
@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-attribute.h"
 #include "core-builtin.h"
+#include "core-cpu-cache.h"
 
 #if defined(HAVE_LIBAIO_H)
 #include <libaio.h>
@@ -33,11 +34,20 @@
 #define MAX_AIO_LINUX_REQUESTS		(4096)
 #define DEFAULT_AIO_LINUX_REQUESTS	(64)
 
+#define MIN_AIOL_DEPTH			(1)
+#define MAX_AIOL_DEPTH			(4096)
+
+#define MIN_AIOL_BS			(512)
+#define MAX_AIOL_BS			(1 * MB)
+
 #define BUFFER_SZ			(4096)
 #define DEFAULT_AIO_MAX_NR		(65536)
 
 static const stress_help_t help[] = {
 	{ NULL,	"aiol N",	   "start N workers that exercise Linux async I/O" },
+	{ NULL,	"aiol-batch N",	   "--aiol-depth io_getevents batch min_nr (default depth / 4)" },
+	{ NULL,	"aiol-bs N",	   "--aiol-depth I/O block size (default 4K)" },
+	{ NULL,	"aiol-depth N",	   "compare completion reaping with N O_DIRECT reads in flight" },
 	{ NULL,	"aiol-ops N",	   "stop after N bogo Linux aio async I/O requests" },
 	{ NULL,	"aiol-requests N", "number of Linux aio async I/O requests per worker" },
 	{ NULL,	NULL,		   NULL }
@@ -53,7 +63,44 @@ static int stress_set_aio_linux_requests(const char *opt)
 	return stress_set_setting("aiol-requests", TYPE_ID_UINT32, &aio_linux_requests);
 }
 
+static int stress_set_aiol_depth(const char *opt)
+{
+	size_t aiol_depth;
+
+	aiol_depth = (size_t)stress_get_uint64(opt);
+	stress_check_range("aiol-depth", (uint64_t)aiol_depth,
+		MIN_AIOL_DEPTH, MAX_AIOL_DEPTH);
+	return stress_set_setting("aiol-depth", TYPE_ID_SIZE_T, &aiol_depth);
+}
+
+static int stress_set_aiol_bs(const char *opt)
+{
+	size_t aiol_bs;
+
+	aiol_bs = (size_t)stress_get_uint64_byte(opt);
+	stress_check_range_bytes("aiol-bs", (uint64_t)aiol_bs,
+		MIN_AIOL_BS, MAX_AIOL_BS);
+	if (aiol_bs & (aiol_bs - 1)) {
+		(void)fprintf(stderr, "aiol-bs must be a power of 2\n");
+		return -1;
+	}
+	return stress_set_setting("aiol-bs", TYPE_ID_SIZE_T, &aiol_bs);
+}
+
+static int stress_set_aiol_batch(const char *opt)
+{
+	size_t aiol_batch;
+
+	aiol_batch = (size_t)stress_get_uint64(opt);
+	stress_check_range("aiol-batch", (uint64_t)aiol_batch,
+		MIN_AIOL_DEPTH, MAX_AIOL_DEPTH);
+	return stress_set_setting("aiol-batch", TYPE_ID_SIZE_T, &aiol_batch);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_aiol_batch,	stress_set_aiol_batch },
+	{ OPT_aiol_bs,		stress_set_aiol_bs },
+	{ OPT_aiol_depth,	stress_set_aiol_depth },
 	{ OPT_aiol_requests,	stress_set_aio_linux_requests },
 	{ 0,			NULL }
 };
@@ -356,6 +403,417 @@ static void stress_aiol_free(
 	free(iov);
 }
 
+/*
+ *  Kernel's aio completion ring, the io_context_t handle is the
+ *  address of this ring mapped into the process, cf. fs/aio.c
+ */
+struct stress_aio_ring {
+	unsigned int	id;
+	unsigned int	nr;		/* number of io_events */
+	volatile unsigned int head;	/* written by user space when reaping */
+	volatile unsigned int tail;	/* written by the kernel on completion */
+	unsigned int	magic;
+	unsigned int	compat_features;
+	unsigned int	incompat_features;
+	unsigned int	header_length;	/* size of aio_ring */
+	struct io_event	io_events[];
+};
+
+#define AIOL_BENCH_RING_MAGIC		(0xa10a10a1)
+#define AIOL_BENCH_SLOT			(1.0)	/* seconds per reap method */
+#define AIOL_BENCH_FILE_SIZE		(64 * MB)
+#define AIOL_BENCH_FILL_SIZE		(MAX_AIOL_BS)	/* file fill write size */
+
+#define AIOL_REAP_GETEVENTS		(0)	/* io_getevents, min_nr = 1 */
+#define AIOL_REAP_GETEVENTS_BATCH	(1)	/* io_getevents, min_nr = --aiol-batch */
+#define AIOL_REAP_RING			(2)	/* user space ring reaping */
+#define AIOL_REAP_METHODS		(3)
+
+/* per reap method totals */
+typedef struct {
+	uint64_t ios;			/* completed I/Os */
+	uint64_t syscalls;		/* io_submit and io_getevents calls */
+	uint64_t lat_total_ns;		/* sum of completion latencies */
+	uint64_t lat_max_ns;		/* maximum completion latency */
+	double duration;		/* run time */
+	bool available;
+} stress_aiol_bench_t;
+
+static const char * const aiol_reap_names[AIOL_REAP_METHODS] = {
+	"getevents",
+	"getevents-batch",
+	"ring",
+};
+
+/*
+ *  stress_aiol_ring_reap()
+ *	reap up to nr completions directly from the aio ring, no
+ *	system call required. This is safe as there is just one
+ *	reaper per context.
+ */
+static inline int OPTIMIZE3 stress_aiol_ring_reap(
+	struct stress_aio_ring *ring,
+	struct io_event *events,
+	const long nr)
+{
+	unsigned int head = ring->head;
+	int n = 0;
+
+	while (n < nr) {
+		unsigned int tail;
+
+		/* acquire, the kernel fills an event before moving tail */
+#if defined(HAVE_ATOMIC_LOAD)
+		tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+#else
+		tail = ring->tail;
+		shim_mfence();
+#endif
+		if (head == tail)
+			break;
+		events[n++] = ring->io_events[head];
+		head = (head + 1) % ring->nr;
+	}
+	if (n) {
+		/* release, events must be copied before the slots are freed */
+#if defined(HAVE_ATOMIC_STORE)
+		__atomic_store_n(&ring->head, head, __ATOMIC_RELEASE);
+#else
+		shim_mfence();
+		ring->head = head;
+#endif
+	}
+	return n;
+}
+
+/*
+ *  stress_aiol_bench_prep()
+ *	set up a random block read, the block number is stashed in
+ *	the iocb data field for verification
+ */
+static inline void stress_aiol_bench_prep(
+	struct iocb *cb,
+	const int fd,
+	uint8_t *buf,
+	const size_t bs,
+	const uint64_t blocks)
+{
+	const uint64_t block = stress_mwc64modn(blocks);
+
+	(void)shim_memset(cb, 0, sizeof(*cb));
+	cb->aio_fildes = fd;
+	cb->aio_lio_opcode = IO_CMD_PREAD;
+	cb->data = (void *)(uintptr_t)block;
+	cb->u.c.buf = buf;
+	cb->u.c.offset = (long long)(block * bs);
+	cb->u.c.nbytes = bs;
+}
+
+/*
+ *  stress_aiol_bench_run()
+ *	keep depth random reads in flight for AIOL_BENCH_SLOT seconds
+ *	using a given completion reap method, returns -1 on failure
+ */
+static int stress_aiol_bench_run(
+	stress_args_t *args,
+	const io_context_t ctx,
+	const int fd,
+	const int method,
+	const size_t depth,
+	const long batch,
+	const size_t bs,
+	const uint64_t blocks,
+	uint8_t *buffer,
+	struct iocb *cb,
+	struct iocb **cbs,
+	struct io_event *events,
+	uint64_t *submit_ns,
+	stress_aiol_bench_t *bench)
+{
+	struct stress_aio_ring *ring = (struct stress_aio_ring *)ctx;
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	const long min_nr = (method == AIOL_REAP_GETEVENTS) ? 1 : batch;
+	size_t i, inflight = 0;
+	uint64_t ios = 0, syscalls = 0, lat_total_ns = 0, lat_max_ns = 0;
+	double t;
+	int rc = 0;
+
+	for (i = 0; i < depth; i++) {
+		stress_aiol_bench_prep(&cb[i], fd, buffer + (i * bs), bs, blocks);
+		cbs[i] = &cb[i];
+	}
+
+	t = stress_time_now();
+	for (i = 0; i < depth; i++)
+		submit_ns[i] = stress_time_now_ns();
+	syscalls++;
+	if (stress_aiol_submit(args, ctx, cbs, depth, false) < 0)
+		return -1;
+	inflight = depth;
+
+	while (inflight > 0) {
+		const bool running = stress_continue_flag() &&
+				     (stress_time_now() - t < AIOL_BENCH_SLOT);
+		size_t n_submit = 0;
+		int n = 0;
+		uint64_t now;
+
+		if (method == AIOL_REAP_RING)
+			n = stress_aiol_ring_reap(ring, events, (long)inflight);
+		if (n == 0) {
+			/* nothing in the ring, or not ring reaping, so block */
+			syscalls++;
+			n = shim_io_getevents(ctx, running ? STRESS_MINIMUM(min_nr, (long)inflight) : (long)inflight,
+					(long)inflight, events, NULL);
+			if (n < 0) {
+				if (errno == EINTR)
+					continue;
+				pr_fail("%s: io_getevents failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				return -1;
+			}
+		}
+		now = stress_time_now_ns();
+		for (i = 0; i < (size_t)n; i++) {
+			struct iocb *obj = events[i].obj;
+			const size_t idx = (size_t)(obj - cb);
+			const uint64_t lat_ns = now - submit_ns[idx];
+
+			if ((size_t)events[i].res != bs) {
+				pr_fail("%s: %zu byte read completed with result %ld\n",
+					args->name, bs, (long)events[i].res);
+				rc = -1;
+			} else if (verify) {
+				const uint64_t block = (uint64_t)(uintptr_t)obj->data;
+
+				if (*(uint64_t *)obj->u.c.buf != block) {
+					pr_fail("%s: block %" PRIu64 " read back unexpected data\n",
+						args->name, block);
+					rc = -1;
+				}
+			}
+			lat_total_ns += lat_ns;
+			if (lat_ns > lat_max_ns)
+				lat_max_ns = lat_ns;
+			ios++;
+			inflight--;
+
+			if (running && (rc == 0)) {
+				stress_aiol_bench_prep(obj, fd, obj->u.c.buf, bs, blocks);
+				submit_ns[idx] = now;
+				cbs[n_submit++] = obj;
+			}
+		}
+		if (n_submit) {
+			syscalls++;
+			if (stress_aiol_submit(args, ctx, cbs, n_submit, false) < 0)
+				return -1;
+			inflight += n_submit;
+		}
+	}
+	t = stress_time_now() - t;
+
+	bench->ios += ios;
+	bench->syscalls += syscalls;
+	bench->lat_total_ns += lat_total_ns;
+	if (lat_max_ns > bench->lat_max_ns)
+		bench->lat_max_ns = lat_max_ns;
+	bench->duration += t;
+
+	stress_bogo_add(args, ios);
+	if (args->max_ops && (stress_bogo_get(args) > args->max_ops))
+		stress_bogo_set(args, args->max_ops);
+	return rc;
+}
+
+/*
+ *  stress_aiol_bench()
+ *	keep --aiol-depth random O_DIRECT reads of --aiol-bs bytes in
+ *	flight and compare reaping completions with io_getevents,
+ *	io_getevents batching and directly from the user space aio ring
+ */
+static int stress_aiol_bench(
+	stress_args_t *args,
+	const uint32_t aio_max_nr,
+	size_t depth)
+{
+	stress_aiol_bench_t bench[AIOL_REAP_METHODS];
+	size_t bs = 4096, i;
+	size_t batch_setting;
+	long batch;
+	uint64_t blocks, *submit_ns = NULL;
+	uint8_t *buffer = NULL, *block_buf = NULL;
+	struct iocb *cb = NULL, **cbs = NULL;
+	struct io_event *events = NULL;
+	io_context_t ctx = 0;
+	struct stress_aio_ring *ring;
+	char filename[PATH_MAX];
+	int fd, ret, m, rc = EXIT_SUCCESS, idx = 0;
+	bool direct = true;
+	off_t file_size;
+
+	(void)stress_get_setting("aiol-bs", &bs);
+	if (depth > aio_max_nr) {
+		depth = aio_max_nr;
+		if (args->instance == 0)
+			pr_inf("%s: limiting queue depth to %zu per stressor "
+				"(avoids running out of resources)\n",
+				args->name, depth);
+	}
+	batch_setting = STRESS_MAXIMUM(depth / 4, 1);
+	(void)stress_get_setting("aiol-batch", &batch_setting);
+	batch = (long)batch_setting;
+	if (batch > (long)depth)
+		batch = (long)depth;
+
+	file_size = (off_t)STRESS_MAXIMUM((uint64_t)AIOL_BENCH_FILE_SIZE, (uint64_t)(depth * bs));
+	blocks = (uint64_t)file_size / bs;
+
+	if (posix_memalign((void **)&buffer, 4096, depth * bs)) {
+		buffer = NULL;
+		goto no_mem;
+	}
+	if (posix_memalign((void **)&block_buf, 4096, AIOL_BENCH_FILL_SIZE)) {
+		block_buf = NULL;
+		goto no_mem;
+	}
+	cb = (struct iocb *)calloc(depth, sizeof(*cb));
+	cbs = (struct iocb **)calloc(depth, sizeof(*cbs));
+	events = (struct io_event *)calloc(depth, sizeof(*events));
+	submit_ns = (uint64_t *)calloc(depth, sizeof(*submit_ns));
+	if (!cb || !cbs || !events || !submit_ns)
+		goto no_mem;
+
+	if (shim_io_setup((unsigned int)depth, &ctx) < 0) {
+		pr_inf_skip("%s: io_setup failed, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto free_memory;
+	}
+	ring = (struct stress_aio_ring *)ctx;
+
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0) {
+		rc = stress_exit_status(-ret);
+		goto destroy;
+	}
+	(void)stress_temp_filename_args(args, filename, sizeof(filename), stress_mwc32());
+	fd = open(filename, O_CREAT | O_RDWR | O_DIRECT, S_IRUSR | S_IWUSR);
+	if ((fd < 0) && (errno == EINVAL)) {
+		direct = false;
+		fd = open(filename, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+	}
+	if (fd < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: open %s failed, errno=%d (%s)\n",
+			args->name, filename, errno, strerror(errno));
+		goto rm_dir;
+	}
+	(void)shim_unlink(filename);
+
+	/* fill the file, each block is tagged with its block number */
+	(void)shim_memset(block_buf, 0, AIOL_BENCH_FILL_SIZE);
+	for (i = 0; i < (size_t)blocks; i += AIOL_BENCH_FILL_SIZE / bs) {
+		size_t j;
+
+		for (j = 0; j < AIOL_BENCH_FILL_SIZE / bs; j++)
+			*(uint64_t *)(block_buf + (j * bs)) = (uint64_t)(i + j);
+		if (pwrite(fd, block_buf, AIOL_BENCH_FILL_SIZE, (off_t)(i * bs)) != (ssize_t)AIOL_BENCH_FILL_SIZE) {
+			pr_inf_skip("%s: cannot fill %jd byte file, errno=%d (%s), skipping stressor\n",
+				args->name, (intmax_t)file_size, errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			goto close_fd;
+		}
+		if (!stress_continue(args))
+			goto close_fd;
+	}
+	(void)shim_fsync(fd);
+
+	(void)shim_memset(bench, 0, sizeof(bench));
+	bench[AIOL_REAP_GETEVENTS].available = true;
+	bench[AIOL_REAP_GETEVENTS_BATCH].available = (batch > 1);
+	bench[AIOL_REAP_RING].available = (ring->magic == AIOL_BENCH_RING_MAGIC) &&
+					  (ring->incompat_features == 0);
+	if ((args->instance == 0) && !bench[AIOL_REAP_RING].available)
+		pr_inf("%s: unknown aio ring layout, skipping user space ring reaping\n",
+			args->name);
+	if (args->instance == 0)
+		pr_inf("%s: %zu x %zu byte random %sreads in flight, batch %ld\n",
+			args->name, depth, bs, direct ? "O_DIRECT " : "", batch);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (m = 0; m < AIOL_REAP_METHODS; m++) {
+			if (!bench[m].available)
+				continue;
+			if (!stress_continue(args))
+				break;
+			if (stress_aiol_bench_run(args, ctx, fd, m, depth, batch, bs, blocks,
+					buffer, cb, cbs, events, submit_ns, &bench[m]) < 0) {
+				rc = EXIT_FAILURE;
+				goto finish;
+			}
+		}
+	} while (stress_continue(args));
+finish:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if ((args->instance == 0) && (rc == EXIT_SUCCESS)) {
+		pr_block_begin();
+		pr_inf("%s: %-16s %12s %12s %14s %14s\n", args->name,
+			"reap method", "IOPS", "syscalls/IO", "mean lat (us)", "max lat (us)");
+		for (m = 0; m < AIOL_REAP_METHODS; m++) {
+			const stress_aiol_bench_t *b = &bench[m];
+
+			if (!b->ios || (b->duration <= 0.0))
+				continue;
+			pr_inf("%s: %-16s %12.0f %12.3f %14.2f %14.2f\n", args->name,
+				aiol_reap_names[m], (double)b->ios / b->duration,
+				(double)b->syscalls / (double)b->ios,
+				(double)b->lat_total_ns / (double)b->ios / 1000.0,
+				(double)b->lat_max_ns / 1000.0);
+		}
+		pr_block_end();
+	}
+	for (m = 0; m < AIOL_REAP_METHODS; m++) {
+		const stress_aiol_bench_t *b = &bench[m];
+		char str[64];
+
+		if (!b->ios || (b->duration <= 0.0))
+			continue;
+		(void)snprintf(str, sizeof(str), "%s IOPS", aiol_reap_names[m]);
+		stress_metrics_set(args, idx++, str,
+			(double)b->ios / b->duration, STRESS_HARMONIC_MEAN);
+		(void)snprintf(str, sizeof(str), "%s syscalls per I/O", aiol_reap_names[m]);
+		stress_metrics_set(args, idx++, str,
+			(double)b->syscalls / (double)b->ios, STRESS_GEOMETRIC_MEAN);
+		(void)snprintf(str, sizeof(str), "%s mean completion latency (us)", aiol_reap_names[m]);
+		stress_metrics_set(args, idx++, str,
+			(double)b->lat_total_ns / (double)b->ios / 1000.0, STRESS_GEOMETRIC_MEAN);
+	}
+
+close_fd:
+	(void)close(fd);
+rm_dir:
+	(void)stress_temp_dir_rm_args(args);
+destroy:
+	(void)shim_io_destroy(ctx);
+free_memory:
+	free(submit_ns);
+	free(events);
+	free(cbs);
+	free(cb);
+	free(block_buf);
+	free(buffer);
+	return rc;
+
+no_mem:
+	pr_inf_skip("%s: out of memory allocating buffers, skipping stressor\n",
+		args->name);
+	rc = EXIT_NO_RESOURCE;
+	goto free_memory;
+}
+
 /*
  *  stress_aiol
  *	stress asynchronous I/O using the linux specific aio ABI
@@ -378,6 +836,7 @@ static int stress_aiol(stress_args_t *args)
 	int j = 0;
 	size_t i;
 	int warnings = 0;
+	size_t aiol_depth;
 #if defined(__NR_io_cancel)
 	int bad_fd;
 #endif
@@ -407,6 +866,9 @@ static int stress_aiol(stress_args_t *args)
 	aio_max_nr /= (args->num_instances == 0) ? 1 : args->num_instances;
 	if (aio_max_nr < 1)
 		aio_max_nr = 1;
+
+	if (stress_get_setting("aiol-depth", &aiol_depth))
+		return stress_aiol_bench(args, aio_max_nr, aiol_depth);
 	if (aio_linux_requests > aio_max_nr) {
 		aio_linux_requests = aio_max_nr;
 		if (args->instance == 0)
@@ -366,6 +366,9 @@ static int stress_atomic_exercise(
 	stress_atomic_info_t *atomic_info)
 {
 	const int rounds = 1000;
+	stress_bogo_batch_t bb;
+
+	stress_bogo_batch_init(&bb, args, STRESS_BOGO_BATCH_DEFAULT);
 	do {
 		size_t i;
 
@@ -375,12 +378,15 @@ static int stress_atomic_exercise(
 
 			for (j = 0; j < rounds; j++) {
 				if (func(args, &atomic_info->metrics[i].duration,
-				     &atomic_info->metrics[i].count) < 0)
+				     &atomic_info->metrics[i].count) < 0) {
+					stress_bogo_batch_flush(&bb);
 					return -1;
+				}
 			}
 		}
-		stress_bogo_inc(args);
-	} while (stress_continue(args));
+		stress_bogo_batch_inc(&bb);
+	} while (stress_bogo_batch_continue(&bb));
+	stress_bogo_batch_flush(&bb);
 
 	return 0;
 }
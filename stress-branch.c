@@ -208,20 +208,22 @@ static int OPTIMIZE3 stress_branch(stress_args_t *args)
 	register uint32_t seed = 123456789;
 	register uint32_t idx = (seed >> 22);
 	register const void *label_next = labels[idx];
+	stress_bogo_batch_t bb;
 
 	for (i = 0; i < SIZEOF_ARRAY(counters); i++)
 		counters[i] = 0ULL;
 
+	stress_bogo_batch_init(&bb, args, STRESS_BOGO_BATCH_DEFAULT);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	for (;;) {
 L0x000:
-		stress_bogo_inc(args);
+		stress_bogo_batch_inc(&bb);
 #if defined(STRESS_ARCH_SH4)
 		/* For some reason, can't interrupt SH4 in QEMU, add yield to do so */
 		shim_sched_yield();
 #endif
-		if (!stress_continue(args))
+		if (!stress_bogo_batch_continue(&bb))
 			break;
 		RESEED_JMP(0x000)
 
@@ -369,6 +371,7 @@ L0x000:
 		J(0x3f0) J(0x3f1) J(0x3f2) J(0x3f3) J(0x3f4) J(0x3f5) J(0x3f6) J(0x3f7)
 		J(0x3f8) J(0x3f9) J(0x3fa) J(0x3fb) J(0x3fc) J(0x3fd) J(0x3fe) J(0x3ff)
 	}
+	stress_bogo_batch_flush(&bb);
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
 	bogo_counter = stress_bogo_get(args);
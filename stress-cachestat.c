@@ -0,0 +1,663 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+
+#define MIN_CACHESTAT_RATIO	(50)		/* % of physical memory */
+#define MAX_CACHESTAT_RATIO	(200)
+#define DEFAULT_CACHESTAT_RATIO	(100)
+
+#define CACHESTAT_MIN_BYTES	(16 * MB)	/* smallest working set */
+#define CACHESTAT_FILE_BYTES	(256 * MB)	/* largest file in the set */
+#define CACHESTAT_MAX_FILES	(64)
+#define CACHESTAT_FILL_BYTES	(1 * MB)
+#define CACHESTAT_BATCH		(64)		/* reads between time checks */
+#define CACHESTAT_PROBE_SHIFT	(3)		/* probe 1 in 8 reads */
+#define CACHESTAT_EPOCH		(1.0)		/* seconds per sample */
+#define CACHESTAT_PHASE		(30.0)		/* default secs per pattern */
+#define CACHESTAT_MAX_EPOCHS	(4096)
+#define CACHESTAT_ZIPF_THETA	(0.99)		/* YCSB style skew */
+
+#define CACHESTAT_PATTERN_ALL	(0)
+
+static const stress_help_t help[] = {
+	{ NULL,	"cachestat N",		"start N workers measuring page cache hit ratios" },
+	{ NULL,	"cachestat-ops N",	"stop after N cachestat bogo file reads" },
+	{ NULL,	"cachestat-pattern P",	"select access pattern, uniform, zipf, scan-hot or all" },
+	{ NULL,	"cachestat-ratio P",	"size working set to P% of physical memory (50..200)" },
+	{ NULL,	NULL,			NULL }
+};
+
+static const char * const cachestat_patterns[] = {
+	"all",
+	"uniform",
+	"zipf",
+	"scan-hot",
+};
+
+static int stress_set_cachestat_pattern(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(cachestat_patterns); i++) {
+		if (!strcmp(opt, cachestat_patterns[i]))
+			return stress_set_setting("cachestat-pattern", TYPE_ID_SIZE_T, &i);
+	}
+	(void)fprintf(stderr, "cachestat-pattern must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(cachestat_patterns); i++)
+		(void)fprintf(stderr, " %s", cachestat_patterns[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_cachestat_ratio(const char *opt)
+{
+	uint32_t cachestat_ratio;
+
+	cachestat_ratio = stress_get_uint32(opt);
+	stress_check_range("cachestat-ratio", (uint64_t)cachestat_ratio,
+		MIN_CACHESTAT_RATIO, MAX_CACHESTAT_RATIO);
+	return stress_set_setting("cachestat-ratio", TYPE_ID_UINT32, &cachestat_ratio);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_cachestat_pattern,	stress_set_cachestat_pattern },
+	{ OPT_cachestat_ratio,		stress_set_cachestat_ratio },
+	{ 0,				NULL }
+};
+
+#if defined(__linux__)
+
+/* system wide page cache reclaim counters from /proc/vmstat */
+typedef struct {
+	uint64_t refault;		/* file pages refaulted after eviction */
+	uint64_t steal;			/* file pages reclaimed */
+} stress_cachestat_vmstat_t;
+
+/* per pattern totals */
+typedef struct {
+	uint64_t reads;			/* pages read */
+	uint64_t probes;		/* pages probed with cachestat */
+	uint64_t hits;			/* probed pages that were cached */
+	uint64_t steady_probes;		/* probes in the second half */
+	uint64_t steady_hits;		/* hits in the second half */
+	uint64_t refaults;		/* system wide file refaults */
+	uint64_t evictions;		/* system wide file page reclaims */
+	uint64_t resident;		/* cached pages of set at end */
+	uint64_t recently_evicted;	/* recently evicted pages at end */
+	double duration;		/* time spent reading */
+} stress_cachestat_result_t;
+
+/* Zipfian rank generator state, rejection-inversion sampling */
+typedef struct {
+	double n;			/* number of elements */
+	double h_x1;			/* H(1.5) - 1 */
+	double h_n;			/* H(n + 0.5) */
+	double s;			/* acceptance threshold */
+} stress_cachestat_zipf_t;
+
+typedef struct {
+	int fds[CACHESTAT_MAX_FILES];	/* working set files */
+	size_t nfiles;			/* number of files */
+	uint64_t file_pages;		/* pages per file */
+	uint64_t pages;			/* pages in the working set */
+	uint64_t scatter;		/* prime to spread zipf ranks */
+	uint64_t hot_pages;		/* scan-hot hot set size */
+	uint64_t scan_page;		/* scan-hot scan position */
+	stress_cachestat_zipf_t zipf;
+	uint8_t *buf;			/* read buffer */
+	size_t page_size;
+} stress_cachestat_ctxt_t;
+
+/*
+ *  stress_cachestat_zipf_helper1()
+ *	log1p(x) / x, accurate near zero
+ */
+static inline double stress_cachestat_zipf_helper1(const double x)
+{
+	return (fabs(x) > 1E-8) ? log1p(x) / x : 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+}
+
+/*
+ *  stress_cachestat_zipf_helper2()
+ *	expm1(x) / x, accurate near zero
+ */
+static inline double stress_cachestat_zipf_helper2(const double x)
+{
+	return (fabs(x) > 1E-8) ? expm1(x) / x : 1.0 + x * 0.5 * (1.0 + x * (1.0 / 3.0) * (1.0 + 0.25 * x));
+}
+
+static inline double stress_cachestat_zipf_h(const double x)
+{
+	return exp(-CACHESTAT_ZIPF_THETA * log(x));
+}
+
+static inline double stress_cachestat_zipf_hint(const double x)
+{
+	const double log_x = log(x);
+
+	return stress_cachestat_zipf_helper2((1.0 - CACHESTAT_ZIPF_THETA) * log_x) * log_x;
+}
+
+static inline double stress_cachestat_zipf_hint_inv(const double x)
+{
+	double t = x * (1.0 - CACHESTAT_ZIPF_THETA);
+
+	if (t < -1.0)
+		t = -1.0;
+	return exp(stress_cachestat_zipf_helper1(t) * x);
+}
+
+static void stress_cachestat_zipf_init(stress_cachestat_zipf_t *zipf, const uint64_t n)
+{
+	zipf->n = (double)n;
+	zipf->h_x1 = stress_cachestat_zipf_hint(1.5) - 1.0;
+	zipf->h_n = stress_cachestat_zipf_hint(zipf->n + 0.5);
+	zipf->s = 2.0 - stress_cachestat_zipf_hint_inv(
+		stress_cachestat_zipf_hint(2.5) - stress_cachestat_zipf_h(2.0));
+}
+
+/*
+ *  stress_cachestat_zipf()
+ *	return a Zipf distributed rank 1..n, rank 1 being the most popular
+ */
+static uint64_t stress_cachestat_zipf(const stress_cachestat_zipf_t *zipf)
+{
+	for (;;) {
+		const double r = (double)stress_mwc32() / 4294967296.0;
+		const double u = zipf->h_n + r * (zipf->h_x1 - zipf->h_n);
+		const double x = stress_cachestat_zipf_hint_inv(u);
+		double k = floor(x + 0.5);
+
+		if (k < 1.0)
+			k = 1.0;
+		else if (k > zipf->n)
+			k = zipf->n;
+		if ((k - x <= zipf->s) ||
+		    (u >= stress_cachestat_zipf_hint(k + 0.5) - stress_cachestat_zipf_h(k)))
+			return (uint64_t)k;
+	}
+}
+
+/*
+ *  stress_cachestat_next_page()
+ *	select the next working set page for the given access pattern
+ */
+static uint64_t stress_cachestat_next_page(stress_cachestat_ctxt_t *ctxt, const size_t pattern)
+{
+	switch (pattern) {
+	default:
+	case 1:
+		/* uniform */
+		return stress_mwc64modn(ctxt->pages);
+	case 2:
+		/* zipf, popular ranks scattered across the set */
+		return ((stress_cachestat_zipf(&ctxt->zipf) - 1) * ctxt->scatter) % ctxt->pages;
+	case 3:
+		/* scan-hot, 80% hot set hits, 20% one-off sequential scan */
+		if (stress_mwc8modn(10) < 8)
+			return stress_mwc64modn(ctxt->hot_pages);
+		ctxt->scan_page++;
+		if (ctxt->scan_page >= ctxt->pages)
+			ctxt->scan_page = ctxt->hot_pages;
+		return ctxt->scan_page;
+	}
+}
+
+/*
+ *  stress_cachestat_read_vmstat()
+ *	fetch file page refault and reclaim counters, older kernels
+ *	don't have the _file variants so fall back to the totals
+ */
+static void stress_cachestat_read_vmstat(stress_cachestat_vmstat_t *vmstat)
+{
+	FILE *fp;
+	char buffer[128];
+	uint64_t refault = 0, refault_file = 0, steal = 0, steal_file = 0;
+	bool has_refault_file = false, has_steal_file = false;
+
+	vmstat->refault = 0;
+	vmstat->steal = 0;
+	fp = fopen("/proc/vmstat", "r");
+	if (!fp)
+		return;
+	while (fgets(buffer, sizeof(buffer), fp)) {
+		if (!strncmp(buffer, "workingset_refault_file ", 24)) {
+			refault_file = (uint64_t)strtoull(buffer + 24, NULL, 10);
+			has_refault_file = true;
+		} else if (!strncmp(buffer, "workingset_refault ", 19)) {
+			refault = (uint64_t)strtoull(buffer + 19, NULL, 10);
+		} else if (!strncmp(buffer, "pgsteal_file ", 13)) {
+			steal_file = (uint64_t)strtoull(buffer + 13, NULL, 10);
+			has_steal_file = true;
+		} else if (!strncmp(buffer, "pgsteal_kswapd ", 15)) {
+			steal += (uint64_t)strtoull(buffer + 15, NULL, 10);
+		} else if (!strncmp(buffer, "pgsteal_direct ", 15)) {
+			steal += (uint64_t)strtoull(buffer + 15, NULL, 10);
+		} else if (!strncmp(buffer, "pgsteal_khugepaged ", 19)) {
+			steal += (uint64_t)strtoull(buffer + 19, NULL, 10);
+		}
+	}
+	(void)fclose(fp);
+
+	vmstat->refault = has_refault_file ? refault_file : refault;
+	vmstat->steal = has_steal_file ? steal_file : steal;
+}
+
+/*
+ *  stress_cachestat_set()
+ *	sum cachestat over all the working set files
+ */
+static int stress_cachestat_set(const stress_cachestat_ctxt_t *ctxt, struct shim_cachestat *total)
+{
+	size_t i;
+
+	(void)shim_memset(total, 0, sizeof(*total));
+	for (i = 0; i < ctxt->nfiles; i++) {
+		struct shim_cachestat_range cstat_range;
+		struct shim_cachestat cstat;
+
+		cstat_range.off = 0;
+		cstat_range.len = 0;	/* to end of file */
+		if (shim_cachestat(ctxt->fds[i], &cstat_range, &cstat, 0) < 0)
+			return -1;
+		total->nr_cache += cstat.nr_cache;
+		total->nr_dirty += cstat.nr_dirty;
+		total->nr_writeback += cstat.nr_writeback;
+		total->nr_evicted += cstat.nr_evicted;
+		total->nr_recently_evicted += cstat.nr_recently_evicted;
+	}
+	return 0;
+}
+
+/*
+ *  stress_cachestat_lru()
+ *	report which page reclaim LRU scheme is in use
+ */
+static const char *stress_cachestat_lru(void)
+{
+	char buf[32];
+	unsigned long enabled;
+
+	(void)shim_memset(buf, 0, sizeof(buf));
+	if (stress_system_read("/sys/kernel/mm/lru_gen/enabled", buf, sizeof(buf)) < 1)
+		return "classic LRU";
+	enabled = strtoul(buf, NULL, 16);
+	return enabled ? "multi-gen LRU" : "classic LRU (multi-gen LRU disabled)";
+}
+
+/*
+ *  stress_cachestat_fill()
+ *	create and fill the working set files, then drop them from
+ *	the page cache so each run starts cold
+ */
+static int stress_cachestat_fill(
+	stress_args_t *args,
+	stress_cachestat_ctxt_t *ctxt,
+	const char *pathname)
+{
+	const uint64_t file_bytes = ctxt->file_pages * ctxt->page_size;
+	size_t i;
+
+	for (i = 0; i < ctxt->nfiles; i++) {
+		char filename[PATH_MAX], name[32];
+		uint64_t off;
+
+		(void)snprintf(name, sizeof(name), "cachestat-%zu", i);
+		(void)stress_mk_filename(filename, sizeof(filename), pathname, name);
+		ctxt->fds[i] = open(filename, O_CREAT | O_RDWR | O_TRUNC, S_IRUSR | S_IWUSR);
+		if (ctxt->fds[i] < 0) {
+			pr_fail("%s: open %s failed, errno=%d (%s)\n",
+				args->name, filename, errno, strerror(errno));
+			return EXIT_FAILURE;
+		}
+		(void)shim_unlink(filename);
+
+		for (off = 0; off < file_bytes; off += CACHESTAT_FILL_BYTES) {
+			if (!stress_continue(args))
+				return EXIT_SUCCESS;
+			stress_rndbuf(ctxt->buf, CACHESTAT_FILL_BYTES);
+			if (pwrite(ctxt->fds[i], ctxt->buf, CACHESTAT_FILL_BYTES, (off_t)off) != CACHESTAT_FILL_BYTES) {
+				if ((errno == ENOSPC) || (errno == EFBIG) || (errno == EDQUOT)) {
+					pr_inf_skip("%s: cannot create %" PRIu64 " MB working set, "
+						"errno=%d (%s), skipping stressor\n", args->name,
+						(ctxt->pages * ctxt->page_size) / (uint64_t)MB,
+						errno, strerror(errno));
+					return EXIT_NO_RESOURCE;
+				}
+				pr_fail("%s: write failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				return EXIT_FAILURE;
+			}
+		}
+		(void)shim_fdatasync(ctxt->fds[i]);
+#if defined(HAVE_POSIX_FADVISE) &&	\
+    defined(POSIX_FADV_DONTNEED)
+		(void)posix_fadvise(ctxt->fds[i], 0, (off_t)file_bytes, POSIX_FADV_DONTNEED);
+#endif
+	}
+	return EXIT_SUCCESS;
+}
+
+/*
+ *  stress_cachestat_run()
+ *	read the working set with the given access pattern until the end
+ *	of the phase, sampling hit ratio, refaults and evictions each epoch
+ */
+static int stress_cachestat_run(
+	stress_args_t *args,
+	stress_cachestat_ctxt_t *ctxt,
+	const size_t pattern,
+	const double phase,
+	stress_cachestat_result_t *result)
+{
+	stress_cachestat_vmstat_t vm_start, vm_prev, vm_now;
+	struct shim_cachestat total;
+	const double t_start = stress_time_now();
+	const double t_end = t_start + phase;
+	const double t_steady = t_start + (phase / 2.0);
+	double t_epoch = t_start;
+	uint32_t epoch = 0;
+	uint64_t probe_count = 0;
+
+	stress_cachestat_read_vmstat(&vm_start);
+	vm_prev = vm_start;
+
+	if (args->instance == 0)
+		pr_dbg("%s: %s: %5s %8s %7s %10s %10s %9s\n", args->name,
+			cachestat_patterns[pattern], "secs", "MB/s", "hit %",
+			"refaults/s", "evicts/s", "cached %");
+
+	while ((epoch < CACHESTAT_MAX_EPOCHS) && stress_continue(args)) {
+		const double t_epoch_end = t_epoch + CACHESTAT_EPOCH;
+		uint64_t reads = 0, probes = 0, hits = 0;
+		double t_now;
+		bool steady;
+
+		do {
+			int i;
+
+			for (i = 0; i < CACHESTAT_BATCH; i++) {
+				const uint64_t page = stress_cachestat_next_page(ctxt, pattern);
+				const size_t f = (size_t)(page / ctxt->file_pages);
+				const off_t off = (off_t)((page % ctxt->file_pages) * ctxt->page_size);
+
+				/* probe residency before the read faults the page in */
+				if ((probe_count++ & ((1U << CACHESTAT_PROBE_SHIFT) - 1)) == 0) {
+					struct shim_cachestat_range cstat_range;
+					struct shim_cachestat cstat;
+
+					cstat_range.off = (uint64_t)off;
+					cstat_range.len = (uint64_t)ctxt->page_size;
+					if (shim_cachestat(ctxt->fds[f], &cstat_range, &cstat, 0) == 0) {
+						probes++;
+						hits += (cstat.nr_cache > 0);
+					}
+				}
+				if (UNLIKELY(pread(ctxt->fds[f], ctxt->buf, ctxt->page_size, off) < 0)) {
+					if (errno == EINTR)
+						break;
+					pr_fail("%s: pread failed, errno=%d (%s)\n",
+						args->name, errno, strerror(errno));
+					return EXIT_FAILURE;
+				}
+				reads++;
+			}
+			stress_bogo_add(args, (uint64_t)i);
+			t_now = stress_time_now();
+		} while ((t_now < t_epoch_end) && (t_now < t_end) && stress_continue(args));
+
+		steady = (t_epoch >= t_steady);
+		result->reads += reads;
+		result->probes += probes;
+		result->hits += hits;
+		if (steady) {
+			result->steady_probes += probes;
+			result->steady_hits += hits;
+		}
+
+		stress_cachestat_read_vmstat(&vm_now);
+		if ((args->instance == 0) && (stress_cachestat_set(ctxt, &total) == 0)) {
+			const double dt = t_now - t_epoch;
+
+			pr_dbg("%s: %s: %5.1f %8.2f %7.2f %10.1f %10.1f %9.2f\n",
+				args->name, cachestat_patterns[pattern],
+				t_now - t_start,
+				(dt > 0.0) ? ((double)(reads * ctxt->page_size) / dt) / (double)MB : 0.0,
+				probes ? 100.0 * (double)hits / (double)probes : 0.0,
+				(dt > 0.0) ? (double)(vm_now.refault - vm_prev.refault) / dt : 0.0,
+				(dt > 0.0) ? (double)(vm_now.steal - vm_prev.steal) / dt : 0.0,
+				100.0 * (double)total.nr_cache / (double)ctxt->pages);
+		}
+		vm_prev = vm_now;
+		t_epoch = t_now;
+		epoch++;
+		if (t_now >= t_end)
+			break;
+	}
+	result->duration += t_epoch - t_start;
+	result->refaults += vm_prev.refault - vm_start.refault;
+	result->evictions += vm_prev.steal - vm_start.steal;
+	if (stress_cachestat_set(ctxt, &total) == 0) {
+		result->resident = total.nr_cache;
+		result->recently_evicted = total.nr_recently_evicted;
+	}
+	return EXIT_SUCCESS;
+}
+
+/*
+ *  stress_cachestat()
+ *	read a file set sized around physical memory with uniform,
+ *	Zipfian and scan plus hot set access patterns and measure the
+ *	page cache hit ratio, refaults and eviction rate
+ */
+static int stress_cachestat(stress_args_t *args)
+{
+	stress_cachestat_ctxt_t ctxt;
+	stress_cachestat_result_t results[SIZEOF_ARRAY(cachestat_patterns)];
+	struct shim_cachestat total;
+	char pathname[PATH_MAX];
+	uint32_t cachestat_ratio = DEFAULT_CACHESTAT_RATIO;
+	size_t cachestat_pattern = CACHESTAT_PATTERN_ALL;
+	size_t i, first, last, pattern;
+	uint64_t ws_bytes, fs_bytes, file_bytes;
+	double phase;
+	int ret, rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("cachestat-pattern", &cachestat_pattern);
+	if (!stress_get_setting("cachestat-ratio", &cachestat_ratio)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			cachestat_ratio = MAX_CACHESTAT_RATIO;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			cachestat_ratio = MIN_CACHESTAT_RATIO;
+	}
+
+	(void)shim_memset(&ctxt, 0, sizeof(ctxt));
+	(void)shim_memset(results, 0, sizeof(results));
+	for (i = 0; i < CACHESTAT_MAX_FILES; i++)
+		ctxt.fds[i] = -1;
+	ctxt.page_size = args->page_size;
+
+	/* working set is a share of physical memory, bounded by free space */
+	ws_bytes = (stress_get_phys_mem_size() / 100) * cachestat_ratio;
+	ws_bytes /= args->num_instances;
+	fs_bytes = ((stress_get_filesystem_size() / 10) * 9) / args->num_instances;
+	if (fs_bytes && (ws_bytes > fs_bytes)) {
+		if (args->instance == 0)
+			pr_inf("%s: file system too small for a %" PRIu64 " MB working set, "
+				"using %" PRIu64 " MB\n", args->name,
+				ws_bytes / (uint64_t)MB, fs_bytes / (uint64_t)MB);
+		ws_bytes = fs_bytes;
+	}
+	if (ws_bytes < CACHESTAT_MIN_BYTES)
+		ws_bytes = CACHESTAT_MIN_BYTES;
+	ctxt.nfiles = (size_t)((ws_bytes + CACHESTAT_FILE_BYTES - 1) / CACHESTAT_FILE_BYTES);
+	if (ctxt.nfiles > CACHESTAT_MAX_FILES)
+		ctxt.nfiles = CACHESTAT_MAX_FILES;
+	file_bytes = (ws_bytes / ctxt.nfiles) & ~(uint64_t)(CACHESTAT_FILL_BYTES - 1);
+	if (file_bytes < CACHESTAT_FILL_BYTES)
+		file_bytes = CACHESTAT_FILL_BYTES;
+	ctxt.file_pages = file_bytes / ctxt.page_size;
+	ctxt.pages = ctxt.file_pages * ctxt.nfiles;
+	ctxt.hot_pages = STRESS_MAXIMUM(ctxt.pages / 10, 1);
+	ctxt.scan_page = ctxt.hot_pages;
+	ctxt.scatter = stress_get_next_prime64(ctxt.pages / 3 + 1);
+	while ((ctxt.pages % ctxt.scatter) == 0)
+		ctxt.scatter = stress_get_next_prime64(ctxt.scatter + 1);
+	stress_cachestat_zipf_init(&ctxt.zipf, ctxt.pages);
+
+	ctxt.buf = (uint8_t *)malloc(CACHESTAT_FILL_BYTES);
+	if (!ctxt.buf) {
+		pr_inf_skip("%s: cannot allocate %zu byte buffer, skipping stressor\n",
+			args->name, (size_t)CACHESTAT_FILL_BYTES);
+		return EXIT_NO_RESOURCE;
+	}
+
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0) {
+		free(ctxt.buf);
+		return stress_exit_status(-ret);
+	}
+	(void)stress_temp_dir_args(args, pathname, sizeof(pathname));
+
+	if (args->instance == 0)
+		pr_inf("%s: %zu x %" PRIu64 " MB files, %" PRIu64 " MB working set (%" PRIu32
+			"%% of memory) per instance, %s\n", args->name, ctxt.nfiles,
+			file_bytes / (uint64_t)MB, (ctxt.pages * ctxt.page_size) / (uint64_t)MB,
+			cachestat_ratio, stress_cachestat_lru());
+
+	rc = stress_cachestat_fill(args, &ctxt, pathname);
+	if ((rc != EXIT_SUCCESS) || !stress_continue(args))
+		goto tidy;
+
+	if (stress_cachestat_set(&ctxt, &total) < 0) {
+		if (errno == ENOSYS) {
+			pr_inf_skip("%s: cachestat system call not implemented, skipping stressor\n",
+				args->name);
+			rc = EXIT_NOT_IMPLEMENTED;
+		} else {
+			pr_fail("%s: cachestat failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+		}
+		goto tidy;
+	}
+
+	if (cachestat_pattern == CACHESTAT_PATTERN_ALL) {
+		first = 1;
+		last = SIZEOF_ARRAY(cachestat_patterns) - 1;
+	} else {
+		first = cachestat_pattern;
+		last = cachestat_pattern;
+	}
+	/* share the remaining run time between the patterns */
+	phase = CACHESTAT_PHASE;
+	if (g_opt_timeout > 0) {
+		phase = (args->time_end - stress_time_now()) / (double)(last - first + 1);
+		if (phase < 2.0 * CACHESTAT_EPOCH)
+			phase = 2.0 * CACHESTAT_EPOCH;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	pattern = first;
+	do {
+		rc = stress_cachestat_run(args, &ctxt, pattern, phase, &results[pattern]);
+		if (rc != EXIT_SUCCESS)
+			break;
+		/* drop the set so the next pattern starts cold too */
+#if defined(HAVE_POSIX_FADVISE) &&	\
+    defined(POSIX_FADV_DONTNEED)
+		for (i = 0; i < ctxt.nfiles; i++)
+			(void)posix_fadvise(ctxt.fds[i], 0, (off_t)file_bytes, POSIX_FADV_DONTNEED);
+#endif
+		pattern = (pattern >= last) ? first : pattern + 1;
+	} while (stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if ((args->instance == 0) && (rc == EXIT_SUCCESS)) {
+		pr_block_begin();
+		pr_inf("%s: %-8s %9s %7s %8s %11s %10s %9s %10s\n", args->name,
+			"pattern", "MB/s", "hit %", "steady %", "refaults/s",
+			"evicts/s", "cached %", "recent MB");
+		for (pattern = first; pattern <= last; pattern++) {
+			const stress_cachestat_result_t *r = &results[pattern];
+
+			if (r->duration <= 0.0)
+				continue;
+			pr_inf("%s: %-8s %9.2f %7.2f %8.2f %11.1f %10.1f %9.2f %10.1f\n",
+				args->name, cachestat_patterns[pattern],
+				((double)(r->reads * ctxt.page_size) / r->duration) / (double)MB,
+				r->probes ? 100.0 * (double)r->hits / (double)r->probes : 0.0,
+				r->steady_probes ? 100.0 * (double)r->steady_hits / (double)r->steady_probes : 0.0,
+				(double)r->refaults / r->duration,
+				(double)r->evictions / r->duration,
+				100.0 * (double)r->resident / (double)ctxt.pages,
+				(double)(r->recently_evicted * ctxt.page_size) / (double)MB);
+		}
+		pr_block_end();
+	}
+	for (i = 0, pattern = first; pattern <= last; pattern++) {
+		const stress_cachestat_result_t *r = &results[pattern];
+		char str[64];
+
+		if (r->duration <= 0.0)
+			continue;
+		(void)snprintf(str, sizeof(str), "MB per sec %s reads", cachestat_patterns[pattern]);
+		stress_metrics_set(args, i++, str,
+			((double)(r->reads * ctxt.page_size) / r->duration) / (double)MB,
+			STRESS_HARMONIC_MEAN);
+		(void)snprintf(str, sizeof(str), "%% page cache hits %s", cachestat_patterns[pattern]);
+		stress_metrics_set(args, i++, str,
+			r->probes ? 100.0 * (double)r->hits / (double)r->probes : 0.0,
+			STRESS_GEOMETRIC_MEAN);
+		(void)snprintf(str, sizeof(str), "refaults per sec %s", cachestat_patterns[pattern]);
+		stress_metrics_set(args, i++, str,
+			(double)r->refaults / r->duration, STRESS_GEOMETRIC_MEAN);
+		(void)snprintf(str, sizeof(str), "evictions per sec %s", cachestat_patterns[pattern]);
+		stress_metrics_set(args, i++, str,
+			(double)r->evictions / r->duration, STRESS_GEOMETRIC_MEAN);
+	}
+
+tidy:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	for (i = 0; i < ctxt.nfiles; i++) {
+		if (ctxt.fds[i] >= 0)
+			(void)close(ctxt.fds[i]);
+	}
+	(void)stress_temp_dir_rm_args(args);
+	free(ctxt.buf);
+
+	return rc;
+}
+
+stressor_info_t stress_cachestat_info = {
+	.stressor = stress_cachestat,
+	.class = CLASS_IO | CLASS_FILESYSTEM | CLASS_MEMORY,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#else
+stressor_info_t stress_cachestat_info = {
+	.stressor = stress_unimplemented,
+	.class = CLASS_IO | CLASS_FILESYSTEM | CLASS_MEMORY,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help,
+	.unimplemented_reason = "only supported on Linux"
+};
+#endif
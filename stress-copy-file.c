@@ -20,6 +20,14 @@
 #include "stress-ng.h"
 #include "core-builtin.h"
 
+#if defined(HAVE_LINUX_FS_H)
+#include <linux/fs.h>
+#endif
+
+#if defined(HAVE_SYS_SENDFILE_H)
+#include <sys/sendfile.h>
+#endif
+
 #define MIN_COPY_FILE_BYTES	(128 * MB)
 #define MAX_COPY_FILE_BYTES	(MAX_FILE_LIMIT)
 #define DEFAULT_COPY_FILE_BYTES	(256 * MB)
@@ -28,6 +36,7 @@
 static const stress_help_t help[] = {
 	{ NULL,	"copy-file N",		"start N workers that copy file data" },
 	{ NULL,	"copy-file-bytes N",	"specify size of file to be copied" },
+	{ NULL,	"copy-file-method M",	"compare copy mechanisms, M is copy-file-range, ficlone, etc or all" },
 	{ NULL,	"copy-file-ops N",	"stop after N copy bogo operations" },
 	{ NULL,	NULL,			NULL }
 
@@ -43,8 +52,36 @@ static int stress_set_copy_file_bytes(const char *opt)
 	return stress_set_setting("copy-file-bytes", TYPE_ID_UINT64, &copy_file_bytes);
 }
 
+static const char * const copy_file_method_names[] = {
+	"all",
+	"copy-file-range",
+	"ficlone",
+	"ficlonerange",
+	"sendfile",
+	"splice",
+	"mmap",
+	"read-write",
+	"direct",
+};
+
+static int stress_set_copy_file_method(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(copy_file_method_names); i++) {
+		if (!strcmp(opt, copy_file_method_names[i]))
+			return stress_set_setting("copy-file-method", TYPE_ID_SIZE_T, &i);
+	}
+	(void)fprintf(stderr, "copy-file-method must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(copy_file_method_names); i++)
+		(void)fprintf(stderr, " %s", copy_file_method_names[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_copy_file_bytes,	stress_set_copy_file_bytes },
+	{ OPT_copy_file_method,	stress_set_copy_file_method },
 	{ 0,			NULL }
 };
 
@@ -153,6 +190,478 @@ static int stress_copy_file_range_verify(
 	return 0;
 }
 
+#define COPY_FILE_BENCH_BYTES	(64 * MB)	/* default file size to copy */
+#define COPY_FILE_BENCH_FILL	(1 * MB)	/* fill and size granularity */
+#define COPY_FILE_BENCH_ALIGN	(4096)		/* O_DIRECT buffer alignment */
+#define COPY_FILE_BENCH_CHUNKS	(4)
+
+static const size_t copy_file_chunks[COPY_FILE_BENCH_CHUNKS] = {
+	4 * KB, 64 * KB, 1 * MB, 16 * MB
+};
+
+/* state shared by the copy methods */
+typedef struct {
+	int fd_in;			/* source */
+	int fd_out;			/* destination */
+	int fd_in_direct;		/* source, O_DIRECT */
+	int fd_out_direct;		/* destination, O_DIRECT */
+	int pipefds[2];			/* pipe for splice */
+	size_t pipe_size;		/* size of pipe */
+	uint8_t *buf;			/* copy buffer, largest chunk */
+	uint64_t size;			/* bytes to copy */
+} stress_copy_file_ctxt_t;
+
+/* copy ctxt->size bytes in chunk sized steps, 0 ok, 1 interrupted, -1 errno failure */
+typedef int (*stress_copy_file_func_t)(const stress_copy_file_ctxt_t *ctxt, const size_t chunk);
+
+typedef struct {
+	const char *name;		/* method name */
+	const stress_copy_file_func_t func;
+	const bool chunked;		/* false if chunk size is not used */
+} stress_copy_file_method_t;
+
+static int stress_copy_file_cfr(const stress_copy_file_ctxt_t *ctxt, const size_t chunk)
+{
+	shim_off64_t off_in = 0, off_out = 0;
+
+	while ((uint64_t)off_in < ctxt->size) {
+		const size_t sz = (size_t)STRESS_MINIMUM((uint64_t)chunk, ctxt->size - (uint64_t)off_in);
+		ssize_t n;
+
+		if (UNLIKELY(!stress_continue_flag()))
+			return 1;
+		n = shim_copy_file_range(ctxt->fd_in, &off_in, ctxt->fd_out, &off_out, sz, 0);
+		if (n <= 0)
+			return -1;
+	}
+	return 0;
+}
+
+#if defined(FICLONE)
+static int stress_copy_file_ficlone(const stress_copy_file_ctxt_t *ctxt, const size_t chunk)
+{
+	(void)chunk;
+
+	return (ioctl(ctxt->fd_out, FICLONE, ctxt->fd_in) < 0) ? -1 : 0;
+}
+#endif
+
+#if defined(FICLONERANGE)
+static int stress_copy_file_ficlonerange(const stress_copy_file_ctxt_t *ctxt, const size_t chunk)
+{
+	uint64_t off;
+
+	for (off = 0; off < ctxt->size; off += chunk) {
+		struct file_clone_range fcr;
+
+		if (UNLIKELY(!stress_continue_flag()))
+			return 1;
+		fcr.src_fd = (int64_t)ctxt->fd_in;
+		fcr.src_offset = off;
+		fcr.src_length = STRESS_MINIMUM((uint64_t)chunk, ctxt->size - off);
+		fcr.dest_offset = off;
+		if (ioctl(ctxt->fd_out, FICLONERANGE, &fcr) < 0)
+			return -1;
+	}
+	return 0;
+}
+#endif
+
+#if defined(HAVE_SENDFILE) &&	\
+    defined(HAVE_SYS_SENDFILE_H)
+static int stress_copy_file_sendfile(const stress_copy_file_ctxt_t *ctxt, const size_t chunk)
+{
+	off_t off_in = 0;
+
+	if (lseek(ctxt->fd_out, 0, SEEK_SET) < 0)
+		return -1;
+	while ((uint64_t)off_in < ctxt->size) {
+		const size_t sz = (size_t)STRESS_MINIMUM((uint64_t)chunk, ctxt->size - (uint64_t)off_in);
+
+		if (UNLIKELY(!stress_continue_flag()))
+			return 1;
+		if (sendfile(ctxt->fd_out, ctxt->fd_in, &off_in, sz) <= 0)
+			return -1;
+	}
+	return 0;
+}
+#endif
+
+#if defined(HAVE_SPLICE) &&	\
+    defined(SPLICE_F_MOVE)
+static int stress_copy_file_splice(const stress_copy_file_ctxt_t *ctxt, const size_t chunk)
+{
+	const size_t step = STRESS_MINIMUM(chunk, ctxt->pipe_size);
+	loff_t off_in = 0, off_out = 0;
+
+	while ((uint64_t)off_in < ctxt->size) {
+		const size_t sz = (size_t)STRESS_MINIMUM((uint64_t)step, ctxt->size - (uint64_t)off_in);
+		ssize_t n;
+
+		if (UNLIKELY(!stress_continue_flag()))
+			return 1;
+		n = splice(ctxt->fd_in, &off_in, ctxt->pipefds[1], NULL, sz, SPLICE_F_MOVE);
+		if (n <= 0)
+			return -1;
+		while (n > 0) {
+			const ssize_t m = splice(ctxt->pipefds[0], NULL, ctxt->fd_out, &off_out, (size_t)n, SPLICE_F_MOVE);
+
+			if (m <= 0)
+				return -1;
+			n -= m;
+		}
+	}
+	return 0;
+}
+#endif
+
+static int stress_copy_file_mmap(const stress_copy_file_ctxt_t *ctxt, const size_t chunk)
+{
+	/* map in chunk sized windows, at least a page */
+	const size_t page_size = stress_get_page_size();
+	const size_t step = STRESS_MAXIMUM(chunk, page_size);
+	uint64_t off;
+
+	if (ftruncate(ctxt->fd_out, (off_t)ctxt->size) < 0)
+		return -1;
+	for (off = 0; off < ctxt->size; off += step) {
+		const size_t sz = (size_t)STRESS_MINIMUM((uint64_t)step, ctxt->size - off);
+		void *src, *dst;
+
+		if (UNLIKELY(!stress_continue_flag()))
+			return 1;
+		src = mmap(NULL, sz, PROT_READ, MAP_SHARED, ctxt->fd_in, (off_t)off);
+		if (src == MAP_FAILED)
+			return -1;
+		dst = mmap(NULL, sz, PROT_WRITE, MAP_SHARED, ctxt->fd_out, (off_t)off);
+		if (dst == MAP_FAILED) {
+			(void)munmap(src, sz);
+			return -1;
+		}
+		(void)shim_memcpy(dst, src, sz);
+		(void)munmap(dst, sz);
+		(void)munmap(src, sz);
+	}
+	return 0;
+}
+
+static int stress_copy_file_rw_fds(const int fd_in, const int fd_out, uint8_t *buf, const uint64_t size, const size_t chunk)
+{
+	uint64_t off;
+
+	for (off = 0; off < size; off += chunk) {
+		const size_t sz = (size_t)STRESS_MINIMUM((uint64_t)chunk, size - off);
+		ssize_t n;
+
+		if (UNLIKELY(!stress_continue_flag()))
+			return 1;
+		n = pread(fd_in, buf, sz, (off_t)off);
+		if (n != (ssize_t)sz)
+			return -1;
+		n = pwrite(fd_out, buf, sz, (off_t)off);
+		if (n != (ssize_t)sz)
+			return -1;
+	}
+	return 0;
+}
+
+static int stress_copy_file_rw(const stress_copy_file_ctxt_t *ctxt, const size_t chunk)
+{
+	return stress_copy_file_rw_fds(ctxt->fd_in, ctxt->fd_out, ctxt->buf, ctxt->size, chunk);
+}
+
+#if defined(O_DIRECT)
+static int stress_copy_file_direct(const stress_copy_file_ctxt_t *ctxt, const size_t chunk)
+{
+	if ((ctxt->fd_in_direct < 0) || (ctxt->fd_out_direct < 0)) {
+		errno = EINVAL;
+		return -1;
+	}
+	return stress_copy_file_rw_fds(ctxt->fd_in_direct, ctxt->fd_out_direct, ctxt->buf, ctxt->size, chunk);
+}
+#endif
+
+static const stress_copy_file_method_t copy_file_methods[] = {
+	{ "copy-file-range",	stress_copy_file_cfr,		true },
+#if defined(FICLONE)
+	{ "ficlone",		stress_copy_file_ficlone,	false },
+#endif
+#if defined(FICLONERANGE)
+	{ "ficlonerange",	stress_copy_file_ficlonerange,	true },
+#endif
+#if defined(HAVE_SENDFILE) &&	\
+    defined(HAVE_SYS_SENDFILE_H)
+	{ "sendfile",		stress_copy_file_sendfile,	true },
+#endif
+#if defined(HAVE_SPLICE) &&	\
+    defined(SPLICE_F_MOVE)
+	{ "splice",		stress_copy_file_splice,	true },
+#endif
+	{ "mmap",		stress_copy_file_mmap,		true },
+	{ "read-write",		stress_copy_file_rw,		true },
+#if defined(O_DIRECT)
+	{ "direct",		stress_copy_file_direct,	true },
+#endif
+};
+
+#define COPY_FILE_METHODS	(SIZEOF_ARRAY(copy_file_methods))
+
+/* cumulative results for a method and chunk size */
+typedef struct {
+	double bytes;
+	double duration;
+	double cpu;
+} stress_copy_file_result_t;
+
+/*
+ *  stress_copy_file_cpu_time()
+ *	user + system time used by the process
+ */
+static double stress_copy_file_cpu_time(void)
+{
+#if defined(HAVE_GETRUSAGE) &&	\
+    defined(RUSAGE_SELF)
+	struct rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage) == 0)
+		return stress_timeval_to_double(&usage.ru_utime) +
+		       stress_timeval_to_double(&usage.ru_stime);
+#endif
+	return 0.0;
+}
+
+/*
+ *  stress_copy_file_bench()
+ *	copy the same file with a range of copy mechanisms and
+ *	chunk sizes, report GB/s and CPU seconds per GB for each
+ */
+static int stress_copy_file_bench(
+	stress_args_t *args,
+	const char *method,
+	const uint64_t size)
+{
+	stress_copy_file_result_t results[COPY_FILE_METHODS][COPY_FILE_BENCH_CHUNKS];
+	bool available[COPY_FILE_METHODS];
+	stress_copy_file_ctxt_t ctxt;
+	char filename[PATH_MAX - 5], name_in[PATH_MAX], name_out[PATH_MAX];
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	const char *fs_type;
+	size_t m, c, idx = 0;
+	uint64_t off;
+	int ret, rc = EXIT_SUCCESS;
+
+	for (m = 0; m < COPY_FILE_METHODS; m++) {
+		available[m] = !strcmp(method, "all") ||
+			       !strcmp(method, copy_file_methods[m].name);
+		if (available[m])
+			idx++;
+	}
+	if (idx == 0) {
+		pr_inf_skip("%s: copy method %s is not available in this build, skipping stressor\n",
+			args->name, method);
+		return EXIT_NO_RESOURCE;
+	}
+	idx = 0;
+
+	(void)shim_memset(&ctxt, 0, sizeof(ctxt));
+	ctxt.fd_in_direct = -1;
+	ctxt.fd_out_direct = -1;
+	ctxt.pipefds[0] = -1;
+	ctxt.pipefds[1] = -1;
+	ctxt.size = size;
+
+	ret = posix_memalign((void **)&ctxt.buf, COPY_FILE_BENCH_ALIGN,
+		copy_file_chunks[COPY_FILE_BENCH_CHUNKS - 1]);
+	if (ret || !ctxt.buf) {
+		pr_inf_skip("%s: cannot allocate copy buffer, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0) {
+		free(ctxt.buf);
+		return stress_exit_status(-ret);
+	}
+	(void)stress_temp_filename_args(args, filename, sizeof(filename), stress_mwc32());
+	(void)snprintf(name_in, sizeof(name_in), "%s-orig", filename);
+	(void)snprintf(name_out, sizeof(name_out), "%s-copy", filename);
+
+	ctxt.fd_in = open(name_in, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+	ctxt.fd_out = open(name_out, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+	if ((ctxt.fd_in < 0) || (ctxt.fd_out < 0)) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: open failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		goto tidy;
+	}
+	fs_type = stress_get_fs_type(name_in);
+
+	/* fill the source with random data */
+	for (off = 0; off < size; off += COPY_FILE_BENCH_FILL) {
+		stress_rndbuf(ctxt.buf, COPY_FILE_BENCH_FILL);
+		if (pwrite(ctxt.fd_in, ctxt.buf, COPY_FILE_BENCH_FILL, (off_t)off) != COPY_FILE_BENCH_FILL) {
+			pr_inf_skip("%s: cannot fill %" PRIu64 " byte file, errno=%d (%s), skipping stressor%s\n",
+				args->name, size, errno, strerror(errno), fs_type);
+			rc = EXIT_NO_RESOURCE;
+			goto tidy;
+		}
+		if (!stress_continue_flag())
+			goto tidy;
+	}
+	(void)shim_fsync(ctxt.fd_in);
+
+#if defined(O_DIRECT)
+	ctxt.fd_in_direct = open(name_in, O_RDONLY | O_DIRECT);
+	ctxt.fd_out_direct = open(name_out, O_WRONLY | O_DIRECT);
+#endif
+#if defined(HAVE_SPLICE)
+	if (pipe(ctxt.pipefds) == 0) {
+		ctxt.pipe_size = 64 * KB;
+#if defined(F_SETPIPE_SZ) &&	\
+    defined(F_GETPIPE_SZ)
+		(void)fcntl(ctxt.pipefds[1], F_SETPIPE_SZ, (int)(1 * MB));
+		ret = fcntl(ctxt.pipefds[1], F_GETPIPE_SZ);
+		if (ret > 0)
+			ctxt.pipe_size = (size_t)ret;
+#endif
+	}
+#endif
+
+	(void)shim_memset(results, 0, sizeof(results));
+	if (args->instance == 0)
+		pr_inf("%s: copying a %" PRIu64 " MB file%s\n", args->name, size / (uint64_t)MB, fs_type);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (m = 0; m < COPY_FILE_METHODS; m++) {
+			for (c = 0; available[m] && (c < COPY_FILE_BENCH_CHUNKS); c++) {
+				const stress_copy_file_method_t *cfm = &copy_file_methods[m];
+				double t, cpu;
+
+				if (!cfm->chunked && (c > 0))
+					break;
+				if (!stress_continue(args))
+					goto finish;
+
+				/* start from an empty destination */
+				if (ftruncate(ctxt.fd_out, 0) < 0) {
+					pr_fail("%s: ftruncate failed, errno=%d (%s)%s\n",
+						args->name, errno, strerror(errno), fs_type);
+					rc = EXIT_FAILURE;
+					goto finish;
+				}
+				cpu = stress_copy_file_cpu_time();
+				t = stress_time_now();
+				ret = cfm->func(&ctxt, copy_file_chunks[c]);
+				t = stress_time_now() - t;
+				cpu = stress_copy_file_cpu_time() - cpu;
+				if (ret > 0)
+					goto finish;
+				if (ret < 0) {
+					if ((errno == EOPNOTSUPP) || (errno == EXDEV) || (errno == EINVAL) ||
+					    (errno == ENOSYS) || (errno == ENOTTY) || (errno == EBADF)) {
+						if (args->instance == 0)
+							pr_inf("%s: %s not supported, errno=%d (%s)%s\n",
+								args->name, cfm->name, errno, strerror(errno), fs_type);
+						available[m] = false;
+						break;
+					}
+					if (errno == ENOSPC)
+						continue;
+					pr_fail("%s: %s copy failed, errno=%d (%s)%s\n",
+						args->name, cfm->name, errno, strerror(errno), fs_type);
+					rc = EXIT_FAILURE;
+					goto finish;
+				}
+				results[m][c].bytes += (double)size;
+				results[m][c].duration += t;
+				results[m][c].cpu += cpu;
+				stress_bogo_inc(args);
+
+				if (verify) {
+					shim_off64_t off_in, off_out;
+
+					off_in = (shim_off64_t)stress_mwc64modn(size - (uint64_t)COPY_FILE_MAX_BUF_SIZE * 16);
+					off_out = off_in;
+					if (stress_copy_file_range_verify(ctxt.fd_in, &off_in, ctxt.fd_out, &off_out,
+							COPY_FILE_MAX_BUF_SIZE * 16) < 0) {
+						pr_fail("%s: %s copy verify failed at offset %jd\n",
+							args->name, cfm->name, (intmax_t)off_in);
+						rc = EXIT_FAILURE;
+						goto finish;
+					}
+				}
+			}
+		}
+	} while (stress_continue(args));
+finish:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if ((args->instance == 0) && (rc == EXIT_SUCCESS)) {
+		pr_block_begin();
+		pr_inf("%s: %-16s %8s %10s %12s\n", args->name,
+			"method", "chunk", "GB/s", "CPU secs/GB");
+		for (m = 0; m < COPY_FILE_METHODS; m++) {
+			for (c = 0; c < COPY_FILE_BENCH_CHUNKS; c++) {
+				const stress_copy_file_result_t *r = &results[m][c];
+				char chunk[32];
+
+				if (r->duration <= 0.0)
+					continue;
+				if (copy_file_methods[m].chunked)
+					(void)snprintf(chunk, sizeof(chunk), "%zuK", (size_t)(copy_file_chunks[c] / KB));
+				else
+					(void)shim_strscpy(chunk, "-", sizeof(chunk));
+				pr_inf("%s: %-16s %8s %10.3f %12.4f\n", args->name,
+					copy_file_methods[m].name, chunk,
+					r->bytes / r->duration / (double)GB,
+					r->cpu / (r->bytes / (double)GB));
+			}
+		}
+		pr_block_end();
+	}
+	for (m = 0; m < COPY_FILE_METHODS; m++) {
+		for (c = 0; c < COPY_FILE_BENCH_CHUNKS; c++) {
+			const stress_copy_file_result_t *r = &results[m][c];
+			char str[96], chunk[32];
+
+			if (r->duration <= 0.0)
+				continue;
+			if (copy_file_methods[m].chunked)
+				(void)snprintf(chunk, sizeof(chunk), " %zuK chunks", (size_t)(copy_file_chunks[c] / KB));
+			else
+				*chunk = '\0';
+			(void)snprintf(str, sizeof(str), "GB/s %s%s",
+				copy_file_methods[m].name, chunk);
+			stress_metrics_set(args, idx++, str,
+				r->bytes / r->duration / (double)GB, STRESS_HARMONIC_MEAN);
+			(void)snprintf(str, sizeof(str), "CPU secs/GB %s%s",
+				copy_file_methods[m].name, chunk);
+			stress_metrics_set(args, idx++, str,
+				r->cpu / (r->bytes / (double)GB), STRESS_GEOMETRIC_MEAN);
+		}
+	}
+
+tidy:
+	if (ctxt.pipefds[0] >= 0)
+		(void)close(ctxt.pipefds[0]);
+	if (ctxt.pipefds[1] >= 0)
+		(void)close(ctxt.pipefds[1]);
+	if (ctxt.fd_in_direct >= 0)
+		(void)close(ctxt.fd_in_direct);
+	if (ctxt.fd_out_direct >= 0)
+		(void)close(ctxt.fd_out_direct);
+	if (ctxt.fd_out >= 0)
+		(void)close(ctxt.fd_out);
+	if (ctxt.fd_in >= 0)
+		(void)close(ctxt.fd_in);
+	(void)shim_unlink(name_out);
+	(void)shim_unlink(name_in);
+	(void)stress_temp_dir_rm_args(args);
+	free(ctxt.buf);
+
+	return rc;
+}
+
 /*
  *  stress_copy_file
  *	stress reading chunks of file using copy_file_range()
@@ -165,6 +674,18 @@ static int stress_copy_file(stress_args_t *args)
 	uint64_t copy_file_bytes = DEFAULT_COPY_FILE_BYTES;
 	double duration = 0.0, bytes = 0.0, rate;
 	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	size_t copy_file_method = 0;
+
+	if (stress_get_setting("copy-file-method", &copy_file_method)) {
+		uint64_t size = COPY_FILE_BENCH_BYTES;
+
+		if (stress_get_setting("copy-file-bytes", &copy_file_bytes))
+			size = copy_file_bytes / args->num_instances;
+		size &= ~(uint64_t)(COPY_FILE_BENCH_FILL - 1);
+		if (size < COPY_FILE_BENCH_FILL)
+			size = COPY_FILE_BENCH_FILL;
+		return stress_copy_file_bench(args, copy_file_method_names[copy_file_method], size);
+	}
 
 	if (!stress_get_setting("copy-file-bytes", &copy_file_bytes)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
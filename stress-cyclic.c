@@ -20,7 +20,9 @@
 #include "stress-ng.h"
 #include "core-builtin.h"
 #include "core-capabilities.h"
+#include "core-ftrace.h"
 #include "core-killpid.h"
+#include "core-pthread.h"
 
 #include <sched.h>
 
@@ -29,6 +31,12 @@
 #define DEFAULT_SAMPLES		(10000)
 #define MAX_BUCKETS		(250)
 
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_SCHED_GETAFFINITY) &&	\
+    defined(HAVE_SCHED_SETAFFINITY)
+#define HAVE_CYCLIC_PERCPU
+#endif
+
 typedef struct {
 	const int	policy;		/* scheduler policy */
 	const char	*name;		/* name of scheduler policy */
@@ -49,6 +57,8 @@ typedef struct {
 	double		latency_mean;	/* average latency */
 	int64_t		latency_mode;	/* first mode */
 	double		std_dev;	/* standard deviation */
+	int64_t		last_ns;	/* most recent latency */
+	uint64_t	breaches;	/* latencies over the threshold */
 } stress_rt_stats_t;
 
 typedef int (*stress_cyclic_func)(stress_args_t *args, stress_rt_stats_t *rt_stats, uint64_t cyclic_sleep);
@@ -63,10 +73,12 @@ static const stress_help_t help[] = {
 	{ NULL,	"cyclic-dist N",	"calculate distribution of interval N nanosecs" },
 	{ NULL,	"cyclic-method M",	"specify cyclic method M, default is clock_ns" },
 	{ NULL,	"cyclic-ops N",		"stop after N cyclic timing cycles" },
+	{ NULL,	"cyclic-percpu",	"run a measurement thread on each CPU" },
 	{ NULL,	"cyclic-policy P",	"used rr or fifo scheduling policy" },
 	{ NULL,	"cyclic-prio N",	"real time scheduling priority 1..100" },
 	{ NULL, "cyclic-samples N",	"number of latency samples to take" },
 	{ NULL,	"cyclic-sleep N",	"sleep time of real time timer in nanosecs" },
+	{ NULL,	"cyclic-threshold N",	"ftrace snapshot when latency exceeds N nanosecs" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -139,6 +151,21 @@ static int stress_set_cyclic_samples(const char *opt)
 	return stress_set_setting("cyclic-samples", TYPE_ID_SIZE_T, &cyclic_samples);
 }
 
+static int stress_set_cyclic_percpu(const char *opt)
+{
+	return stress_set_setting_true("cyclic-percpu", opt);
+}
+
+static int stress_set_cyclic_threshold(const char *opt)
+{
+	uint64_t cyclic_threshold;
+
+	cyclic_threshold = stress_get_uint64(opt);
+	stress_check_range("cyclic-threshold", cyclic_threshold,
+		1, STRESS_NANOSECOND);
+	return stress_set_setting("cyclic-threshold", TYPE_ID_UINT64, &cyclic_threshold);
+}
+
 #if (defined(HAVE_CLOCK_GETTIME) && defined(HAVE_CLOCK_NANOSLEEP)) ||	\
     (defined(HAVE_CLOCK_GETTIME) && defined(HAVE_NANOSLEEP)) ||		\
     (defined(HAVE_CLOCK_GETTIME) && defined(HAVE_PSELECT)) ||		\
@@ -158,6 +185,7 @@ static void stress_cyclic_stats(
 	if (rt_stats->index < rt_stats->cyclic_samples)
 		rt_stats->latencies[rt_stats->index++] = delta_ns;
 	rt_stats->index_reqd++;
+	rt_stats->last_ns = delta_ns;
 
 	rt_stats->ns += (double)delta_ns;
 }
@@ -259,6 +287,7 @@ static int stress_cyclic_poll(
 			if (rt_stats->index < rt_stats->cyclic_samples)
 				rt_stats->latencies[rt_stats->index++] = delta_ns;
 			rt_stats->index_reqd++;
+			rt_stats->last_ns = delta_ns;
 
 			rt_stats->ns += (double)delta_ns;
 			break;
@@ -359,6 +388,7 @@ static int stress_cyclic_itimer(
 	if (rt_stats->index < rt_stats->cyclic_samples)
 		rt_stats->latencies[rt_stats->index++] = delta_ns;
 	rt_stats->index_reqd++;
+	rt_stats->last_ns = delta_ns;
 
 	rt_stats->ns += (double)delta_ns;
 
@@ -611,6 +641,306 @@ static void stress_rt_dist(
 	free(dist);
 }
 
+#if defined(HAVE_CYCLIC_PERCPU)
+static shim_pthread_spinlock_t snapshot_lock;
+#endif
+static bool snapshot_taken;
+
+/*
+ *  stress_cyclic_breach()
+ *	latency exceeded the threshold, save a one-shot ftrace
+ *	snapshot of the trace buffer for later analysis
+ */
+static void stress_cyclic_breach(
+	stress_args_t *args,
+	stress_rt_stats_t *rt_stats,
+	const uint64_t cyclic_threshold,
+	const int cpu)
+{
+	char filename[PATH_MAX], marker[128];
+	bool take;
+
+	rt_stats->breaches++;
+
+#if defined(HAVE_CYCLIC_PERCPU)
+	(void)shim_pthread_spin_lock(&snapshot_lock);
+#endif
+	take = !snapshot_taken;
+	snapshot_taken = true;
+#if defined(HAVE_CYCLIC_PERCPU)
+	(void)shim_pthread_spin_unlock(&snapshot_lock);
+#endif
+	if (!take)
+		return;
+
+	(void)snprintf(filename, sizeof(filename), "%s/stress-ng-%s-%" PRIdMAX "-cpu%d.trace",
+		stress_get_temp_path(), args->name, (intmax_t)args->pid, cpu);
+	(void)snprintf(marker, sizeof(marker), "stress-ng: %s latency %" PRId64
+		" ns exceeded %" PRIu64 " ns threshold on CPU %d\n",
+		args->name, rt_stats->last_ns, cyclic_threshold, cpu);
+	if (stress_ftrace_snapshot(marker, filename) < 0) {
+		pr_inf("%s: latency %" PRId64 " ns exceeded %" PRIu64 " ns threshold on CPU %d, "
+			"cannot save ftrace snapshot, errno=%d (%s)\n",
+			args->name, rt_stats->last_ns, cyclic_threshold, cpu,
+			errno, strerror(errno));
+	} else {
+		pr_inf("%s: latency %" PRId64 " ns exceeded %" PRIu64 " ns threshold on CPU %d, "
+			"ftrace snapshot saved to %s\n",
+			args->name, rt_stats->last_ns, cyclic_threshold, cpu, filename);
+	}
+}
+
+#if defined(HAVE_CYCLIC_PERCPU)
+typedef struct {
+	stress_args_t *args;		/* stressor args */
+	stress_cyclic_func func;	/* cyclic measurement method */
+	uint64_t cyclic_sleep;		/* sleep time in nanosecs */
+	uint64_t cyclic_threshold;	/* snapshot threshold, 0 = disabled */
+	size_t cyclic_policy;		/* index into policies[] */
+	double start;			/* start time */
+	uint64_t timeout;		/* run time limit */
+	struct stress_cyclic_cpu *cpus;	/* per CPU measurement threads */
+	size_t n_cpus;			/* number of CPUs */
+} stress_cyclic_context_t;
+
+typedef struct stress_cyclic_cpu {
+	stress_rt_stats_t rt_stats;	/* per CPU latency statistics */
+	const stress_cyclic_context_t *context;
+	pthread_t pthread;		/* measurement thread */
+	int cpu;			/* CPU the thread is pinned to */
+	int policy;			/* index of policy actually used */
+	int err;			/* errno if thread setup failed */
+	bool created;			/* thread was created */
+	bool done;			/* thread has finished */
+	uint64_t ops;			/* samples taken */
+} stress_cyclic_cpu_t;
+
+/*
+ *  stress_cyclic_percpu_ops()
+ *	total samples taken by all the measurement threads
+ */
+static uint64_t stress_cyclic_percpu_ops(const stress_cyclic_context_t *context)
+{
+	uint64_t ops = 0;
+	size_t i;
+
+	for (i = 0; i < context->n_cpus; i++)
+		ops += context->cpus[i].ops;
+	return ops;
+}
+
+/*
+ *  stress_cyclic_percpu_sched()
+ *	set the real time scheduling policy on the calling thread,
+ *	SCHED_DEADLINE cannot be used on threads pinned to a subset
+ *	of the CPUs in the root domain, so fall back to the next policy
+ */
+static int stress_cyclic_percpu_sched(stress_cyclic_cpu_t *cpu)
+{
+	const pid_t tid = (pid_t)shim_gettid();
+
+	for (;;) {
+		const int policy = policies[cpu->policy].policy;
+
+		if (stress_set_sched(tid, policy, cpu->rt_stats.max_prio, true) == 0)
+			return 0;
+#if defined(SCHED_DEADLINE)
+		if ((policy == SCHED_DEADLINE) &&
+		    ((size_t)cpu->policy + 1 < num_policies)) {
+			cpu->policy++;
+#if defined(HAVE_SCHED_GET_PRIORITY_MAX)
+			cpu->rt_stats.max_prio = sched_get_priority_max(policies[cpu->policy].policy);
+#endif
+			continue;
+		}
+#endif
+		return -1;
+	}
+}
+
+/*
+ *  stress_cyclic_percpu_thread()
+ *	pinned real time thread measuring latencies on one CPU
+ */
+static void *stress_cyclic_percpu_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_cyclic_cpu_t *cpu = (stress_cyclic_cpu_t *)arg;
+	const stress_cyclic_context_t *context = cpu->context;
+	stress_rt_stats_t *rt_stats = &cpu->rt_stats;
+	cpu_set_t mask;
+
+	CPU_ZERO(&mask);
+	CPU_SET(cpu->cpu, &mask);
+	if (sched_setaffinity(0, sizeof(mask), &mask) < 0) {
+		cpu->err = errno;
+		goto done;
+	}
+	if (stress_cyclic_percpu_sched(cpu) < 0) {
+		cpu->err = errno;
+		goto done;
+	}
+
+	do {
+		const size_t index_reqd = rt_stats->index_reqd;
+
+		context->func(context->args, rt_stats, context->cyclic_sleep);
+		if (rt_stats->index_reqd == index_reqd)
+			continue;
+		cpu->ops++;
+		if (context->cyclic_threshold &&
+		    (rt_stats->last_ns > (int64_t)context->cyclic_threshold))
+			stress_cyclic_breach(context->args, rt_stats,
+				context->cyclic_threshold, cpu->cpu);
+
+		/* Ensure we NEVER spin forever */
+		if ((stress_time_now() - context->start) > (double)context->timeout)
+			break;
+		if (context->args->max_ops &&
+		    (stress_cyclic_percpu_ops(context) >= context->args->max_ops))
+			break;
+	} while (stress_continue_flag());
+done:
+	cpu->done = true;
+	return &nowt;
+}
+
+/*
+ *  stress_cyclic_percpu()
+ *	run a pinned measurement thread on each CPU and
+ *	gather the bogo-op count from all the threads
+ */
+static int stress_cyclic_percpu(
+	stress_args_t *args,
+	stress_cyclic_cpu_t *cpus,
+	const size_t n_cpus)
+{
+	size_t i, created = 0;
+	uint64_t ops;
+
+	for (i = 0; i < n_cpus; i++) {
+		int ret;
+
+		ret = pthread_create(&cpus[i].pthread, NULL,
+				stress_cyclic_percpu_thread, (void *)&cpus[i]);
+		if (ret) {
+			cpus[i].err = ret;
+			cpus[i].done = true;
+			continue;
+		}
+		cpus[i].created = true;
+		created++;
+	}
+	if (!created) {
+		pr_inf("%s: cannot create any measurement threads, errno=%d (%s)\n",
+			args->name, cpus[0].err, strerror(cpus[0].err));
+		return EXIT_NO_RESOURCE;
+	}
+
+	do {
+		bool all_done = true;
+
+		for (i = 0; i < n_cpus; i++)
+			all_done &= cpus[i].done;
+		stress_bogo_set(args, stress_cyclic_percpu_ops(cpus[0].context));
+		if (all_done)
+			break;
+		(void)shim_usleep(100000);
+	} while (stress_continue(args));
+
+	stress_continue_set_flag(false);
+	for (i = 0; i < n_cpus; i++) {
+		if (cpus[i].created)
+			(void)pthread_join(cpus[i].pthread, NULL);
+	}
+	ops = stress_cyclic_percpu_ops(cpus[0].context);
+	stress_bogo_set(args, args->max_ops ? STRESS_MINIMUM(ops, args->max_ops) : ops);
+
+	return EXIT_SUCCESS;
+}
+
+/*
+ *  stress_cyclic_percpu_report()
+ *	report per CPU latency statistics
+ */
+static void stress_cyclic_percpu_report(
+	stress_args_t *args,
+	stress_cyclic_cpu_t *cpus,
+	const size_t n_cpus,
+	const size_t cyclic_policy,
+	const uint64_t cyclic_sleep,
+	const int64_t cyclic_dist)
+{
+	size_t i;
+	int64_t worst_max = INT64_MIN, worst_p99 = INT64_MIN;
+	uint64_t breaches = 0;
+
+	for (i = 0; i < n_cpus; i++) {
+		stress_rt_stats_t *rt_stats = &cpus[i].rt_stats;
+
+		breaches += rt_stats->breaches;
+		if (!rt_stats->index)
+			continue;
+		stress_rt_stats(rt_stats);
+		if (rt_stats->max_ns > worst_max)
+			worst_max = rt_stats->max_ns;
+		if (rt_stats->latencies[(rt_stats->index * 99) / 100] > worst_p99)
+			worst_p99 = rt_stats->latencies[(rt_stats->index * 99) / 100];
+	}
+	if (worst_max == INT64_MIN) {
+		pr_inf("%s: %10s: no latency information available\n",
+			args->name, policies[cyclic_policy].name);
+		return;
+	}
+	stress_metrics_set(args, 0, "ns max latency (all CPUs)",
+		(double)worst_max, STRESS_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 1, "ns worst CPU p99 latency",
+		(double)worst_p99, STRESS_GEOMETRIC_MEAN);
+	stress_metrics_set(args, 2, "threshold breaches",
+		(double)breaches, STRESS_HARMONIC_MEAN);
+
+	if (args->instance != 0)
+		return;
+
+	pr_block_begin();
+	pr_inf("%s: sched %s: %" PRIu64 " ns delay, per-CPU latencies:\n",
+		args->name, policies[cyclic_policy].name, cyclic_sleep);
+	pr_inf("%s: %4s %10s %10s %10s %10s %10s %8s\n", args->name,
+		"CPU", "samples", "min ns", "mean ns", "p99 ns", "max ns", "breaches");
+	for (i = 0; i < n_cpus; i++) {
+		const stress_rt_stats_t *rt_stats = &cpus[i].rt_stats;
+
+		if (cpus[i].err) {
+			pr_inf("%s: %4d no samples, thread setup failed, errno=%d (%s)\n",
+				args->name, cpus[i].cpu, cpus[i].err, strerror(cpus[i].err));
+			continue;
+		}
+		if (!rt_stats->index) {
+			pr_inf("%s: %4d no samples\n", args->name, cpus[i].cpu);
+			continue;
+		}
+		pr_inf("%s: %4d %10zd %10" PRId64 " %10.2f %10" PRId64 " %10" PRId64 " %8" PRIu64 "%s%s\n",
+			args->name, cpus[i].cpu, rt_stats->index,
+			rt_stats->min_ns, rt_stats->latency_mean,
+			rt_stats->latencies[(rt_stats->index * 99) / 100],
+			rt_stats->max_ns, rt_stats->breaches,
+			(cpus[i].policy != (int)cyclic_policy) ? " " : "",
+			(cpus[i].policy != (int)cyclic_policy) ? policies[cpus[i].policy].name : "");
+	}
+	if (cyclic_dist) {
+		for (i = 0; i < n_cpus; i++) {
+			char name[64];
+
+			if (!cpus[i].rt_stats.index)
+				continue;
+			(void)snprintf(name, sizeof(name), "%s: cpu %d", args->name, cpus[i].cpu);
+			stress_rt_dist(name, &cpus[i].rt_stats, cyclic_dist);
+		}
+	}
+	pr_block_end();
+}
+#endif
+
 /*
  *  stress_cyclic_supported()
  *      check if we can run this as root
@@ -645,15 +975,40 @@ static int stress_cyclic(stress_args_t *args)
 	const size_t page_size = args->page_size;
 	const size_t size = (sizeof(*rt_stats) + page_size - 1) & (~(page_size - 1));
 	stress_cyclic_func func;
+	bool cyclic_percpu = false;
+	uint64_t cyclic_threshold = 0;
+#if defined(HAVE_CYCLIC_PERCPU)
+	stress_cyclic_context_t context;
+	stress_cyclic_cpu_t *cpus = NULL;
+	int64_t *cpu_latencies = NULL;
+	size_t n_cpus = 0, cpus_size = 0, cpu_latencies_size = 0;
+#endif
 
 	timeout  = g_opt_timeout;
 	(void)stress_get_setting("cyclic-dist", &cyclic_dist);
 	(void)stress_get_setting("cyclic-method", &cyclic_method);
+	(void)stress_get_setting("cyclic-percpu", &cyclic_percpu);
 	(void)stress_get_setting("cyclic-policy", &cyclic_policy);
 	(void)stress_get_setting("cyclic-prio", &cyclic_prio);
 	(void)stress_get_setting("cyclic-samples", &cyclic_samples);
 	(void)stress_get_setting("cyclic-sleep", &cyclic_sleep);
-
+	(void)stress_get_setting("cyclic-threshold", &cyclic_threshold);
+
+#if defined(HAVE_CYCLIC_PERCPU)
+	/* itimer uses process wide signals, not usable from threads */
+	if (cyclic_percpu && !strcmp(cyclic_methods[cyclic_method].name, "itimer")) {
+		cyclic_method = 0;
+		if (args->instance == 0)
+			pr_inf("%s: itimer method cannot be used with --cyclic-percpu, using %s instead\n",
+				args->name, cyclic_methods[cyclic_method].name);
+	}
+#else
+	if (cyclic_percpu && (args->instance == 0)) {
+		pr_inf("%s: --cyclic-percpu is not available on this system, "
+			"using a single measurement loop\n", args->name);
+	}
+	cyclic_percpu = false;
+#endif
 	func = cyclic_methods[cyclic_method].func;
 	policy = policies[cyclic_policy].policy;
 
@@ -718,6 +1073,64 @@ static int stress_cyclic(stress_args_t *args)
 		}
 	}
 
+#if defined(HAVE_CYCLIC_PERCPU)
+	if (cyclic_percpu) {
+		cpu_set_t mask;
+		size_t i;
+		int cpu;
+
+		if (sched_getaffinity(0, sizeof(mask), &mask) < 0) {
+			pr_inf_skip("%s: sched_getaffinity failed, errno=%d (%s), skipping stressor\n",
+				args->name, errno, strerror(errno));
+			(void)munmap((void *)rt_stats->latencies, rt_stats->latencies_size);
+			(void)munmap((void *)rt_stats, size);
+			return EXIT_NO_RESOURCE;
+		}
+		n_cpus = (size_t)CPU_COUNT(&mask);
+		cpus_size = (n_cpus * sizeof(*cpus) + page_size - 1) & (~(page_size - 1));
+		cpus = (stress_cyclic_cpu_t *)stress_mmap_populate(NULL, cpus_size,
+						PROT_READ | PROT_WRITE,
+						MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		cpu_latencies_size = n_cpus * rt_stats->latencies_size;
+		cpu_latencies = (int64_t *)stress_mmap_populate(NULL, cpu_latencies_size,
+						PROT_READ | PROT_WRITE,
+						MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+		if ((cpus == MAP_FAILED) || (cpu_latencies == MAP_FAILED)) {
+			pr_inf_skip("%s: mmap of %zd per-CPU statistics failed, errno=%d (%s), "
+				"skipping stressor\n", args->name, n_cpus, errno, strerror(errno));
+			if (cpu_latencies != MAP_FAILED)
+				(void)munmap((void *)cpu_latencies, cpu_latencies_size);
+			if (cpus != MAP_FAILED)
+				(void)munmap((void *)cpus, cpus_size);
+			(void)munmap((void *)rt_stats->latencies, rt_stats->latencies_size);
+			(void)munmap((void *)rt_stats, size);
+			return EXIT_NO_RESOURCE;
+		}
+
+		context.args = args;
+		context.func = func;
+		context.cyclic_sleep = cyclic_sleep;
+		context.cyclic_threshold = cyclic_threshold;
+		context.cyclic_policy = cyclic_policy;
+		context.start = start;
+		context.timeout = timeout;
+		context.cpus = cpus;
+		context.n_cpus = n_cpus;
+
+		for (i = 0, cpu = 0; (i < n_cpus) && (cpu < CPU_SETSIZE); cpu++) {
+			if (!CPU_ISSET(cpu, &mask))
+				continue;
+			cpus[i].rt_stats = *rt_stats;
+			cpus[i].rt_stats.latencies = cpu_latencies + (i * cyclic_samples);
+			cpus[i].context = &context;
+			cpus[i].cpu = cpu;
+			cpus[i].policy = (int)cyclic_policy;
+			i++;
+		}
+	}
+	(void)shim_pthread_spin_init(&snapshot_lock, SHIM_PTHREAD_PROCESS_PRIVATE);
+#endif
+
 	if (args->instance == 0)
 		pr_dbg("%s: using method '%s'\n", args->name, cyclic_methods[cyclic_method].name);
 
@@ -732,9 +1145,8 @@ again:
 			goto finish;
 		pr_inf("%s: cannot fork, errno=%d (%s)\n",
 			args->name, errno, strerror(errno));
-		(void)munmap((void *)rt_stats->latencies, rt_stats->latencies_size);
-		(void)munmap((void *)rt_stats, size);
-		return EXIT_NO_RESOURCE;
+		rc = EXIT_NO_RESOURCE;
+		goto finish;
 	} else if (pid == 0) {
 #if defined(HAVE_SCHED_GET_PRIORITY_MIN) &&	\
     defined(HAVE_SCHED_GET_PRIORITY_MAX)
@@ -751,6 +1163,13 @@ again:
 		 */
 		rlim.rlim_cur = timeout;
 		rlim.rlim_max = timeout;
+#if defined(HAVE_CYCLIC_PERCPU)
+		/* RLIMIT_CPU is the CPU time of all the threads */
+		if (cpus) {
+			rlim.rlim_cur *= n_cpus;
+			rlim.rlim_max *= n_cpus;
+		}
+#endif
 		(void)setrlimit(RLIMIT_CPU, &rlim);
 
 #if defined(RLIMIT_RTTIME)
@@ -766,6 +1185,13 @@ again:
 		if (stress_sighandler(args->name, SIGXCPU, stress_rlimit_handler, &old_action_xcpu) < 0)
 			goto tidy;
 
+#if defined(HAVE_CYCLIC_PERCPU)
+		if (cpus) {
+			ncrc = stress_cyclic_percpu(args, cpus, n_cpus);
+			goto tidy;
+		}
+#endif
+
 #if defined(HAVE_SCHED_GET_PRIORITY_MIN) &&	\
     defined(HAVE_SCHED_GET_PRIORITY_MAX)
 #if defined(SCHED_DEADLINE)
@@ -816,8 +1242,15 @@ redo_policy:
 		}
 #endif
 		do {
+			const size_t index_reqd = rt_stats->index_reqd;
+
 			func(args, rt_stats, cyclic_sleep);
 			stress_bogo_inc(args);
+			if (cyclic_threshold &&
+			    (rt_stats->index_reqd != index_reqd) &&
+			    (rt_stats->last_ns > (int64_t)cyclic_threshold))
+				stress_cyclic_breach(args, rt_stats, cyclic_threshold,
+					(int)stress_get_cpu());
 
 			/* Ensure we NEVER spin forever */
 			if ((stress_time_now() - start) > (double)timeout)
@@ -839,6 +1272,13 @@ tidy:
 		(void)stress_kill_pid_wait(pid, NULL);
 	}
 
+#if defined(HAVE_CYCLIC_PERCPU)
+	if (cpus) {
+		stress_cyclic_percpu_report(args, cpus, n_cpus, cyclic_policy,
+			cyclic_sleep, (int64_t)cyclic_dist);
+		goto finish;
+	}
+#endif
 	stress_rt_stats(rt_stats);
 
 	if (args->instance == 0) {
@@ -883,6 +1323,9 @@ tidy:
 			}
 			stress_rt_dist(args->name, rt_stats, (int64_t)cyclic_dist);
 
+			if (cyclic_threshold)
+				pr_inf("%s: %" PRIu64 " latencies exceeded the %" PRIu64 " ns threshold\n",
+					args->name, rt_stats->breaches, cyclic_threshold);
 			if (rt_stats->index < rt_stats->index_reqd)
 				pr_inf("%s: Note: --cyclic-samples needed to be %zd to capture all the data for this run\n",
 					args->name, rt_stats->index_reqd);
@@ -897,6 +1340,13 @@ tidy:
 finish:
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
+#if defined(HAVE_CYCLIC_PERCPU)
+	(void)shim_pthread_spin_destroy(&snapshot_lock);
+	if (cpus) {
+		(void)munmap((void *)cpu_latencies, cpu_latencies_size);
+		(void)munmap((void *)cpus, cpus_size);
+	}
+#endif
 	(void)munmap((void *)rt_stats->latencies, rt_stats->latencies_size);
 	(void)munmap((void *)rt_stats, size);
 
@@ -906,10 +1356,12 @@ finish:
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_cyclic_dist,	stress_set_cyclic_dist },
 	{ OPT_cyclic_method,	stress_set_cyclic_method },
+	{ OPT_cyclic_percpu,	stress_set_cyclic_percpu },
 	{ OPT_cyclic_policy,	stress_set_cyclic_policy },
 	{ OPT_cyclic_prio, 	stress_set_cyclic_prio },
 	{ OPT_cyclic_sleep,	stress_set_cyclic_sleep },
 	{ OPT_cyclic_samples,	stress_set_cyclic_samples },
+	{ OPT_cyclic_threshold,	stress_set_cyclic_threshold },
 	{ 0,			NULL }
 };
 
@@ -18,16 +18,47 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-pthread.h"
+
+#if defined(HAVE_LINUX_OPENAT2_H)
+#include <linux/openat2.h>
+#endif
 
 #define MIN_DIRDEEP_BYTES	(0)
 #define MAX_DIRDEEP_BYTES	(MAX_FILE_LIMIT)
 
+#define MAX_DIRDEEP_LOOKUP_THREADS	(1024)
+#define MIN_DIRDEEP_LOOKUP_DEPTH	(1)
+#define MAX_DIRDEEP_LOOKUP_DEPTH	(128)
+#define DEFAULT_DIRDEEP_LOOKUP_DEPTH	(8)
+
+#define DIRDEEP_METHOD_STAT	(0x01)
+#define DIRDEEP_METHOD_OPENAT	(0x02)
+#define DIRDEEP_METHOD_OPENAT2	(0x04)
+#define DIRDEEP_METHOD_ALL	(DIRDEEP_METHOD_STAT | DIRDEEP_METHOD_OPENAT | DIRDEEP_METHOD_OPENAT2)
+
+typedef struct {
+	const char *name;
+	const int method;
+} stress_dirdeep_method_t;
+
+static const stress_dirdeep_method_t dirdeep_methods[] = {
+	{ "stat",	DIRDEEP_METHOD_STAT },
+	{ "openat",	DIRDEEP_METHOD_OPENAT },
+	{ "openat2",	DIRDEEP_METHOD_OPENAT2 },
+	{ "all",	DIRDEEP_METHOD_ALL },
+};
+
 static const stress_help_t help[] = {
 	{ NULL,	"dirdeep N",		"start N directory depth stressors" },
 	{ NULL, "dirdeep-bytes N",	"size of files to create per level (see --dirdeep-files)" },
 	{ NULL,	"dirdeep-dirs N",	"create N directories per level" },
 	{ NULL, "dirdeep-files N",	"create N files per level (see --dirdeep-bytes) " },
 	{ NULL,	"dirdeep-inodes N",	"create a maximum N inodes (N can also be %)" },
+	{ NULL,	"dirdeep-lookup-depth N","resolve paths N directories deep with --dirdeep-lookup-threads" },
+	{ NULL,	"dirdeep-lookup-method M","select lookup method, stat, openat, openat2 or all" },
+	{ NULL,	"dirdeep-lookup-threads N","measure path lookup scalability with 1 to N threads" },
 	{ NULL,	"dirdeep-ops N",	"stop after N directory depth bogo operations" },
 	{ NULL,	NULL,			NULL }
 };
@@ -99,6 +130,55 @@ static int stress_set_dirdeep_files(const char *opt)
 	return stress_set_setting("dirdeep-files", TYPE_ID_UINT32, &dirdeep_files);
 }
 
+/*
+ *  stress_set_dirdeep_lookup_threads()
+ *      set maximum number of path lookup threads
+ */
+static int stress_set_dirdeep_lookup_threads(const char *opt)
+{
+	size_t dirdeep_lookup_threads;
+
+	dirdeep_lookup_threads = (size_t)stress_get_uint64(opt);
+	stress_check_range("dirdeep-lookup-threads", dirdeep_lookup_threads, 1, MAX_DIRDEEP_LOOKUP_THREADS);
+	return stress_set_setting("dirdeep-lookup-threads", TYPE_ID_SIZE_T, &dirdeep_lookup_threads);
+}
+
+/*
+ *  stress_set_dirdeep_lookup_depth()
+ *      set depth of paths to resolve
+ */
+static int stress_set_dirdeep_lookup_depth(const char *opt)
+{
+	uint32_t dirdeep_lookup_depth;
+
+	dirdeep_lookup_depth = stress_get_uint32(opt);
+	stress_check_range("dirdeep-lookup-depth", (uint64_t)dirdeep_lookup_depth,
+		MIN_DIRDEEP_LOOKUP_DEPTH, MAX_DIRDEEP_LOOKUP_DEPTH);
+	return stress_set_setting("dirdeep-lookup-depth", TYPE_ID_UINT32, &dirdeep_lookup_depth);
+}
+
+/*
+ *  stress_set_dirdeep_lookup_method()
+ *      set path lookup method
+ */
+static int stress_set_dirdeep_lookup_method(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(dirdeep_methods); i++) {
+		if (!strcmp(dirdeep_methods[i].name, opt)) {
+			int method = dirdeep_methods[i].method;
+
+			return stress_set_setting("dirdeep-lookup-method", TYPE_ID_INT, &method);
+		}
+	}
+	(void)fprintf(stderr, "dirdeep-lookup-method must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(dirdeep_methods); i++)
+		(void)fprintf(stderr, " %s", dirdeep_methods[i].name);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
 /*
  *  stress_dirdeep_make()
  *	depth-first tree creation, create lots of sub-trees with
@@ -428,6 +508,527 @@ static void stress_dir_tidy(
 }
 
 
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_FSTATAT) &&		\
+    defined(HAVE_OPENAT) &&		\
+    defined(O_DIRECTORY)
+
+#if defined(HAVE_OPENAT2) &&		\
+    defined(HAVE_LINUX_OPENAT2_H) &&	\
+    defined(RESOLVE_BENEATH) &&		\
+    defined(RESOLVE_CACHED) &&		\
+    defined(__NR_openat2) &&		\
+    defined(HAVE_SYSCALL)
+#define HAVE_DIRDEEP_OPENAT2
+#endif
+
+#define DIRDEEP_LOOKUP_SLOT		(0.25)	/* seconds per pattern, method and thread count */
+#define DIRDEEP_LOOKUP_MAX_COUNTS	(16)	/* maximum thread counts in the sweep */
+#define DIRDEEP_LOOKUP_PATH_MAX		(1024)	/* fits a MAX_DIRDEEP_LOOKUP_DEPTH .. path */
+#define DIRDEEP_LOOKUP_SYMLINKS		(32)	/* symlink chain, below the kernel's 40 limit */
+#define DIRDEEP_LOOKUP_BATCH		(16)	/* lookups between stop flag checks */
+
+#define DIRDEEP_LOOKUP_IDENTICAL	(0)
+#define DIRDEEP_LOOKUP_DISJOINT		(1)
+#define DIRDEEP_LOOKUP_SYMLINK		(2)
+#define DIRDEEP_LOOKUP_DOTDOT		(3)
+#define DIRDEEP_LOOKUP_PATTERNS		(4)
+
+#define DIRDEEP_LOOKUP_METHODS		(3)
+
+/* a path looking up thread */
+typedef struct {
+	volatile bool *go;		/* start looking up */
+	volatile bool *stop;		/* stop looking up */
+	int dir_fd;			/* top of the tree */
+	int method;			/* DIRDEEP_METHOD_* */
+	const char *path;		/* path relative to dir_fd */
+	uint64_t lookups;		/* lookups completed */
+	uint64_t fallouts;		/* RESOLVE_CACHED lookups that fell out of RCU-walk */
+	uint64_t errors;		/* failed lookups */
+	int err;			/* errno of the last failure */
+	pthread_t pthread;
+	int ret;
+} stress_dirdeep_lookup_thread_t;
+
+/* cumulative lookups for a method, pattern and thread count */
+typedef struct {
+	uint64_t lookups;
+	uint64_t fallouts;
+	double duration;
+} stress_dirdeep_lookup_scale_t;
+
+static const char * const dirdeep_lookup_patterns[DIRDEEP_LOOKUP_PATTERNS] = {
+	"identical", "disjoint", "symlink", "dotdot"
+};
+
+static void *nowt = NULL;
+
+/*
+ *  stress_dirdeep_lookup_one()
+ *	resolve a path once with the given method
+ */
+static inline void stress_dirdeep_lookup_one(stress_dirdeep_lookup_thread_t *thread)
+{
+	struct stat statbuf;
+	int fd;
+#if defined(HAVE_DIRDEEP_OPENAT2)
+	struct open_how how;
+#endif
+
+	switch (thread->method) {
+	case DIRDEEP_METHOD_STAT:
+		if (UNLIKELY(fstatat(thread->dir_fd, thread->path, &statbuf, 0) < 0))
+			goto err;
+		return;
+	case DIRDEEP_METHOD_OPENAT:
+		fd = openat(thread->dir_fd, thread->path, O_RDONLY);
+		if (UNLIKELY(fd < 0))
+			goto err;
+		(void)close(fd);
+		return;
+#if defined(HAVE_DIRDEEP_OPENAT2)
+	case DIRDEEP_METHOD_OPENAT2:
+		/*
+		 *  RESOLVE_CACHED fails with EAGAIN if the lookup cannot be
+		 *  completed in RCU-walk mode, so count that as a fall out
+		 *  and retry it the slow way
+		 */
+		(void)shim_memset(&how, 0, sizeof(how));
+		how.flags = O_RDONLY;
+		how.resolve = RESOLVE_BENEATH | RESOLVE_CACHED;
+		fd = (int)syscall(__NR_openat2, thread->dir_fd, thread->path, &how, sizeof(how));
+		if (fd < 0) {
+			if (errno != EAGAIN)
+				goto err;
+			thread->fallouts++;
+			how.resolve = RESOLVE_BENEATH;
+			fd = (int)syscall(__NR_openat2, thread->dir_fd, thread->path, &how, sizeof(how));
+			if (UNLIKELY(fd < 0))
+				goto err;
+		}
+		(void)close(fd);
+		return;
+#endif
+	default:
+		return;
+	}
+err:
+	thread->err = errno;
+	thread->errors++;
+}
+
+/*
+ *  stress_dirdeep_lookup_thread()
+ *	resolve the same path over and over until told to stop
+ */
+static void *stress_dirdeep_lookup_thread(void *arg)
+{
+	stress_dirdeep_lookup_thread_t *thread = (stress_dirdeep_lookup_thread_t *)arg;
+
+	while (!*thread->go && !*thread->stop)
+		(void)shim_sched_yield();
+
+	while (!*thread->stop) {
+		int i;
+
+		for (i = 0; i < DIRDEEP_LOOKUP_BATCH; i++)
+			stress_dirdeep_lookup_one(thread);
+		thread->lookups += DIRDEEP_LOOKUP_BATCH;
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_dirdeep_lookup_path()
+ *	fill in the path a thread resolves for a given pattern
+ */
+static void stress_dirdeep_lookup_path(
+	char *path,
+	const uint32_t thread,
+	const int pattern,
+	const uint32_t depth)
+{
+	size_t len;
+	uint32_t i;
+
+	switch (pattern) {
+	case DIRDEEP_LOOKUP_SYMLINK:
+		(void)snprintf(path, DIRDEEP_LOOKUP_PATH_MAX, "t%" PRIu32 "/l0", thread);
+		return;
+	case DIRDEEP_LOOKUP_IDENTICAL:
+		len = (size_t)snprintf(path, DIRDEEP_LOOKUP_PATH_MAX, "t0/");
+		break;
+	default:
+		len = (size_t)snprintf(path, DIRDEEP_LOOKUP_PATH_MAX, "t%" PRIu32 "/", thread);
+		break;
+	}
+	for (i = 0; i < depth; i++) {
+		/* step down, back up and down again at each level */
+		if (pattern == DIRDEEP_LOOKUP_DOTDOT)
+			len += (size_t)shim_strscpy(path + len, "d/../", DIRDEEP_LOOKUP_PATH_MAX - len);
+		len += (size_t)shim_strscpy(path + len, "d/", DIRDEEP_LOOKUP_PATH_MAX - len);
+	}
+	(void)shim_strscpy(path + len, "f", DIRDEEP_LOOKUP_PATH_MAX - len);
+}
+
+/*
+ *  stress_dirdeep_lookup_tree()
+ *	create (or remove if remove is true) a thread's tree,
+ *	a chain of depth directories with a file at the bottom
+ *	and a chain of symlinks to the file
+ */
+static int stress_dirdeep_lookup_tree(
+	stress_args_t *args,
+	const char *rootpath,
+	const uint32_t thread,
+	const uint32_t depth,
+	const bool remove)
+{
+	char path[PATH_MAX], target[DIRDEEP_LOOKUP_PATH_MAX];
+	const uint32_t links = STRESS_MINIMUM(depth, DIRDEEP_LOOKUP_SYMLINKS);
+	const char *slash;
+	size_t len, top;
+	uint32_t i;
+	int fd;
+
+	top = (size_t)snprintf(path, sizeof(path), "%s/t%" PRIu32, rootpath, thread);
+	if (!remove && (mkdir(path, S_IRWXU) < 0))
+		goto err;
+
+	for (i = 0; i < links; i++) {
+		(void)snprintf(path + top, sizeof(path) - top, "/l%" PRIu32, i);
+		if (remove) {
+			(void)shim_unlink(path);
+			continue;
+		}
+		if (i + 1 < links) {
+			(void)snprintf(target, sizeof(target), "l%" PRIu32, i + 1);
+		} else {
+			stress_dirdeep_lookup_path(target, thread, DIRDEEP_LOOKUP_DISJOINT, depth);
+			/* the link lives in the thread's directory, drop the t<N>/ prefix */
+			slash = strchr(target, '/');
+			(void)memmove(target, slash + 1, strlen(slash));
+		}
+		if (symlink(target, path) < 0)
+			goto err;
+	}
+
+	len = top;
+	for (i = 0; i < depth; i++)
+		len += (size_t)shim_strscpy(path + len, "/d", sizeof(path) - len);
+	if (remove) {
+		(void)shim_strscpy(path + len, "/f", sizeof(path) - len);
+		(void)shim_unlink(path);
+		for (; len >= top; len -= 2) {
+			path[len] = '\0';
+			(void)shim_rmdir(path);
+			if (len == top)
+				break;
+		}
+		return 0;
+	}
+	for (len = top, i = 0; i < depth; i++) {
+		len += (size_t)shim_strscpy(path + len, "/d", sizeof(path) - len);
+		if (mkdir(path, S_IRWXU) < 0)
+			goto err;
+	}
+	(void)shim_strscpy(path + len, "/f", sizeof(path) - len);
+	fd = open(path, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+	if (fd < 0)
+		goto err;
+	(void)close(fd);
+	return 0;
+err:
+	pr_inf_skip("%s: cannot create %s, errno=%d (%s), skipping stressor\n",
+		args->name, path, errno, strerror(errno));
+	return -1;
+}
+
+/*
+ *  stress_dirdeep_lookup_run()
+ *	resolve paths using lookup method index m with n_threads
+ *	threads for DIRDEEP_LOOKUP_SLOT seconds, returns -1 on lookup
+ *	failure, 1 if threads could not be created
+ */
+static int stress_dirdeep_lookup_run(
+	stress_args_t *args,
+	const int dir_fd,
+	const int m,
+	const int pattern,
+	const size_t n_threads,
+	char *paths,
+	stress_dirdeep_lookup_thread_t *threads,
+	stress_dirdeep_lookup_scale_t *scale)
+{
+	volatile bool go = false, stop = false;
+	uint64_t lookups = 0, fallouts = 0, errors = 0;
+	size_t i, started = 0;
+	int rc = 0, err = 0;
+	double t;
+
+	(void)shim_memset(threads, 0, sizeof(*threads) * n_threads);
+	for (i = 0; i < n_threads; i++) {
+		threads[i].go = &go;
+		threads[i].stop = &stop;
+		threads[i].dir_fd = dir_fd;
+		threads[i].method = dirdeep_methods[m].method;
+		threads[i].path = paths + ((i * DIRDEEP_LOOKUP_PATTERNS) + (size_t)pattern) * DIRDEEP_LOOKUP_PATH_MAX;
+		threads[i].ret = pthread_create(&threads[i].pthread, NULL,
+					stress_dirdeep_lookup_thread, (void *)&threads[i]);
+		if (threads[i].ret != 0)
+			break;
+		started++;
+	}
+
+	t = stress_time_now();
+	go = true;
+	while (stress_continue(args) && (started == n_threads) &&
+	       (stress_time_now() - t < DIRDEEP_LOOKUP_SLOT))
+		(void)shim_usleep(10000);
+	stop = true;
+	t = stress_time_now() - t;
+
+	for (i = 0; i < started; i++) {
+		(void)pthread_join(threads[i].pthread, NULL);
+		lookups += threads[i].lookups;
+		fallouts += threads[i].fallouts;
+		errors += threads[i].errors;
+		if (threads[i].errors)
+			err = threads[i].err;
+	}
+
+	if (errors) {
+		pr_fail("%s: %" PRIu64 " %s lookups of %s paths failed, errno=%d (%s)\n",
+			args->name, errors, dirdeep_methods[m].name,
+			dirdeep_lookup_patterns[pattern], err, strerror(err));
+		rc = -1;
+	} else if (started == n_threads) {
+		scale->lookups += lookups;
+		scale->fallouts += fallouts;
+		scale->duration += t;
+	} else {
+		pr_inf("%s: could only create %zu of %zu threads\n",
+			args->name, started, n_threads);
+		rc = 1;
+	}
+	stress_bogo_add(args, lookups);
+	if (args->max_ops && (stress_bogo_get(args) > args->max_ops))
+		stress_bogo_set(args, args->max_ops);
+	return rc;
+}
+
+/*
+ *  stress_dirdeep_lookup()
+ *	measure path lookups per second as the number of threads
+ *	resolving paths concurrently increases, for identical paths,
+ *	disjoint paths, symlink chains and .. traversal
+ */
+static int stress_dirdeep_lookup(
+	stress_args_t *args,
+	const char *rootpath,
+	const size_t lookup_threads)
+{
+	stress_dirdeep_lookup_scale_t (*scales)[DIRDEEP_LOOKUP_PATTERNS][DIRDEEP_LOOKUP_MAX_COUNTS];
+	stress_dirdeep_lookup_thread_t *threads;
+	size_t counts[DIRDEEP_LOOKUP_MAX_COUNTS], n_counts = 0, c, idx = 0;
+	uint32_t depth = DEFAULT_DIRDEEP_LOOKUP_DEPTH, i;
+	int lookup_method = DIRDEEP_METHOD_ALL, m, p, dir_fd, ret;
+	int rc = EXIT_SUCCESS;
+	uint32_t trees = 0;
+	char *paths;
+
+	(void)stress_get_setting("dirdeep-lookup-depth", &depth);
+	(void)stress_get_setting("dirdeep-lookup-method", &lookup_method);
+
+	/* 1, 2, 4.. threads doubling, then all threads */
+	for (c = 1; (c <= lookup_threads) && (n_counts < DIRDEEP_LOOKUP_MAX_COUNTS - 1); c *= 2)
+		counts[n_counts++] = c;
+	if (counts[n_counts - 1] != lookup_threads)
+		counts[n_counts++] = lookup_threads;
+
+	threads = (stress_dirdeep_lookup_thread_t *)calloc(lookup_threads, sizeof(*threads));
+	paths = (char *)calloc(lookup_threads * DIRDEEP_LOOKUP_PATTERNS, DIRDEEP_LOOKUP_PATH_MAX);
+	scales = calloc(DIRDEEP_LOOKUP_METHODS, sizeof(*scales));
+	if (!threads || !paths || !scales) {
+		pr_inf_skip("%s: cannot allocate %zu thread contexts, skipping stressor\n",
+			args->name, lookup_threads);
+		rc = EXIT_NO_RESOURCE;
+		goto free_all;
+	}
+
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0) {
+		rc = stress_exit_status(-ret);
+		goto free_all;
+	}
+	for (trees = 0; trees < lookup_threads; trees++) {
+		if (!stress_continue(args))
+			goto tidy;
+		if (stress_dirdeep_lookup_tree(args, rootpath, trees, depth, false) < 0) {
+			trees++;
+			rc = EXIT_NO_RESOURCE;
+			goto tidy;
+		}
+		for (p = 0; p < DIRDEEP_LOOKUP_PATTERNS; p++)
+			stress_dirdeep_lookup_path(paths + ((trees * DIRDEEP_LOOKUP_PATTERNS) + (size_t)p) * DIRDEEP_LOOKUP_PATH_MAX,
+				trees, p, depth);
+	}
+	dir_fd = open(rootpath, O_RDONLY | O_DIRECTORY);
+	if (dir_fd < 0) {
+		pr_inf_skip("%s: cannot open %s, errno=%d (%s), skipping stressor\n",
+			args->name, rootpath, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+
+#if defined(HAVE_DIRDEEP_OPENAT2)
+	if (lookup_method & DIRDEEP_METHOD_OPENAT2) {
+		struct open_how how;
+		int fd;
+
+		/* RESOLVE_CACHED appeared in Linux 5.12 */
+		(void)shim_memset(&how, 0, sizeof(how));
+		how.flags = O_RDONLY;
+		how.resolve = RESOLVE_BENEATH | RESOLVE_CACHED;
+		fd = (int)syscall(__NR_openat2, dir_fd, paths, &how, sizeof(how));
+		if (fd >= 0) {
+			(void)close(fd);
+		} else if (errno != EAGAIN) {
+			if (args->instance == 0)
+				pr_inf("%s: openat2 with RESOLVE_CACHED not available, errno=%d (%s), "
+					"skipping openat2 lookups\n", args->name, errno, strerror(errno));
+			lookup_method &= ~DIRDEEP_METHOD_OPENAT2;
+		}
+	}
+#else
+	if ((args->instance == 0) && (lookup_method & DIRDEEP_METHOD_OPENAT2))
+		pr_inf("%s: openat2 with RESOLVE_CACHED not available, skipping openat2 lookups\n",
+			args->name);
+	lookup_method &= ~DIRDEEP_METHOD_OPENAT2;
+#endif
+
+	if (args->instance == 0)
+		pr_inf("%s: path lookups with 1 to %zu threads, depth %" PRIu32 "\n",
+			args->name, lookup_threads, depth);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (m = 0; m < DIRDEEP_LOOKUP_METHODS; m++) {
+			if (!(lookup_method & dirdeep_methods[m].method))
+				continue;
+			for (p = 0; p < DIRDEEP_LOOKUP_PATTERNS; p++) {
+				for (c = 0; c < n_counts; c++) {
+					if (!stress_continue(args))
+						goto finish;
+					ret = stress_dirdeep_lookup_run(args, dir_fd, m,
+						p, counts[c], paths, threads, &scales[m][p][c]);
+					if (ret < 0) {
+						rc = EXIT_FAILURE;
+						goto finish;
+					} else if (ret > 0) {
+						break;
+					}
+				}
+			}
+		}
+	} while (stress_continue(args));
+finish:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	(void)close(dir_fd);
+
+	if ((args->instance == 0) && (rc == EXIT_SUCCESS)) {
+		pr_block_begin();
+		for (m = 0; m < DIRDEEP_LOOKUP_METHODS; m++) {
+			if (!(lookup_method & dirdeep_methods[m].method))
+				continue;
+			pr_inf("%s: %s lookups per second:\n", args->name, dirdeep_methods[m].name);
+			pr_inf("%s: %7s %12s %12s %12s %12s\n", args->name, "threads",
+				dirdeep_lookup_patterns[0], dirdeep_lookup_patterns[1],
+				dirdeep_lookup_patterns[2], dirdeep_lookup_patterns[3]);
+			for (c = 0; c < n_counts; c++) {
+				char buf[64];
+				int len = 0;
+
+				for (p = 0; p < DIRDEEP_LOOKUP_PATTERNS; p++) {
+					const stress_dirdeep_lookup_scale_t *s = &scales[m][p][c];
+
+					if (s->duration > 0.0)
+						len += snprintf(buf + len, sizeof(buf) - (size_t)len, " %12.0f",
+							(double)s->lookups / s->duration);
+					else
+						len += snprintf(buf + len, sizeof(buf) - (size_t)len, " %12s", "n/a");
+				}
+				pr_inf("%s: %7zu%s\n", args->name, counts[c], buf);
+			}
+		}
+		if (lookup_method & DIRDEEP_METHOD_OPENAT2) {
+			m = DIRDEEP_LOOKUP_METHODS - 1;
+			pr_inf("%s: %% of openat2 RESOLVE_CACHED lookups falling out of RCU-walk:\n", args->name);
+			pr_inf("%s: %7s %12s %12s %12s %12s\n", args->name, "threads",
+				dirdeep_lookup_patterns[0], dirdeep_lookup_patterns[1],
+				dirdeep_lookup_patterns[2], dirdeep_lookup_patterns[3]);
+			for (c = 0; c < n_counts; c++) {
+				char buf[64];
+				int len = 0;
+
+				for (p = 0; p < DIRDEEP_LOOKUP_PATTERNS; p++) {
+					const stress_dirdeep_lookup_scale_t *s = &scales[m][p][c];
+
+					if (s->lookups > 0)
+						len += snprintf(buf + len, sizeof(buf) - (size_t)len, " %12.3f",
+							100.0 * (double)s->fallouts / (double)s->lookups);
+					else
+						len += snprintf(buf + len, sizeof(buf) - (size_t)len, " %12s", "n/a");
+				}
+				pr_inf("%s: %7zu%s\n", args->name, counts[c], buf);
+			}
+		}
+		pr_block_end();
+	}
+
+	/* metrics for 1 thread and all threads, 64 metrics are too few for every count */
+	for (m = 0; m < DIRDEEP_LOOKUP_METHODS; m++) {
+		for (p = 0; p < DIRDEEP_LOOKUP_PATTERNS; p++) {
+			for (c = 0; c < n_counts; c += (n_counts > 1) ? n_counts - 1 : 1) {
+				const stress_dirdeep_lookup_scale_t *s = &scales[m][p][c];
+				char str[64];
+
+				if (s->duration <= 0.0)
+					continue;
+				(void)snprintf(str, sizeof(str), "%s %s lookups per sec, %zu thread%s",
+					dirdeep_methods[m].name, dirdeep_lookup_patterns[p],
+					counts[c], counts[c] > 1 ? "s" : "");
+				stress_metrics_set(args, idx++, str,
+					(double)s->lookups / s->duration, STRESS_HARMONIC_MEAN);
+			}
+		}
+	}
+	for (p = 0; p < DIRDEEP_LOOKUP_PATTERNS; p++) {
+		const stress_dirdeep_lookup_scale_t *s = &scales[DIRDEEP_LOOKUP_METHODS - 1][p][n_counts - 1];
+		char str[64];
+
+		if (s->lookups == 0)
+			continue;
+		(void)snprintf(str, sizeof(str), "%% %s RCU-walk fall outs, %zu thread%s",
+			dirdeep_lookup_patterns[p], counts[n_counts - 1], counts[n_counts - 1] > 1 ? "s" : "");
+		stress_metrics_set(args, idx++, str,
+			100.0 * (double)s->fallouts / (double)s->lookups, STRESS_GEOMETRIC_MEAN);
+	}
+
+tidy:
+	for (i = 0; i < trees; i++)
+		(void)stress_dirdeep_lookup_tree(args, rootpath, i, depth, true);
+	(void)stress_temp_dir_rm_args(args);
+free_all:
+	free(scales);
+	free(paths);
+	free(threads);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_dir
  *	stress deep recursive directory mkdir and rmdir
@@ -447,6 +1048,22 @@ static int stress_dirdeep(stress_args_t *args)
 	uint64_t inodes_estimate;
 	uint64_t inodes_min;
 	uint64_t inodes_exercised;
+	size_t dirdeep_lookup_threads = 0;
+
+	(void)stress_temp_dir_args(args, rootpath, sizeof(rootpath));
+
+	if (stress_get_setting("dirdeep-lookup-threads", &dirdeep_lookup_threads)) {
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_FSTATAT) &&		\
+    defined(HAVE_OPENAT) &&		\
+    defined(O_DIRECTORY)
+		return stress_dirdeep_lookup(args, rootpath, dirdeep_lookup_threads);
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --dirdeep-lookup-threads requires pthreads, fstatat() and openat(), ignoring option\n",
+				args->name);
+#endif
+	}
 
 	(void)stress_get_setting("dirdeep-bytes", &dirdeep_bytes);
 	(void)stress_get_setting("dirdeep-dirs", &dirdeep_dirs);
@@ -455,7 +1072,6 @@ static int stress_dirdeep(stress_args_t *args)
 
 	inodes_start = stress_get_filesystem_available_inodes();
 
-	(void)stress_temp_dir_args(args, rootpath, sizeof(rootpath));
 	path_len = strlen(rootpath);
 
 	(void)stress_mk_filename(linkpath, sizeof(linkpath), rootpath, "/f");
@@ -525,6 +1141,9 @@ static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_dirdeep_dirs,	stress_set_dirdeep_dirs },
 	{ OPT_dirdeep_inodes,	stress_set_dirdeep_inodes },
 	{ OPT_dirdeep_files,	stress_set_dirdeep_files },
+	{ OPT_dirdeep_lookup_depth,	stress_set_dirdeep_lookup_depth },
+	{ OPT_dirdeep_lookup_method,	stress_set_dirdeep_lookup_method },
+	{ OPT_dirdeep_lookup_threads,	stress_set_dirdeep_lookup_threads },
 	{ 0,			NULL }
 };
 
@@ -22,6 +22,7 @@
 #include "core-killpid.h"
 #include "core-net.h"
 #include "core-pragma.h"
+#include "core-pthread.h"
 
 #if defined(HAVE_SYS_UN_H)
 #include <sys/un.h>
@@ -31,6 +32,12 @@
 #include <sys/epoll.h>
 #endif
 
+#include <netinet/in.h>
+
+#if defined(HAVE_NETINET_TCP_H)
+#include <netinet/tcp.h>
+#endif
+
 #define MIN_EPOLL_PORT		(1024)
 #define MAX_EPOLL_PORT		(65535)
 #define DEFAULT_EPOLL_PORT	(6000)
@@ -40,16 +47,46 @@
 #define MIN_EPOLL_SOCKETS	(64)
 #define MAX_EPOLL_SOCKETS	(100000)
 #define DEFAULT_EPOLL_SOCKETS	(4096)
+#define MIN_EPOLL_THREADS	(1)
+#define MAX_EPOLL_THREADS	(256)
+#define MIN_EPOLL_CLIENTS	(1)
+#define MAX_EPOLL_CLIENTS	(10000)
+#define DEFAULT_EPOLL_CLIENTS	(256)
+#define MIN_EPOLL_BUSY_POLL	(1)
+#define MAX_EPOLL_BUSY_POLL	(1000000)
+
+#define EPOLL_ACCEPT_ACCEPTOR	(0)
+#define EPOLL_ACCEPT_EXCLUSIVE	(1)
+#define EPOLL_ACCEPT_REUSEPORT	(2)
+
+#define EPOLL_TRIGGER_LEVEL	(0)
+#define EPOLL_TRIGGER_EDGE	(1)
 
 static const stress_help_t help[] = {
 	{ NULL,	"epoll N",	  	"start N workers doing epoll handled socket activity" },
+	{ NULL,	"epoll-accept M",	"server accept distribution: acceptor, exclusive or reuseport" },
+	{ NULL,	"epoll-busy-poll N",	"set SO_BUSY_POLL to N usecs on server benchmark sockets" },
+	{ NULL,	"epoll-clients N",	"number of server benchmark client connections" },
 	{ NULL,	"epoll-domain D", 	"specify socket domain, default is unix" },
 	{ NULL,	"epoll-ops N",	  	"stop after N epoll bogo operations" },
 	{ NULL,	"epoll-port P",	  	"use socket ports P upwards" },
 	{ NULL, "epoll-sockets N",	"specify maximum number of open sockets" },
+	{ NULL,	"epoll-threads N",	"run a server benchmark with N event loop threads" },
+	{ NULL,	"epoll-trigger T",	"server benchmark connection events, T is level or edge" },
 	{ NULL,	NULL,			NULL }
 };
 
+static const char * const epoll_accept_names[] = {
+	"acceptor",	/* EPOLL_ACCEPT_ACCEPTOR */
+	"exclusive",	/* EPOLL_ACCEPT_EXCLUSIVE */
+	"reuseport",	/* EPOLL_ACCEPT_REUSEPORT */
+};
+
+static const char * const epoll_trigger_names[] = {
+	"level",	/* EPOLL_TRIGGER_LEVEL */
+	"edge",		/* EPOLL_TRIGGER_EDGE */
+};
+
 #if defined(HAVE_SYS_EPOLL_H) &&	\
     defined(HAVE_EPOLL_CREATE) &&	\
     defined(HAVE_LIB_RT) &&		\
@@ -123,10 +160,92 @@ static int stress_set_epoll_sockets(const char *opt)
         return stress_set_setting("epoll-sockets", TYPE_ID_INT, &epoll_sockets);
 }
 
+/*
+ *  stress_set_epoll_threads()
+ *	set the number of server benchmark event loop threads
+ */
+static int stress_set_epoll_threads(const char *opt)
+{
+	uint32_t epoll_threads;
+
+	epoll_threads = stress_get_uint32(opt);
+	stress_check_range("epoll-threads", (uint64_t)epoll_threads,
+		MIN_EPOLL_THREADS, MAX_EPOLL_THREADS);
+	return stress_set_setting("epoll-threads", TYPE_ID_UINT32, &epoll_threads);
+}
+
+/*
+ *  stress_set_epoll_clients()
+ *	set the number of server benchmark client connections
+ */
+static int stress_set_epoll_clients(const char *opt)
+{
+	uint32_t epoll_clients;
+
+	epoll_clients = stress_get_uint32(opt);
+	stress_check_range("epoll-clients", (uint64_t)epoll_clients,
+		MIN_EPOLL_CLIENTS, MAX_EPOLL_CLIENTS);
+	return stress_set_setting("epoll-clients", TYPE_ID_UINT32, &epoll_clients);
+}
+
+/*
+ *  stress_set_epoll_busy_poll()
+ *	set the server benchmark SO_BUSY_POLL time in usecs
+ */
+static int stress_set_epoll_busy_poll(const char *opt)
+{
+	uint32_t epoll_busy_poll;
+
+	epoll_busy_poll = stress_get_uint32(opt);
+	stress_check_range("epoll-busy-poll", (uint64_t)epoll_busy_poll,
+		MIN_EPOLL_BUSY_POLL, MAX_EPOLL_BUSY_POLL);
+	return stress_set_setting("epoll-busy-poll", TYPE_ID_UINT32, &epoll_busy_poll);
+}
+
+/*
+ *  stress_set_epoll_name()
+ *	set an option from a table of names
+ */
+static int stress_set_epoll_name(
+	const char *name,
+	const char *opt,
+	const char * const *names,
+	const size_t n_names)
+{
+	size_t i;
+
+	for (i = 0; i < n_names; i++) {
+		if (!strcmp(opt, names[i]))
+			return stress_set_setting(name, TYPE_ID_SIZE_T, &i);
+	}
+	(void)fprintf(stderr, "%s must be one of:", name);
+	for (i = 0; i < n_names; i++)
+		(void)fprintf(stderr, " %s", names[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_epoll_accept(const char *opt)
+{
+	return stress_set_epoll_name("epoll-accept", opt,
+		epoll_accept_names, SIZEOF_ARRAY(epoll_accept_names));
+}
+
+static int stress_set_epoll_trigger(const char *opt)
+{
+	return stress_set_epoll_name("epoll-trigger", opt,
+		epoll_trigger_names, SIZEOF_ARRAY(epoll_trigger_names));
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_epoll_accept,	stress_set_epoll_accept },
+	{ OPT_epoll_busy_poll,	stress_set_epoll_busy_poll },
+	{ OPT_epoll_clients,	stress_set_epoll_clients },
 	{ OPT_epoll_domain,	stress_set_epoll_domain },
 	{ OPT_epoll_port,	stress_set_epoll_port },
 	{ OPT_epoll_sockets,	stress_set_epoll_sockets },
+	{ OPT_epoll_threads,	stress_set_epoll_threads },
+	{ OPT_epoll_trigger,	stress_set_epoll_trigger },
 	{ 0,			NULL }
 };
 
@@ -138,6 +257,12 @@ static const stress_opt_set_func_t opt_set_funcs[] = {
     defined(HAVE_TIMER_SETTIME) &&	\
     NEED_GLIBC(2,3,2)
 
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(AF_INET) &&		\
+    defined(EPOLLET)
+#define STRESS_EPOLL_BENCH	(1)
+#endif
+
 static sigjmp_buf jmp_env;
 
 /*
@@ -1006,6 +1131,735 @@ die:
 	_exit(rc);
 }
 
+#if defined(STRESS_EPOLL_BENCH)
+
+#define EPOLL_BENCH_MSG_SIZE		(64)	/* request and response size */
+#define EPOLL_BENCH_EVENTS		(64)	/* events per epoll_wait */
+#define EPOLL_BENCH_SAMPLES		(16384)	/* latency samples per client thread */
+#define EPOLL_BENCH_CLIENT_THREADS	(16)	/* maximum client threads */
+
+typedef struct stress_epoll_bench stress_epoll_bench_t;
+
+/* a server side connection or listening socket */
+typedef struct stress_epoll_bench_conn {
+	struct stress_epoll_bench_conn *next;	/* next connection of server */
+	int fd;					/* socket fd, -1 when closed */
+	bool listener;				/* true if listening socket */
+	size_t len;				/* request bytes received */
+	char buf[EPOLL_BENCH_MSG_SIZE];		/* request being received */
+} stress_epoll_bench_conn_t;
+
+/* a client side connection */
+typedef struct {
+	int fd;					/* socket fd */
+	size_t len;				/* response bytes received */
+	uint64_t seq;				/* request sequence number */
+	uint64_t t_sent;			/* ns time request was sent */
+	char buf[EPOLL_BENCH_MSG_SIZE];		/* response being received */
+} stress_epoll_bench_client_conn_t;
+
+/* an event loop server thread */
+typedef struct {
+	pthread_t pthread;			/* thread handle */
+	int ret;				/* pthread_create return */
+	int efd;				/* epoll fd of this thread */
+	stress_epoll_bench_conn_t listener;	/* listening socket context */
+	stress_epoll_bench_conn_t *conns;	/* connections of this thread */
+	uint64_t n_conns;			/* connections handled */
+	uint64_t requests;			/* requests served */
+	int err;				/* errno of a failure */
+	stress_epoll_bench_t *bench;		/* benchmark state */
+} stress_epoll_bench_server_t;
+
+/* a client thread driving a set of connections */
+typedef struct {
+	pthread_t pthread;			/* thread handle */
+	int ret;				/* pthread_create return */
+	size_t n_conns;				/* number of connections */
+	volatile bool ready;			/* true once connected */
+	uint64_t requests;			/* responses received */
+	uint64_t bad;				/* responses not matching request */
+	uint64_t n_samples;			/* latencies seen */
+	double *samples;			/* reservoir of latencies */
+	uint64_t rnd;				/* xorshift state, mwc is not thread safe */
+	int err;				/* errno of a failure */
+	stress_epoll_bench_t *bench;		/* benchmark state */
+} stress_epoll_bench_client_t;
+
+struct stress_epoll_bench {
+	volatile bool stop;			/* stop all threads */
+	volatile bool go;			/* start sending requests */
+	struct sockaddr_storage addr;		/* server address */
+	socklen_t addr_len;			/* server address length */
+	int domain;				/* AF_INET or AF_INET6 */
+	size_t accept_mode;			/* EPOLL_ACCEPT_* */
+	uint32_t events;			/* connection epoll events */
+	int busy_poll;				/* SO_BUSY_POLL usecs, 0 = off */
+	volatile bool busy_poll_failed;		/* SO_BUSY_POLL could not be set */
+	size_t n_servers;			/* number of event loop threads */
+	size_t next_server;			/* acceptor round robin index */
+	stress_epoll_bench_server_t *servers;	/* servers + acceptor */
+};
+
+/*
+ *  stress_epoll_bench_sockopts()
+ *	set socket options on a connected socket
+ */
+static int stress_epoll_bench_sockopts(stress_epoll_bench_t *bench, const int fd)
+{
+#if defined(TCP_NODELAY)
+	int one = 1;
+
+	(void)setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+#endif
+#if defined(SO_BUSY_POLL)
+	if ((bench->busy_poll > 0) && !bench->busy_poll_failed) {
+		if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &bench->busy_poll, sizeof(bench->busy_poll)) < 0)
+			bench->busy_poll_failed = true;
+	}
+#else
+	(void)bench;
+#endif
+	return epoll_set_fd_nonblock(fd);
+}
+
+/*
+ *  stress_epoll_bench_listen()
+ *	create a non-blocking listening socket on the benchmark port
+ */
+static int stress_epoll_bench_listen(stress_epoll_bench_t *bench, const bool reuseport)
+{
+	int fd, one = 1;
+
+	fd = socket(bench->domain, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+	if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0)
+		goto err;
+#if defined(SO_REUSEPORT)
+	if (reuseport && (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0))
+		goto err;
+#else
+	(void)reuseport;
+#endif
+	if (bind(fd, (struct sockaddr *)&bench->addr, bench->addr_len) < 0)
+		goto err;
+	if (listen(fd, 4096) < 0)
+		goto err;
+	if (epoll_set_fd_nonblock(fd) < 0)
+		goto err;
+	return fd;
+err:
+	(void)close(fd);
+	return -1;
+}
+
+/*
+ *  stress_epoll_bench_accept()
+ *	accept all pending connections, add them to the epoll set of
+ *	the accepting thread or, for the acceptor thread, hand them
+ *	round robin to the event loop threads
+ */
+static void stress_epoll_bench_accept(stress_epoll_bench_server_t *server, const int listen_fd)
+{
+	stress_epoll_bench_t *bench = server->bench;
+
+	while (!bench->stop) {
+		stress_epoll_bench_server_t *target = server;
+		stress_epoll_bench_conn_t *conn;
+		struct epoll_event event;
+		int fd;
+
+		fd = accept(listen_fd, NULL, NULL);
+		if (fd < 0)
+			break;
+		if (bench->accept_mode == EPOLL_ACCEPT_ACCEPTOR)
+			target = &bench->servers[bench->next_server++ % bench->n_servers];
+
+		conn = (stress_epoll_bench_conn_t *)calloc(1, sizeof(*conn));
+		if (!conn || (stress_epoll_bench_sockopts(bench, fd) < 0)) {
+			free(conn);
+			(void)close(fd);
+			continue;
+		}
+		conn->fd = fd;
+		(void)shim_memset(&event, 0, sizeof(event));
+		event.events = bench->events;
+		event.data.ptr = (void *)conn;
+		if (epoll_ctl(target->efd, EPOLL_CTL_ADD, fd, &event) < 0) {
+			free(conn);
+			(void)close(fd);
+			continue;
+		}
+		/* only the accepting thread links to the target's list */
+		conn->next = target->conns;
+		target->conns = conn;
+		target->n_conns++;
+	}
+}
+
+/*
+ *  stress_epoll_bench_serve()
+ *	read requests on a connection and echo back each complete
+ *	request as the response, edge triggered mode reads until the
+ *	socket is drained, level triggered mode reads once per event
+ */
+static void stress_epoll_bench_serve(stress_epoll_bench_server_t *server, stress_epoll_bench_conn_t *conn)
+{
+	const bool edge = !!(server->bench->events & EPOLLET);
+
+	for (;;) {
+		ssize_t n;
+
+		n = recv(conn->fd, conn->buf + conn->len, sizeof(conn->buf) - conn->len, 0);
+		if (n < 0) {
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))
+				return;
+			break;
+		} else if (n == 0) {
+			break;
+		}
+		conn->len += (size_t)n;
+		if (conn->len == sizeof(conn->buf)) {
+			size_t sent = 0;
+
+			while (sent < sizeof(conn->buf)) {
+				n = send(conn->fd, conn->buf + sent, sizeof(conn->buf) - sent, 0);
+				if (n < 0) {
+					if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)) {
+						(void)shim_sched_yield();
+						continue;
+					}
+					goto close_conn;
+				}
+				sent += (size_t)n;
+			}
+			conn->len = 0;
+			server->requests++;
+		}
+		if (!edge)
+			return;
+	}
+close_conn:
+	(void)epoll_ctl_del(server->efd, conn->fd);
+	(void)close(conn->fd);
+	conn->fd = -1;
+}
+
+/*
+ *  stress_epoll_bench_server()
+ *	event loop thread, also used for the single acceptor thread
+ */
+static void *stress_epoll_bench_server(void *arg)
+{
+	static void *nowt = NULL;
+	stress_epoll_bench_server_t *server = (stress_epoll_bench_server_t *)arg;
+	stress_epoll_bench_t *bench = server->bench;
+	struct epoll_event events[EPOLL_BENCH_EVENTS];
+
+	while (!bench->stop) {
+		int i, n;
+
+		n = epoll_wait(server->efd, events, EPOLL_BENCH_EVENTS, 100);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			server->err = errno;
+			break;
+		}
+		for (i = 0; i < n; i++) {
+			stress_epoll_bench_conn_t *conn = (stress_epoll_bench_conn_t *)events[i].data.ptr;
+
+			if (conn->listener)
+				stress_epoll_bench_accept(server, conn->fd);
+			else
+				stress_epoll_bench_serve(server, conn);
+		}
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_epoll_bench_send()
+ *	send the next request on a client connection
+ */
+static int stress_epoll_bench_send(stress_epoll_bench_client_conn_t *conn)
+{
+	char buf[EPOLL_BENCH_MSG_SIZE];
+	size_t sent = 0;
+
+	(void)shim_memset(buf, 0xa5, sizeof(buf));
+	(void)memcpy(buf, &conn->seq, sizeof(conn->seq));
+	conn->len = 0;
+	conn->t_sent = stress_time_now_ns();
+	while (sent < sizeof(buf)) {
+		const ssize_t n = send(conn->fd, buf + sent, sizeof(buf) - sent, 0);
+
+		if (n < 0) {
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)) {
+				(void)shim_sched_yield();
+				continue;
+			}
+			return -1;
+		}
+		sent += (size_t)n;
+	}
+	return 0;
+}
+
+/*
+ *  stress_epoll_bench_client()
+ *	connect a set of connections, each keeps one request in flight
+ *	and sends the next request once the response has been received
+ */
+static void *stress_epoll_bench_client(void *arg)
+{
+	static void *nowt = NULL;
+	stress_epoll_bench_client_t *client = (stress_epoll_bench_client_t *)arg;
+	stress_epoll_bench_t *bench = client->bench;
+	stress_epoll_bench_client_conn_t *conns;
+	struct epoll_event events[EPOLL_BENCH_EVENTS];
+	size_t i, n_connected = 0;
+	int efd;
+
+	efd = epoll_create(1);
+	if (efd < 0) {
+		client->err = errno;
+		client->ready = true;
+		return &nowt;
+	}
+	conns = (stress_epoll_bench_client_conn_t *)calloc(client->n_conns, sizeof(*conns));
+	if (!conns) {
+		client->err = ENOMEM;
+		goto close_efd;
+	}
+	for (n_connected = 0; (n_connected < client->n_conns) && !bench->stop; n_connected++) {
+		stress_epoll_bench_client_conn_t *conn = &conns[n_connected];
+		struct epoll_event event;
+
+		conn->fd = socket(bench->domain, SOCK_STREAM, 0);
+		if (conn->fd < 0) {
+			client->err = errno;
+			break;
+		}
+		if ((connect(conn->fd, (struct sockaddr *)&bench->addr, bench->addr_len) < 0) ||
+		    (stress_epoll_bench_sockopts(bench, conn->fd) < 0)) {
+			client->err = errno;
+			(void)close(conn->fd);
+			break;
+		}
+		(void)shim_memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN;
+		event.data.ptr = (void *)conn;
+		if (epoll_ctl(efd, EPOLL_CTL_ADD, conn->fd, &event) < 0) {
+			client->err = errno;
+			(void)close(conn->fd);
+			break;
+		}
+	}
+	client->ready = true;
+	if (client->err)
+		goto close_conns;
+
+	while (!bench->go && !bench->stop)
+		(void)shim_usleep(1000);
+
+	for (i = 0; i < n_connected; i++) {
+		if (stress_epoll_bench_send(&conns[i]) < 0) {
+			client->err = errno;
+			goto close_conns;
+		}
+	}
+
+	while (!bench->stop) {
+		int j, n;
+
+		n = epoll_wait(efd, events, EPOLL_BENCH_EVENTS, 100);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			client->err = errno;
+			break;
+		}
+		for (j = 0; j < n; j++) {
+			stress_epoll_bench_client_conn_t *conn = (stress_epoll_bench_client_conn_t *)events[j].data.ptr;
+			ssize_t ret;
+
+			ret = recv(conn->fd, conn->buf + conn->len, sizeof(conn->buf) - conn->len, 0);
+			if (ret <= 0) {
+				if ((ret < 0) && ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)))
+					continue;
+				if (!bench->stop)
+					client->err = ret ? errno : ECONNRESET;
+				goto close_conns;
+			}
+			conn->len += (size_t)ret;
+			if (conn->len == sizeof(conn->buf)) {
+				const double latency = (double)(stress_time_now_ns() - conn->t_sent) /
+					STRESS_DBL_NANOSECOND;
+				uint64_t seq;
+
+				(void)memcpy(&seq, conn->buf, sizeof(seq));
+				if (seq != conn->seq)
+					client->bad++;
+
+				/* reservoir sample the latencies */
+				if (client->n_samples < EPOLL_BENCH_SAMPLES) {
+					client->samples[client->n_samples] = latency;
+				} else {
+					uint64_t r;
+
+					client->rnd ^= client->rnd << 13;
+					client->rnd ^= client->rnd >> 7;
+					client->rnd ^= client->rnd << 17;
+					r = client->rnd % (client->n_samples + 1);
+					if (r < EPOLL_BENCH_SAMPLES)
+						client->samples[r] = latency;
+				}
+				client->n_samples++;
+				client->requests++;
+				conn->seq++;
+				if (stress_epoll_bench_send(conn) < 0) {
+					client->err = errno;
+					goto close_conns;
+				}
+			}
+		}
+	}
+
+close_conns:
+	for (i = 0; i < n_connected; i++)
+		(void)close(conns[i].fd);
+	free(conns);
+close_efd:
+	(void)close(efd);
+	client->ready = true;
+	return &nowt;
+}
+
+/*
+ *  stress_epoll_bench()
+ *	multi-threaded event loop server benchmark, epoll_threads event
+ *	loop threads serve epoll_clients loopback TCP connections with a
+ *	fixed size request/response protocol, connections are distributed
+ *	by a single acceptor thread, a shared EPOLLEXCLUSIVE listener or
+ *	per thread SO_REUSEPORT listeners
+ */
+static int stress_epoll_bench(
+	stress_args_t *args,
+	const int port,
+	const int epoll_domain,
+	const uint32_t epoll_threads,
+	const uint32_t epoll_clients,
+	const size_t epoll_accept,
+	const size_t epoll_trigger,
+	const uint32_t epoll_busy_poll)
+{
+	stress_epoll_bench_t bench;
+	stress_epoll_bench_client_t clients[EPOLL_BENCH_CLIENT_THREADS];
+	const size_t n_clients = STRESS_MINIMUM((size_t)epoll_clients,
+		(size_t)EPOLL_BENCH_CLIENT_THREADS);
+	const size_t n_servers = (size_t)epoll_threads;
+	const size_t n_threads = n_servers + ((epoll_accept == EPOLL_ACCEPT_ACCEPTOR) ? 1 : 0);
+	size_t i, servers_started = 0, clients_started = 0, n_samples = 0;
+	struct sockaddr *addr = NULL;
+	int listen_fd = -1, rc = EXIT_SUCCESS, err = 0;
+	uint64_t requests = 0, bad = 0, min_conns = ~0ULL, max_conns = 0;
+	uint64_t min_requests = ~0ULL, max_requests = 0;
+	double *latencies = NULL, t_start, duration = 0.0;
+#if defined(RLIMIT_NOFILE)
+	struct rlimit rlim;
+#endif
+
+#if !defined(EPOLLEXCLUSIVE)
+	if (epoll_accept == EPOLL_ACCEPT_EXCLUSIVE) {
+		pr_inf_skip("%s: EPOLLEXCLUSIVE not supported, skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+	}
+#endif
+#if !defined(SO_REUSEPORT)
+	if (epoll_accept == EPOLL_ACCEPT_REUSEPORT) {
+		pr_inf_skip("%s: SO_REUSEPORT not supported, skipping stressor\n", args->name);
+		return EXIT_NOT_IMPLEMENTED;
+	}
+#endif
+
+	(void)shim_memset(&bench, 0, sizeof(bench));
+	(void)shim_memset(clients, 0, sizeof(clients));
+	bench.domain = (epoll_domain == AF_INET6) ? AF_INET6 : AF_INET;
+	bench.accept_mode = epoll_accept;
+	bench.events = EPOLLIN | ((epoll_trigger == EPOLL_TRIGGER_EDGE) ? EPOLLET : 0);
+	bench.busy_poll = (int)epoll_busy_poll;
+	bench.n_servers = n_servers;
+	if (stress_set_sockaddr(args->name, args->instance, args->pid, bench.domain,
+			port, &addr, &bench.addr_len, NET_ADDR_LOOPBACK) < 0) {
+		pr_inf_skip("%s: cannot set up socket address, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)memcpy(&bench.addr, addr, bench.addr_len);
+
+	/* each connection needs a client and a server fd */
+#if defined(RLIMIT_NOFILE)
+	if (getrlimit(RLIMIT_NOFILE, &rlim) == 0) {
+		rlim.rlim_cur = rlim.rlim_max;
+		(void)setrlimit(RLIMIT_NOFILE, &rlim);
+	}
+#endif
+
+	bench.servers = (stress_epoll_bench_server_t *)calloc(n_threads, sizeof(*bench.servers));
+	latencies = (double *)calloc(n_clients * EPOLL_BENCH_SAMPLES, sizeof(*latencies));
+	if (!bench.servers || !latencies) {
+		pr_inf_skip("%s: cannot allocate benchmark state, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+	for (i = 0; i < n_threads; i++)
+		bench.servers[i].efd = -1;
+
+	if (epoll_accept != EPOLL_ACCEPT_REUSEPORT) {
+		listen_fd = stress_epoll_bench_listen(&bench, false);
+		if (listen_fd < 0) {
+			pr_inf_skip("%s: cannot listen on port %d, errno=%d (%s), skipping stressor\n",
+				args->name, port, errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			goto tidy;
+		}
+	}
+
+	for (i = 0; i < n_threads; i++) {
+		stress_epoll_bench_server_t *server = &bench.servers[i];
+		struct epoll_event event;
+		bool add_listener = false;
+
+		server->bench = &bench;
+		server->listener.fd = -1;
+		server->listener.listener = true;
+		server->efd = epoll_create(1);
+		if (server->efd < 0) {
+			err = errno;
+			break;
+		}
+		(void)shim_memset(&event, 0, sizeof(event));
+		event.events = EPOLLIN;
+		switch (epoll_accept) {
+		case EPOLL_ACCEPT_ACCEPTOR:
+		default:
+			/* only the acceptor thread, the last thread, listens */
+			if (i == n_servers) {
+				server->listener.fd = listen_fd;
+				add_listener = true;
+			}
+			break;
+#if defined(EPOLLEXCLUSIVE)
+		case EPOLL_ACCEPT_EXCLUSIVE:
+			/* one shared listener, only one thread is woken per connection */
+			server->listener.fd = listen_fd;
+			event.events |= EPOLLEXCLUSIVE;
+			add_listener = true;
+			break;
+#endif
+		case EPOLL_ACCEPT_REUSEPORT:
+			/* per thread listener, the kernel hashes connections across them */
+			server->listener.fd = stress_epoll_bench_listen(&bench, true);
+			if (server->listener.fd < 0) {
+				err = errno;
+				goto start_failed;
+			}
+			add_listener = true;
+			break;
+		}
+		if (add_listener) {
+			event.data.ptr = (void *)&server->listener;
+			if (epoll_ctl(server->efd, EPOLL_CTL_ADD, server->listener.fd, &event) < 0) {
+				err = errno;
+				break;
+			}
+		}
+		server->ret = pthread_create(&server->pthread, NULL, stress_epoll_bench_server, (void *)server);
+		if (server->ret != 0) {
+			err = server->ret;
+			break;
+		}
+		servers_started++;
+	}
+start_failed:
+	if (servers_started < n_threads) {
+		pr_inf_skip("%s: cannot start event loop threads, errno=%d (%s), skipping stressor\n",
+			args->name, err, strerror(err));
+		rc = EXIT_NO_RESOURCE;
+		goto stop;
+	}
+
+	for (i = 0; i < n_clients; i++) {
+		stress_epoll_bench_client_t *client = &clients[i];
+
+		client->bench = &bench;
+		client->samples = latencies + (i * EPOLL_BENCH_SAMPLES);
+		client->n_conns = ((epoll_clients * (i + 1)) / n_clients) - ((epoll_clients * i) / n_clients);
+		client->rnd = stress_mwc64() | 1;
+		client->ret = pthread_create(&client->pthread, NULL, stress_epoll_bench_client, (void *)client);
+		if (client->ret != 0) {
+			pr_inf_skip("%s: cannot start client threads, errno=%d (%s), skipping stressor\n",
+				args->name, client->ret, strerror(client->ret));
+			rc = EXIT_NO_RESOURCE;
+			goto stop;
+		}
+		clients_started++;
+	}
+
+	/* wait for all the clients to connect */
+	for (i = 0; (i < n_clients) && stress_continue(args); ) {
+		if (clients[i].ready)
+			i++;
+		else
+			(void)shim_usleep(1000);
+	}
+	for (i = 0; i < n_clients; i++) {
+		if (clients[i].err) {
+			pr_inf_skip("%s: cannot connect %" PRIu32 " clients, errno=%d (%s), skipping stressor\n",
+				args->name, epoll_clients, clients[i].err, strerror(clients[i].err));
+			rc = EXIT_NO_RESOURCE;
+			goto stop;
+		}
+	}
+	if (args->instance == 0)
+		pr_inf("%s: %" PRIu32 " event loop threads, %s accept, %s triggered, "
+			"%" PRIu32 " connections from %zu client threads\n",
+			args->name, epoll_threads, epoll_accept_names[epoll_accept],
+			epoll_trigger_names[epoll_trigger], epoll_clients, n_clients);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	t_start = stress_time_now();
+	bench.go = true;
+	while (stress_continue(args)) {
+		uint64_t total = 0;
+
+		(void)shim_usleep(100000);
+		for (i = 0; i < n_clients; i++) {
+			total += clients[i].requests;
+			if (clients[i].err)
+				break;
+		}
+		if (i < n_clients)
+			break;
+		stress_bogo_set(args, total);
+	}
+	duration = stress_time_now() - t_start;
+
+stop:
+	bench.stop = true;
+	for (i = 0; i < clients_started; i++) {
+		stress_epoll_bench_client_t *client = &clients[i];
+
+		(void)pthread_join(client->pthread, NULL);
+		requests += client->requests;
+		bad += client->bad;
+		if (client->err && !err)
+			err = client->err;
+		/* compact the latency samples */
+		if (client->n_samples > 0) {
+			const size_t n = (size_t)STRESS_MINIMUM(client->n_samples, (uint64_t)EPOLL_BENCH_SAMPLES);
+
+			(void)memmove(latencies + n_samples, client->samples, n * sizeof(*latencies));
+			n_samples += n;
+		}
+	}
+	for (i = 0; i < servers_started; i++) {
+		stress_epoll_bench_server_t *server = &bench.servers[i];
+
+		(void)pthread_join(server->pthread, NULL);
+		if (server->err && !err)
+			err = server->err;
+		if (i < n_servers) {
+			min_conns = STRESS_MINIMUM(min_conns, server->n_conns);
+			max_conns = STRESS_MAXIMUM(max_conns, server->n_conns);
+			min_requests = STRESS_MINIMUM(min_requests, server->requests);
+			max_requests = STRESS_MAXIMUM(max_requests, server->requests);
+		}
+	}
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	if (rc != EXIT_SUCCESS)
+		goto tidy;
+
+	if (err) {
+		pr_fail("%s: event loop benchmark failed, errno=%d (%s)\n",
+			args->name, err, strerror(err));
+		rc = EXIT_FAILURE;
+	} else if (bad) {
+		pr_fail("%s: %" PRIu64 " responses did not match their requests\n",
+			args->name, bad);
+		rc = EXIT_FAILURE;
+	}
+	if (bench.busy_poll_failed && (args->instance == 0))
+		pr_inf("%s: cannot set SO_BUSY_POLL to %" PRIu32 " usecs (needs CAP_NET_ADMIN "
+			"above net.core.busy_read)\n", args->name, epoll_busy_poll);
+
+	if (duration > 0.0) {
+		const double rate = (double)requests / duration;
+		double p50 = 0.0, p90 = 0.0, p99 = 0.0, p999 = 0.0, max = 0.0;
+
+		if (n_samples > 0) {
+			qsort(latencies, n_samples, sizeof(*latencies), stress_metrics_cmp_double);
+			p50 = latencies[n_samples / 2];
+			p90 = latencies[(n_samples * 90) / 100];
+			p99 = latencies[(n_samples * 99) / 100];
+			p999 = latencies[(n_samples * 999) / 1000];
+			max = latencies[n_samples - 1];
+		}
+		if (args->instance == 0) {
+			pr_block_begin();
+			pr_inf("%s: %.0f requests/sec, latency p50 %.2f, p90 %.2f, p99 %.2f, "
+				"p99.9 %.2f, max %.2f usecs\n", args->name, rate,
+				p50 * STRESS_DBL_MICROSECOND, p90 * STRESS_DBL_MICROSECOND,
+				p99 * STRESS_DBL_MICROSECOND, p999 * STRESS_DBL_MICROSECOND,
+				max * STRESS_DBL_MICROSECOND);
+			pr_inf("%s: per thread connections %" PRIu64 "..%" PRIu64
+				", per thread requests %" PRIu64 "..%" PRIu64 "\n",
+				args->name, min_conns, max_conns, min_requests, max_requests);
+			pr_block_end();
+		}
+		stress_metrics_set(args, 0, "requests per sec",
+			rate, STRESS_HARMONIC_MEAN);
+		stress_metrics_set(args, 1, "usec p50 latency",
+			p50 * STRESS_DBL_MICROSECOND, STRESS_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 2, "usec p90 latency",
+			p90 * STRESS_DBL_MICROSECOND, STRESS_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 3, "usec p99 latency",
+			p99 * STRESS_DBL_MICROSECOND, STRESS_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 4, "usec p99.9 latency",
+			p999 * STRESS_DBL_MICROSECOND, STRESS_GEOMETRIC_MEAN);
+		stress_metrics_set(args, 5, "% requests on busiest thread",
+			requests ? 100.0 * (double)max_requests / (double)requests : 0.0,
+			STRESS_GEOMETRIC_MEAN);
+	}
+
+tidy:
+	if (bench.servers) {
+		for (i = 0; i < n_threads; i++) {
+			stress_epoll_bench_server_t *server = &bench.servers[i];
+			stress_epoll_bench_conn_t *conn, *next;
+
+			for (conn = server->conns; conn; conn = next) {
+				next = conn->next;
+				if (conn->fd >= 0)
+					(void)close(conn->fd);
+				free(conn);
+			}
+			if ((server->listener.fd >= 0) && (server->listener.fd != listen_fd))
+				(void)close(server->listener.fd);
+			if (server->efd >= 0)
+				(void)close(server->efd);
+		}
+		free(bench.servers);
+	}
+	if (listen_fd >= 0)
+		(void)close(listen_fd);
+	free(latencies);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_epoll
  *	stress by heavy socket I/O
@@ -1018,10 +1872,20 @@ static int stress_epoll(stress_args_t *args)
 	int epoll_port = DEFAULT_EPOLL_PORT;
 	int epoll_sockets = DEFAULT_EPOLL_SOCKETS;
 	int start_port, end_port, reserved_port;
+	uint32_t epoll_threads = 0;
+	uint32_t epoll_clients = DEFAULT_EPOLL_CLIENTS;
+	uint32_t epoll_busy_poll = 0;
+	size_t epoll_accept = EPOLL_ACCEPT_ACCEPTOR;
+	size_t epoll_trigger = EPOLL_TRIGGER_LEVEL;
 
 	(void)stress_get_setting("epoll-domain", &epoll_domain);
 	(void)stress_get_setting("epoll-port", &epoll_port);
 	(void)stress_get_setting("epoll-sockets", &epoll_sockets);
+	(void)stress_get_setting("epoll-threads", &epoll_threads);
+	(void)stress_get_setting("epoll-clients", &epoll_clients);
+	(void)stress_get_setting("epoll-busy-poll", &epoll_busy_poll);
+	(void)stress_get_setting("epoll-accept", &epoll_accept);
+	(void)stress_get_setting("epoll-trigger", &epoll_trigger);
 
 	if (stress_sighandler(args->name, SIGPIPE, SIG_IGN, NULL) < 0)
 		return EXIT_NO_RESOURCE;
@@ -1061,6 +1925,19 @@ static int stress_epoll(stress_args_t *args)
 			args->name, (intmax_t)args->pid, start_port, end_port);
 	}
 
+	if (epoll_threads > 0) {
+#if defined(STRESS_EPOLL_BENCH)
+		rc = stress_epoll_bench(args, start_port, epoll_domain, epoll_threads,
+			epoll_clients, epoll_accept, epoll_trigger, epoll_busy_poll);
+		stress_net_release_ports(start_port, end_port);
+		return rc;
+#else
+		if (args->instance == 0)
+			pr_inf("%s: pthreads or EPOLLET not supported, ignoring --epoll-threads option\n",
+				args->name);
+#endif
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	/*
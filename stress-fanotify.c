@@ -20,9 +20,14 @@
 #include "stress-ng.h"
 #include "core-builtin.h"
 #include "core-capabilities.h"
+#include "core-fsnotify.h"
 #include "core-killpid.h"
 #include "core-mounts.h"
 
+#if defined(HAVE_POLL_H)
+#include <poll.h>
+#endif
+
 #if defined(HAVE_SYS_FANOTIFY_H)
 #include <sys/fanotify.h>
 #endif
@@ -31,10 +36,45 @@
 #include <sys/select.h>
 #endif
 
+#define MIN_FANOTIFY_FILES	(1)
+#define MAX_FANOTIFY_FILES	(1000000)
+
+#define MIN_FANOTIFY_WRITERS	(1)
+#define MAX_FANOTIFY_WRITERS	(64)
+#define DEFAULT_FANOTIFY_WRITERS (4)
+
 static const stress_help_t help[] = {
-	{ NULL,	"fanotify N",	  "start N workers exercising fanotify events" },
-	{ NULL,	"fanotify-ops N", "stop fanotify workers after N bogo operations" },
-	{ NULL,	NULL,		  NULL }
+	{ NULL,	"fanotify N",		"start N workers exercising fanotify events" },
+	{ NULL,	"fanotify-files N",	"mark N files and measure event delivery rate and latency" },
+	{ NULL,	"fanotify-ops N",	"stop fanotify workers after N bogo operations" },
+	{ NULL,	"fanotify-writers N",	"number of threads modifying marked files (1..64)" },
+	{ NULL,	NULL,			NULL }
+};
+
+static int stress_set_fanotify_files(const char *opt)
+{
+	uint32_t fanotify_files;
+
+	fanotify_files = stress_get_uint32(opt);
+	stress_check_range("fanotify-files", (uint64_t)fanotify_files,
+		MIN_FANOTIFY_FILES, MAX_FANOTIFY_FILES);
+	return stress_set_setting("fanotify-files", TYPE_ID_UINT32, &fanotify_files);
+}
+
+static int stress_set_fanotify_writers(const char *opt)
+{
+	uint32_t fanotify_writers;
+
+	fanotify_writers = stress_get_uint32(opt);
+	stress_check_range("fanotify-writers", (uint64_t)fanotify_writers,
+		MIN_FANOTIFY_WRITERS, MAX_FANOTIFY_WRITERS);
+	return stress_set_setting("fanotify-writers", TYPE_ID_UINT32, &fanotify_writers);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_fanotify_files,	stress_set_fanotify_files },
+	{ OPT_fanotify_writers,	stress_set_fanotify_writers },
+	{ 0,			NULL }
 };
 
 #if defined(HAVE_MNTENT_H) &&		\
@@ -472,6 +512,224 @@ static void stress_fanotify_read_events(
 	}
 }
 
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(FAN_CLASS_NOTIF) &&		\
+    defined(FAN_NONBLOCK) &&		\
+    defined(FAN_CLOSE_WRITE) &&		\
+    defined(FAN_Q_OVERFLOW) &&		\
+    defined(FAN_MARK_ADD) &&		\
+    defined(FAN_MARK_MOUNT) &&		\
+    defined(O_DIRECTORY) &&		\
+    defined(HAVE_POLL_H)
+
+#define FANOTIFY_SCALE_BUF_SIZE		(64 * KB)	/* event read buffer */
+
+/* inode to file index lookup */
+typedef struct {
+	ino_t ino;
+	size_t idx;
+} stress_fanotify_ino_t;
+
+static int stress_fanotify_ino_cmp(const void *p1, const void *p2)
+{
+	const stress_fanotify_ino_t *i1 = (const stress_fanotify_ino_t *)p1;
+	const stress_fanotify_ino_t *i2 = (const stress_fanotify_ino_t *)p2;
+
+	if (i1->ino > i2->ino)
+		return 1;
+	else if (i1->ino < i2->ino)
+		return -1;
+	return 0;
+}
+
+/*
+ *  stress_fanotify_scale()
+ *	mark the whole file system holding a large number of files,
+ *	modify them from writer threads and measure the event delivery
+ *	rate, latency and queue overflows
+ */
+static int stress_fanotify_scale(
+	stress_args_t *args,
+	const char *pathname,
+	const uint32_t fanotify_files,
+	const uint32_t fanotify_writers)
+{
+	stress_fsnotify_scale_t scale;
+	const pid_t mypid = getpid();
+	const size_t n_dirs = (fanotify_files + STRESS_FSNOTIFY_PER_DIR - 1) / STRESS_FSNOTIFY_PER_DIR;
+	size_t i, n_files = 0;
+	int *dir_fds, fan_fd = -1, rc = EXIT_SUCCESS, ret;
+	double t_start, duration;
+	stress_fanotify_ino_t *inodes = NULL;
+	const char *mark = "file system";
+	char *buf = NULL;
+
+	if (stress_fsnotify_scale_init(&scale, (size_t)fanotify_files) < 0) {
+		pr_inf_skip("%s: cannot allocate file state, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	dir_fds = (int *)calloc(n_dirs, sizeof(*dir_fds));
+	inodes = (stress_fanotify_ino_t *)calloc(fanotify_files, sizeof(*inodes));
+	buf = (char *)malloc(FANOTIFY_SCALE_BUF_SIZE);
+	if (!dir_fds || !inodes || !buf) {
+		pr_inf_skip("%s: cannot allocate file state, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_free;
+	}
+	for (i = 0; i < n_dirs; i++)
+		dir_fds[i] = -1;
+
+	/* create the files, STRESS_FSNOTIFY_PER_DIR per directory */
+	for (i = 0; (i < n_dirs) && stress_continue(args); i++) {
+		char dirname[PATH_MAX], name[32];
+		size_t j;
+
+		(void)snprintf(name, sizeof(name), "d%zu", i);
+		(void)stress_mk_filename(dirname, sizeof(dirname), pathname, name);
+		if (mkdir(dirname, S_IRWXU) < 0)
+			break;
+		dir_fds[i] = open(dirname, O_RDONLY | O_DIRECTORY);
+		if (dir_fds[i] < 0)
+			break;
+		for (j = 0; (j < STRESS_FSNOTIFY_PER_DIR) && (n_files < fanotify_files); j++) {
+			struct stat statbuf;
+			int fd;
+
+			(void)snprintf(name, sizeof(name), "f%zu", j);
+			fd = openat(dir_fds[i], name, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+			if (fd < 0)
+				break;
+			if (shim_fstat(fd, &statbuf) < 0) {
+				(void)close(fd);
+				break;
+			}
+			(void)close(fd);
+			inodes[n_files].ino = statbuf.st_ino;
+			inodes[n_files].idx = n_files;
+			n_files++;
+		}
+		if (j < STRESS_FSNOTIFY_PER_DIR)
+			break;
+	}
+	if (!stress_continue(args))
+		goto tidy_files;
+	if (n_files == 0) {
+		pr_inf_skip("%s: cannot create any files, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_files;
+	}
+	qsort(inodes, n_files, sizeof(*inodes), stress_fanotify_ino_cmp);
+
+	fan_fd = fanotify_init(FAN_CLASS_NOTIF | FAN_NONBLOCK, O_RDONLY);
+	if (fan_fd < 0) {
+		pr_inf_skip("%s: fanotify_init failed, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_files;
+	}
+	/* one mark covers every file, fall back to a mount mark on older kernels */
+	ret = -1;
+#if defined(FAN_MARK_FILESYSTEM)
+	ret = fanotify_mark(fan_fd, FAN_MARK_ADD | FAN_MARK_FILESYSTEM,
+		FAN_CLOSE_WRITE, AT_FDCWD, pathname);
+#endif
+	if (ret < 0) {
+		mark = "mount";
+		ret = fanotify_mark(fan_fd, FAN_MARK_ADD | FAN_MARK_MOUNT,
+			FAN_CLOSE_WRITE, AT_FDCWD, pathname);
+	}
+	if (ret < 0) {
+		pr_inf_skip("%s: fanotify_mark failed, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_files;
+	}
+	if (args->instance == 0)
+		pr_inf("%s: %zu files on a %s wide mark, %" PRIu32 " writer threads\n",
+			args->name, n_files, mark, fanotify_writers);
+
+	/* split the files between the writers */
+	(void)stress_fsnotify_scale_start(&scale, dir_fds, n_files, (size_t)fanotify_writers);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	t_start = stress_time_now();
+	while (stress_continue(args) && (scale.started > 0)) {
+		struct pollfd pfd;
+		struct fanotify_event_metadata *metadata;
+		ssize_t len;
+		uint64_t t_now;
+
+		pfd.fd = fan_fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if (poll(&pfd, 1, 100) <= 0)
+			continue;
+		len = read(fan_fd, buf, FANOTIFY_SCALE_BUF_SIZE);
+		if (len <= 0)
+			continue;
+		t_now = stress_time_now_ns();
+
+		metadata = (struct fanotify_event_metadata *)(void *)buf;
+		while (FAN_EVENT_OK(metadata, len)) {
+			struct stat statbuf;
+
+			if (metadata->vers != FANOTIFY_METADATA_VERSION)
+				break;
+			if (metadata->mask & FAN_Q_OVERFLOW) {
+				scale.overflows++;
+			} else if (metadata->pid == mypid) {
+				/* ignore events from other processes on the file system */
+				scale.events++;
+				if ((metadata->fd >= 0) && (shim_fstat(metadata->fd, &statbuf) == 0)) {
+					stress_fanotify_ino_t key, *found;
+
+					key.ino = statbuf.st_ino;
+					key.idx = 0;
+					found = (stress_fanotify_ino_t *)bsearch(&key, inodes, n_files,
+						sizeof(*inodes), stress_fanotify_ino_cmp);
+					if (found)
+						stress_fsnotify_scale_event(&scale, found->idx, t_now);
+				}
+			}
+			if (metadata->fd >= 0)
+				(void)close(metadata->fd);
+			metadata = FAN_EVENT_NEXT(metadata, len);
+		}
+		stress_bogo_set(args, scale.events);
+	}
+	duration = stress_time_now() - t_start;
+	rc = stress_fsnotify_scale_stop(args, &scale, duration);
+
+tidy_files:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	if (fan_fd >= 0)
+		(void)close(fan_fd);
+	for (i = 0; i < n_dirs; i++) {
+		char dirname[PATH_MAX], name[32];
+		size_t j;
+
+		if (dir_fds[i] >= 0) {
+			for (j = 0; j < STRESS_FSNOTIFY_PER_DIR; j++) {
+				(void)snprintf(name, sizeof(name), "f%zu", j);
+				if ((unlinkat(dir_fds[i], name, 0) < 0) && (errno == ENOENT))
+					break;
+			}
+			(void)close(dir_fds[i]);
+		}
+		(void)snprintf(name, sizeof(name), "d%zu", i);
+		(void)stress_mk_filename(dirname, sizeof(dirname), pathname, name);
+		(void)shim_rmdir(dirname);
+	}
+tidy_free:
+	free(buf);
+	free(inodes);
+	free(dir_fds);
+	stress_fsnotify_scale_free(&scale);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_fanotify()
  *	stress fanotify
@@ -482,6 +740,11 @@ static int stress_fanotify(stress_args_t *args)
 	pid_t pid;
 	int ret, rc = EXIT_SUCCESS;
 	stress_fanotify_account_t account;
+	uint32_t fanotify_files = 0;
+	uint32_t fanotify_writers = DEFAULT_FANOTIFY_WRITERS;
+
+	(void)stress_get_setting("fanotify-files", &fanotify_files);
+	(void)stress_get_setting("fanotify-writers", &fanotify_writers);
 
 	if (stress_sigchld_set_handler(args) < 0)
 		return EXIT_NO_RESOURCE;
@@ -495,6 +758,26 @@ static int stress_fanotify(stress_args_t *args)
 	if (ret < 0)
 		return stress_exit_status(-ret);
 
+	if (fanotify_files > 0) {
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(FAN_CLASS_NOTIF) &&		\
+    defined(FAN_NONBLOCK) &&		\
+    defined(FAN_CLOSE_WRITE) &&		\
+    defined(FAN_Q_OVERFLOW) &&		\
+    defined(FAN_MARK_ADD) &&		\
+    defined(FAN_MARK_MOUNT) &&		\
+    defined(O_DIRECTORY) &&		\
+    defined(HAVE_POLL_H)
+		ret = stress_fanotify_scale(args, pathname, fanotify_files, fanotify_writers);
+		(void)stress_temp_dir_rm_args(args);
+		return ret;
+#else
+		if (args->instance == 0)
+			pr_inf("%s: pthreads or poll() not supported, ignoring --fanotify-files option\n",
+				args->name);
+#endif
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	pid = fork();
@@ -742,6 +1025,7 @@ stressor_info_t stress_fanotify_info = {
 	.stressor = stress_fanotify,
 	.supported = stress_fanotify_supported,
 	.class = CLASS_FILESYSTEM | CLASS_SCHEDULER | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help
 };
@@ -749,6 +1033,7 @@ stressor_info_t stress_fanotify_info = {
 stressor_info_t stress_fanotify_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_FILESYSTEM | CLASS_SCHEDULER | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help,
 	.unimplemented_reason = "built without sys/fanotify.h"
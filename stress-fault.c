@@ -18,6 +18,8 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-pthread.h"
 #include "core-put.h"
 
 static sigjmp_buf jmp_env;
@@ -25,9 +27,77 @@ static volatile bool do_jmp = true;
 static volatile int die_signum = -1;
 
 static const stress_help_t help[] = {
-	{ NULL,	"fault N",	"start N workers producing page faults" },
-	{ NULL,	"fault-ops N",	"stop after N page fault bogo operations" },
-	{ NULL,	NULL,		NULL }
+	{ NULL,	"fault N",	  "start N workers producing page faults" },
+	{ NULL,	"fault-churn",	  "mmap and munmap concurrently with --fault-threads" },
+	{ NULL,	"fault-mem M",	  "select --fault-threads memory, anon, file, shmem or all" },
+	{ NULL,	"fault-ops N",	  "stop after N page fault bogo operations" },
+	{ NULL,	"fault-shared",	  "--fault-threads threads fault in one shared mapping" },
+	{ NULL,	"fault-threads N","measure fault scalability with 1 to N threads in one mm" },
+	{ NULL,	NULL,		  NULL }
+};
+
+#define FAULT_MEM_ANON		(0x01)
+#define FAULT_MEM_FILE		(0x02)
+#define FAULT_MEM_SHMEM		(0x04)
+#define FAULT_MEM_ALL		(FAULT_MEM_ANON | FAULT_MEM_FILE | FAULT_MEM_SHMEM)
+
+#define MAX_FAULT_THREADS	(1024)
+
+typedef struct {
+	const char *name;
+	const int mem;
+} stress_fault_mem_t;
+
+static const stress_fault_mem_t fault_mems[] = {
+	{ "anon",	FAULT_MEM_ANON },
+	{ "file",	FAULT_MEM_FILE },
+	{ "shmem",	FAULT_MEM_SHMEM },
+	{ "all",	FAULT_MEM_ALL },
+};
+
+static int stress_set_fault_threads(const char *opt)
+{
+	size_t fault_threads;
+
+	fault_threads = (size_t)stress_get_uint64(opt);
+	stress_check_range("fault-threads", fault_threads, 1, MAX_FAULT_THREADS);
+	return stress_set_setting("fault-threads", TYPE_ID_SIZE_T, &fault_threads);
+}
+
+static int stress_set_fault_mem(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(fault_mems); i++) {
+		if (!strcmp(fault_mems[i].name, opt)) {
+			int mem = fault_mems[i].mem;
+
+			return stress_set_setting("fault-mem", TYPE_ID_INT, &mem);
+		}
+	}
+	(void)fprintf(stderr, "fault-mem must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(fault_mems); i++)
+		(void)fprintf(stderr, " %s", fault_mems[i].name);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_fault_shared(const char *opt)
+{
+	return stress_set_setting_true("fault-shared", opt);
+}
+
+static int stress_set_fault_churn(const char *opt)
+{
+	return stress_set_setting_true("fault-churn", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_fault_churn,	stress_set_fault_churn },
+	{ OPT_fault_mem,	stress_set_fault_mem },
+	{ OPT_fault_shared,	stress_set_fault_shared },
+	{ OPT_fault_threads,	stress_set_fault_threads },
+	{ 0,			NULL }
 };
 
 /*
@@ -42,6 +112,364 @@ static void MLOCKED_TEXT stress_segvhandler(int signum)
 		siglongjmp(jmp_env, 1);		/* Ugly, bounce back */
 }
 
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_MADVISE) &&		\
+    defined(MADV_DONTNEED)
+
+#define FAULT_SCALE_PAGES	(128)	/* pages faulted per thread per pass */
+#define FAULT_SCALE_SLOT	(0.25)	/* seconds per memory type and thread count */
+#define FAULT_SCALE_CHURN_PAGES	(16)	/* pages mapped per churn mmap */
+#define FAULT_SCALE_MAX_COUNTS	(16)	/* maximum thread counts in the sweep */
+#define FAULT_SCALE_MEMS	(3)	/* anon, file, shmem */
+
+/* a faulting thread, or the mmap/munmap churn thread */
+typedef struct {
+	stress_args_t *args;
+	volatile bool *go;		/* start faulting */
+	volatile bool *stop;		/* stop faulting */
+	uint8_t *mem;			/* pages to fault */
+	size_t size;			/* size of pages to fault */
+	uint64_t passes;		/* passes over all the pages */
+	uint64_t faults;		/* pages faulted */
+	pthread_t pthread;
+	int ret;
+} stress_fault_thread_t;
+
+/* cumulative faults for a memory type and thread count */
+typedef struct {
+	uint64_t faults;
+	double duration;
+} stress_fault_scale_t;
+
+static void *nowt = NULL;
+
+/*
+ *  stress_fault_scale_thread()
+ *	fault in all the pages of a region then drop them again
+ *	with MADV_DONTNEED so the next pass faults them back in
+ */
+static void *stress_fault_scale_thread(void *arg)
+{
+	stress_fault_thread_t *thread = (stress_fault_thread_t *)arg;
+	const size_t page_size = thread->args->page_size;
+
+	while (!*thread->go && !*thread->stop)
+		(void)shim_sched_yield();
+
+	while (!*thread->stop) {
+		uint8_t *ptr;
+
+		for (ptr = thread->mem; ptr < thread->mem + thread->size; ptr += page_size)
+			*(volatile uint8_t *)ptr = 1;
+		thread->faults += thread->size / page_size;
+		thread->passes++;
+		(void)madvise((void *)thread->mem, thread->size, MADV_DONTNEED);
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_fault_churn_thread()
+ *	map, touch and unmap memory to contend with the faulting
+ *	threads on the mm's mmap lock
+ */
+static void *stress_fault_churn_thread(void *arg)
+{
+	stress_fault_thread_t *thread = (stress_fault_thread_t *)arg;
+	const size_t page_size = thread->args->page_size;
+	const size_t size = page_size * FAULT_SCALE_CHURN_PAGES;
+
+	while (!*thread->go && !*thread->stop)
+		(void)shim_sched_yield();
+
+	while (!*thread->stop) {
+		uint8_t *mem, *ptr;
+
+		mem = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mem == MAP_FAILED) {
+			(void)shim_sched_yield();
+			continue;
+		}
+		for (ptr = mem; ptr < mem + size; ptr += page_size)
+			*(volatile uint8_t *)ptr = 1;
+		(void)munmap((void *)mem, size);
+		thread->passes++;
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_fault_scale_map()
+ *	map size bytes of anonymous, file backed or shmem memory
+ */
+static uint8_t *stress_fault_scale_map(const int mem, const size_t size, const int fd, const off_t offset)
+{
+	uint8_t *ptr;
+
+	switch (mem) {
+	case FAULT_MEM_FILE:
+		return (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+				MAP_SHARED, fd, offset);
+	case FAULT_MEM_SHMEM:
+		return (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	default:
+		ptr = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		/* keep to base page faults, huge pages would hide the scaling */
+		if (ptr != MAP_FAILED)
+			(void)shim_madvise((void *)ptr, size, MADV_NOHUGEPAGE);
+		return ptr;
+	}
+}
+
+/*
+ *  stress_fault_scale_run()
+ *	fault with n_threads threads in one mm for FAULT_SCALE_SLOT
+ *	seconds, returns 1 if memory is not available, 2 if the
+ *	threads could not be created
+ */
+static int stress_fault_scale_run(
+	stress_args_t *args,
+	const int mem,
+	const size_t n_threads,
+	const bool fault_shared,
+	const bool fault_churn,
+	const int fd,
+	stress_fault_thread_t *threads,
+	stress_fault_scale_t *scale)
+{
+	const size_t size = args->page_size * FAULT_SCALE_PAGES;
+	stress_fault_thread_t *churn = &threads[n_threads];
+	volatile bool go = false, stop = false;
+	uint8_t *shared = MAP_FAILED;
+	uint64_t faults = 0, passes = 0;
+	size_t i, started = 0;
+	double t;
+	int rc = 0;
+
+	(void)shim_memset(threads, 0, sizeof(*threads) * (n_threads + 1));
+	if (fault_shared) {
+		/* one mapping, each thread faults its own slice of it */
+		shared = stress_fault_scale_map(mem, size * n_threads, fd, 0);
+		if (shared == MAP_FAILED)
+			return 1;
+	}
+	for (i = 0; i < n_threads; i++) {
+		threads[i].mem = fault_shared ? shared + (size * i) :
+			stress_fault_scale_map(mem, size, fd, (off_t)(size * i));
+		if (threads[i].mem == MAP_FAILED) {
+			rc = 1;
+			goto unmap;
+		}
+	}
+	for (i = 0; i < n_threads; i++) {
+		threads[i].args = args;
+		threads[i].go = &go;
+		threads[i].stop = &stop;
+		threads[i].size = size;
+		threads[i].ret = pthread_create(&threads[i].pthread, NULL,
+					stress_fault_scale_thread, (void *)&threads[i]);
+		if (threads[i].ret != 0)
+			break;
+		started++;
+	}
+	if (fault_churn && (started == n_threads)) {
+		churn->args = args;
+		churn->go = &go;
+		churn->stop = &stop;
+		churn->ret = pthread_create(&churn->pthread, NULL,
+					stress_fault_churn_thread, (void *)churn);
+	} else {
+		churn->ret = -1;
+	}
+
+	t = stress_time_now();
+	go = true;
+	while (stress_continue(args) && (started == n_threads) &&
+	       (stress_time_now() - t < FAULT_SCALE_SLOT))
+		(void)shim_usleep(10000);
+	stop = true;
+	t = stress_time_now() - t;
+
+	for (i = 0; i < started; i++) {
+		(void)pthread_join(threads[i].pthread, NULL);
+		faults += threads[i].faults;
+		passes += threads[i].passes;
+	}
+	if (churn->ret == 0)
+		(void)pthread_join(churn->pthread, NULL);
+
+	if (started == n_threads) {
+		scale->faults += faults;
+		scale->duration += t;
+	} else {
+		const int ret = threads[started].ret;
+
+		pr_inf("%s: could only create %zu of %zu threads, errno=%d (%s)\n",
+			args->name, started, n_threads, ret, strerror(ret));
+		rc = 2;
+	}
+	stress_bogo_add(args, passes);
+	if (args->max_ops && (stress_bogo_get(args) > args->max_ops))
+		stress_bogo_set(args, args->max_ops);
+unmap:
+	if (fault_shared) {
+		(void)munmap((void *)shared, size * n_threads);
+	} else {
+		for (i = 0; i < n_threads; i++) {
+			if (threads[i].mem && (threads[i].mem != MAP_FAILED))
+				(void)munmap((void *)threads[i].mem, size);
+		}
+	}
+	return rc;
+}
+
+/*
+ *  stress_fault_scale()
+ *	measure page faults per second as the number of threads
+ *	faulting concurrently in one address space increases
+ */
+static int stress_fault_scale(stress_args_t *args, const size_t fault_threads)
+{
+	static const int mems[FAULT_SCALE_MEMS] = {
+		FAULT_MEM_ANON, FAULT_MEM_FILE, FAULT_MEM_SHMEM
+	};
+	static const char * const mem_names[FAULT_SCALE_MEMS] = {
+		"anon", "file", "shmem"
+	};
+	const size_t size = args->page_size * FAULT_SCALE_PAGES;
+	stress_fault_scale_t scales[FAULT_SCALE_MEMS][FAULT_SCALE_MAX_COUNTS];
+	bool available[FAULT_SCALE_MEMS];
+	stress_fault_thread_t *threads;
+	size_t counts[FAULT_SCALE_MAX_COUNTS], n_counts = 0, c, idx = 0;
+	int fault_mem = FAULT_MEM_ALL, fd = -1, m;
+	bool fault_shared = false, fault_churn = false;
+	char filename[PATH_MAX];
+
+	(void)stress_get_setting("fault-mem", &fault_mem);
+	(void)stress_get_setting("fault-shared", &fault_shared);
+	(void)stress_get_setting("fault-churn", &fault_churn);
+
+	/* 1, 2, 4.. threads doubling, then all threads */
+	for (c = 1; (c <= fault_threads) && (n_counts < FAULT_SCALE_MAX_COUNTS - 1); c *= 2)
+		counts[n_counts++] = c;
+	if (counts[n_counts - 1] != fault_threads)
+		counts[n_counts++] = fault_threads;
+
+	threads = (stress_fault_thread_t *)calloc(fault_threads + 1, sizeof(*threads));
+	if (!threads) {
+		pr_inf_skip("%s: cannot allocate %zu thread contexts, skipping stressor\n",
+			args->name, fault_threads + 1);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)shim_memset(scales, 0, sizeof(scales));
+	for (m = 0; m < FAULT_SCALE_MEMS; m++)
+		available[m] = !!(fault_mem & mems[m]);
+
+	if (fault_mem & FAULT_MEM_FILE) {
+		int ret;
+
+		ret = stress_temp_dir_mk_args(args);
+		if (ret < 0) {
+			free(threads);
+			return stress_exit_status(-ret);
+		}
+		(void)stress_temp_filename_args(args,
+			filename, sizeof(filename), stress_mwc32());
+		fd = open(filename, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+		if (fd < 0) {
+			pr_inf("%s: cannot create %s, errno=%d (%s), skipping file backed faults\n",
+				args->name, filename, errno, strerror(errno));
+			available[1] = false;
+		} else {
+			(void)shim_unlink(filename);
+			if (ftruncate(fd, (off_t)(size * fault_threads)) < 0) {
+				pr_inf("%s: cannot size file, errno=%d (%s), skipping file backed faults\n",
+					args->name, errno, strerror(errno));
+				available[1] = false;
+			}
+		}
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (m = 0; m < FAULT_SCALE_MEMS; m++) {
+			for (c = 0; (c < n_counts) && available[m]; c++) {
+				int ret;
+
+				if (!stress_continue(args))
+					goto finish;
+				ret = stress_fault_scale_run(args, mems[m], counts[c],
+						fault_shared, fault_churn, fd, threads, &scales[m][c]);
+				if (ret == 2) {
+					/* larger thread counts will not fit either */
+					n_counts = c;
+					if (n_counts == 0)
+						goto finish;
+					break;
+				}
+				if (ret == 1) {
+					pr_inf("%s: cannot map %s memory, errno=%d (%s), skipping %s faults\n",
+						args->name, mem_names[m], errno, strerror(errno), mem_names[m]);
+					available[m] = false;
+				}
+			}
+		}
+	} while (stress_continue(args));
+finish:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0) {
+		pr_block_begin();
+		pr_inf("%s: page faults per second, %s%s:\n", args->name,
+			fault_shared ? "threads sharing one mapping" : "one mapping per thread",
+			fault_churn ? " with concurrent mmap/munmap" : "");
+		pr_inf("%s: %7s %13s %13s %13s\n", args->name, "threads",
+			mem_names[0], mem_names[1], mem_names[2]);
+		for (c = 0; c < n_counts; c++) {
+			char buf[64];
+			int len = 0;
+
+			for (m = 0; m < FAULT_SCALE_MEMS; m++) {
+				const stress_fault_scale_t *s = &scales[m][c];
+
+				if (s->duration > 0.0)
+					len += snprintf(buf + len, sizeof(buf) - (size_t)len, " %13.0f",
+						(double)s->faults / s->duration);
+				else
+					len += snprintf(buf + len, sizeof(buf) - (size_t)len, " %13s", "n/a");
+			}
+			pr_inf("%s: %7zu%s\n", args->name, counts[c], buf);
+		}
+		pr_block_end();
+	}
+
+	for (m = 0; m < FAULT_SCALE_MEMS; m++) {
+		for (c = 0; c < n_counts; c++) {
+			const stress_fault_scale_t *s = &scales[m][c];
+			char str[64];
+
+			if (s->duration <= 0.0)
+				continue;
+			(void)snprintf(str, sizeof(str), "%s page faults per sec with %zu thread%s",
+				mem_names[m], counts[c], counts[c] > 1 ? "s" : "");
+			stress_metrics_set(args, idx++, str,
+				(double)s->faults / s->duration, STRESS_HARMONIC_MEAN);
+		}
+	}
+
+	if (fd >= 0)
+		(void)close(fd);
+	if (fault_mem & FAULT_MEM_FILE)
+		(void)stress_temp_dir_rm_args(args);
+	free(threads);
+
+	return EXIT_SUCCESS;
+}
+#endif
+
 /*
  *  stress_fault()
  *	stress min and max page faulting
@@ -66,6 +494,19 @@ static int stress_fault(stress_args_t *args)
 	double t1 = 0.0, t2 = 0.0, dt;
 #endif
 	NOCLOBBER double duration = 0.0, count = 0.0;
+	size_t fault_threads = 0;
+
+	if (stress_get_setting("fault-threads", &fault_threads)) {
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_MADVISE) &&		\
+    defined(MADV_DONTNEED)
+		return stress_fault_scale(args, fault_threads);
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --fault-threads requires pthreads and madvise(), ignoring option\n",
+				args->name);
+#endif
+	}
 
 	ret = stress_temp_dir_mk_args(args);
 	if (ret < 0)
@@ -278,5 +719,6 @@ next:
 stressor_info_t stress_fault_info = {
 	.stressor = stress_fault,
 	.class = CLASS_INTERRUPT | CLASS_SCHEDULER | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
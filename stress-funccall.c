@@ -65,7 +65,7 @@ STRESS_PRAGMA_NO_HARD_DFP
 #undef HAVE_Decimal128
 #endif
 
-typedef bool (*stress_funccall_func)(stress_args_t *args);
+typedef bool (*stress_funccall_func)(stress_bogo_batch_t *bb);
 
 typedef struct {
 	const char              *name;  /* human readable form of stressor */
@@ -158,10 +158,10 @@ static inline double stress_mwcdouble(void)
 
 #define stress_funccall_type(type, rndfunc, cmpfunc)			\
 static bool NOINLINE 							\
-stress_funccall_ ## type(stress_args_t *args);			\
+stress_funccall_ ## type(stress_bogo_batch_t *bb);		\
 									\
 static bool NOINLINE							\
-stress_funccall_ ## type(stress_args_t *args)			\
+stress_funccall_ ## type(stress_bogo_batch_t *bb)		\
 {									\
 	register int ii;						\
 	type res_old;							\
@@ -209,7 +209,7 @@ stress_funccall_ ## type(stress_args_t *args)			\
 			}						\
 		}							\
 	}								\
-	stress_bogo_inc(args);						\
+	stress_bogo_batch_inc(bb);					\
 	return true;							\
 }
 
@@ -1138,7 +1138,7 @@ stress_funcdeep_9(_Float128)
 stress_funccall_type(_Float128, (_Float128)stress_mwc64, cmp_fp)
 #endif
 
-static bool stress_funccall_all(stress_args_t *args);
+static bool stress_funccall_all(stress_bogo_batch_t *bb);
 
 /*
  * Table of func call stress methods
@@ -1206,30 +1206,30 @@ static const stress_funccall_method_info_t stress_funccall_methods[] = {
 
 static stress_metrics_t stress_funccall_metrics[SIZEOF_ARRAY(stress_funccall_methods)];
 
-static bool stress_funccall_exercise(stress_args_t *args, const size_t method)
+static bool stress_funccall_exercise(stress_bogo_batch_t *bb, const size_t method)
 {
 	bool success;
 	double t;
 
 	t = stress_time_now();
-	success = stress_funccall_methods[method].func(args);
+	success = stress_funccall_methods[method].func(bb);
 	stress_funccall_metrics[method].duration += stress_time_now() - t;
 	stress_funccall_metrics[method].count += 1.0;
 
 	if (!success && (method != 0)) {
 		pr_fail("%s: verification failed with a nested %s function call return value\n",
-			args->name, stress_funccall_methods[method].name);
+			bb->args->name, stress_funccall_methods[method].name);
 	}
 	return success;
 }
 
-static bool stress_funccall_all(stress_args_t *args)
+static bool stress_funccall_all(stress_bogo_batch_t *bb)
 {
 	size_t i;
 	bool success = true;
 
 	for (i = 1; success && (i < SIZEOF_ARRAY(stress_funccall_methods)); i++) {
-		success &= stress_funccall_exercise(args, i);
+		success &= stress_funccall_exercise(bb, i);
 	}
 	return success;
 }
@@ -1266,6 +1266,7 @@ static int stress_funccall(stress_args_t *args)
 {
 	size_t funccall_method = 0;
 	bool success;
+	stress_bogo_batch_t bb;
 
 	size_t i, j;
 
@@ -1276,11 +1277,13 @@ static int stress_funccall(stress_args_t *args)
 
 	(void)stress_get_setting("funccall-method", &funccall_method);
 
+	stress_bogo_batch_init(&bb, args, STRESS_BOGO_BATCH_DEFAULT);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
-		success = stress_funccall_exercise(args, funccall_method);
-	} while (success && stress_continue(args));
+		success = stress_funccall_exercise(&bb, funccall_method);
+	} while (success && stress_bogo_batch_continue(&bb));
+	stress_bogo_batch_flush(&bb);
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 
@@ -18,6 +18,7 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
 
 #if defined(__NR_getdents)
 #define HAVE_GETDENTS
@@ -27,10 +28,29 @@
 #define HAVE_GETDENTS64
 #endif
 
+#define MIN_GETDENT_ENTRIES	(10)
+#define MAX_GETDENT_ENTRIES	(10000000)
+
 static const stress_help_t help[] = {
-	{ NULL,	"getdent N",	 "start N workers reading directories using getdents" },
-	{ NULL,	"getdent-ops N", "stop after N getdents bogo operations" },
-	{ NULL,	NULL,		 NULL }
+	{ NULL,	"getdent N",		"start N workers reading directories using getdents" },
+	{ NULL,	"getdent-entries N",	"enumerate a directory of N entries using a range of buffer sizes" },
+	{ NULL,	"getdent-ops N",	"stop after N getdents bogo operations" },
+	{ NULL,	NULL,			NULL }
+};
+
+static int stress_set_getdent_entries(const char *opt)
+{
+	uint32_t getdent_entries;
+
+	getdent_entries = stress_get_uint32(opt);
+	stress_check_range("getdent-entries", (uint64_t)getdent_entries,
+		MIN_GETDENT_ENTRIES, MAX_GETDENT_ENTRIES);
+	return stress_set_setting("getdent-entries", TYPE_ID_UINT32, &getdent_entries);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_getdent_entries,	stress_set_getdent_entries },
+	{ 0,			NULL }
 };
 
 #if defined(HAVE_GETDENTS64) || defined(HAVE_GETDENTS)
@@ -278,6 +298,310 @@ exit_close:
 }
 #endif
 
+#if defined(HAVE_GETDENTS64)
+
+#define GETDENT_LARGE_METHODS	(SIZEOF_ARRAY(getdent_large_buf_sizes) + 1)
+
+/* getdents64 buffer sizes to sweep, the last method is readdir() */
+static const size_t getdent_large_buf_sizes[] = {
+	4 * KB, 16 * KB, 64 * KB, 256 * KB, 1 * MB
+};
+
+/* per enumeration method statistics, index 0 warm, 1 cold dcache */
+typedef struct {
+	double duration[2];		/* time enumerating */
+	double entries[2];		/* entries read */
+	double calls[2];		/* getdents64 calls made */
+} stress_getdent_large_t;
+
+/*
+ *  stress_getdent_large_name()
+ *	make a directory entry name that is unique for idx and
+ *	with a pseudo-random length of 8..64 characters
+ */
+static void stress_getdent_large_name(char *name, const size_t name_len, const uint32_t idx)
+{
+	const size_t len = 8 + (size_t)(((idx * 2654435761U) >> 16) % 57);
+	size_t i;
+	int n;
+
+	n = snprintf(name, name_len, "%" PRIx32 "_", idx);
+	if (n < 0)
+		return;
+	for (i = (size_t)n; (i < len) && (i < name_len - 1); i++)
+		name[i] = 'a' + (char)((idx + i) % 26);
+	name[i] = '\0';
+}
+
+/*
+ *  stress_getdent_large_getdents()
+ *	enumerate a directory with getdents64 using a buffer of buf_sz
+ *	bytes, returns number of entries (excluding . and ..) or -errno
+ */
+static int64_t stress_getdent_large_getdents(
+	const char *path,
+	void *buf,
+	const size_t buf_sz,
+	double *calls)
+{
+	int fd;
+	int64_t entries = 0;
+
+	fd = open(path, O_RDONLY | O_DIRECTORY);
+	if (fd < 0)
+		return -errno;
+
+	for (;;) {
+		const int nread = shim_getdents64((unsigned int)fd, buf, (unsigned int)buf_sz);
+		struct shim_linux_dirent64 *ptr = (struct shim_linux_dirent64 *)buf;
+		const struct shim_linux_dirent64 *end;
+
+		(*calls) += 1.0;
+		if (nread < 0) {
+			entries = -errno;
+			break;
+		}
+		if (nread == 0)
+			break;
+		end = (struct shim_linux_dirent64 *)stress_gendent_offset(buf, nread);
+		while (ptr < end) {
+			if (!stress_is_dot_filename(ptr->d_name))
+				entries++;
+			ptr = (struct shim_linux_dirent64 *)stress_gendent_offset((void *)ptr, ptr->d_reclen);
+		}
+	}
+	(void)close(fd);
+
+	return entries;
+}
+
+/*
+ *  stress_getdent_large_readdir()
+ *	enumerate a directory with readdir, returns number of entries
+ *	(excluding . and ..) or -errno
+ */
+static int64_t stress_getdent_large_readdir(const char *path)
+{
+	DIR *dir;
+	const struct dirent *d;
+	int64_t entries = 0;
+
+	dir = opendir(path);
+	if (!dir)
+		return -errno;
+	while ((d = readdir(dir)) != NULL) {
+		if (!stress_is_dot_filename(d->d_name))
+			entries++;
+	}
+	(void)closedir(dir);
+
+	return entries;
+}
+
+/*
+ *  stress_getdent_large()
+ *	create a directory of getdent_entries entries with varying name
+ *	lengths and enumerate it with getdents64 over a range of buffer
+ *	sizes and with readdir, with a warm and (if caches can be dropped)
+ *	a cold dcache
+ */
+static int stress_getdent_large(stress_args_t *args, const uint32_t getdent_entries)
+{
+	char pathname[PATH_MAX - 16], dirname[PATH_MAX], name[80];
+	stress_getdent_large_t stats[GETDENT_LARGE_METHODS];
+	const size_t max_buf_sz = getdent_large_buf_sizes[SIZEOF_ARRAY(getdent_large_buf_sizes) - 1];
+	uint32_t n_entries = 0, i;
+	size_t metrics_idx = 0;
+	bool cold = true;
+	int dir_fd, ret, rc = EXIT_SUCCESS;
+	void *buf;
+	double t;
+
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0)
+		return stress_exit_status(-ret);
+	stress_temp_dir_args(args, pathname, sizeof(pathname));
+	(void)stress_mk_filename(dirname, sizeof(dirname), pathname, "large");
+
+	buf = malloc(max_buf_sz);
+	if (!buf) {
+		pr_inf_skip("%s: cannot allocate %zu byte getdents buffer, skipping stressor\n",
+			args->name, max_buf_sz);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_dir;
+	}
+	if (mkdir(dirname, S_IRWXU) < 0) {
+		pr_inf_skip("%s: cannot create directory %s, errno=%d (%s), skipping stressor\n",
+			args->name, dirname, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_buf;
+	}
+	dir_fd = open(dirname, O_RDONLY | O_DIRECTORY);
+	if (dir_fd < 0) {
+		pr_inf_skip("%s: cannot open directory %s, errno=%d (%s), skipping stressor\n",
+			args->name, dirname, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_rmdir;
+	}
+
+	t = stress_time_now();
+	for (n_entries = 0; (n_entries < getdent_entries) && stress_continue(args); n_entries++) {
+		int fd;
+
+		stress_getdent_large_name(name, sizeof(name), n_entries);
+		fd = openat(dir_fd, name, O_CREAT | O_WRONLY, S_IRUSR | S_IWUSR);
+		if (fd < 0) {
+			if (args->instance == 0)
+				pr_inf("%s: only %" PRIu32 " of %" PRIu32 " directory entries created, "
+					"errno=%d (%s)\n", args->name, n_entries, getdent_entries,
+					errno, strerror(errno));
+			break;
+		}
+		(void)close(fd);
+	}
+	if (!stress_continue(args))
+		goto tidy_files;
+	if (n_entries == 0) {
+		pr_inf_skip("%s: cannot create any directory entries, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_files;
+	}
+	if (args->instance == 0)
+		pr_dbg("%s: created %" PRIu32 " directory entries in %.2f secs\n",
+			args->name, n_entries, stress_time_now() - t);
+
+	(void)shim_memset(stats, 0, sizeof(stats));
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		size_t method;
+
+		for (method = 0; (method < GETDENT_LARGE_METHODS) && stress_continue(args); method++) {
+			int variant;
+
+			/*
+			 *  variant 0 is a warm dcache, 1 is after dropping the dentry
+			 *  and inode caches and the page cache holding directory blocks
+			 */
+			for (variant = 0; (variant < (cold ? 2 : 1)) && stress_continue(args); variant++) {
+				int64_t entries;
+				double calls = 0.0;
+
+				if (variant == 1) {
+					(void)sync();
+					if (stress_system_write("/proc/sys/vm/drop_caches", "3", 1) < 0) {
+						if (args->instance == 0)
+							pr_inf("%s: cannot drop dentry, inode and page caches, "
+								"skipping cold dcache measurements\n", args->name);
+						cold = false;
+						break;
+					}
+				}
+				t = stress_time_now();
+				if (method < SIZEOF_ARRAY(getdent_large_buf_sizes))
+					entries = stress_getdent_large_getdents(dirname, buf,
+						getdent_large_buf_sizes[method], &calls);
+				else
+					entries = stress_getdent_large_readdir(dirname);
+				t = stress_time_now() - t;
+
+				if (entries < 0) {
+					pr_fail("%s: directory enumeration failed, errno=%d (%s)%s\n",
+						args->name, (int)-entries, strerror((int)-entries),
+						stress_get_fs_type(dirname));
+					rc = EXIT_FAILURE;
+					goto tidy_files;
+				}
+				if (entries != (int64_t)n_entries) {
+					pr_fail("%s: directory enumeration found %" PRId64 " entries, "
+						"expected %" PRIu32 "\n", args->name, entries, n_entries);
+					rc = EXIT_FAILURE;
+					goto tidy_files;
+				}
+				stats[method].duration[variant] += t;
+				stats[method].entries[variant] += (double)entries;
+				stats[method].calls[variant] += calls;
+				stress_bogo_inc(args);
+			}
+		}
+	} while (stress_continue(args));
+
+	if (args->instance == 0) {
+		size_t method;
+
+		pr_block_begin();
+		pr_inf("%s: %" PRIu32 " entry directory, entries/sec warm %s, getdents calls per 1K entries\n",
+			args->name, n_entries, cold ? "and cold dcache" : "dcache");
+		pr_inf("%s: %-16s %14s %14s %10s\n", args->name, "method",
+			"warm ents/sec", "cold ents/sec", "calls/1K");
+		for (method = 0; method < GETDENT_LARGE_METHODS; method++) {
+			const stress_getdent_large_t *s = &stats[method];
+			char method_str[32], warm_str[32], cold_str[32], calls_str[32];
+
+			if (method < SIZEOF_ARRAY(getdent_large_buf_sizes)) {
+				(void)snprintf(method_str, sizeof(method_str), "getdents64 %zuK",
+					getdent_large_buf_sizes[method] / (size_t)KB);
+				(void)snprintf(calls_str, sizeof(calls_str), "%.3f", (s->entries[0] > 0.0) ?
+					1000.0 * s->calls[0] / s->entries[0] : 0.0);
+			} else {
+				(void)shim_strscpy(method_str, "readdir", sizeof(method_str));
+				(void)shim_strscpy(calls_str, "-", sizeof(calls_str));
+			}
+			(void)snprintf(warm_str, sizeof(warm_str), "%.0f", (s->duration[0] > 0.0) ?
+				s->entries[0] / s->duration[0] : 0.0);
+			if (cold)
+				(void)snprintf(cold_str, sizeof(cold_str), "%.0f", (s->duration[1] > 0.0) ?
+					s->entries[1] / s->duration[1] : 0.0);
+			else
+				(void)shim_strscpy(cold_str, "-", sizeof(cold_str));
+			pr_inf("%s: %-16s %14s %14s %10s\n", args->name, method_str,
+				warm_str, cold_str, calls_str);
+		}
+		pr_block_end();
+	}
+
+	for (i = 0; i < GETDENT_LARGE_METHODS; i++) {
+		const stress_getdent_large_t *s = &stats[i];
+		char method_str[32], desc[64];
+
+		if (i < SIZEOF_ARRAY(getdent_large_buf_sizes))
+			(void)snprintf(method_str, sizeof(method_str), "getdents64 %zuK",
+				getdent_large_buf_sizes[i] / (size_t)KB);
+		else
+			(void)shim_strscpy(method_str, "readdir", sizeof(method_str));
+
+		(void)snprintf(desc, sizeof(desc), "%s warm entries per sec", method_str);
+		stress_metrics_set(args, metrics_idx++, desc, (s->duration[0] > 0.0) ?
+			s->entries[0] / s->duration[0] : 0.0, STRESS_HARMONIC_MEAN);
+		if (cold) {
+			(void)snprintf(desc, sizeof(desc), "%s cold entries per sec", method_str);
+			stress_metrics_set(args, metrics_idx++, desc, (s->duration[1] > 0.0) ?
+				s->entries[1] / s->duration[1] : 0.0, STRESS_HARMONIC_MEAN);
+		}
+		if (i < SIZEOF_ARRAY(getdent_large_buf_sizes)) {
+			(void)snprintf(desc, sizeof(desc), "%s calls per 1K entries", method_str);
+			stress_metrics_set(args, metrics_idx++, desc, (s->entries[0] > 0.0) ?
+				1000.0 * s->calls[0] / s->entries[0] : 0.0, STRESS_GEOMETRIC_MEAN);
+		}
+	}
+
+tidy_files:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	for (i = 0; i < n_entries; i++) {
+		stress_getdent_large_name(name, sizeof(name), i);
+		(void)unlinkat(dir_fd, name, 0);
+	}
+	(void)close(dir_fd);
+tidy_rmdir:
+	(void)shim_rmdir(dirname);
+tidy_buf:
+	free(buf);
+tidy_dir:
+	(void)stress_temp_dir_rm_args(args);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_getdent
  *	stress reading directories
@@ -286,6 +610,18 @@ static int stress_getdent(stress_args_t *args)
 {
 	const int bad_fd = stress_get_bad_fd();
 	double duration = 0.0, count = 0.0, rate;
+	uint32_t getdent_entries = 0;
+
+	(void)stress_get_setting("getdent-entries", &getdent_entries);
+	if (getdent_entries > 0) {
+#if defined(HAVE_GETDENTS64)
+		return stress_getdent_large(args, getdent_entries);
+#else
+		if (args->instance == 0)
+			pr_inf("%s: getdents64 not supported, ignoring --getdent-entries option\n",
+				args->name);
+#endif
+	}
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
@@ -321,6 +657,7 @@ static int stress_getdent(stress_args_t *args)
 stressor_info_t stress_getdent_info = {
 	.stressor = stress_getdent,
 	.class = CLASS_FILESYSTEM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help
 };
@@ -328,6 +665,7 @@ stressor_info_t stress_getdent_info = {
 stressor_info_t stress_getdent_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_FILESYSTEM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help,
 	.unimplemented_reason = "built without getdents() or getdents64() support"
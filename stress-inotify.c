@@ -19,6 +19,11 @@
  */
 #include "stress-ng.h"
 #include "core-builtin.h"
+#include "core-fsnotify.h"
+
+#if defined(HAVE_POLL_H)
+#include <poll.h>
+#endif
 
 #if defined(HAVE_SYS_EPOLL_H)
 #include <sys/epoll.h>
@@ -33,10 +38,45 @@
 #define INOTIFY_IOC_SETNEXTWD	_IOW('I', 0, __s32)
 #endif
 
+#define MIN_INOTIFY_WATCHES	(1)
+#define MAX_INOTIFY_WATCHES	(1000000)
+
+#define MIN_INOTIFY_WRITERS	(1)
+#define MAX_INOTIFY_WRITERS	(64)
+#define DEFAULT_INOTIFY_WRITERS	(4)
+
 static const stress_help_t help[] = {
-	{ NULL,	"inotify N",	 "start N workers exercising inotify events" },
-	{ NULL,	"inotify-ops N", "stop inotify workers after N bogo operations" },
-	{ NULL, NULL,		 NULL }
+	{ NULL,	"inotify N",		"start N workers exercising inotify events" },
+	{ NULL,	"inotify-ops N",	"stop inotify workers after N bogo operations" },
+	{ NULL,	"inotify-watches N",	"watch N files and measure event delivery rate and latency" },
+	{ NULL,	"inotify-writers N",	"number of threads modifying watched files (1..64)" },
+	{ NULL, NULL,			NULL }
+};
+
+static int stress_set_inotify_watches(const char *opt)
+{
+	uint32_t inotify_watches;
+
+	inotify_watches = stress_get_uint32(opt);
+	stress_check_range("inotify-watches", (uint64_t)inotify_watches,
+		MIN_INOTIFY_WATCHES, MAX_INOTIFY_WATCHES);
+	return stress_set_setting("inotify-watches", TYPE_ID_UINT32, &inotify_watches);
+}
+
+static int stress_set_inotify_writers(const char *opt)
+{
+	uint32_t inotify_writers;
+
+	inotify_writers = stress_get_uint32(opt);
+	stress_check_range("inotify-writers", (uint64_t)inotify_writers,
+		MIN_INOTIFY_WRITERS, MAX_INOTIFY_WRITERS);
+	return stress_set_setting("inotify-writers", TYPE_ID_UINT32, &inotify_writers);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_inotify_watches,	stress_set_inotify_watches },
+	{ OPT_inotify_writers,	stress_set_inotify_writers },
+	{ 0,			NULL }
 };
 
 #if defined(HAVE_INOTIFY) &&		\
@@ -942,6 +982,204 @@ static const stress_inotify_t inotify_stressors[] = {
 	{ NULL,				NULL }
 };
 
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(IN_CLOSE_WRITE) &&		\
+    defined(IN_Q_OVERFLOW) &&		\
+    defined(O_DIRECTORY) &&		\
+    defined(HAVE_POLL_H)
+
+#define INOTIFY_SCALE_BUF_SIZE	(64 * KB)	/* event read buffer */
+
+/*
+ *  stress_inotify_read_limit()
+ *	read an inotify /proc/sys/fs/inotify limit, 0 if unknown
+ */
+static uint64_t stress_inotify_read_limit(const char *name)
+{
+	char path[PATH_MAX], buf[32];
+
+	(void)snprintf(path, sizeof(path), "/proc/sys/fs/inotify/%s", name);
+	(void)shim_memset(buf, 0, sizeof(buf));
+	if (stress_system_read(path, buf, sizeof(buf)) < 1)
+		return 0;
+	return (uint64_t)strtoull(buf, NULL, 10);
+}
+
+/*
+ *  stress_inotify_scale()
+ *	watch a large number of files, modify them from writer threads
+ *	and measure the event delivery rate, latency and queue overflows
+ */
+static int stress_inotify_scale(
+	stress_args_t *args,
+	const char *pathname,
+	const uint32_t inotify_watches,
+	const uint32_t inotify_writers)
+{
+	stress_fsnotify_scale_t scale;
+	const size_t n_dirs = (inotify_watches + STRESS_FSNOTIFY_PER_DIR - 1) / STRESS_FSNOTIFY_PER_DIR;
+	size_t i, n_files = 0, n_watches = 0;
+	int *dir_fds, *wd_to_idx = NULL, fd = -1, rc = EXIT_SUCCESS, max_wd = 0;
+	double t_start, duration;
+	char *buf = NULL;
+
+	if (stress_fsnotify_scale_init(&scale, (size_t)inotify_watches) < 0) {
+		pr_inf_skip("%s: cannot allocate watch state, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	dir_fds = (int *)calloc(n_dirs, sizeof(*dir_fds));
+	buf = (char *)malloc(INOTIFY_SCALE_BUF_SIZE);
+	if (!dir_fds || !buf) {
+		pr_inf_skip("%s: cannot allocate watch state, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_free;
+	}
+	for (i = 0; i < n_dirs; i++)
+		dir_fds[i] = -1;
+
+	/* create the files, STRESS_FSNOTIFY_PER_DIR per directory */
+	for (i = 0; (i < n_dirs) && stress_continue(args); i++) {
+		char dirname[PATH_MAX], name[32];
+		size_t j;
+
+		(void)snprintf(name, sizeof(name), "d%zu", i);
+		(void)stress_mk_filename(dirname, sizeof(dirname), pathname, name);
+		if (mk_dir(args, dirname) < 0)
+			break;
+		dir_fds[i] = open(dirname, O_RDONLY | O_DIRECTORY);
+		if (dir_fds[i] < 0)
+			break;
+		for (j = 0; (j < STRESS_FSNOTIFY_PER_DIR) && (n_files < inotify_watches); j++) {
+			int file_fd;
+
+			(void)snprintf(name, sizeof(name), "f%zu", j);
+			file_fd = openat(dir_fds[i], name, O_CREAT | O_RDWR, FILE_FLAGS);
+			if (file_fd < 0)
+				break;
+			(void)close(file_fd);
+			n_files++;
+		}
+		if (j < STRESS_FSNOTIFY_PER_DIR)
+			break;
+	}
+	if (!stress_continue(args))
+		goto tidy_files;
+	if (n_files == 0) {
+		pr_inf_skip("%s: cannot create any files to watch, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_files;
+	}
+
+	fd = inotify_init1(IN_NONBLOCK);
+	if (fd < 0) {
+		pr_inf_skip("%s: inotify_init1 failed, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_files;
+	}
+	wd_to_idx = (int *)calloc(n_files + 1, sizeof(*wd_to_idx));
+	if (!wd_to_idx) {
+		pr_inf_skip("%s: cannot allocate watch state, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_files;
+	}
+	for (n_watches = 0; (n_watches < n_files) && stress_continue(args); n_watches++) {
+		char filename[PATH_MAX + 64];
+		int wd;
+
+		(void)snprintf(filename, sizeof(filename), "%s/d%zu/f%zu", pathname,
+			n_watches / STRESS_FSNOTIFY_PER_DIR, n_watches % STRESS_FSNOTIFY_PER_DIR);
+		wd = inotify_add_watch(fd, filename, IN_CLOSE_WRITE);
+		if (wd < 0)
+			break;
+		/* watch descriptors are normally allocated sequentially from 1 */
+		if ((size_t)wd <= n_files)
+			wd_to_idx[wd] = (int)n_watches + 1;
+		if (wd > max_wd)
+			max_wd = wd;
+	}
+	if (n_watches < n_files) {
+		if (args->instance == 0)
+			pr_inf("%s: only %zu of %zu watches added, errno=%d (%s), "
+				"max_user_watches is %" PRIu64 "\n",
+				args->name, n_watches, n_files, errno, strerror(errno),
+				stress_inotify_read_limit("max_user_watches"));
+		if (n_watches == 0) {
+			rc = EXIT_NO_RESOURCE;
+			goto tidy_files;
+		}
+	}
+	if (args->instance == 0)
+		pr_inf("%s: %zu watched files, %" PRIu32 " writer threads, "
+			"max_queued_events %" PRIu64 "\n", args->name, n_watches,
+			inotify_writers, stress_inotify_read_limit("max_queued_events"));
+
+	/* split the watched files between the writers */
+	(void)stress_fsnotify_scale_start(&scale, dir_fds, n_watches, (size_t)inotify_writers);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	t_start = stress_time_now();
+	while (stress_continue(args) && (scale.started > 0)) {
+		struct pollfd pfd;
+		const struct inotify_event *event;
+		ssize_t len;
+		uint64_t t_now;
+		char *ptr;
+
+		pfd.fd = fd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		if (poll(&pfd, 1, 100) <= 0)
+			continue;
+		len = read(fd, buf, INOTIFY_SCALE_BUF_SIZE);
+		if (len <= 0)
+			continue;
+		t_now = stress_time_now_ns();
+
+		for (ptr = buf; ptr < buf + len; ) {
+			event = (const struct inotify_event *)(void *)ptr;
+			ptr += sizeof(struct inotify_event) + event->len;
+			if (event->mask & IN_Q_OVERFLOW) {
+				scale.overflows++;
+				continue;
+			}
+			scale.events++;
+			if ((event->wd > 0) && (event->wd <= max_wd) && ((size_t)event->wd <= n_files)) {
+				const int idx = wd_to_idx[event->wd] - 1;
+
+				if (idx >= 0)
+					stress_fsnotify_scale_event(&scale, (size_t)idx, t_now);
+			}
+		}
+		stress_bogo_set(args, scale.events);
+	}
+	duration = stress_time_now() - t_start;
+	rc = stress_fsnotify_scale_stop(args, &scale, duration);
+
+tidy_files:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	/* closing the inotify fd drops all the watches in one go */
+	if (fd >= 0)
+		(void)close(fd);
+	for (i = 0; i < n_dirs; i++) {
+		char dirname[PATH_MAX], name[32];
+
+		if (dir_fds[i] >= 0)
+			(void)close(dir_fds[i]);
+		(void)snprintf(name, sizeof(name), "d%zu", i);
+		(void)stress_mk_filename(dirname, sizeof(dirname), pathname, name);
+		(void)rm_dir(args, dirname);
+	}
+tidy_free:
+	free(wd_to_idx);
+	free(buf);
+	free(dir_fds);
+	stress_fsnotify_scale_free(&scale);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_inotify()
  *	stress inotify
@@ -951,12 +1189,33 @@ static int stress_inotify(stress_args_t *args)
 	char pathname[PATH_MAX - 16];
 	int ret, i;
 	const int bad_fd = stress_get_bad_fd();
+	uint32_t inotify_watches = 0;
+	uint32_t inotify_writers = DEFAULT_INOTIFY_WRITERS;
+
+	(void)stress_get_setting("inotify-watches", &inotify_watches);
+	(void)stress_get_setting("inotify-writers", &inotify_writers);
 
 	stress_temp_dir_args(args, pathname, sizeof(pathname));
 	ret = stress_temp_dir_mk_args(args);
 	if (ret < 0)
 		return stress_exit_status(-ret);
 
+	if (inotify_watches > 0) {
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(IN_CLOSE_WRITE) &&		\
+    defined(IN_Q_OVERFLOW) &&		\
+    defined(O_DIRECTORY) &&		\
+    defined(HAVE_POLL_H)
+		ret = stress_inotify_scale(args, pathname, inotify_watches, inotify_writers);
+		(void)stress_temp_dir_rm_args(args);
+		return ret;
+#else
+		if (args->instance == 0)
+			pr_inf("%s: pthreads or poll() not supported, ignoring --inotify-watches option\n",
+				args->name);
+#endif
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
 	do {
@@ -974,6 +1233,7 @@ static int stress_inotify(stress_args_t *args)
 stressor_info_t stress_inotify_info = {
 	.stressor = stress_inotify,
 	.class = CLASS_FILESYSTEM | CLASS_SCHEDULER | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_OPTIONAL,
 	.help = help
 };
@@ -981,6 +1241,7 @@ stressor_info_t stress_inotify_info = {
 stressor_info_t stress_inotify_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_FILESYSTEM | CLASS_SCHEDULER | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_OPTIONAL,
 	.help = help,
 	.unimplemented_reason = "built without sys/epoll.h, sys/inotify.h, inotify(), inotify1() or select() support"
@@ -19,6 +19,7 @@
  */
 #include "stress-ng.h"
 #include "core-builtin.h"
+#include "core-io-uring.h"
 #include "core-out-of-memory.h"
 #include "io-uring.h"
 
@@ -59,13 +60,7 @@ static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ 0,			NULL },
 };
 
-#if defined(HAVE_LINUX_IO_URING_H) &&	\
-    defined(HAVE_SYSCALL) &&		\
-    defined(__NR_io_uring_enter) &&	\
-    defined(__NR_io_uring_setup) &&	\
-    defined(IORING_OFF_SQ_RING) &&	\
-    defined(IORING_OFF_CQ_RING) &&	\
-    defined(IORING_OFF_SQES) &&		\
+#if defined(HAVE_STRESS_IO_URING_RING) &&	\
     defined(HAVE_POSIX_MEMALIGN) &&	\
     (defined(HAVE_IORING_OP_WRITEV) ||	\
      defined(HAVE_IORING_OP_READV) ||	\
@@ -97,45 +92,6 @@ typedef struct {
 	size_t block_size;	/* per block size */
 } stress_io_uring_file_t;
 
-/*
- * io uring submission queue info
- */
-typedef struct {
-	unsigned *head;
-	unsigned *tail;
-	unsigned *ring_mask;
-	unsigned *ring_entries;
-	unsigned *flags;
-	unsigned *array;
-} stress_uring_io_sq_ring_t;
-
-/*
- * io uring completion queue info
- */
-typedef struct {
-	unsigned *head;
-	unsigned *tail;
-	unsigned *ring_mask;
-	unsigned *ring_entries;
-	struct io_uring_cqe *cqes;
-} stress_uring_io_cq_ring_t;
-
-/*
- *  io uring submission info
- */
-typedef struct {
-	stress_uring_io_sq_ring_t sq_ring;
-	stress_uring_io_cq_ring_t cq_ring;
-	struct io_uring_sqe *sqes_mmap;
-	void *sq_mmap;
-	void *cq_mmap;
-	int io_uring_fd;
-	size_t sq_size;
-	size_t cq_size;
-	size_t sqes_size;
-	size_t sqes_entries;
-} stress_io_uring_submit_t;
-
 typedef struct {
 	size_t  index;
 	uint8_t opcode;
@@ -155,29 +111,6 @@ typedef struct {
 
 static const char *stress_io_uring_opcode_name(const uint8_t opcode);
 
-/*
- *  shim_io_uring_setup
- *	wrapper for io_uring_setup()
- */
-static inline int shim_io_uring_setup(unsigned entries, struct io_uring_params *p)
-{
-	return (int)syscall(__NR_io_uring_setup, entries, p);
-}
-
-/*
- *  shim_io_uring_enter
- *	wrapper for io_uring_enter()
- */
-static inline int shim_io_uring_enter(
-	int fd,
-	unsigned int to_submit,
-	unsigned int min_complete,
-	unsigned int flags)
-{
-	return (int)syscall(__NR_io_uring_enter, fd, to_submit,
-		min_complete, flags, NULL, 0);
-}
-
 /*
  *  stress_io_uring_unmap_iovecs()
  *	free uring file iovecs
@@ -198,13 +131,6 @@ static void stress_io_uring_unmap_iovecs(stress_io_uring_file_t *io_uring_file)
 	io_uring_file->iovecs = NULL;
 }
 
-/*
- *  Avoid GCCism of void * pointer arithmetic by casting to
- *  uint8_t *, doing the offset and then casting back to void *
- */
-#define VOID_ADDR_OFFSET(addr, offset)	\
-	((void *)(((uint8_t *)addr) + offset))
-
 /*
  *  stress_setup_io_uring()
  *	setup the io uring
@@ -214,19 +140,16 @@ static int stress_setup_io_uring(
 	const uint32_t io_uring_entries,
 	stress_io_uring_submit_t *submit)
 {
-	stress_uring_io_sq_ring_t *sring = &submit->sq_ring;
-	stress_uring_io_cq_ring_t *cring = &submit->cq_ring;
-	struct io_uring_params p;
+	int ret;
 
-	(void)shim_memset(&p, 0, sizeof(p));
 	/*
 	 *  16 is plenty, with too many we end up with lots of cache
 	 *  misses, with too few we end up with ring filling. This
 	 *  seems to be a good fit with the set of requests being
 	 *  issue by this stressor
 	 */
-	submit->io_uring_fd = shim_io_uring_setup(io_uring_entries, &p);
-	if (submit->io_uring_fd < 0) {
+	ret = stress_io_uring_ring_setup(io_uring_entries, submit);
+	if (ret == STRESS_IO_URING_RING_SETUP_FAILED) {
 		if (errno == ENOSYS) {
 			pr_inf_skip("%s: io-uring not supported by the kernel, skipping stressor\n",
 				args->name);
@@ -247,70 +170,12 @@ static int stress_setup_io_uring(
 		pr_fail("%s: io-uring setup failed, errno=%d (%s)\n",
 			args->name, errno, strerror(errno));
 		return EXIT_FAILURE;
-	}
-	submit->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
-	submit->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
-	if (p.features & IORING_FEAT_SINGLE_MMAP) {
-		if (submit->cq_size > submit->sq_size)
-			submit->sq_size = submit->cq_size;
-		submit->cq_size = submit->sq_size;
-	}
-
-	submit->sq_mmap = stress_mmap_populate(NULL, submit->sq_size,
-		PROT_READ | PROT_WRITE,
-		MAP_SHARED | MAP_POPULATE,
-		submit->io_uring_fd, IORING_OFF_SQ_RING);
-	if (submit->sq_mmap == MAP_FAILED) {
-		pr_inf_skip("%s: could not mmap submission queue buffer, "
+	} else if (ret < 0) {
+		pr_inf_skip("%s: could not mmap io-uring queue buffers, "
 			"errno=%d (%s), skipping stressor\n",
 			args->name, errno, strerror(errno));
 		return EXIT_NO_RESOURCE;
 	}
-
-	if (p.features & IORING_FEAT_SINGLE_MMAP) {
-		submit->cq_mmap = submit->sq_mmap;
-	} else {
-		submit->cq_mmap = stress_mmap_populate(NULL, submit->cq_size,
-				PROT_READ | PROT_WRITE,
-				MAP_SHARED | MAP_POPULATE,
-				submit->io_uring_fd, IORING_OFF_CQ_RING);
-		if (submit->cq_mmap == MAP_FAILED) {
-			pr_inf_skip("%s: could not mmap completion queue buffer, "
-				"errno=%d (%s), skipping stressor\n",
-				args->name, errno, strerror(errno));
-			(void)munmap(submit->sq_mmap, submit->cq_size);
-			return EXIT_NO_RESOURCE;
-		}
-	}
-
-	sring->head = VOID_ADDR_OFFSET(submit->sq_mmap, p.sq_off.head);
-	sring->tail = VOID_ADDR_OFFSET(submit->sq_mmap, p.sq_off.tail);
-	sring->ring_mask = VOID_ADDR_OFFSET(submit->sq_mmap, p.sq_off.ring_mask);
-	sring->ring_entries = VOID_ADDR_OFFSET(submit->sq_mmap, p.sq_off.ring_entries);
-	sring->flags = VOID_ADDR_OFFSET(submit->sq_mmap, p.sq_off.flags);
-	sring->array = VOID_ADDR_OFFSET(submit->sq_mmap, p.sq_off.array);
-
-	submit->sqes_entries = p.sq_entries;
-	submit->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
-	submit->sqes_mmap = stress_mmap_populate(NULL, submit->sqes_size,
-			PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
-			submit->io_uring_fd, IORING_OFF_SQES);
-	if (submit->sqes_mmap == MAP_FAILED) {
-		pr_inf_skip("%s: count not mmap submission queue buffer, "
-			"errno=%d (%s), skipping stressor\n",
-			args->name, errno, strerror(errno));
-		if (submit->cq_mmap != submit->sq_mmap)
-			(void)munmap(submit->cq_mmap, submit->cq_size);
-		(void)munmap(submit->sq_mmap, submit->sq_size);
-		return EXIT_NO_RESOURCE;
-	}
-
-	cring->head = VOID_ADDR_OFFSET(submit->cq_mmap, p.cq_off.head);
-	cring->tail = VOID_ADDR_OFFSET(submit->cq_mmap, p.cq_off.tail);
-	cring->ring_mask = VOID_ADDR_OFFSET(submit->cq_mmap, p.cq_off.ring_mask);
-	cring->ring_entries = VOID_ADDR_OFFSET(submit->cq_mmap, p.cq_off.ring_entries);
-	cring->cqes = VOID_ADDR_OFFSET(submit->cq_mmap, p.cq_off.cqes);
-
 	return EXIT_SUCCESS;
 }
 
@@ -320,25 +185,7 @@ static int stress_setup_io_uring(
  */
 static void stress_close_io_uring(stress_io_uring_submit_t *submit)
 {
-	if (submit->io_uring_fd >= 0) {
-		(void)close(submit->io_uring_fd);
-		submit->io_uring_fd = -1;
-	}
-
-	if (submit->sqes_mmap) {
-		(void)munmap(submit->sqes_mmap, submit->sqes_size);
-		submit->sqes_mmap = NULL;
-	}
-
-	if (submit->cq_mmap && (submit->cq_mmap != submit->sq_mmap)) {
-		(void)munmap(submit->cq_mmap, submit->cq_size);
-		submit->cq_mmap = NULL;
-	}
-
-	if (submit->sq_mmap) {
-		(void)munmap(submit->sq_mmap, submit->sq_size);
-		submit->sq_mmap = NULL;
-	}
+	stress_io_uring_ring_close(submit);
 }
 
 /*
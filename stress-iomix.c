@@ -932,35 +932,6 @@ static void stress_iomix_sendfile(
 
 #if defined(__linux__) &&	\
     defined(__NR_cachestat)
-struct shim_cachestat_range {
-	uint64_t off;
-	uint64_t len;
-};
-
-struct shim_cachestat {
-	uint64_t nr_cache;
-	uint64_t nr_dirty;
-	uint64_t nr_writeback;
-	uint64_t nr_evicted;
-	uint64_t nr_recently_evicted;
-};
-
-/*
- *  shim_cachestat
- *	wrapper for cachestat system call
- */
-static inline int shim_cachestat(
-	int fd,
-	struct shim_cachestat_range *cstat_range,
-	struct shim_cachestat *cstat,
-	unsigned int flags)
-{
-	return (int)syscall(__NR_cachestat, (unsigned long)fd,
-			(unsigned long)cstat_range,
-			(unsigned long)cstat,
-			(unsigned long)flags);
-}
-
 /*
  *  stress_iomix_cachestat()
  *	various periodic cache statistics calls (linux only)
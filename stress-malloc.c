@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-builtin.h"
 #include "core-cpu-cache.h"
+#include "core-lock.h"
 #include "core-mincore.h"
 #include "core-out-of-memory.h"
 #include "core-pthread.h"
@@ -42,6 +43,25 @@
 
 #define MAX_MALLOC_PTHREADS	(32)
 
+#define MAX_MALLOC_TRACE_IDS	(1024 * 1024)
+#define MAX_MALLOC_TRACE_OPS	(64 * 1024 * 1024)
+
+#define MALLOC_LATENCY_SAMPLES	(16384)
+#define MALLOC_POOL_CHUNK	(1 * MB)
+#define MALLOC_SLAB_SHIFT_MIN	(5)	/* smallest slab class, 32 bytes */
+#define MALLOC_SLAB_CLASSES	(12)	/* 32 bytes .. 64K */
+#define MALLOC_ARENA_HDR_SIZE	((sizeof(stress_malloc_arena_chunk_t) + 15) & ~(size_t)15)
+
+#define MALLOC_PATTERN_RANDOM	(0)
+#define MALLOC_PATTERN_SIZECLASS (1)
+#define MALLOC_PATTERN_LIFETIME	(2)
+#define MALLOC_PATTERN_PRODCONS	(3)
+#define MALLOC_PATTERN_TRACE	(4)
+
+#define MALLOC_ALLOCATOR_LIBC	(0)
+#define MALLOC_ALLOCATOR_SLAB	(1)
+#define MALLOC_ALLOCATOR_ARENA	(2)
+
 #define MK_ALIGN(x)	(1U << (3 + ((x) & 7)))
 
 typedef struct {
@@ -49,9 +69,94 @@ typedef struct {
 	size_t len;			/* Allocation length */
 } stress_malloc_info_t;
 
+typedef struct {
+	uint64_t allocs;		/* successful allocations */
+	double alloc_duration;		/* total nanosecs spent allocating */
+	int64_t live_bytes;		/* bytes allocated and not freed */
+	double latencies[MALLOC_LATENCY_SAMPLES]; /* reservoir of allocation latencies */
+} stress_malloc_stats_t;
+
+/* built-in pool allocator object header */
+typedef struct {
+	void *owner;			/* owning pool or chunk, NULL if mmap'd */
+	size_t size;			/* slab class or allocation size */
+} stress_malloc_hdr_t;
+
+/* built-in pool allocator, one per thread */
+typedef struct stress_malloc_pool {
+	void *lock;			/* pool lock, objects can be freed by any thread */
+	void *free_list[MALLOC_SLAB_CLASSES]; /* slab free lists */
+	void *chunks;			/* slab chunk list */
+	uint8_t *chunk;			/* chunk being allocated from */
+	size_t chunk_used;		/* bytes used in chunk */
+} stress_malloc_pool_t;
+
+/* arena allocator chunk header */
+typedef struct {
+	stress_malloc_pool_t *pool;	/* owning pool */
+	uint64_t live;			/* objects not yet freed */
+	bool retired;			/* no longer allocated from */
+} stress_malloc_arena_chunk_t;
+
+/* producer to consumer ring of allocations */
+typedef struct {
+	void *lock;			/* ring lock */
+	stress_malloc_info_t *info;	/* ring entries */
+	size_t size;			/* number of ring entries */
+	size_t head;			/* next entry to push */
+	size_t tail;			/* next entry to pop */
+	size_t count;			/* entries in use */
+} stress_malloc_ring_t;
+
+/* allocation trace operation */
+typedef struct {
+	size_t size;			/* allocation size */
+	uint32_t id;			/* allocation id */
+	char op;			/* 'a' alloc, 'r' realloc, 'f' free */
+} stress_malloc_trace_op_t;
+
+typedef struct {
+	stress_malloc_trace_op_t *ops;	/* trace operations */
+	size_t n_ops;			/* number of operations */
+	size_t n_ids;			/* highest allocation id + 1 */
+} stress_malloc_trace_t;
+
+/* state shared by the child and its pthreads */
+typedef struct {
+	stress_malloc_stats_t *stats;	/* per thread statistics */
+	size_t n_stats;			/* number of stats */
+	stress_malloc_ring_t ring;	/* producer/consumer ring */
+	size_t rss;			/* resident set size at end of run */
+	int64_t live_bytes;		/* live bytes at end of run */
+} stress_malloc_state_t;
+
+typedef struct {
+	const char *name;		/* pattern or allocator name */
+	const int value;		/* MALLOC_PATTERN_* or MALLOC_ALLOCATOR_* */
+} stress_malloc_choice_t;
+
+static const stress_malloc_choice_t malloc_patterns[] = {
+	{ "random",	MALLOC_PATTERN_RANDOM },
+	{ "sizeclass",	MALLOC_PATTERN_SIZECLASS },
+	{ "lifetime",	MALLOC_PATTERN_LIFETIME },
+	{ "prodcons",	MALLOC_PATTERN_PRODCONS },
+	{ "trace",	MALLOC_PATTERN_TRACE },
+};
+
+static const stress_malloc_choice_t malloc_allocators[] = {
+	{ "libc",	MALLOC_ALLOCATOR_LIBC },
+	{ "slab",	MALLOC_ALLOCATOR_SLAB },
+	{ "arena",	MALLOC_ALLOCATOR_ARENA },
+};
+
 static bool malloc_mlock;		/* True = mlock all future allocs */
 static bool malloc_touch;		/* True = will touch allocate pages */
 static bool malloc_trim_opt;		/* True = periodically trim malloc arena */
+static bool malloc_zerofree;		/* True = zero memory before freeing */
+static int malloc_pattern;		/* Allocation pattern generator */
+static int malloc_allocator;		/* Allocator being exercised */
+static stress_malloc_trace_t *malloc_trace;	/* Allocation trace to replay */
+static stress_malloc_state_t *malloc_state;	/* Shared child state */
 static size_t malloc_max;		/* Maximum number of allocations */
 static size_t malloc_bytes;		/* Maximum per-allocation size */
 static void *counter_lock;		/* Counter lock */
@@ -76,17 +181,22 @@ typedef struct {
 typedef struct {
 	stress_args_t *args;	/* args info */
 	size_t instance;		/* per thread instance number */
+	stress_malloc_stats_t *stats;	/* per thread statistics */
+	stress_malloc_pool_t *pool;	/* per thread allocator pool */
 } stress_malloc_args_t;
 
 static const stress_help_t help[] = {
 	{ NULL,	"malloc N",		"start N workers exercising malloc/realloc/free" },
+	{ NULL,	"malloc-allocator A",	"allocator: libc, slab or arena" },
 	{ NULL,	"malloc-bytes N",	"allocate up to N bytes per allocation" },
 	{ NULL,	"malloc-max N",		"keep up to N allocations at a time" },
 	{ NULL,	"malloc-mlock",		"attempt to mlock pages into memory" },
 	{ NULL,	"malloc-ops N",		"stop after N malloc bogo operations" },
+	{ NULL,	"malloc-pattern P",	"pattern: random, sizeclass, lifetime, prodcons or trace" },
 	{ NULL, "malloc-pthreads N",	"number of pthreads to run concurrently" },
 	{ NULL,	"malloc-thresh N",	"threshold where malloc uses mmap instead of sbrk" },
 	{ NULL, "malloc-touch",		"touch pages force pages to be populated" },
+	{ NULL,	"malloc-trace F",	"replay allocation trace file F" },
 	{ NULL,	"malloc-zerofree",	"zero free'd memory" },
 	{ NULL, "malloc-trim",		"enable malloc trimming" },
 	{ NULL,	NULL,			NULL }
@@ -158,6 +268,49 @@ static int stress_set_malloc_zerofree(const char *opt)
 	return stress_set_setting_true("malloc-zerofree", opt);
 }
 
+/*
+ *  stress_set_malloc_choice()
+ *	set a named pattern or allocator setting
+ */
+static int stress_set_malloc_choice(
+	const char *setting,
+	const char *opt,
+	const stress_malloc_choice_t *choices,
+	const size_t n_choices)
+{
+	size_t i;
+
+	for (i = 0; i < n_choices; i++) {
+		if (!strcmp(choices[i].name, opt)) {
+			int value = choices[i].value;
+
+			return stress_set_setting(setting, TYPE_ID_INT, &value);
+		}
+	}
+	(void)fprintf(stderr, "%s must be one of:", setting);
+	for (i = 0; i < n_choices; i++)
+		(void)fprintf(stderr, " %s", choices[i].name);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_malloc_pattern(const char *opt)
+{
+	return stress_set_malloc_choice("malloc-pattern", opt,
+		malloc_patterns, SIZEOF_ARRAY(malloc_patterns));
+}
+
+static int stress_set_malloc_allocator(const char *opt)
+{
+	return stress_set_malloc_choice("malloc-allocator", opt,
+		malloc_allocators, SIZEOF_ARRAY(malloc_allocators));
+}
+
+static int stress_set_malloc_trace(const char *opt)
+{
+	return stress_set_setting("malloc-trace", TYPE_ID_STR, opt);
+}
+
 /*
  *  stress_malloc_free()
  *	standard free, ignore length
@@ -210,11 +363,651 @@ static void stress_malloc_page_touch(
 	}
 }
 
+/*
+ *  stress_malloc_stats_alloc()
+ *	account for an allocation, keep a reservoir of
+ *	allocation latencies in nanosecs for the
+ *	percentile metrics
+ */
+static inline void stress_malloc_stats_alloc(
+	stress_malloc_stats_t *stats,
+	const double latency,
+	const size_t len)
+{
+	const uint64_t n = stats->allocs++;
+
+	stats->alloc_duration += latency;
+	stats->live_bytes += (int64_t)len;
+	if (n < MALLOC_LATENCY_SAMPLES) {
+		stats->latencies[n] = latency;
+	} else {
+		const uint64_t j = stress_mwc64modn(n + 1);
+
+		if (j < MALLOC_LATENCY_SAMPLES)
+			stats->latencies[j] = latency;
+	}
+}
+
+/*
+ *  stress_malloc_rss()
+ *	resident set size in bytes, 0 if not known
+ */
+static size_t stress_malloc_rss(const size_t page_size)
+{
+#if defined(__linux__)
+	FILE *fp;
+	unsigned long int size, resident = 0;
+
+	fp = fopen("/proc/self/statm", "r");
+	if (!fp)
+		return 0;
+	if (fscanf(fp, "%lu %lu", &size, &resident) != 2)
+		resident = 0;
+	(void)fclose(fp);
+
+	return (size_t)resident * page_size;
+#else
+	(void)page_size;
+
+	return 0;
+#endif
+}
+
+/*
+ *  stress_malloc_rss_sample()
+ *	sample the resident set size and the bytes still allocated
+ *	by all the threads, called by instance 0 as it finishes
+ *	and before any allocations are freed
+ */
+static void stress_malloc_rss_sample(stress_args_t *args)
+{
+	size_t i;
+
+	malloc_state->rss = stress_malloc_rss(args->page_size);
+	malloc_state->live_bytes = 0;
+	for (i = 0; i < malloc_state->n_stats; i++)
+		malloc_state->live_bytes += malloc_state->stats[i].live_bytes;
+}
+
+/*
+ *  stress_malloc_hdr()
+ *	built-in pool allocator object header
+ */
+static inline stress_malloc_hdr_t *stress_malloc_hdr(void *ptr)
+{
+	return ((stress_malloc_hdr_t *)ptr) - 1;
+}
+
+/*
+ *  stress_malloc_mmap_alloc()
+ *	large allocations for the built-in pool allocators
+ */
+static void *stress_malloc_mmap_alloc(const size_t len)
+{
+	const size_t size = len + sizeof(stress_malloc_hdr_t);
+	stress_malloc_hdr_t *hdr;
+
+	hdr = (stress_malloc_hdr_t *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (hdr == MAP_FAILED)
+		return NULL;
+	hdr->owner = NULL;
+	hdr->size = size;
+	return (void *)(hdr + 1);
+}
+
+/*
+ *  stress_malloc_chunk_alloc()
+ *	allocate a pool chunk, chain it onto the pool chunk list
+ */
+static void *stress_malloc_chunk_alloc(void **chunks)
+{
+	void **chunk;
+
+	chunk = (void **)mmap(NULL, MALLOC_POOL_CHUNK, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (chunk == MAP_FAILED)
+		return NULL;
+	if (chunks) {
+		*chunk = *chunks;
+		*chunks = (void *)chunk;
+	}
+	return (void *)chunk;
+}
+
+/*
+ *  stress_malloc_slab_alloc()
+ *	slab allocator, power of 2 size classes carved out of
+ *	1MB chunks with a free list per size class
+ */
+static void *stress_malloc_slab_alloc(stress_malloc_pool_t *pool, const size_t len)
+{
+	const size_t size = len + sizeof(stress_malloc_hdr_t);
+	size_t class, class_size;
+	stress_malloc_hdr_t *hdr;
+
+	if (size > (1U << (MALLOC_SLAB_SHIFT_MIN + MALLOC_SLAB_CLASSES - 1)))
+		return stress_malloc_mmap_alloc(len);
+
+	for (class = 0; size > (1U << (MALLOC_SLAB_SHIFT_MIN + class)); class++)
+		;
+	class_size = 1U << (MALLOC_SLAB_SHIFT_MIN + class);
+
+	(void)stress_lock_acquire(pool->lock);
+	hdr = (stress_malloc_hdr_t *)pool->free_list[class];
+	if (hdr) {
+		pool->free_list[class] = hdr->owner;
+	} else {
+		if (!pool->chunk || (pool->chunk_used + class_size > MALLOC_POOL_CHUNK)) {
+			pool->chunk = (uint8_t *)stress_malloc_chunk_alloc(&pool->chunks);
+			if (!pool->chunk) {
+				(void)stress_lock_release(pool->lock);
+				return NULL;
+			}
+			/* first slot is the chunk list link */
+			pool->chunk_used = sizeof(stress_malloc_hdr_t);
+		}
+		hdr = (stress_malloc_hdr_t *)(pool->chunk + pool->chunk_used);
+		pool->chunk_used += class_size;
+	}
+	(void)stress_lock_release(pool->lock);
+
+	hdr->owner = (void *)pool;
+	hdr->size = class;
+	return (void *)(hdr + 1);
+}
+
+/*
+ *  stress_malloc_slab_free()
+ *	return object to the size class free list of the owning pool,
+ *	the owner may be another thread's pool
+ */
+static void stress_malloc_slab_free(stress_malloc_pool_t *pool, void *ptr)
+{
+	stress_malloc_hdr_t *hdr = stress_malloc_hdr(ptr);
+	const size_t class = hdr->size;
+
+	(void)pool;
+
+	pool = (stress_malloc_pool_t *)hdr->owner;
+	if (!pool) {
+		(void)munmap((void *)hdr, hdr->size);
+		return;
+	}
+	(void)stress_lock_acquire(pool->lock);
+	hdr->owner = pool->free_list[class];
+	pool->free_list[class] = (void *)hdr;
+	(void)stress_lock_release(pool->lock);
+}
+
+/*
+ *  stress_malloc_arena_alloc()
+ *	arena allocator, bump allocate from 1MB chunks, chunks are
+ *	reference counted and released when all their objects are freed
+ */
+static void *stress_malloc_arena_alloc(stress_malloc_pool_t *pool, const size_t len)
+{
+	const size_t size = (len + sizeof(stress_malloc_hdr_t) + 15) & ~(size_t)15;
+	stress_malloc_arena_chunk_t *chunk;
+	stress_malloc_hdr_t *hdr;
+
+	if (size > MALLOC_POOL_CHUNK / 4)
+		return stress_malloc_mmap_alloc(len);
+
+	(void)stress_lock_acquire(pool->lock);
+	chunk = (stress_malloc_arena_chunk_t *)pool->chunk;
+	if (!chunk || (pool->chunk_used + size > MALLOC_POOL_CHUNK)) {
+		if (chunk && (chunk->live == 0)) {
+			/* nothing live in the current chunk, recycle it */
+			pool->chunk_used = MALLOC_ARENA_HDR_SIZE;
+		} else {
+			if (chunk)
+				chunk->retired = true;
+			chunk = (stress_malloc_arena_chunk_t *)stress_malloc_chunk_alloc(NULL);
+			if (!chunk) {
+				pool->chunk = NULL;
+				(void)stress_lock_release(pool->lock);
+				return NULL;
+			}
+			chunk->pool = pool;
+			chunk->live = 0;
+			chunk->retired = false;
+			pool->chunk = (uint8_t *)chunk;
+			pool->chunk_used = MALLOC_ARENA_HDR_SIZE;
+		}
+	}
+	hdr = (stress_malloc_hdr_t *)(pool->chunk + pool->chunk_used);
+	pool->chunk_used += size;
+	chunk->live++;
+	(void)stress_lock_release(pool->lock);
+
+	hdr->owner = (void *)chunk;
+	hdr->size = size;
+	return (void *)(hdr + 1);
+}
+
+/*
+ *  stress_malloc_arena_free()
+ *	drop a reference on the owning chunk, unmap retired
+ *	chunks once the last object has been freed
+ */
+static void stress_malloc_arena_free(stress_malloc_pool_t *pool, void *ptr)
+{
+	stress_malloc_hdr_t *hdr = stress_malloc_hdr(ptr);
+	stress_malloc_arena_chunk_t *chunk = (stress_malloc_arena_chunk_t *)hdr->owner;
+	bool unmap;
+
+	(void)pool;
+
+	if (!chunk) {
+		(void)munmap((void *)hdr, hdr->size);
+		return;
+	}
+	pool = chunk->pool;
+	(void)stress_lock_acquire(pool->lock);
+	chunk->live--;
+	unmap = chunk->retired && (chunk->live == 0);
+	(void)stress_lock_release(pool->lock);
+	if (unmap)
+		(void)munmap((void *)chunk, MALLOC_POOL_CHUNK);
+}
+
+/*
+ *  stress_malloc_pool_init()
+ *	initialize a per thread allocator pool
+ */
+static int stress_malloc_pool_init(stress_malloc_pool_t *pool)
+{
+	(void)shim_memset(pool, 0, sizeof(*pool));
+	pool->lock = stress_lock_create();
+
+	return pool->lock ? 0 : -1;
+}
+
+/*
+ *  stress_malloc_pool_deinit()
+ *	release a per thread allocator pool, all the objects
+ *	must have been freed beforehand
+ */
+static void stress_malloc_pool_deinit(stress_malloc_pool_t *pool)
+{
+	if (malloc_allocator == MALLOC_ALLOCATOR_SLAB) {
+		void *chunk, *next;
+
+		for (chunk = pool->chunks; chunk; chunk = next) {
+			next = *(void **)chunk;
+			(void)munmap(chunk, MALLOC_POOL_CHUNK);
+		}
+	} else if ((malloc_allocator == MALLOC_ALLOCATOR_ARENA) && pool->chunk) {
+		(void)munmap((void *)pool->chunk, MALLOC_POOL_CHUNK);
+	}
+	if (pool->lock)
+		(void)stress_lock_destroy(pool->lock);
+}
+
+/*
+ *  stress_malloc_pool_alloc()
+ *	allocate using the selected allocator
+ */
+static inline void *stress_malloc_pool_alloc(stress_malloc_pool_t *pool, const size_t len)
+{
+	switch (malloc_allocator) {
+	case MALLOC_ALLOCATOR_SLAB:
+		return stress_malloc_slab_alloc(pool, len);
+	case MALLOC_ALLOCATOR_ARENA:
+		return stress_malloc_arena_alloc(pool, len);
+	default:
+		return malloc(len);
+	}
+}
+
+/*
+ *  stress_malloc_pool_free()
+ *	free using the selected allocator
+ */
+static inline void stress_malloc_pool_free(stress_malloc_pool_t *pool, void *ptr, const size_t len)
+{
+	if (!ptr)
+		return;
+
+	switch (malloc_allocator) {
+	case MALLOC_ALLOCATOR_SLAB:
+		if (malloc_zerofree)
+			(void)shim_memset(ptr, 0, len);
+		stress_malloc_slab_free(pool, ptr);
+		break;
+	case MALLOC_ALLOCATOR_ARENA:
+		if (malloc_zerofree)
+			(void)shim_memset(ptr, 0, len);
+		stress_malloc_arena_free(pool, ptr);
+		break;
+	default:
+		free_func(ptr, len);
+		break;
+	}
+}
+
+/*
+ *  stress_malloc_pool_realloc()
+ *	reallocate using the selected allocator, the built-in
+ *	pools allocate, copy and free
+ */
+static inline void *stress_malloc_pool_realloc(
+	stress_malloc_pool_t *pool,
+	void *ptr,
+	const size_t old_len,
+	const size_t len)
+{
+	void *new_ptr;
+
+	if (malloc_allocator == MALLOC_ALLOCATOR_LIBC)
+		return realloc(ptr, len);
+
+	new_ptr = stress_malloc_pool_alloc(pool, len);
+	if (!new_ptr)
+		return NULL;
+	if (ptr) {
+		(void)shim_memcpy(new_ptr, ptr, STRESS_MINIMUM(old_len, len));
+		stress_malloc_pool_free(pool, ptr, old_len);
+	}
+	return new_ptr;
+}
+
+/*
+ *  stress_malloc_size_class()
+ *	allocation size drawn from a small object biased size class
+ *	distribution, most allocations are small with a long tail
+ */
+static size_t stress_malloc_size_class(void)
+{
+	static const uint16_t size_classes[] = {
+		16, 16, 16, 16, 24, 24, 32, 32, 32, 48,
+		48, 64, 64, 80, 96, 128, 128, 192, 256, 384,
+		512, 768, 1024, 2048, 4096, 8192, 16384, 32768,
+	};
+	size_t size;
+
+	size = size_classes[stress_mwc8modn(SIZEOF_ARRAY(size_classes))];
+	/* 1 in 64 allocations are from the large uniform tail */
+	if (stress_mwc8() < 4)
+		size = stress_alloc_size(malloc_bytes);
+	return STRESS_MAXIMUM(sizeof(uintptr_t), STRESS_MINIMUM(size, malloc_bytes));
+}
+
+/*
+ *  stress_malloc_pattern_alloc()
+ *	timed allocation into slot info
+ */
+static bool stress_malloc_pattern_alloc(
+	const stress_malloc_args_t *malloc_args,
+	stress_malloc_info_t *info,
+	const size_t len)
+{
+	stress_args_t *args = malloc_args->args;
+	double t;
+
+	stress_alloc_action("malloc", len);
+	t = (double)stress_time_now_ns();
+	info->addr = (uintptr_t *)stress_malloc_pool_alloc(malloc_args->pool, len);
+	t = (double)stress_time_now_ns() - t;
+	if (UNLIKELY(!info->addr)) {
+		info->len = 0;
+		return true;
+	}
+	stress_malloc_stats_alloc(malloc_args->stats, t, len);
+	stress_malloc_page_touch((void *)info->addr, len, args->page_size);
+	*info->addr = (uintptr_t)info->addr;	/* stash address */
+	info->len = len;
+
+	return stress_bogo_inc_lock(args, counter_lock, true);
+}
+
+/*
+ *  stress_malloc_pattern_free()
+ *	check and free the allocation in slot info, inc is
+ *	true to count the free as a bogo-op
+ */
+static bool stress_malloc_pattern_free(
+	const stress_malloc_args_t *malloc_args,
+	stress_malloc_info_t *info,
+	const bool verify,
+	const bool inc)
+{
+	stress_args_t *args = malloc_args->args;
+
+	if (!info->addr)
+		return true;
+	if (UNLIKELY(verify && (uintptr_t)info->addr != *info->addr)) {
+		pr_fail("%s: allocation at %p does not contain correct value\n",
+			args->name, (void *)info->addr);
+	}
+	stress_alloc_action("free", info->len);
+	stress_malloc_pool_free(malloc_args->pool, info->addr, info->len);
+	malloc_args->stats->live_bytes -= (int64_t)info->len;
+	info->addr = NULL;
+	info->len = 0;
+
+	return inc ? stress_bogo_inc_lock(args, counter_lock, true) : true;
+}
+
+/*
+ *  stress_malloc_pattern_realloc()
+ *	timed reallocation of slot info
+ */
+static bool stress_malloc_pattern_realloc(
+	const stress_malloc_args_t *malloc_args,
+	stress_malloc_info_t *info,
+	const size_t len)
+{
+	stress_args_t *args = malloc_args->args;
+	void *ptr;
+	double t;
+
+	stress_alloc_action("realloc", len);
+	t = (double)stress_time_now_ns();
+	ptr = stress_malloc_pool_realloc(malloc_args->pool, info->addr, info->len, len);
+	t = (double)stress_time_now_ns() - t;
+	if (UNLIKELY(!ptr))
+		return true;
+	malloc_args->stats->live_bytes -= (int64_t)info->len;
+	stress_malloc_stats_alloc(malloc_args->stats, t, len);
+	info->addr = (uintptr_t *)ptr;
+	info->len = len;
+	stress_malloc_page_touch((void *)info->addr, len, args->page_size);
+	*info->addr = (uintptr_t)info->addr;	/* stash address */
+
+	return stress_bogo_inc_lock(args, counter_lock, true);
+}
+
+/*
+ *  stress_malloc_ring_push()
+ *	producer hands an allocation over to the consumers,
+ *	returns false if the ring is full
+ */
+static bool stress_malloc_ring_push(const stress_malloc_info_t *info)
+{
+	stress_malloc_ring_t *ring = &malloc_state->ring;
+	bool pushed = false;
+
+	(void)stress_lock_acquire(ring->lock);
+	if (ring->count < ring->size) {
+		ring->info[ring->head] = *info;
+		ring->head = (ring->head + 1) % ring->size;
+		ring->count++;
+		pushed = true;
+	}
+	(void)stress_lock_release(ring->lock);
+
+	return pushed;
+}
+
+/*
+ *  stress_malloc_ring_pop()
+ *	consumer takes an allocation to free,
+ *	returns false if the ring is empty
+ */
+static bool stress_malloc_ring_pop(stress_malloc_info_t *info)
+{
+	stress_malloc_ring_t *ring = &malloc_state->ring;
+	bool popped = false;
+
+	(void)stress_lock_acquire(ring->lock);
+	if (ring->count > 0) {
+		*info = ring->info[ring->tail];
+		ring->tail = (ring->tail + 1) % ring->size;
+		ring->count--;
+		popped = true;
+	}
+	(void)stress_lock_release(ring->lock);
+
+	return popped;
+}
+
+/*
+ *  stress_malloc_pattern_loop()
+ *	exercise the allocator with one of the allocation
+ *	pattern generators or by replaying a trace
+ */
+static void *stress_malloc_pattern_loop(void *ptr)
+{
+	const stress_malloc_args_t *malloc_args = (stress_malloc_args_t *)ptr;
+	stress_args_t *args = malloc_args->args;
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	const size_t n_slots = (malloc_pattern == MALLOC_PATTERN_TRACE) ?
+		malloc_trace->n_ids : malloc_max;
+	const size_t info_size = n_slots * sizeof(stress_malloc_info_t);
+	const size_t n_short = STRESS_MAXIMUM(n_slots / 8, 1);
+	const bool producer = !(malloc_args->instance & 1);
+	stress_malloc_info_t *info;
+	static void *nowt = NULL;
+	size_t j, trace_pos = 0;
+
+	stress_alloc_action("mmap", info_size);
+	info = (stress_malloc_info_t *)stress_mmap_populate(NULL, info_size,
+			PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS,
+			-1, 0);
+	if (info == MAP_FAILED) {
+		pr_inf("%s: cannot mmap address buffer of size %zd bytes: %d (%s)\n",
+			args->name, info_size, errno, strerror(errno));
+		return &nowt;
+	}
+
+	for (;;) {
+		const uint32_t rnd = stress_mwc32();
+		stress_malloc_info_t *slot;
+		bool ok = true;
+
+#if defined(HAVE_LIB_PTHREAD)
+		if (!keep_thread_running_flag)
+			break;
+#endif
+		if (!stress_bogo_inc_lock(args, counter_lock, false))
+			break;
+
+		switch (malloc_pattern) {
+		case MALLOC_PATTERN_SIZECLASS:
+			slot = &info[rnd % n_slots];
+			ok = slot->addr ?
+				stress_malloc_pattern_free(malloc_args, slot, verify, true) :
+				stress_malloc_pattern_alloc(malloc_args, slot, stress_malloc_size_class());
+			break;
+		case MALLOC_PATTERN_LIFETIME:
+			/*
+			 *  90% of the churn is on a small set of short lived
+			 *  objects interleaved with long lived objects that are
+			 *  rarely freed, fragmenting the heap
+			 */
+			if ((rnd >> 24) < 230) {
+				slot = &info[rnd % n_short];
+				ok = slot->addr ?
+					stress_malloc_pattern_free(malloc_args, slot, verify, true) :
+					stress_malloc_pattern_alloc(malloc_args, slot, stress_malloc_size_class());
+			} else {
+				slot = &info[n_short + (rnd % (n_slots - n_short))];
+				if (!slot->addr)
+					ok = stress_malloc_pattern_alloc(malloc_args, slot, stress_alloc_size(malloc_bytes));
+				else if (((rnd >> 16) & 0x3f) == 0)
+					ok = stress_malloc_pattern_free(malloc_args, slot, verify, true);
+			}
+			break;
+		case MALLOC_PATTERN_PRODCONS:
+			/*
+			 *  even instances allocate, odd instances free the
+			 *  allocations made by the other threads
+			 */
+			if (producer) {
+				stress_malloc_info_t tmp = { NULL, 0 };
+
+				ok = stress_malloc_pattern_alloc(malloc_args, &tmp, stress_malloc_size_class());
+				if (tmp.addr && !stress_malloc_ring_push(&tmp)) {
+					(void)shim_sched_yield();
+					ok &= stress_malloc_pattern_free(malloc_args, &tmp, verify, true);
+				}
+			} else {
+				stress_malloc_info_t tmp;
+
+				if (stress_malloc_ring_pop(&tmp))
+					ok = stress_malloc_pattern_free(malloc_args, &tmp, verify, true);
+				else
+					(void)shim_sched_yield();
+			}
+			break;
+		case MALLOC_PATTERN_TRACE:
+			{
+				const stress_malloc_trace_op_t *op = &malloc_trace->ops[trace_pos];
+
+				slot = &info[op->id];
+				switch (op->op) {
+				case 'a':
+					if (slot->addr)
+						ok = stress_malloc_pattern_free(malloc_args, slot, verify, true);
+					ok &= stress_malloc_pattern_alloc(malloc_args, slot, op->size);
+					break;
+				case 'r':
+					ok = stress_malloc_pattern_realloc(malloc_args, slot, op->size);
+					break;
+				default:
+					ok = stress_malloc_pattern_free(malloc_args, slot, verify, true);
+					break;
+				}
+				trace_pos++;
+				if (trace_pos >= malloc_trace->n_ops) {
+					/* end of trace, free what was leaked and replay */
+					trace_pos = 0;
+					for (j = 0; ok && (j < n_slots); j++)
+						ok = stress_malloc_pattern_free(malloc_args, &info[j], verify, true);
+				}
+			}
+			break;
+		default:
+			slot = &info[rnd % n_slots];
+			ok = slot->addr ?
+				stress_malloc_pattern_free(malloc_args, slot, verify, true) :
+				stress_malloc_pattern_alloc(malloc_args, slot, stress_alloc_size(malloc_bytes));
+			break;
+		}
+		if (UNLIKELY(!ok))
+			break;
+	}
+
+	if (malloc_args->instance == 0)
+		stress_malloc_rss_sample(args);
+
+	for (j = 0; j < n_slots; j++)
+		(void)stress_malloc_pattern_free(malloc_args, &info[j], verify, false);
+	stress_alloc_action("munmap", info_size);
+	(void)munmap((void *)info, info_size);
+
+	return &nowt;
+}
+
 static void *stress_malloc_loop(void *ptr)
 {
 	const stress_malloc_args_t *malloc_args = (stress_malloc_args_t *)ptr;
 	register stress_malloc_info_t *info;
 	stress_args_t *args = malloc_args->args;
+	stress_malloc_stats_t *stats = malloc_args->stats;
 	const size_t page_size = args->page_size;
 	const size_t info_size = malloc_max * sizeof(*info);
 	static void *nowt = NULL;
@@ -272,6 +1065,7 @@ static void *stress_malloc_loop(void *ptr)
 				}
 				stress_alloc_action("free", info[i].len);
 				free_func(info[i].addr, info[i].len);
+				stats->live_bytes -= (int64_t)info[i].len;
 				info[i].addr = NULL;
 				info[i].len = 0;
 
@@ -280,10 +1074,15 @@ static void *stress_malloc_loop(void *ptr)
 			} else {
 				void *tmp;
 				const size_t len = stress_alloc_size(malloc_bytes);
+				double t;
 
 				stress_alloc_action("realloc", len);
+				t = (double)stress_time_now_ns();
 				tmp = realloc(info[i].addr, len);
+				t = (double)stress_time_now_ns() - t;
 				if (tmp) {
+					stats->live_bytes -= (int64_t)info[i].len;
+					stress_malloc_stats_alloc(stats, t, len);
 					info[i].addr = tmp;
 					info[i].len = len;
 
@@ -301,6 +1100,7 @@ static void *stress_malloc_loop(void *ptr)
 			/* 50% free, 50% alloc */
 			if (action && !low_mem) {
 				size_t n, len = stress_alloc_size(malloc_bytes);
+				double t = (double)stress_time_now_ns();
 
 				switch (do_calloc) {
 				case 0:
@@ -352,7 +1152,9 @@ static void *stress_malloc_loop(void *ptr)
 					info[i].addr = malloc(len);
 					break;
 				}
+				t = (double)stress_time_now_ns() - t;
 				if (LIKELY(info[i].addr != NULL)) {
+					stress_malloc_stats_alloc(stats, t, len);
 					stress_alloc_action("malloc", len);
 					stress_malloc_page_touch((void *)info[i].addr, len, page_size);
 					*info[i].addr = (uintptr_t)info[i].addr;	/* stash address */
@@ -385,6 +1187,9 @@ static void *stress_malloc_loop(void *ptr)
 #endif
 	}
 
+	if (malloc_args->instance == 0)
+		stress_malloc_rss_sample(args);
+
 	for (j = 0; j < malloc_max; j++) {
 		if (verify && info[j].addr && ((uintptr_t)info[j].addr != *info[j].addr)) {
 			pr_fail("%s: allocation at %p does not contain correct value\n",
@@ -409,6 +1214,55 @@ static void MLOCKED_TEXT stress_malloc_sigsegv_handler(int signum)
 	}
 }
 
+/*
+ *  stress_malloc_metrics()
+ *	report allocation rate, latency and memory overhead
+ */
+static void stress_malloc_metrics(
+	stress_args_t *args,
+	const size_t n_stats,
+	const double duration,
+	const size_t rss_base)
+{
+	uint64_t allocs = 0;
+	double alloc_duration = 0.0, *latencies;
+	size_t i, n = 0;
+
+	for (i = 0; i < n_stats; i++) {
+		allocs += malloc_state->stats[i].allocs;
+		alloc_duration += malloc_state->stats[i].alloc_duration;
+	}
+	stress_metrics_set(args, 0, "allocations per sec",
+		(duration > 0.0) ? (double)allocs / duration : 0.0, STRESS_HARMONIC_MEAN);
+	stress_metrics_set(args, 1, "nanosecs per allocation",
+		allocs ? alloc_duration / (double)allocs : 0.0,
+		STRESS_HARMONIC_MEAN);
+
+	latencies = (double *)calloc(n_stats * MALLOC_LATENCY_SAMPLES, sizeof(*latencies));
+	if (latencies) {
+		for (i = 0; i < n_stats; i++) {
+			const size_t n_samples = (size_t)STRESS_MINIMUM(malloc_state->stats[i].allocs,
+								MALLOC_LATENCY_SAMPLES);
+
+			(void)shim_memcpy(latencies + n, malloc_state->stats[i].latencies,
+				n_samples * sizeof(*latencies));
+			n += n_samples;
+		}
+		if (n) {
+			qsort(latencies, n, sizeof(*latencies), stress_metrics_cmp_double);
+			stress_metrics_set(args, 2, "nanosecs p99 allocation latency",
+				latencies[(n * 99) / 100], STRESS_GEOMETRIC_MEAN);
+		}
+		free(latencies);
+	}
+
+	if ((malloc_state->rss > rss_base) && (malloc_state->live_bytes > 0)) {
+		stress_metrics_set(args, 3, "RSS to live bytes ratio",
+			(double)(malloc_state->rss - rss_base) / (double)malloc_state->live_bytes,
+			STRESS_GEOMETRIC_MEAN);
+	}
+}
+
 static int stress_malloc_child(stress_args_t *args, void *context)
 {
 	int ret;
@@ -420,8 +1274,12 @@ static int stress_malloc_child(stress_args_t *args, void *context)
 	size_t malloc_pthreads = 0;
 #if defined(HAVE_LIB_PTHREAD)
 	stress_pthread_info_t pthreads[MAX_MALLOC_PTHREADS];
-	size_t j;
 #endif
+	size_t j, n_stats, state_size, ring_size, rss_base;
+	stress_malloc_pool_t pools[MAX_MALLOC_PTHREADS + 1];
+	stress_malloc_info_t tmp;
+	void *(*loop_func)(void *ptr);
+	double t_start, duration;
 
 	(void)shim_memset(malloc_args, 0, sizeof(malloc_args));
 
@@ -436,6 +1294,54 @@ static int stress_malloc_child(stress_args_t *args, void *context)
 		return EXIT_FAILURE;
 
 	(void)stress_get_setting("malloc-pthreads", &malloc_pthreads);
+	if ((malloc_pattern == MALLOC_PATTERN_PRODCONS) && (malloc_pthreads == 0)) {
+#if defined(HAVE_LIB_PTHREAD)
+		if (args->instance == 0)
+			pr_inf("%s: prodcons pattern requires a consumer, "
+				"using 1 pthread\n", args->name);
+		malloc_pthreads = 1;
+#endif
+	}
+
+	/* existing random mix of the libc allocation functions */
+	loop_func = ((malloc_pattern == MALLOC_PATTERN_RANDOM) &&
+		     (malloc_allocator == MALLOC_ALLOCATOR_LIBC)) ?
+		stress_malloc_loop : stress_malloc_pattern_loop;
+
+	n_stats = malloc_pthreads + 1;
+	state_size = sizeof(*malloc_state) + (n_stats * sizeof(*malloc_state->stats));
+	malloc_state = (stress_malloc_state_t *)stress_mmap_populate(NULL, state_size,
+			PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (malloc_state == MAP_FAILED) {
+		pr_inf("%s: cannot mmap statistics buffer of size %zd bytes: %d (%s)\n",
+			args->name, state_size, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+	malloc_state->stats = (stress_malloc_stats_t *)(malloc_state + 1);
+	malloc_state->n_stats = n_stats;
+
+	ring_size = malloc_max * sizeof(*malloc_state->ring.info);
+	malloc_state->ring.size = malloc_max;
+	malloc_state->ring.info = (stress_malloc_info_t *)stress_mmap_populate(NULL, ring_size,
+			PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	malloc_state->ring.lock = stress_lock_create();
+	if ((malloc_state->ring.info == MAP_FAILED) || !malloc_state->ring.lock) {
+		pr_inf("%s: cannot allocate producer/consumer ring\n", args->name);
+		ret = EXIT_NO_RESOURCE;
+		goto unmap_state;
+	}
+
+	for (j = 0; j < n_stats; j++) {
+		if (stress_malloc_pool_init(&pools[j]) < 0) {
+			pr_inf("%s: cannot create allocator pool lock\n", args->name);
+			ret = EXIT_NO_RESOURCE;
+			goto deinit_pools;
+		}
+		malloc_args[j].args = args;
+		malloc_args[j].instance = j;
+		malloc_args[j].stats = &malloc_state->stats[j];
+		malloc_args[j].pool = &pools[j];
+	}
 
 #if defined(MCL_FUTURE)
 	if (malloc_mlock) {
@@ -444,28 +1350,25 @@ static int stress_malloc_child(stress_args_t *args, void *context)
 	}
 #endif
 
-	malloc_args[0].args = args;
-	malloc_args[0].instance = 0;
-
 	(void)context;
 
+	rss_base = stress_malloc_rss(args->page_size);
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	t_start = stress_time_now();
 
 #if defined(HAVE_LIB_PTHREAD)
 	keep_thread_running_flag = true;
 	(void)shim_memset(pthreads, 0, sizeof(pthreads));
 	for (j = 0; j < malloc_pthreads; j++) {
-		malloc_args[j + 1].args = args;
-		malloc_args[j + 1].instance = j + 1;
 		pthreads[j].ret = pthread_create(&pthreads[j].pthread, NULL,
-			stress_malloc_loop, (void *)&malloc_args);
+			loop_func, (void *)&malloc_args[j + 1]);
 	}
 #else
 	if ((args->instance == 0) && (malloc_pthreads > 0))
 		pr_inf("%s: pthreads not supported, ignoring the "
 			"--malloc-pthreads option\n", args->name);
 #endif
-	stress_malloc_loop(&malloc_args);
+	loop_func(&malloc_args[0]);
 
 	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
 #if defined(HAVE_LIB_PTHREAD)
@@ -481,7 +1384,132 @@ static int stress_malloc_child(stress_args_t *args, void *context)
 		}
 	}
 #endif
-	return EXIT_SUCCESS;
+	duration = stress_time_now() - t_start;
+
+	/* free allocations not picked up by the consumers */
+	while (stress_malloc_ring_pop(&tmp))
+		stress_malloc_pool_free(&pools[0], tmp.addr, tmp.len);
+
+	stress_malloc_metrics(args, n_stats, duration, rss_base);
+	ret = EXIT_SUCCESS;
+
+	j = n_stats;
+deinit_pools:
+	while (j > 0) {
+		j--;
+		stress_malloc_pool_deinit(&pools[j]);
+	}
+unmap_state:
+	if (malloc_state->ring.lock)
+		(void)stress_lock_destroy(malloc_state->ring.lock);
+	if (malloc_state->ring.info != MAP_FAILED)
+		(void)munmap((void *)malloc_state->ring.info, ring_size);
+	(void)munmap((void *)malloc_state, state_size);
+
+	return ret;
+}
+
+/*
+ *  stress_malloc_trace_free()
+ *	free a loaded allocation trace
+ */
+static void stress_malloc_trace_free(stress_malloc_trace_t *trace)
+{
+	if (!trace)
+		return;
+	free(trace->ops);
+	free(trace);
+}
+
+/*
+ *  stress_malloc_trace_load()
+ *	load an allocation trace, one operation per line:
+ *	  a ID SIZE	allocate SIZE bytes as allocation ID
+ *	  r ID SIZE	reallocate allocation ID to SIZE bytes
+ *	  f ID		free allocation ID
+ *	blank lines and lines starting with # are ignored
+ */
+static stress_malloc_trace_t *stress_malloc_trace_load(
+	stress_args_t *args,
+	const char *filename)
+{
+	stress_malloc_trace_t *trace;
+	size_t n_alloc = 0, line = 0;
+	char buf[256];
+	FILE *fp;
+
+	fp = fopen(filename, "r");
+	if (!fp) {
+		pr_err("%s: cannot open allocation trace file '%s', errno=%d (%s)\n",
+			args->name, filename, errno, strerror(errno));
+		return NULL;
+	}
+	trace = (stress_malloc_trace_t *)calloc(1, sizeof(*trace));
+	if (!trace) {
+		pr_inf("%s: cannot allocate allocation trace\n", args->name);
+		(void)fclose(fp);
+		return NULL;
+	}
+
+	while (fgets(buf, sizeof(buf), fp)) {
+		stress_malloc_trace_op_t *op;
+		char op_char, *ptr = buf;
+		uint32_t id;
+		size_t size = 0;
+		int n;
+
+		line++;
+		while (isspace((unsigned char)*ptr))
+			ptr++;
+		if ((*ptr == '\0') || (*ptr == '#'))
+			continue;
+
+		n = sscanf(ptr, "%c %" SCNu32 " %zu", &op_char, &id, &size);
+		if ((n < 2) ||
+		    ((op_char != 'a') && (op_char != 'r') && (op_char != 'f')) ||
+		    ((op_char != 'f') && ((n < 3) || (size > MAX_MALLOC_BYTES))) ||
+		    (id >= MAX_MALLOC_TRACE_IDS)) {
+			pr_err("%s: invalid allocation trace operation in '%s' at line %zu\n",
+				args->name, filename, line);
+			goto err;
+		}
+		if (trace->n_ops >= n_alloc) {
+			stress_malloc_trace_op_t *ops;
+
+			if (n_alloc >= MAX_MALLOC_TRACE_OPS) {
+				pr_err("%s: allocation trace '%s' has more than %d operations\n",
+					args->name, filename, MAX_MALLOC_TRACE_OPS);
+				goto err;
+			}
+			n_alloc = n_alloc ? n_alloc * 2 : 4096;
+			ops = (stress_malloc_trace_op_t *)realloc(trace->ops, n_alloc * sizeof(*ops));
+			if (!ops) {
+				pr_inf("%s: cannot allocate allocation trace\n", args->name);
+				goto err;
+			}
+			trace->ops = ops;
+		}
+		op = &trace->ops[trace->n_ops++];
+		op->op = op_char;
+		op->id = id;
+		op->size = STRESS_MAXIMUM(size, sizeof(uintptr_t));
+		if (id >= trace->n_ids)
+			trace->n_ids = id + 1;
+	}
+	(void)fclose(fp);
+
+	if (!trace->n_ops) {
+		pr_err("%s: allocation trace '%s' contains no operations\n",
+			args->name, filename);
+		stress_malloc_trace_free(trace);
+		return NULL;
+	}
+	return trace;
+
+err:
+	(void)fclose(fp);
+	stress_malloc_trace_free(trace);
+	return NULL;
 }
 
 /*
@@ -492,7 +1520,7 @@ static int stress_malloc_child(stress_args_t *args, void *context)
 static int stress_malloc(stress_args_t *args)
 {
 	int ret;
-	bool malloc_zerofree = false;
+	char *malloc_trace_filename = NULL;
 
 	stress_alloc_action("<unknown>", 0);
 
@@ -538,23 +1566,51 @@ static int stress_malloc(stress_args_t *args)
 	(void)stress_get_setting("malloc-trim", &malloc_trim_opt);
 	malloc_mlock = false;
 	(void)stress_get_setting("malloc-mlock", &malloc_mlock);
+	malloc_zerofree = false;
 	(void)stress_get_setting("malloc-zerofree", &malloc_zerofree);
 	free_func = malloc_zerofree ? stress_malloc_zerofree : stress_malloc_free;
+	malloc_allocator = MALLOC_ALLOCATOR_LIBC;
+	(void)stress_get_setting("malloc-allocator", &malloc_allocator);
+	(void)stress_get_setting("malloc-trace", &malloc_trace_filename);
+	malloc_pattern = malloc_trace_filename ? MALLOC_PATTERN_TRACE : MALLOC_PATTERN_RANDOM;
+	(void)stress_get_setting("malloc-pattern", &malloc_pattern);
+
+	malloc_trace = NULL;
+	if (malloc_pattern == MALLOC_PATTERN_TRACE) {
+		if (!malloc_trace_filename) {
+			pr_err("%s: trace pattern requires an allocation trace, "
+				"use --malloc-trace to specify one\n", args->name);
+			(void)stress_lock_destroy(counter_lock);
+			return EXIT_FAILURE;
+		}
+		malloc_trace = stress_malloc_trace_load(args, malloc_trace_filename);
+		if (!malloc_trace) {
+			(void)stress_lock_destroy(counter_lock);
+			return EXIT_FAILURE;
+		}
+	}
+	if (args->instance == 0)
+		pr_dbg("%s: using %s allocator with %s allocation pattern\n", args->name,
+			malloc_allocators[malloc_allocator].name, malloc_patterns[malloc_pattern].name);
 
 	ret = stress_oomable_child(args, NULL, stress_malloc_child, STRESS_OOMABLE_NORMAL);
 
+	stress_malloc_trace_free(malloc_trace);
 	(void)stress_lock_destroy(counter_lock);
 
 	return ret;
 }
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_malloc_allocator,	stress_set_malloc_allocator },
 	{ OPT_malloc_bytes,	stress_set_malloc_bytes },
 	{ OPT_malloc_max,	stress_set_malloc_max },
 	{ OPT_malloc_mlock,	stress_set_malloc_mlock },
+	{ OPT_malloc_pattern,	stress_set_malloc_pattern },
 	{ OPT_malloc_pthreads,	stress_set_malloc_pthreads },
 	{ OPT_malloc_threshold,	stress_set_malloc_threshold },
 	{ OPT_malloc_touch,	stress_set_malloc_touch },
+	{ OPT_malloc_trace,	stress_set_malloc_trace },
 	{ OPT_malloc_trim,	stress_set_malloc_trim },
 	{ OPT_malloc_zerofree,	stress_set_malloc_zerofree },
 	{ 0,			NULL }
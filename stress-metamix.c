@@ -28,6 +28,22 @@
 #define METAMIX_PROCS			(15)
 #define METAMIX_WRITES			(256)
 
+#define MIN_METAMIX_FILES		(1)
+#define MAX_METAMIX_FILES		(100000000)
+#define DEFAULT_METAMIX_FILES		(10000)
+
+#define MIN_METAMIX_WORKERS		(1)
+#define MAX_METAMIX_WORKERS		(1024)
+#define DEFAULT_METAMIX_WORKERS		(4)
+
+#define METAMIX_PHASE_CREATE		(0)
+#define METAMIX_PHASE_STAT		(1)
+#define METAMIX_PHASE_OPEN		(2)
+#define METAMIX_PHASE_RENAME		(3)
+#define METAMIX_PHASE_READDIR		(4)
+#define METAMIX_PHASE_UNLINK		(5)
+#define METAMIX_PHASES			(6)
+
 typedef struct {
 	off_t	 offset;		/* seek offset */
 	size_t	 data_len;		/* length of data written */
@@ -35,10 +51,40 @@ typedef struct {
 	bool	 valid;			/* true of data written sanely */
 } file_info_t;
 
+typedef struct {
+	volatile uint64_t done;		/* last phase generation completed */
+	uint64_t ops;			/* operations completed in phase */
+	double t_end;			/* time phase completed */
+	bool partial;			/* phase was cut short */
+	bool failed;			/* phase hit an unexpected error */
+	bool no_space;			/* phase ran out of space or inodes */
+} metamix_worker_t;
+
+typedef struct {
+	volatile uint64_t go;		/* phase generation, bumped per phase */
+	volatile bool stop;		/* workers should exit */
+	volatile bool halt;		/* workers should end the current phase */
+	double t_start;			/* time phase started */
+	metamix_worker_t worker[];	/* per worker phase results */
+} metamix_bench_t;
+
+static const char * const metamix_phase_names[METAMIX_PHASES] = {
+	"create",
+	"stat",
+	"open/close",
+	"rename",
+	"readdir",
+	"unlink",
+};
+
 static const stress_help_t help[] = {
 	{ NULL,	"metamix N",	 	"start N workers that have a mix of file metadata operations" },
+	{ NULL,	"metamix-bench",	"run create, stat, open, rename, readdir and unlink phases, report ops/s" },
 	{ NULL,	"metamix-bytes N",	"write N bytes per metamix file (default is 1MB, 16 files per instance)" },
+	{ NULL,	"metamix-files N",	"create N files per worker in metamix-bench mode (default 10000)" },
 	{ NULL,	"metamix-ops N",	"stop metamix workers after N metamix bogo operations" },
+	{ NULL,	"metamix-shared",	"metamix-bench workers share one directory rather than one each" },
+	{ NULL,	"metamix-workers N",	"use N worker processes in metamix-bench mode (default 4)" },
 	{ NULL, NULL,		 	NULL }
 };
 
@@ -54,6 +100,36 @@ static int stress_set_metamix_bytes(const char *opt)
 	return stress_set_setting("metamix-bytes", TYPE_ID_OFF_T, &metamix_bytes);
 }
 
+static int stress_set_metamix_bench(const char *opt)
+{
+	return stress_set_setting_true("metamix-bench", opt);
+}
+
+static int stress_set_metamix_files(const char *opt)
+{
+	uint64_t metamix_files;
+
+	metamix_files = stress_get_uint64(opt);
+	stress_check_range("metamix-files", metamix_files,
+		MIN_METAMIX_FILES, MAX_METAMIX_FILES);
+	return stress_set_setting("metamix-files", TYPE_ID_UINT64, &metamix_files);
+}
+
+static int stress_set_metamix_shared(const char *opt)
+{
+	return stress_set_setting_true("metamix-shared", opt);
+}
+
+static int stress_set_metamix_workers(const char *opt)
+{
+	uint32_t metamix_workers;
+
+	metamix_workers = stress_get_uint32(opt);
+	stress_check_range("metamix-workers", (uint64_t)metamix_workers,
+		MIN_METAMIX_WORKERS, MAX_METAMIX_WORKERS);
+	return stress_set_setting("metamix-workers", TYPE_ID_UINT32, &metamix_workers);
+}
+
 /*
  *  stress_metamix_cmp()
  *	sort by checksum to get randomized seek read ordering
@@ -318,6 +394,425 @@ err_unlink:
 	return rc;
 }
 
+/*
+ *  stress_metamix_bench_name()
+ *	build the name of file i for a given worker, shared directory
+ *	names are prefixed with the worker number to keep them unique
+ */
+static inline void stress_metamix_bench_name(
+	char *name,
+	const size_t len,
+	const char *dir,
+	const bool shared,
+	const uint32_t worker,
+	const uint64_t i,
+	const bool renamed)
+{
+	const char ch = renamed ? 'r' : 'f';
+	char leaf[64];
+
+	if (shared)
+		(void)snprintf(leaf, sizeof(leaf), "w%" PRIu32 ".%c%" PRIu64, worker, ch, i);
+	else
+		(void)snprintf(leaf, sizeof(leaf), "%c%" PRIu64, ch, i);
+	(void)stress_mk_filename(name, len, dir, leaf);
+}
+
+/*
+ *  stress_metamix_bench_dir()
+ *	build the name of the directory used by a given worker
+ */
+static inline void stress_metamix_bench_dir(
+	char *dir,
+	const size_t len,
+	const char *temp_dir,
+	const bool shared,
+	const uint32_t worker)
+{
+	char leaf[32];
+
+	if (shared)
+		(void)shim_strscpy(leaf, "shared", sizeof(leaf));
+	else
+		(void)snprintf(leaf, sizeof(leaf), "w%" PRIu32, worker);
+	(void)stress_mk_filename(dir, len, temp_dir, leaf);
+}
+
+/*
+ *  stress_metamix_bench_readdir()
+ *	scan a directory, return number of non-dot entries found
+ */
+static uint64_t stress_metamix_bench_readdir(
+	stress_args_t *args,
+	const char *dir,
+	const volatile bool *halt,
+	metamix_worker_t *w)
+{
+	DIR *dp;
+	const struct dirent *d;
+	uint64_t n = 0;
+
+	dp = opendir(dir);
+	if (!dp) {
+		pr_fail("%s: opendir on %s failed, errno=%d (%s)\n",
+			args->name, dir, errno, strerror(errno));
+		w->failed = true;
+		return 0;
+	}
+	while ((d = readdir(dp)) != NULL) {
+		if (d->d_name[0] == '.')
+			continue;
+		n++;
+		if (UNLIKELY(((n & 1023) == 0) && (*halt || !stress_continue_flag()))) {
+			w->partial = true;
+			break;
+		}
+	}
+	(void)closedir(dp);
+	return n;
+}
+
+/*
+ *  stress_metamix_bench_phase()
+ *	run one metadata phase over all of a worker's files
+ */
+static void stress_metamix_bench_phase(
+	stress_args_t *args,
+	metamix_worker_t *w,
+	const volatile bool *halt,
+	const int phase,
+	const char *dir,
+	const bool shared,
+	const uint32_t worker,
+	const uint32_t metamix_workers,
+	const uint64_t metamix_files)
+{
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	char name[PATH_MAX], rname[PATH_MAX];
+	uint64_t i;
+
+	w->ops = 0;
+	w->partial = false;
+
+	if (phase == METAMIX_PHASE_READDIR) {
+		const uint64_t expected = shared ?
+			metamix_files * metamix_workers : metamix_files;
+
+		w->ops = stress_metamix_bench_readdir(args, dir, halt, w);
+		if (verify && !w->partial && !w->failed && (w->ops != expected)) {
+			pr_fail("%s: readdir on %s found %" PRIu64 " files, expected %" PRIu64 "\n",
+				args->name, dir, w->ops, expected);
+			w->failed = true;
+		}
+		return;
+	}
+
+	for (i = 0; i < metamix_files; i++) {
+		struct stat statbuf;
+		int fd;
+
+		if (UNLIKELY(((i & 63) == 0) && (*halt || !stress_continue_flag()))) {
+			w->partial = true;
+			return;
+		}
+		stress_metamix_bench_name(name, sizeof(name), dir, shared, worker, i, phase > METAMIX_PHASE_OPEN);
+
+		switch (phase) {
+		case METAMIX_PHASE_CREATE:
+			fd = open(name, O_WRONLY | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+			if (fd < 0)
+				goto err;
+			(void)close(fd);
+			break;
+		case METAMIX_PHASE_STAT:
+			if (shim_stat(name, &statbuf) < 0)
+				goto err;
+			if (verify && !S_ISREG(statbuf.st_mode)) {
+				pr_fail("%s: stat on %s, file is not a regular file\n",
+					args->name, name);
+				w->failed = true;
+				return;
+			}
+			break;
+		case METAMIX_PHASE_OPEN:
+			fd = open(name, O_RDONLY);
+			if (fd < 0)
+				goto err;
+			(void)close(fd);
+			break;
+		case METAMIX_PHASE_RENAME:
+			stress_metamix_bench_name(rname, sizeof(rname), dir, shared, worker, i, false);
+			if (rename(rname, name) < 0)
+				goto err;
+			break;
+		case METAMIX_PHASE_UNLINK:
+			if (shim_unlink(name) < 0)
+				goto err;
+			break;
+		default:
+			return;
+		}
+		w->ops++;
+	}
+	return;
+err:
+	if ((errno == ENOSPC) || (errno == EDQUOT) || (errno == ENOMEM) || (errno == EMFILE) || (errno == ENFILE)) {
+		w->no_space = true;
+		return;
+	}
+	pr_fail("%s: %s on %s failed, errno=%d (%s)\n",
+		args->name, metamix_phase_names[phase], name, errno, strerror(errno));
+	w->failed = true;
+}
+
+/*
+ *  stress_metamix_bench_worker()
+ *	wait for each phase to be started by the parent, run it
+ *	and flag it as done
+ */
+static void stress_metamix_bench_worker(
+	stress_args_t *args,
+	metamix_bench_t *bench,
+	const char *dir,
+	const bool shared,
+	const uint32_t worker,
+	const uint32_t metamix_workers,
+	const uint64_t metamix_files)
+{
+	metamix_worker_t *w = &bench->worker[worker];
+	uint64_t gen = 0;
+
+	for (;;) {
+		while ((bench->go == gen) && !bench->stop)
+			(void)shim_usleep(50);
+		if (bench->stop)
+			break;
+		gen = bench->go;
+
+		stress_metamix_bench_phase(args, w, &bench->halt, (int)((gen - 1) % METAMIX_PHASES),
+			dir, shared, worker, metamix_workers, metamix_files);
+		w->t_end = stress_time_now();
+		stress_asm_mb();
+		w->done = gen;
+	}
+}
+
+/*
+ *  stress_metamix_bench_clean()
+ *	remove any files left behind by an interrupted run and the directory
+ */
+static void stress_metamix_bench_clean(const char *dir)
+{
+	DIR *dp;
+	const struct dirent *d;
+
+	dp = opendir(dir);
+	if (dp) {
+		while ((d = readdir(dp)) != NULL) {
+			char name[PATH_MAX];
+
+			if (d->d_name[0] == '.')
+				continue;
+			(void)stress_mk_filename(name, sizeof(name), dir, d->d_name);
+			(void)shim_unlink(name);
+		}
+		(void)closedir(dp);
+	}
+	(void)shim_rmdir(dir);
+}
+
+/*
+ *  stress_metamix_bench()
+ *	mdtest style metadata rate benchmark, workers run through
+ *	create, stat, open/close, rename, readdir and unlink phases
+ *	in lock-step, either in one shared directory or in a directory
+ *	per worker, and the per phase rates are reported
+ */
+static int stress_metamix_bench(stress_args_t *args, const char *temp_dir)
+{
+	uint64_t metamix_files = DEFAULT_METAMIX_FILES;
+	uint32_t metamix_workers = DEFAULT_METAMIX_WORKERS;
+	bool metamix_shared = false;
+	metamix_bench_t *bench;
+	size_t bench_size;
+	pid_t *pids;
+	uint32_t i;
+	uint64_t phase_ops[METAMIX_PHASES];
+	double phase_time[METAMIX_PHASES];
+	uint64_t cycles = 0;
+	bool running = true;
+	int rc = EXIT_SUCCESS;
+	char dir[PATH_MAX];
+	int p;
+
+	(void)stress_get_setting("metamix-files", &metamix_files);
+	(void)stress_get_setting("metamix-workers", &metamix_workers);
+	(void)stress_get_setting("metamix-shared", &metamix_shared);
+
+	pids = (pid_t *)calloc((size_t)metamix_workers, sizeof(*pids));
+	if (!pids) {
+		pr_inf_skip("%s: failed to allocate %" PRIu32 " pids, skipping stressor\n",
+			args->name, metamix_workers);
+		return EXIT_NO_RESOURCE;
+	}
+	bench_size = sizeof(*bench) + (size_t)metamix_workers * sizeof(metamix_worker_t);
+	bench = (metamix_bench_t *)mmap(NULL, bench_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (bench == MAP_FAILED) {
+		pr_inf_skip("%s: failed to mmap %zu bytes for phase state, skipping stressor\n",
+			args->name, bench_size);
+		free(pids);
+		return EXIT_NO_RESOURCE;
+	}
+	stress_set_vma_anon_name(bench, bench_size, "metamix-bench");
+
+	for (i = 0; i < (metamix_shared ? 1 : metamix_workers); i++) {
+		stress_metamix_bench_dir(dir, sizeof(dir), temp_dir, metamix_shared, i);
+		if ((mkdir(dir, S_IRWXU) < 0) && (errno != EEXIST)) {
+			pr_inf_skip("%s: mkdir %s failed, errno=%d (%s), skipping stressor\n",
+				args->name, dir, errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			goto clean;
+		}
+	}
+
+	(void)shim_memset(phase_ops, 0, sizeof(phase_ops));
+	(void)shim_memset(phase_time, 0, sizeof(phase_time));
+
+	if (args->instance == 0)
+		pr_inf("%s: %" PRIu32 " workers, %" PRIu64 " files per worker in %s\n",
+			args->name, metamix_workers, metamix_files,
+			metamix_shared ? "one shared directory" : "a directory per worker");
+
+	for (i = 0; i < metamix_workers; i++) {
+		stress_metamix_bench_dir(dir, sizeof(dir), temp_dir, metamix_shared, i);
+
+		pids[i] = fork();
+		if (pids[i] < 0) {
+			pr_inf_skip("%s: fork failed, errno=%d (%s), skipping stressor\n",
+				args->name, errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			goto reap;
+		} else if (pids[i] == 0) {
+			stress_parent_died_alarm();
+			(void)sched_settings_apply(true);
+			stress_metamix_bench_worker(args, bench, dir, metamix_shared,
+				i, metamix_workers, metamix_files);
+			_exit(EXIT_SUCCESS);
+		}
+	}
+
+	while (running && stress_continue(args)) {
+		for (p = 0; running && (p < METAMIX_PHASES); p++) {
+			double t_end = 0.0;
+			bool waiting;
+
+			bench->t_start = stress_time_now();
+			stress_asm_mb();
+			bench->go++;
+
+			do {
+				waiting = false;
+				for (i = 0; i < metamix_workers; i++) {
+					int status;
+
+					if (bench->worker[i].done == bench->go)
+						continue;
+					if ((pids[i] > 1) && (waitpid(pids[i], &status, WNOHANG) == pids[i])) {
+						pr_fail("%s: worker %" PRIu32 " died unexpectedly\n",
+							args->name, i);
+						pids[i] = -1;
+						rc = EXIT_FAILURE;
+						running = false;
+						break;
+					}
+					waiting = true;
+				}
+				if (waiting) {
+					/* workers don't see the alarm, tell them to stop */
+					if (!stress_continue_flag())
+						bench->halt = true;
+					(void)shim_usleep(100);
+				}
+			} while (waiting && running);
+			if (!running)
+				break;
+
+			for (i = 0; i < metamix_workers; i++) {
+				metamix_worker_t *w = &bench->worker[i];
+
+				phase_ops[p] += w->ops;
+				if (w->t_end > t_end)
+					t_end = w->t_end;
+				if (w->failed) {
+					rc = EXIT_FAILURE;
+					running = false;
+				}
+				if (w->no_space) {
+					if (cycles == 0) {
+						pr_inf_skip("%s: out of space or inodes in %s phase, "
+							"try fewer --metamix-files, skipping stressor\n",
+							args->name, metamix_phase_names[p]);
+						rc = EXIT_NO_RESOURCE;
+					}
+					running = false;
+				}
+				if (w->partial)
+					running = false;
+			}
+			if (t_end > bench->t_start)
+				phase_time[p] += t_end - bench->t_start;
+		}
+		if (running) {
+			cycles++;
+			stress_bogo_inc(args);
+		}
+	}
+
+reap:
+	bench->stop = true;
+	stress_asm_mb();
+	(void)stress_kill_and_wait_many(args, pids, (size_t)metamix_workers, SIGALRM, true);
+
+	/* report partially complete cycles too, large file counts may not complete one */
+	if ((rc == EXIT_SUCCESS) && (phase_ops[METAMIX_PHASE_CREATE] > 0)) {
+		for (p = 0; p < METAMIX_PHASES; p++) {
+			const double rate = (phase_time[p] > 0.0) ?
+				(double)phase_ops[p] / phase_time[p] : 0.0;
+			char desc[64];
+
+			(void)snprintf(desc, sizeof(desc), "%s ops per sec", metamix_phase_names[p]);
+			stress_metrics_set(args, p, desc, rate, STRESS_HARMONIC_MEAN);
+		}
+		if (args->instance == 0) {
+			pr_block_begin();
+			pr_inf("%s: %-10s %14s %12s %14s\n", args->name,
+				"phase", "ops", "secs", "ops/sec");
+			for (p = 0; p < METAMIX_PHASES; p++) {
+				const double rate = (phase_time[p] > 0.0) ?
+					(double)phase_ops[p] / phase_time[p] : 0.0;
+
+				pr_inf("%s: %-10s %14" PRIu64 " %12.3f %14.1f\n", args->name,
+					metamix_phase_names[p], phase_ops[p], phase_time[p], rate);
+			}
+			pr_inf("%s: %" PRIu64 " complete cycles (readdir ops are directory entries read)\n",
+				args->name, cycles);
+			pr_block_end();
+		}
+	}
+
+clean:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	for (i = 0; i < (metamix_shared ? 1 : metamix_workers); i++) {
+		stress_metamix_bench_dir(dir, sizeof(dir), temp_dir, metamix_shared, i);
+		stress_metamix_bench_clean(dir);
+	}
+	(void)munmap((void *)bench, bench_size);
+	free(pids);
+
+	return rc;
+}
+
 /*
  *  stress_metamix
  *	stress metadata patterns using an emulation of
@@ -333,6 +828,9 @@ static int stress_metamix(stress_args_t *args)
 	uint32_t w, z;
 	char temp_dir[PATH_MAX];
 	const char *fs_type;
+	bool metamix_bench = false;
+
+	(void)stress_get_setting("metamix-bench", &metamix_bench);
 
 	if (stress_sigchld_set_handler(args) < 0)
 		return EXIT_NO_RESOURCE;
@@ -353,6 +851,15 @@ static int stress_metamix(stress_args_t *args)
 	}
 	fs_type = stress_get_fs_type(temp_dir);
 
+	if (metamix_bench) {
+		if (args->instance == 0)
+			pr_inf("%s: metadata benchmark on %s%s\n", args->name, temp_dir, fs_type);
+		stress_set_proc_state(args->name, STRESS_STATE_RUN);
+		ret = stress_metamix_bench(args, temp_dir);
+		(void)stress_temp_dir_rm_args(args);
+		goto lock_destroy;
+	}
+
 	(void)shim_memset(pids, 0, sizeof(pids));
 	stress_mwc_get_seed(&w, &z);
 
@@ -394,7 +901,11 @@ lock_destroy:
 }
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_metamix_bench,	stress_set_metamix_bench },
 	{ OPT_metamix_bytes,	stress_set_metamix_bytes },
+	{ OPT_metamix_files,	stress_set_metamix_files },
+	{ OPT_metamix_shared,	stress_set_metamix_shared },
+	{ OPT_metamix_workers,	stress_set_metamix_workers },
 	{ 0,			NULL }
 };
 
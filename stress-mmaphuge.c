@@ -18,11 +18,16 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
 #include "core-mmap.h"
 #include "core-out-of-memory.h"
+#include "core-perf.h"
+#include "core-put.h"
 
 static const stress_help_t help[] = {
 	{ NULL,	"mmaphuge N",		"start N workers stressing mmap with huge mappings" },
+	{ NULL,	"mmaphuge-bench",	"compare 4K, THP and hugetlb page fault and access rates" },
+	{ NULL,	"mmaphuge-bench-bytes N", "working set size for the page size comparison" },
 	{ NULL, "mmaphuge-file",	"perform mappings on a temporary file" },
 	{ NULL,	"mmaphuge-mlock",	"attempt to mlock pages into memory" },
 	{ NULL, "mmaphuge-mmaps N",	"select number of memory mappings per iteration" },
@@ -30,6 +35,21 @@ static const stress_help_t help[] = {
 	{ NULL,	NULL,			NULL }
 };
 
+static int stress_set_mmaphuge_bench(const char *opt)
+{
+	return stress_set_setting_true("mmaphuge-bench", opt);
+}
+
+static int stress_set_mmaphuge_bench_bytes(const char *opt)
+{
+	size_t mmaphuge_bench_bytes;
+
+	mmaphuge_bench_bytes = (size_t)stress_get_uint64_byte_memory(opt, 1);
+	stress_check_range_bytes("mmaphuge-bench-bytes", mmaphuge_bench_bytes,
+		4 * MB, MAX_MEM_LIMIT);
+	return stress_set_setting("mmaphuge-bench-bytes", TYPE_ID_SIZE_T, &mmaphuge_bench_bytes);
+}
+
 static int stress_set_mmaphuge_mlock(const char *opt)
 {
 	return stress_set_setting_true("mmaphuge-mlock", opt);
@@ -55,6 +75,8 @@ static int stress_set_mmaphuge_file(const char *opt)
 }
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_mmaphuge_bench,	stress_set_mmaphuge_bench },
+	{ OPT_mmaphuge_bench_bytes, stress_set_mmaphuge_bench_bytes },
 	{ OPT_mmaphuge_file,	stress_set_mmaphuge_file },
 	{ OPT_mmaphuge_mlock,	stress_set_mmaphuge_mlock },
 	{ OPT_mmaphuge_mmaps,	stress_set_mmaphuge_mmaps },
@@ -107,6 +129,327 @@ static const stress_mmaphuge_setting_t stress_mmap_settings[] =
 	{ 0, 2 * MB },			/* for THP */
 };
 
+#if defined(__linux__) &&	\
+    !defined(MADV_COLLAPSE)
+#define MADV_COLLAPSE		(25)
+#endif
+
+#define MMAPHUGE_BENCH_DEFAULT_BYTES	(256 * MB)
+#define MMAPHUGE_BENCH_MAX_RANDOM	(16 * 1024 * 1024)
+
+/* a page size configuration to benchmark */
+typedef struct {
+	const char *name;		/* configuration name */
+	const int flags;		/* extra mmap flags */
+	const int advice;		/* madvise advice before first touch, -1 = none */
+	const bool collapse;		/* MADV_COLLAPSE after first touch */
+	const size_t align;		/* working set must be a multiple of this, 0 = any */
+} stress_mmaphuge_bench_t;
+
+/* accumulated benchmark results for a configuration */
+typedef struct {
+	double touch_bytes;		/* bytes first touched */
+	double touch_time;		/* time to first touch (and collapse) */
+	double seq_bytes;		/* bytes read sequentially */
+	double seq_time;		/* sequential read time */
+	double rnd_accesses;		/* random 8 byte reads */
+	double rnd_time;		/* random read time */
+	double dtlb_misses;		/* dTLB read misses in random reads */
+	double huge_bytes;		/* bytes backed by huge pages */
+	double mapped_bytes;		/* bytes mapped */
+	bool dtlb;			/* dTLB misses are valid */
+	bool failed;			/* configuration not available */
+} stress_mmaphuge_bench_result_t;
+
+static const stress_mmaphuge_bench_t stress_mmaphuge_benches[] = {
+#if defined(MADV_NOHUGEPAGE)
+	{ "4K pages",		0,	MADV_NOHUGEPAGE,	false,	0 },
+#else
+	{ "4K pages",		0,	-1,			false,	0 },
+#endif
+	{ "THP default",	0,	-1,			false,	0 },
+#if defined(MADV_HUGEPAGE)
+	{ "THP madvise",	0,	MADV_HUGEPAGE,		false,	2 * MB },
+#endif
+#if defined(MADV_COLLAPSE)
+	{ "MADV_COLLAPSE",	0,	-1,			true,	2 * MB },
+#endif
+#if defined(MAP_HUGE_2MB)
+	{ "hugetlb 2M",		MAP_HUGETLB | MAP_HUGE_2MB, -1,	false,	2 * MB },
+#endif
+#if defined(MAP_HUGE_1GB)
+	{ "hugetlb 1G",		MAP_HUGETLB | MAP_HUGE_1GB, -1,	false,	1 * GB },
+#endif
+};
+
+/*
+ *  stress_mmaphuge_bench_huge_bytes()
+ *	bytes of anonymous memory backed by THP, 0 if unknown
+ */
+static uint64_t stress_mmaphuge_bench_huge_bytes(void)
+{
+	FILE *fp;
+	char buffer[256];
+	uint64_t kb = 0;
+
+	fp = fopen("/proc/self/smaps_rollup", "r");
+	if (!fp)
+		return 0;
+	while (fgets(buffer, sizeof(buffer), fp)) {
+		if (sscanf(buffer, "AnonHugePages: %" SCNu64, &kb) == 1)
+			break;
+	}
+	(void)fclose(fp);
+	return kb * KB;
+}
+
+/*
+ *  stress_mmaphuge_bench_touch()
+ *	first touch, write to every base page
+ */
+static void OPTIMIZE3 stress_mmaphuge_bench_touch(uint8_t *buf, const size_t sz, const size_t page_size)
+{
+	register volatile uint8_t *ptr;
+	register const uint8_t *end = buf + sz;
+
+	for (ptr = buf; ptr < end; ptr += page_size)
+		*ptr = 0xa5;
+}
+
+/*
+ *  stress_mmaphuge_bench_seq()
+ *	sequential read of every 64 bit word
+ */
+static uint64_t OPTIMIZE3 stress_mmaphuge_bench_seq(const uint8_t *buf, const size_t sz)
+{
+	register const uint64_t *ptr = (const uint64_t *)buf;
+	register const uint64_t *end = (const uint64_t *)(buf + sz);
+	register uint64_t sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+
+	while (ptr < end) {
+		sum0 += ptr[0];
+		sum1 += ptr[1];
+		sum2 += ptr[2];
+		sum3 += ptr[3];
+		sum0 += ptr[4];
+		sum1 += ptr[5];
+		sum2 += ptr[6];
+		sum3 += ptr[7];
+		ptr += 8;
+	}
+	return sum0 + sum1 + sum2 + sum3;
+}
+
+/*
+ *  stress_mmaphuge_bench_rnd()
+ *	random reads of 64 bit words, xorshift index generator
+ *	to keep the generator cost low and in registers
+ */
+static uint64_t OPTIMIZE3 stress_mmaphuge_bench_rnd(const uint8_t *buf, const size_t sz, const size_t n)
+{
+	register const uint64_t *ptr = (const uint64_t *)buf;
+	register const uint64_t words = (uint64_t)(sz / sizeof(uint64_t));
+	register uint64_t x = stress_mwc64() | 1, sum = 0;
+	register size_t i;
+
+	for (i = 0; i < n; i++) {
+		x ^= x << 13;
+		x ^= x >> 7;
+		x ^= x << 17;
+		sum += ptr[x % words];
+	}
+	return sum;
+}
+
+/*
+ *  stress_mmaphuge_bench_config()
+ *	benchmark one page size configuration on a working set of sz bytes
+ */
+static void stress_mmaphuge_bench_config(
+	stress_args_t *args,
+	const stress_mmaphuge_bench_t *bench,
+	stress_mmaphuge_bench_result_t *result,
+	const size_t sz,
+	const int dtlb_fd)
+{
+	const size_t page_size = args->page_size;
+	const size_t map_sz = sz;
+	const size_t n_rnd = STRESS_MINIMUM(sz / 64, MMAPHUGE_BENCH_MAX_RANDOM);
+	uint64_t huge_before, miss_before = 0, miss_after = 0;
+	uint8_t *buf;
+	double t;
+
+	/* all configurations use the same working set, skip if it can't be */
+	if (bench->align && (sz & (bench->align - 1))) {
+		result->failed = true;
+		return;
+	}
+
+	huge_before = stress_mmaphuge_bench_huge_bytes();
+	buf = (uint8_t *)mmap(NULL, map_sz, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | bench->flags, -1, 0);
+	if (buf == MAP_FAILED) {
+		result->failed = true;
+		return;
+	}
+	if ((bench->advice >= 0) &&
+	    (shim_madvise((void *)buf, map_sz, bench->advice) < 0)) {
+		result->failed = true;
+		goto unmap;
+	}
+
+	t = stress_time_now();
+	stress_mmaphuge_bench_touch(buf, map_sz, page_size);
+#if defined(MADV_COLLAPSE)
+	if (bench->collapse &&
+	    (shim_madvise((void *)buf, map_sz, MADV_COLLAPSE) < 0)) {
+		result->failed = true;
+		goto unmap;
+	}
+#endif
+	result->touch_time += stress_time_now() - t;
+	result->touch_bytes += (double)map_sz;
+	if (bench->flags & MAP_HUGETLB)
+		result->huge_bytes += (double)map_sz;
+	else
+		result->huge_bytes += (double)(stress_mmaphuge_bench_huge_bytes() - huge_before);
+	result->mapped_bytes += (double)map_sz;
+
+	t = stress_time_now();
+	stress_uint64_put(stress_mmaphuge_bench_seq(buf, sz));
+	result->seq_time += stress_time_now() - t;
+	result->seq_bytes += (double)sz;
+
+#if defined(STRESS_PERF_STATS)
+	if (dtlb_fd >= 0)
+		result->dtlb = (stress_perf_event_read(dtlb_fd, &miss_before) == 0);
+#else
+	(void)dtlb_fd;
+#endif
+	t = stress_time_now();
+	stress_uint64_put(stress_mmaphuge_bench_rnd(buf, sz, n_rnd));
+	result->rnd_time += stress_time_now() - t;
+	result->rnd_accesses += (double)n_rnd;
+#if defined(STRESS_PERF_STATS)
+	if (result->dtlb && (stress_perf_event_read(dtlb_fd, &miss_after) == 0))
+		result->dtlb_misses += (double)(miss_after - miss_before);
+	else
+		result->dtlb = false;
+#else
+	(void)miss_before;
+	(void)miss_after;
+#endif
+	stress_bogo_inc(args);
+unmap:
+	(void)stress_munmap_retry_enomem((void *)buf, map_sz);
+}
+
+/*
+ *  stress_mmaphuge_bench_child()
+ *	compare 4K, THP and hugetlb pages on the same working set
+ */
+static int stress_mmaphuge_bench_child(stress_args_t *args, void *context)
+{
+	const size_t n_benches = SIZEOF_ARRAY(stress_mmaphuge_benches);
+	stress_mmaphuge_bench_result_t results[SIZEOF_ARRAY(stress_mmaphuge_benches)];
+	size_t sz = MMAPHUGE_BENCH_DEFAULT_BYTES, i, idx = 0;
+	int dtlb_fd = -1;
+	char thp[64];
+
+	(void)context;
+	(void)stress_get_setting("mmaphuge-bench-bytes", &sz);
+	sz &= ~(size_t)(args->page_size - 1);
+	(void)shim_memset(results, 0, sizeof(results));
+	(void)shim_memset(thp, 0, sizeof(thp));
+	if (stress_system_read("/sys/kernel/mm/transparent_hugepage/enabled", thp, sizeof(thp)) > 0) {
+		char *ptr = strchr(thp, '\n');
+
+		if (ptr)
+			*ptr = '\0';
+	} else {
+		(void)shim_strscpy(thp, "unknown", sizeof(thp));
+	}
+#if defined(STRESS_PERF_STATS)
+	dtlb_fd = stress_perf_event_open_by_label("Cache DTLB Read Miss", true);
+#endif
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (i = 0; (i < n_benches) && stress_continue(args); i++) {
+			if (!results[i].failed)
+				stress_mmaphuge_bench_config(args, &stress_mmaphuge_benches[i],
+					&results[i], sz, dtlb_fd);
+		}
+	} while (stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (dtlb_fd >= 0)
+		(void)close(dtlb_fd);
+
+	if (args->instance == 0) {
+		pr_block_begin();
+		pr_inf("%s: %zuMB working set, THP policy: %s\n",
+			args->name, sz / (size_t)MB, thp);
+		pr_inf("%s: %-14s %9s %9s %9s %9s %10s\n", args->name,
+			"pages", "touch", "seq read", "rnd read", "huge", "dTLB miss");
+		pr_inf("%s: %-14s %9s %9s %9s %9s %10s\n", args->name,
+			"", "GB/s", "GB/s", "Macc/s", "%", "per acc");
+		for (i = 0; i < n_benches; i++) {
+			const stress_mmaphuge_bench_result_t *r = &results[i];
+			char miss[16];
+
+			if (r->failed || (r->touch_time <= 0.0)) {
+				pr_inf("%s: %-14s %9s %9s %9s %9s %10s\n", args->name,
+					stress_mmaphuge_benches[i].name,
+					"n/a", "n/a", "n/a", "n/a", "n/a");
+				continue;
+			}
+			if (r->dtlb && (r->rnd_accesses > 0.0))
+				(void)snprintf(miss, sizeof(miss), "%.4f", r->dtlb_misses / r->rnd_accesses);
+			else
+				(void)shim_strscpy(miss, "-", sizeof(miss));
+			pr_inf("%s: %-14s %9.2f %9.2f %9.2f %9.1f %10s\n", args->name,
+				stress_mmaphuge_benches[i].name,
+				r->touch_bytes / (r->touch_time * GB),
+				r->seq_time > 0.0 ? r->seq_bytes / (r->seq_time * GB) : 0.0,
+				r->rnd_time > 0.0 ? r->rnd_accesses / (r->rnd_time * 1000000.0) : 0.0,
+				r->mapped_bytes > 0.0 ? 100.0 * r->huge_bytes / r->mapped_bytes : 0.0,
+				miss);
+		}
+		pr_block_end();
+	}
+
+	for (i = 0; i < n_benches; i++) {
+		const stress_mmaphuge_bench_result_t *r = &results[i];
+		const char *name = stress_mmaphuge_benches[i].name;
+		char str[64];
+
+		if (r->failed || (r->touch_time <= 0.0))
+			continue;
+		(void)snprintf(str, sizeof(str), "%s first touch GB/s", name);
+		stress_metrics_set(args, idx++, str,
+			r->touch_bytes / (r->touch_time * GB), STRESS_HARMONIC_MEAN);
+		(void)snprintf(str, sizeof(str), "%s sequential read GB/s", name);
+		stress_metrics_set(args, idx++, str,
+			r->seq_time > 0.0 ? r->seq_bytes / (r->seq_time * GB) : 0.0,
+			STRESS_HARMONIC_MEAN);
+		(void)snprintf(str, sizeof(str), "%s random reads per sec", name);
+		stress_metrics_set(args, idx++, str,
+			r->rnd_time > 0.0 ? r->rnd_accesses / r->rnd_time : 0.0,
+			STRESS_HARMONIC_MEAN);
+		(void)snprintf(str, sizeof(str), "%s %% huge page backed", name);
+		stress_metrics_set(args, idx++, str,
+			r->mapped_bytes > 0.0 ? 100.0 * r->huge_bytes / r->mapped_bytes : 0.0,
+			STRESS_ARITHMETIC_MEAN);
+		if (r->dtlb && (r->rnd_accesses > 0.0)) {
+			(void)snprintf(str, sizeof(str), "%s dTLB misses per random read", name);
+			stress_metrics_set(args, idx++, str,
+				r->dtlb_misses / r->rnd_accesses, STRESS_GEOMETRIC_MEAN);
+		}
+	}
+	return EXIT_SUCCESS;
+}
+
 static int stress_mmaphuge_child(stress_args_t *args, void *v_ctxt)
 {
 	stress_mmaphuge_context_t *ctxt = (stress_mmaphuge_context_t *)v_ctxt;
@@ -258,6 +601,11 @@ static int stress_mmaphuge(stress_args_t *args)
 	char filename[PATH_MAX];
 
 	int ret;
+	bool mmaphuge_bench = false;
+
+	(void)stress_get_setting("mmaphuge-bench", &mmaphuge_bench);
+	if (mmaphuge_bench)
+		return stress_oomable_child(args, NULL, stress_mmaphuge_bench_child, STRESS_OOMABLE_QUIET);
 
 	ctxt.sz = 16 * MB;
 	ctxt.mmaphuge_mmaps = MAX_MMAP_BUFS;
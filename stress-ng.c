@@ -70,6 +70,11 @@
 #define DEFAULT_TIMEOUT		(60 * 60 * 24)
 #define DEFAULT_BACKOFF		(0)
 #define DEFAULT_CACHE_LEVEL     (3)
+#define MIN_REPEAT		(1)
+#define MAX_REPEAT		(10000)
+#define DEFAULT_REPEAT		(1)
+#define MIN_REPEAT_WARMUP	(0)
+#define MAX_REPEAT_WARMUP	(1000)
 
 /* stress_stressor_info ignore value. 2 bits */
 #define STRESS_STRESSOR_NOT_IGNORED		(0)
@@ -87,6 +92,16 @@ typedef struct {
 	const uint64_t opt_flag;	/* global options flag bit setting */
 } stress_opt_flag_t;
 
+/* Statistics of a metric over --repeat runs */
+typedef struct {
+	double mean;			/* arithmetic mean */
+	double stddev;			/* sample standard deviation */
+	double min;			/* minimum */
+	double max;			/* maximum */
+	double cv;			/* coefficient of variation, % */
+	double ci95;			/* 95% confidence interval half width */
+} stress_repeat_stats_t;
+
 /* Per stressor information */
 static stress_stressor_t *stressors_head, *stressors_tail;
 
@@ -328,6 +343,8 @@ static const stress_help_t help_generic[] = {
 	{ NULL,		"permute N",		"run permutations of stressors with N stressors per permutation" },
 	{ "q",		"quiet",		"quiet output" },
 	{ "r",		"random N",		"start N random workers" },
+	{ NULL,		"repeat N",		"repeat the run N times and report run statistics" },
+	{ NULL,		"repeat-warmup N",	"run N warm-up runs that are discarded before --repeat runs" },
 	{ NULL,		"sched type",		"set scheduler type" },
 	{ NULL,		"sched-prio N",		"set scheduler priority level N" },
 	{ NULL,		"sched-period N",	"set period for SCHED_DEADLINE to N nanosecs (Linux only)" },
@@ -1234,6 +1251,8 @@ static void stress_stressors_free(void)
 		stress_stressor_t *next = ss->next;
 
 		free(ss->stats);
+		free(ss->repeat);
+		free(ss->phase.samples);
 		free(ss);
 		ss = next;
 	}
@@ -1313,6 +1332,23 @@ void stress_metrics_set_const_check(
 	metrics->items[idx].mean_type = mean_type;
 }
 
+/*
+ *  stress_metrics_cmp_double()
+ *	qsort comparator to sort metric samples such as
+ *	latencies into order, least first
+ */
+int stress_metrics_cmp_double(const void *p1, const void *p2)
+{
+	const double *d1 = (const double *)p1;
+	const double *d2 = (const double *)p2;
+
+	if (*d1 > *d2)
+		return 1;
+	else if (*d1 < *d2)
+		return -1;
+	return 0;
+}
+
 #if defined(HAVE_GETRUSAGE)
 /*
  *  stress_getrusage()
@@ -1445,6 +1481,8 @@ static int MLOCKED_TEXT stress_run_child(
 		stats->args.mapped = &g_shared->mapped,
 		stats->args.metrics = &stats->metrics,
 		stats->args.info = g_stressor_current->stressor->info;
+		stats->args.time_start = stress_time_now();
+		stats->args.ops_rate = g_stressor_current->phase.ops_rate;
 
 		stress_set_oom_adjustment(&stats->args, false);
 
@@ -1493,7 +1531,8 @@ static int MLOCKED_TEXT stress_run_child(
 		 *  if not then flag up that the counter may
 		 *  be untrustyworthy
 		 */
-		if ((!stats->args.ci.counter_ready) && (!stats->args.ci.force_killed)) {
+		if ((!stats->args.ci.counter_ready || (stats->args.ci.generation & 1)) &&
+		    (!stats->args.ci.force_killed)) {
 			pr_warn("%s: WARNING: bogo-ops counter in non-ready state, "
 				"metrics are untrustworthy (process may have been "
 				"terminated prematurely)\n",
@@ -1613,6 +1652,7 @@ static void MLOCKED_TEXT stress_run(
 #endif
 			stats->pid = -1;
 			stats->args.ci.counter_ready = true;
+			stats->args.ci.generation = 0;
 			stats->args.ci.counter = 0;
 			stats->checksum = *checksum;
 again:
@@ -1656,6 +1696,9 @@ again:
 				break;
 			}
 		}
+		/* Keep checksum slots fixed when job phases run fewer instances */
+		if (g_stressor_current->phase.max_instances > g_stressor_current->num_instances)
+			*checksum += g_stressor_current->phase.max_instances - g_stressor_current->num_instances;
 	}
 	if (!handler_set) {
 		(void)stress_set_handler("stress-ng", false);
@@ -1844,6 +1887,11 @@ static void stress_metrics_check(bool *success)
 					stats->args.ci.run_ok, checksum->data.ci.run_ok);
 				ok = false;
 			}
+			if ((stats->args.ci.generation & 1) && !stats->args.ci.force_killed) {
+				pr_fail("%s instance %d bogo-ops counter generation %" PRIu32 " is mid-update\n",
+					ss->stressor->name, j, stats->args.ci.generation);
+				ok = false;
+			}
 			if (stats_checksum.hash != checksum->hash) {
 				pr_fail("%s instance %d hash error in bogo-ops counter and run flag, %" PRIu32 " vs %" PRIu32 "\n",
 					ss->stressor->name, j,
@@ -1892,6 +1940,503 @@ static char *stess_description_yamlify(const char *description)
 	return yamlified;
 }
 
+/*
+ *  stress_repeat_alloc()
+ *	allocate per run sample arrays for --repeat runs
+ */
+static int stress_repeat_alloc(const uint32_t runs)
+{
+	stress_stressor_t *ss;
+
+	for (ss = stressors_head; ss; ss = ss->next) {
+		if (ss->ignore.run)
+			continue;
+		ss->repeat = calloc((size_t)runs, sizeof(*ss->repeat));
+		if (!ss->repeat) {
+			pr_err("cannot allocate repeat samples for %" PRIu32 " runs\n", runs);
+			return -1;
+		}
+		ss->repeat_runs = 0;
+	}
+	return 0;
+}
+
+/*
+ *  stress_repeat_discard()
+ *	discard the accumulated totals of a warm-up run
+ */
+static void stress_repeat_discard(void)
+{
+	stress_stressor_t *ss;
+
+	for (ss = stressors_head; ss; ss = ss->next) {
+		int32_t j;
+
+		if (ss->ignore.run || !ss->stats)
+			continue;
+		for (j = 0; j < ss->num_instances; j++) {
+			stress_stats_t *const stats = ss->stats[j];
+
+			stats->counter_total = 0;
+			stats->duration_total = 0.0;
+			stats->rusage_utime_total = 0.0;
+			stats->rusage_stime_total = 0.0;
+		}
+	}
+}
+
+/*
+ *  stress_repeat_instance_mean()
+ *	combine misc metric idx of the completed instances of the
+ *	last run using the metric's mean type, zero values are
+ *	ignored for geometric and harmonic means as per the
+ *	metrics dump, arithmetic means include them
+ */
+static double stress_repeat_instance_mean(const stress_stressor_t *ss, const size_t idx)
+{
+	const int mean_type = ss->stats[0]->metrics.items[idx].mean_type;
+	double n = 0.0, sum = 0.0, mantissa = 1.0;
+	int64_t exponent = 0;
+	int32_t j;
+
+	for (j = 0; j < ss->num_instances; j++) {
+		const stress_stats_t *const stats = ss->stats[j];
+		const stress_metrics_item_t *item;
+		int e;
+
+		if (!stats->completed)
+			continue;
+		item = &stats->metrics.items[idx];
+
+		switch (mean_type) {
+		case STRESS_GEOMETRIC_MEAN:
+			if ((item->value > 0.0) || (item->value < 0.0)) {
+				mantissa *= frexp(item->value, &e);
+				exponent += e;
+				n += 1.0;
+			}
+			break;
+		case STRESS_HARMONIC_MEAN:
+			if ((item->value > 0.0) || (item->value < 0.0)) {
+				sum += 1.0 / item->value;
+				n += 1.0;
+			}
+			break;
+		default:
+			sum += item->value;
+			n += 1.0;
+			break;
+		}
+	}
+	if (n <= 0.0)
+		return 0.0;
+
+	switch (mean_type) {
+	case STRESS_GEOMETRIC_MEAN:
+		return pow(mantissa, 1.0 / n) * pow(2.0, (double)exponent / n);
+	case STRESS_HARMONIC_MEAN:
+		return ((sum > 0.0) || (sum < 0.0)) ? n / sum : 0.0;
+	default:
+		break;
+	}
+	return sum / n;
+}
+
+/*
+ *  stress_repeat_sample()
+ *	save the bogo-op rates and misc metrics of the last run
+ */
+static void stress_repeat_sample(void)
+{
+	stress_stressor_t *ss;
+
+	for (ss = stressors_head; ss; ss = ss->next) {
+		stress_repeat_sample_t *sample;
+		uint64_t c_total = 0;
+		double r_total = 0.0, us_total = 0.0, n = 0.0;
+		int32_t j;
+		size_t i;
+
+		if (ss->ignore.run || !ss->stats || !ss->repeat)
+			continue;
+
+		sample = &ss->repeat[ss->repeat_runs];
+		for (j = 0; j < ss->num_instances; j++) {
+			const stress_stats_t *const stats = ss->stats[j];
+
+			if (!stats->completed)
+				continue;
+			c_total += stats->args.ci.counter;
+			r_total += stats->duration;
+			us_total += stats->rusage_utime + stats->rusage_stime;
+			n += 1.0;
+		}
+		r_total = (n > 0.0) ? r_total / n : 0.0;
+		sample->bogo_rate_r_time = (r_total > 0.0) ? (double)c_total / r_total : 0.0;
+		sample->bogo_rate = (us_total > 0.0) ? (double)c_total / us_total : 0.0;
+
+		for (i = 0; i < SIZEOF_ARRAY(sample->metrics); i++)
+			sample->metrics[i] = stress_repeat_instance_mean(ss, i);
+		ss->repeat_runs++;
+	}
+}
+
+/*
+ *  stress_repeat_reset()
+ *	zero the per instance misc metric values before the next
+ *	repeat run so a metric not set in a run is not sampled stale
+ */
+static void stress_repeat_reset(void)
+{
+	stress_stressor_t *ss;
+
+	for (ss = stressors_head; ss; ss = ss->next) {
+		int32_t j;
+
+		if (ss->ignore.run || !ss->stats)
+			continue;
+		for (j = 0; j < ss->num_instances; j++) {
+			stress_stats_t *const stats = ss->stats[j];
+			size_t i;
+
+			for (i = 0; i < SIZEOF_ARRAY(stats->metrics.items); i++)
+				stats->metrics.items[i].value = 0.0;
+		}
+	}
+}
+
+/*
+ *  stress_repeat_t95()
+ *	two sided 95% Student's t critical value for
+ *	n - 1 degrees of freedom
+ */
+static double stress_repeat_t95(const uint32_t n)
+{
+	static const double t95[] = {
+		12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306,
+		2.262, 2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120,
+		2.110, 2.101, 2.093, 2.086, 2.080, 2.074, 2.069, 2.064,
+		2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+	};
+
+	if (n < 2)
+		return 0.0;
+	if ((size_t)(n - 1) <= SIZEOF_ARRAY(t95))
+		return t95[n - 2];
+	return 1.960;
+}
+
+/*
+ *  stress_repeat_stats()
+ *	compute mean, sample standard deviation, min, max, coefficient
+ *	of variation and 95% confidence interval half width of the
+ *	per run samples
+ */
+static void stress_repeat_stats(
+	const stress_stressor_t *ss,
+	double (*get)(const stress_repeat_sample_t *sample, const size_t idx),
+	const size_t idx,
+	stress_repeat_stats_t *rs)
+{
+	const uint32_t n = ss->repeat_runs;
+	double sum = 0.0, sum_sq = 0.0;
+	uint32_t i;
+
+	rs->min = DBL_MAX;
+	rs->max = -DBL_MAX;
+	for (i = 0; i < n; i++) {
+		const double v = get(&ss->repeat[i], idx);
+
+		sum += v;
+		if (v < rs->min)
+			rs->min = v;
+		if (v > rs->max)
+			rs->max = v;
+	}
+	rs->mean = n ? sum / (double)n : 0.0;
+	for (i = 0; i < n; i++) {
+		const double d = get(&ss->repeat[i], idx) - rs->mean;
+
+		sum_sq += d * d;
+	}
+	rs->stddev = (n > 1) ? sqrt(sum_sq / (double)(n - 1)) : 0.0;
+	rs->cv = (rs->mean > 0.0) ? 100.0 * rs->stddev / rs->mean : 0.0;
+	rs->ci95 = (n > 1) ? stress_repeat_t95(n) * rs->stddev / sqrt((double)n) : 0.0;
+}
+
+static double stress_repeat_get_bogo_rate_r_time(const stress_repeat_sample_t *sample, const size_t idx)
+{
+	(void)idx;
+
+	return sample->bogo_rate_r_time;
+}
+
+static double stress_repeat_get_bogo_rate(const stress_repeat_sample_t *sample, const size_t idx)
+{
+	(void)idx;
+
+	return sample->bogo_rate;
+}
+
+static double stress_repeat_get_metric(const stress_repeat_sample_t *sample, const size_t idx)
+{
+	return sample->metrics[idx];
+}
+
+/*
+ *  stress_repeat_metric_dump()
+ *	output statistics of one metric over the repeated runs
+ */
+static void stress_repeat_metric_dump(
+	FILE *yaml,
+	const stress_stressor_t *ss,
+	const char *munged,
+	const char *description,
+	double (*get)(const stress_repeat_sample_t *sample, const size_t idx),
+	const size_t idx)
+{
+	stress_repeat_stats_t rs;
+	uint32_t i;
+
+	stress_repeat_stats(ss, get, idx, &rs);
+
+	if (g_opt_flags & OPT_FLAGS_SN) {
+		pr_metrics("%-13s %12.5e %12.5e %12.5e %12.5e %7.2f %12.5e %s\n",
+			munged, rs.mean, rs.stddev, rs.min, rs.max, rs.cv, rs.ci95, description);
+	} else {
+		pr_metrics("%-13s %12.2f %12.2f %12.2f %12.2f %7.2f %12.2f %s\n",
+			munged, rs.mean, rs.stddev, rs.min, rs.max, rs.cv, rs.ci95, description);
+	}
+
+	if (!yaml)
+		return;
+	pr_yaml(yaml, "    - stressor: %s\n", munged);
+	pr_yaml(yaml, "      metric: %s\n", stess_description_yamlify(description));
+	pr_yaml(yaml, "      repeat-runs: %" PRIu32 "\n", ss->repeat_runs);
+	pr_yaml(yaml, "      mean: %e\n", rs.mean);
+	pr_yaml(yaml, "      std-dev: %e\n", rs.stddev);
+	pr_yaml(yaml, "      min: %e\n", rs.min);
+	pr_yaml(yaml, "      max: %e\n", rs.max);
+	pr_yaml(yaml, "      coefficient-of-variation-percent: %f\n", rs.cv);
+	pr_yaml(yaml, "      confidence-interval-95-lower: %e\n", rs.mean - rs.ci95);
+	pr_yaml(yaml, "      confidence-interval-95-upper: %e\n", rs.mean + rs.ci95);
+	pr_yaml(yaml, "      runs:\n");
+	for (i = 0; i < ss->repeat_runs; i++)
+		pr_yaml(yaml, "        - %e\n", get(&ss->repeat[i], idx));
+	pr_yaml(yaml, "\n");
+}
+
+/*
+ *  stress_repeat_dump()
+ *	output mean, standard deviation, min, max, coefficient of
+ *	variation and 95% confidence intervals of the bogo-op rates
+ *	and misc metrics over the --repeat runs
+ */
+static void stress_repeat_dump(FILE *yaml)
+{
+	stress_stressor_t *ss;
+	uint32_t repeat = DEFAULT_REPEAT, repeat_warmup = 0;
+
+	(void)stress_get_setting("repeat", &repeat);
+	(void)stress_get_setting("repeat-warmup", &repeat_warmup);
+	if ((repeat < 2) && (repeat_warmup == 0))
+		return;
+
+	pr_block_begin();
+	pr_metrics("statistics of %" PRIu32 " repeated run%s (%" PRIu32 " warm-up run%s discarded):\n",
+		repeat, (repeat == 1) ? "" : "s",
+		repeat_warmup, (repeat_warmup == 1) ? "" : "s");
+	pr_metrics("%-13s %12s %12s %12s %12s %7s %12s %s\n",
+		"stressor", "mean", "std dev", "min", "max", "CV (%)", "95% CI (+/-)", "metric");
+	pr_yaml(yaml, "repeat-statistics:\n");
+
+	for (ss = stressors_head; ss; ss = ss->next) {
+		char munged[64];
+		size_t i;
+
+		if (ss->ignore.run || !ss->stats || !ss->repeat || !ss->repeat_runs)
+			continue;
+
+		(void)stress_munge_underscore(munged, ss->stressor->name, sizeof(munged));
+		stress_repeat_metric_dump(yaml, ss, munged, "bogo ops per second real time",
+			stress_repeat_get_bogo_rate_r_time, 0);
+		stress_repeat_metric_dump(yaml, ss, munged, "bogo ops per second usr sys time",
+			stress_repeat_get_bogo_rate, 0);
+
+		for (i = 0; i < SIZEOF_ARRAY(ss->stats[0]->metrics.items); i++) {
+			const char *description = ss->stats[0]->metrics.items[i].description;
+
+			if (description)
+				stress_repeat_metric_dump(yaml, ss, munged, description,
+					stress_repeat_get_metric, i);
+		}
+	}
+	pr_block_end();
+}
+
+/*
+ *  stress_phase_max_instances()
+ *	maximum number of instances of a stressor over all job phases
+ */
+static int32_t stress_phase_max_instances(
+	const stress_stressor_t *ss,
+	const stress_job_phase_t *phases,
+	const size_t n)
+{
+	int32_t max_instances = 0;
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		const int32_t instances = (phases[i].instances < 0) ?
+			ss->phase.num_instances : phases[i].instances;
+
+		if (instances > max_instances)
+			max_instances = instances;
+	}
+	return max_instances;
+}
+
+/*
+ *  stress_phase_setup()
+ *	size the stressors for the largest job phase and
+ *	allocate the per phase sample arrays
+ */
+static int stress_phase_setup(void)
+{
+	const stress_job_phase_t *phases;
+	const size_t n = stress_job_phases(&phases);
+	stress_stressor_t *ss;
+
+	if (n == 0)
+		return 0;
+
+	for (ss = stressors_head; ss; ss = ss->next) {
+		if (ss->ignore.run)
+			continue;
+		ss->phase.num_instances = ss->num_instances;
+		ss->phase.bogo_ops = ss->bogo_ops;
+		ss->phase.max_instances = stress_phase_max_instances(ss, phases, n);
+		ss->num_instances = ss->phase.max_instances;
+		ss->phase.samples = calloc(n, sizeof(*ss->phase.samples));
+		if (!ss->phase.samples) {
+			pr_err("cannot allocate job phase samples for %zu phases\n", n);
+			return -1;
+		}
+	}
+	return 0;
+}
+
+/*
+ *  stress_phase_sample()
+ *	save the bogo-ops and misc metrics of a job phase
+ */
+static void stress_phase_sample(
+	const size_t idx,
+	const stress_job_phase_t *phase,
+	const double duration)
+{
+	stress_stressor_t *ss;
+
+	for (ss = stressors_head; ss; ss = ss->next) {
+		stress_phase_sample_t *sample;
+		double n = 0.0;
+		int32_t j;
+		size_t i;
+
+		if (ss->ignore.run || !ss->stats || !ss->phase.samples)
+			continue;
+
+		sample = &ss->phase.samples[idx];
+		sample->instances = ss->num_instances;
+		sample->ops_rate = phase->ops_rate;
+		sample->bogo_ops = 0;
+		sample->duration = duration;
+		for (j = 0; j < ss->num_instances; j++) {
+			const stress_stats_t *const stats = ss->stats[j];
+
+			if (!stats->completed)
+				continue;
+			sample->bogo_ops += stats->args.ci.counter;
+			n += 1.0;
+		}
+		for (i = 0; i < SIZEOF_ARRAY(sample->metrics); i++) {
+			double total = 0.0;
+
+			for (j = 0; j < ss->num_instances; j++) {
+				const stress_stats_t *const stats = ss->stats[j];
+
+				if (stats->completed)
+					total += stats->metrics.items[i].value;
+			}
+			sample->metrics[i] = (n > 0.0) ? total / n : 0.0;
+		}
+	}
+}
+
+/*
+ *  stress_phase_dump()
+ *	output the per job phase bogo-op rates and misc metrics
+ */
+static void stress_phase_dump(FILE *yaml)
+{
+	const stress_job_phase_t *phases;
+	const size_t n = stress_job_phases(&phases);
+	size_t i;
+
+	if (n == 0)
+		return;
+
+	pr_block_begin();
+	pr_metrics("job phase metrics:\n");
+	pr_metrics("%-5s %-13s %9s %12s %9s %9s %12s\n",
+		"phase", "stressor", "instances", "target ops/s", "bogo ops",
+		"real time", "bogo ops/s");
+	pr_yaml(yaml, "phase-metrics:\n");
+
+	for (i = 0; i < n; i++) {
+		stress_stressor_t *ss;
+
+		for (ss = stressors_head; ss; ss = ss->next) {
+			const stress_phase_sample_t *sample;
+			char munged[64];
+			double rate;
+			size_t j;
+
+			if (ss->ignore.run || !ss->stats || !ss->phase.samples)
+				continue;
+			sample = &ss->phase.samples[i];
+			if (sample->duration <= 0.0)
+				continue;
+
+			(void)stress_munge_underscore(munged, ss->stressor->name, sizeof(munged));
+			rate = (double)sample->bogo_ops / sample->duration;
+			pr_metrics("%5zu %-13s %9" PRId32 " %12" PRIu64 " %9" PRIu64 " %9.2f %12.2f\n",
+				i + 1, munged, sample->instances, sample->ops_rate,
+				sample->bogo_ops, sample->duration, rate);
+			pr_yaml(yaml, "    - phase: %zu\n", i + 1);
+			pr_yaml(yaml, "      stressor: %s\n", munged);
+			pr_yaml(yaml, "      instances: %" PRId32 "\n", sample->instances);
+			pr_yaml(yaml, "      ops-rate: %" PRIu64 "\n", sample->ops_rate);
+			pr_yaml(yaml, "      bogo-ops: %" PRIu64 "\n", sample->bogo_ops);
+			pr_yaml(yaml, "      wall-clock-time: %f\n", sample->duration);
+			pr_yaml(yaml, "      bogo-ops-per-second-real-time: %f\n", rate);
+
+			for (j = 0; j < SIZEOF_ARRAY(ss->stats[0]->metrics.items); j++) {
+				const char *description = ss->stats[0]->metrics.items[j].description;
+
+				if (!description)
+					continue;
+				pr_metrics("%5s %-13s %13.2f %s\n", "", "",
+					sample->metrics[j], description);
+				pr_yaml(yaml, "      %s: %f\n",
+					stess_description_yamlify(description), sample->metrics[j]);
+			}
+			pr_yaml(yaml, "\n");
+		}
+	}
+	pr_block_end();
+}
+
 /*
  *  stress_metrics_dump()
  *	output metrics
@@ -2173,12 +2718,38 @@ static void stress_metrics_dump(FILE *yaml)
 								ss->completed_instances, plural);
 						}
 						break;
+					case STRESS_ARITHMETIC_MEAN:
+						sum = 0.0;
+						n = 0.0;
+
+						for (j = 0; j < ss->num_instances; j++) {
+							const stress_stats_t *const stats = ss->stats[j];
+
+							if (!stats->completed)
+								continue;
+							sum += stats->metrics.items[i].value;
+							n += 1.0;
+						}
+						sum = (n > 0.0) ? sum / n : 0.0;
+						if (g_opt_flags & OPT_FLAGS_SN) {
+							pr_metrics("%-13s %13.2e %s (arithmetic mean of %" PRIu32 " instance%s)\n",
+								munged, sum, description,
+								ss->completed_instances, plural);
+						} else {
+							pr_metrics("%-13s %13.2f %s (arithmetic mean of %" PRIu32 " instance%s)\n",
+								munged, sum, description,
+								ss->completed_instances, plural);
+						}
+						break;
 					}
 				}
 			}
 		}
 	}
 	pr_block_end();
+
+	stress_repeat_dump(yaml);
+	stress_phase_dump(yaml);
 }
 
 /*
@@ -3019,6 +3590,16 @@ next_opt:
 			stress_check_max_stressors("random", i32);
 			stress_set_setting("random", TYPE_ID_INT32, &i32);
 			break;
+		case OPT_repeat:
+			u32 = stress_get_uint32(optarg);
+			stress_check_range("repeat", (uint64_t)u32, MIN_REPEAT, MAX_REPEAT);
+			stress_set_setting_global("repeat", TYPE_ID_UINT32, &u32);
+			break;
+		case OPT_repeat_warmup:
+			u32 = stress_get_uint32(optarg);
+			stress_check_range("repeat-warmup", (uint64_t)u32, MIN_REPEAT_WARMUP, MAX_REPEAT_WARMUP);
+			stress_set_setting_global("repeat-warmup", TYPE_ID_UINT32, &u32);
+			break;
 		case OPT_sched:
 			i32 = stress_get_opt_sched(optarg);
 			stress_set_setting_global("sched", TYPE_ID_INT32, &i32);
@@ -3296,6 +3877,82 @@ static inline void stress_run_parallel(
 			metrics_success, &checksum);
 }
 
+/*
+ *  stress_run_phases()
+ *	run stressors in parallel through the timed load
+ *	phases of a job file scenario
+ */
+static void stress_run_phases(
+	const int32_t ticks_per_sec,
+	double *duration,
+	bool *success,
+	bool *resource_success,
+	bool *metrics_success)
+{
+	const stress_job_phase_t *phases;
+	const size_t n = stress_job_phases(&phases);
+	const uint64_t timeout = g_opt_timeout;
+	stress_stressor_t *ss;
+	size_t i;
+
+	for (i = 0; (i < n) && stress_continue_flag(); i++) {
+		const stress_job_phase_t *phase = &phases[i];
+		const double phase_start = stress_time_now();
+		const double phase_end = phase_start + (double)phase->duration;
+		double now, run_duration = 0.0;
+		char buf[64];
+
+		if (phase->instances < 0)
+			(void)shim_strscpy(buf, "job specified", sizeof(buf));
+		else
+			(void)snprintf(buf, sizeof(buf), "%" PRId32, phase->instances);
+		pr_inf("phase %zu of %zu: %s, %s instances per stressor%s\n",
+			i + 1, n, stress_duration_to_str((double)phase->duration, false),
+			buf, phase->ops_rate ? ", ops-rate limited" : "");
+
+		for (ss = stressors_head; ss; ss = ss->next) {
+			uint64_t ops;
+			int32_t j;
+
+			if (ss->ignore.run)
+				continue;
+			ss->num_instances = (phase->instances < 0) ?
+				ss->phase.num_instances : phase->instances;
+			ops = phase->ops_rate ?
+				phase->ops_rate * phase->duration : ss->phase.bogo_ops;
+			/* Instances sleep in stress_continue when ahead of the rate */
+			ss->phase.ops_rate = (phase->ops_rate && ss->num_instances) ?
+				(double)phase->ops_rate / (double)ss->num_instances : 0.0;
+			/* Share bogo ops between processes equally, rounding up */
+			ss->bogo_ops = (ss->num_instances && ops) ?
+				(ops + (uint64_t)(ss->num_instances - 1)) / (uint64_t)ss->num_instances : 0;
+			for (j = 0; j < ss->phase.max_instances; j++) {
+				ss->stats[j]->pid = -1;
+				ss->stats[j]->completed = false;
+			}
+		}
+
+		g_opt_timeout = phase->duration;
+		stress_run_parallel(ticks_per_sec, &run_duration, success, resource_success, metrics_success);
+
+		/* Stressors may finish early, idle until the end of the phase */
+		while (stress_continue_flag() && (stress_time_now() < phase_end))
+			(void)shim_usleep(100000);
+
+		now = stress_time_now();
+		*duration += now - phase_start;
+		stress_phase_sample(i, phase, now - phase_start);
+	}
+
+	g_opt_timeout = timeout;
+	for (ss = stressors_head; ss; ss = ss->next) {
+		if (ss->ignore.run)
+			continue;
+		ss->num_instances = ss->phase.max_instances;
+		ss->phase.ops_rate = 0.0;
+	}
+}
+
 /*
  *  stress_run_permute()
  *	run stressors using permutations
@@ -3411,6 +4068,10 @@ int main(int argc, char **argv, char **envp)
 	int32_t ionice_level = UNDEFINED;	/* ionice level */
 	size_t i;
 	uint32_t class = 0;
+	uint32_t run, repeat = DEFAULT_REPEAT, repeat_warmup = 0;
+	bool repeating;
+	const stress_job_phase_t *phases;
+	size_t n_phases;
 	const uint32_t cpus_online = (uint32_t)stress_get_processors_online();
 	const uint32_t cpus_configured = (uint32_t)stress_get_processors_configured();
 	int ret;
@@ -3519,6 +4180,30 @@ int main(int argc, char **argv, char **envp)
 		goto exit_stressors_free;
 	}
 
+	/*
+	 *  Sanity check --repeat, permute runs are already repeated
+	 */
+	(void)stress_get_setting("repeat", &repeat);
+	(void)stress_get_setting("repeat-warmup", &repeat_warmup);
+	repeating = (repeat > 1) || (repeat_warmup > 0);
+	if (repeating && (g_opt_flags & OPT_FLAGS_PERMUTE)) {
+		(void)fprintf(stderr, "cannot invoke --repeat or --repeat-warmup "
+			"with the --permute option\n");
+		ret = EXIT_FAILURE;
+		goto exit_stressors_free;
+	}
+
+	/*
+	 *  Sanity check job file load scenario phases
+	 */
+	n_phases = stress_job_phases(&phases);
+	if (n_phases && (repeating || (g_opt_flags & (OPT_FLAGS_SEQUENTIAL | OPT_FLAGS_PERMUTE)))) {
+		(void)fprintf(stderr, "cannot use job file load scenario phases with the "
+			"--repeat, --sequential or --permute options\n");
+		ret = EXIT_FAILURE;
+		goto exit_stressors_free;
+	}
+
 	/*
 	 *  Sanity check mutually exclusive random seed flags
 	 */
@@ -3636,6 +4321,14 @@ int main(int argc, char **argv, char **envp)
 						SIG_IGN, NULL));
 	}
 
+	/*
+	 *  Size stressors for the largest job phase
+	 */
+	if (stress_phase_setup() < 0) {
+		ret = EXIT_FAILURE;
+		goto exit_logging_close;
+	}
+
 	/*
 	 *  Setup stressor proc info
 	 */
@@ -3741,6 +4434,11 @@ int main(int argc, char **argv, char **envp)
 		stress_tz_init(&g_shared->tz_info);
 #endif
 
+	if (repeating && (stress_repeat_alloc(repeat) < 0)) {
+		ret = EXIT_FAILURE;
+		goto exit_shared_unmap;
+	}
+
 	stress_clear_warn_once();
 	stress_stressors_init();
 
@@ -3756,12 +4454,35 @@ int main(int argc, char **argv, char **envp)
 	if (g_opt_flags & OPT_FLAGS_METRICS)
 		stress_config_check();
 
-	if (g_opt_flags & OPT_FLAGS_SEQUENTIAL) {
-		stress_run_sequential(ticks_per_sec, &duration, &success, &resource_success, &metrics_success);
-	} else if (g_opt_flags & OPT_FLAGS_PERMUTE) {
-		stress_run_permute(ticks_per_sec, &duration, &success, &resource_success, &metrics_success);
-	} else {
-		stress_run_parallel(ticks_per_sec, &duration, &success, &resource_success, &metrics_success);
+	for (run = 0; (run < repeat_warmup + repeat) && stress_continue_flag(); run++) {
+		if (repeating) {
+			if (run < repeat_warmup)
+				pr_inf("repeat: warm-up run %" PRIu32 " of %" PRIu32 "\n",
+					run + 1, repeat_warmup);
+			else
+				pr_inf("repeat: run %" PRIu32 " of %" PRIu32 "\n",
+					run + 1 - repeat_warmup, repeat);
+		}
+
+		if (repeating && run)
+			stress_repeat_reset();
+
+		if (g_opt_flags & OPT_FLAGS_SEQUENTIAL) {
+			stress_run_sequential(ticks_per_sec, &duration, &success, &resource_success, &metrics_success);
+		} else if (n_phases) {
+			stress_run_phases(ticks_per_sec, &duration, &success, &resource_success, &metrics_success);
+		} else if (g_opt_flags & OPT_FLAGS_PERMUTE) {
+			stress_run_permute(ticks_per_sec, &duration, &success, &resource_success, &metrics_success);
+		} else {
+			stress_run_parallel(ticks_per_sec, &duration, &success, &resource_success, &metrics_success);
+		}
+
+		if (repeating) {
+			if (run < repeat_warmup)
+				stress_repeat_discard();
+			else
+				stress_repeat_sample();
+		}
 	}
 
 	stress_clocksource_check();
@@ -171,6 +171,7 @@
 
 typedef struct {
 	uint64_t counter;		/* bogo-op counter */
+	uint32_t generation;		/* seqlock generation, odd = updating */
 	bool counter_ready;		/* ready flag */
 	bool run_ok;			/* stressor run w/o issues */
 	bool force_killed;		/* true if sent SIGKILL */
@@ -207,6 +208,8 @@ typedef struct {
 	stress_mapped_t *mapped;	/* mmap'd pages, addr of g_shared mapped */
 	stress_metrics_data_t *metrics;	/* misc per stressor metrics */
 	const struct stressor_info *info; /* stressor info */
+	double time_start;		/* when bogo-op pacing started */
+	double ops_rate;		/* paced bogo-ops/s, 0 = unpaced */
 } stress_args_t;
 
 typedef struct {
@@ -214,6 +217,22 @@ typedef struct {
 	int (*opt_set_func)(const char *opt); /* function to set it */
 } stress_opt_set_func_t;
 
+/* Per run sample of a stressor's metrics, used by --repeat */
+typedef struct {
+	double bogo_rate_r_time;	/* bogo-ops/s on real time */
+	double bogo_rate;		/* bogo-ops/s on usr+sys time */
+	double metrics[STRESS_MISC_METRICS_MAX]; /* misc metrics */
+} stress_repeat_sample_t;
+
+/* Per job phase sample of a stressor's metrics */
+typedef struct {
+	int32_t instances;		/* instances run in the phase */
+	uint64_t ops_rate;		/* target bogo-ops/s, 0 = unlimited */
+	uint64_t bogo_ops;		/* bogo-ops in the phase */
+	double duration;		/* phase wall clock duration */
+	double metrics[STRESS_MISC_METRICS_MAX]; /* misc metrics */
+} stress_phase_sample_t;
+
 /* Per stressor information */
 typedef struct stress_stressor_info {
 	struct stress_stressor_info *next; /* next proc info struct in list */
@@ -225,6 +244,15 @@ typedef struct stress_stressor_info {
 	uint64_t bogo_ops;		/* number of bogo ops */
 	uint32_t status[STRESS_STRESSOR_STATUS_MAX];
 					/* number of instances that passed/failed/skipped */
+	stress_repeat_sample_t *repeat;	/* per run samples, NULL if not repeating */
+	uint32_t repeat_runs;		/* number of per run samples */
+	struct {
+		int32_t num_instances;	/* job specified number of instances */
+		int32_t max_instances;	/* maximum instances over all phases */
+		uint64_t bogo_ops;	/* job specified bogo-ops */
+		double ops_rate;	/* per instance bogo-ops/s of current phase */
+		stress_phase_sample_t *samples; /* per phase samples, NULL if no phases */
+	} phase;
 	struct {
 		uint8_t run;		/* ignore running the stressor, unsupported or excluded */
 		bool	permute;	/* ignore flag, saved for permute */
@@ -657,6 +685,8 @@ extern uint64_t	g_opt_flags;		/* option flags */
 extern volatile bool g_stress_continue_flag; /* false to exit stressor */
 extern jmp_buf g_error_env;		/* parsing error env */
 
+extern void stress_bogo_pace(stress_args_t *args);
+
 /*
  *  stress_continue_flag()
  *	get stress_continue_flag state
@@ -735,6 +765,91 @@ static inline void ALWAYS_INLINE OPTIMIZE3 stress_bogo_set(stress_args_t *args,
 	args->ci.counter_ready = true;
 }
 
+/*
+ *  Batched bogo-op counting for tight loop stressors, ops are
+ *  accumulated in a local stress_bogo_batch_t and published to
+ *  the shared counter every batch ops using a seqlock style
+ *  generation number rather than the counter_ready flag
+ */
+#define STRESS_BOGO_BATCH_DEFAULT	(1024)
+
+typedef struct {
+	stress_args_t *args;		/* stressor args */
+	uint64_t pending;		/* unpublished bogo-ops */
+	uint64_t batch;			/* publish every batch bogo-ops */
+} stress_bogo_batch_t;
+
+/*
+ *  stress_bogo_batch_init()
+ *	initialize a bogo-op batch, batch is clamped to
+ *	max_ops so that bogo-op limits are still honoured
+ */
+static inline void ALWAYS_INLINE stress_bogo_batch_init(
+	stress_bogo_batch_t *bb,
+	stress_args_t *args,
+	const uint64_t batch)
+{
+	bb->args = args;
+	bb->pending = 0;
+	bb->batch = batch ? batch : 1;
+	if (args->max_ops && (bb->batch > args->max_ops))
+		bb->batch = args->max_ops;
+}
+
+/*
+ *  stress_bogo_batch_flush()
+ *	publish pending batched bogo-ops to the shared counter,
+ *	the generation is odd while the counter is being updated
+ */
+static inline void ALWAYS_INLINE OPTIMIZE3 stress_bogo_batch_flush(stress_bogo_batch_t *bb)
+{
+	stress_args_t *args = bb->args;
+	uint32_t generation;
+
+	if (UNLIKELY(bb->pending == 0))
+		return;
+	/* always end on an even generation, even if racing with child processes */
+	generation = args->ci.generation | 1;
+	args->ci.generation = generation;
+	stress_asm_mb();
+	args->ci.counter += bb->pending;
+	stress_asm_mb();
+	args->ci.generation = generation + 1;
+	bb->pending = 0;
+}
+
+/*
+ *  stress_bogo_batch_inc()
+ *	increment the local batched bogo-op counter, publish
+ *	when the batch is full
+ */
+static inline void ALWAYS_INLINE OPTIMIZE3 stress_bogo_batch_inc(stress_bogo_batch_t *bb)
+{
+	if (UNLIKELY(++bb->pending >= bb->batch))
+		stress_bogo_batch_flush(bb);
+}
+
+/*
+ *  stress_bogo_batch_add()
+ *	add inc to the local batched bogo-op counter, publish
+ *	when the batch is full
+ */
+static inline void ALWAYS_INLINE OPTIMIZE3 stress_bogo_batch_add(stress_bogo_batch_t *bb, const uint64_t inc)
+{
+	bb->pending += inc;
+	if (UNLIKELY(bb->pending >= bb->batch))
+		stress_bogo_batch_flush(bb);
+}
+
+/*
+ *  stress_bogo_batch_get()
+ *	get the published and pending bogo-ops count
+ */
+static inline uint64_t ALWAYS_INLINE OPTIMIZE3 stress_bogo_batch_get(const stress_bogo_batch_t *bb)
+{
+	return bb->args->ci.counter + bb->pending;
+}
+
 /*
  *  stress_force_killed_bogo()
  *	note that the process is force killed and counter ready state can
@@ -754,11 +869,29 @@ static inline bool ALWAYS_INLINE OPTIMIZE3 stress_continue(stress_args_t *args)
 {
 	if (UNLIKELY(!g_stress_continue_flag))
 		return false;
+	if (UNLIKELY(args->ops_rate > 0.0))
+		stress_bogo_pace(args);
 	if (LIKELY(args->max_ops == 0))
 		return true;
 	return stress_bogo_get(args) < args->max_ops;
 }
 
+/*
+ *  stress_bogo_batch_continue()
+ *      returns true if we can keep on running a stressor that
+ *	is using batched bogo-op counting
+ */
+static inline bool ALWAYS_INLINE OPTIMIZE3 stress_bogo_batch_continue(const stress_bogo_batch_t *bb)
+{
+	if (UNLIKELY(!g_stress_continue_flag))
+		return false;
+	if (UNLIKELY(bb->args->ops_rate > 0.0))
+		stress_bogo_pace(bb->args);
+	if (LIKELY(bb->args->max_ops == 0))
+		return true;
+	return stress_bogo_batch_get(bb) < bb->args->max_ops;
+}
+
 /*
  *  stress_bogo_add_lock()
  *	add val to the stessor bogo ops counter with lock, return true
@@ -805,6 +938,7 @@ static inline bool stress_bogo_inc_lock(stress_args_t *args, void *lock, const b
 
 #define STRESS_GEOMETRIC_MEAN	(1)
 #define STRESS_HARMONIC_MEAN	(2)
+#define STRESS_ARITHMETIC_MEAN	(3)
 
 extern WARN_UNUSED int stress_parse_opts(int argc, char **argv, const bool jobmode);
 extern void stress_shared_readonly(void);
@@ -812,6 +946,7 @@ extern void stress_shared_unmap(void);
 extern void stress_log_system_mem_info(void);
 extern void stress_metrics_set_const_check(stress_args_t *args,
 	const size_t idx, char *description, const bool const_description, const double value, const int mean_type);
+extern int stress_metrics_cmp_double(const void *p1, const void *p2);
 #if defined(HAVE_BUILTIN_CONSTANT_P)
 #define stress_metrics_set(args, idx, description, value, mean_type)	\
 	stress_metrics_set_const_check(args, idx, description, __builtin_constant_p(description), value, mean_type)
@@ -64,6 +64,9 @@ static void stress_nop_spin_ ## name(				\
 	double *duration,					\
 	double *count)						\
 {								\
+	stress_bogo_batch_t bb;					\
+								\
+	stress_bogo_batch_init(&bb, args, STRESS_BOGO_BATCH_DEFAULT);\
 	do {							\
 		register int j = 64;				\
 		while (j--) {					\
@@ -75,9 +78,10 @@ static void stress_nop_spin_ ## name(				\
 			(*duration) += stress_time_now() - t;	\
 			(*count) += (double)(64 * NOP_LOOPS);	\
 								\
-			stress_bogo_inc(args);			\
+			stress_bogo_batch_inc(&bb);		\
 		}						\
-	} while (flag && stress_continue(args));			\
+	} while (flag && stress_bogo_batch_continue(&bb));	\
+	stress_bogo_batch_flush(&bb);				\
 }
 
 STRESS_NOP_SPIN_OP(nop, stress_asm_nop)
@@ -23,6 +23,10 @@
 #include "core-capabilities.h"
 #include "core-madvise.h"
 #include "core-mmap.h"
+#include "core-numa.h"
+#include "core-put.h"
+
+#include <sched.h>
 
 #if defined(HAVE_LINUX_MEMPOLICY_H)
 #include <linux/mempolicy.h>
@@ -35,6 +39,7 @@
 static const stress_help_t help[] = {
 	{ NULL,	"numa N",		"start N workers stressing NUMA interfaces" },
 	{ NULL,	"numa-bytes N",		"size of memory region to be exercised" },
+	{ NULL,	"numa-matrix",		"measure node-to-node bandwidth, latency and page migration rates" },
 	{ NULL,	"numa-ops N",		"stop after N NUMA bogo operations" },
 	{ NULL,	"numa-shuffle-addr",	"shuffle page addresses to move to numa nodes" },
 	{ NULL,	"numa-shuffle-node",	"shuffle numa nodes on numa pages moves" },
@@ -51,6 +56,11 @@ static int stress_set_numa_bytes(const char *opt)
 	return stress_set_setting("numa-bytes", TYPE_ID_SIZE_T, &numa_bytes);
 }
 
+static int stress_set_numa_matrix(const char *opt)
+{
+	return stress_set_setting_true("numa-matrix", opt);
+}
+
 static int stress_set_numa_shuffle_addr(const char *opt)
 {
 	return stress_set_setting_true("numa-shuffle-addr", opt);
@@ -63,8 +73,10 @@ static int stress_set_numa_shuffle_node(const char *opt)
 
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_numa_bytes,		stress_set_numa_bytes },
+	{ OPT_numa_matrix,		stress_set_numa_matrix },
 	{ OPT_numa_shuffle_addr,	stress_set_numa_shuffle_addr },
 	{ OPT_numa_shuffle_node,	stress_set_numa_shuffle_node },
+	{ 0,				NULL }
 };
 
 #if defined(__NR_get_mempolicy) &&	\
@@ -313,6 +325,588 @@ static inline void stress_set_numa_array(void *array, uint8_t val, size_t nmemb,
 	(void)shim_memset(array, val, n);
 }
 
+#if defined(HAVE_SCHED_GETAFFINITY) &&	\
+    defined(HAVE_SCHED_SETAFFINITY)
+#define HAVE_NUMA_MATRIX
+
+#define NUMA_MATRIX_DEFAULT_BYTES	(64 * MB)
+#define NUMA_MIGRATE_MAX_BATCH		(4096)
+#define NUMA_MIGRATE_BATCHES		(13)	/* 1, 2, 4 .. 4096 pages */
+#define NUMA_CACHE_LINE			(64)
+
+/* accumulated node-to-node performance for a cpu node, mem node pair */
+typedef struct {
+	double read_bytes;		/* bytes read */
+	double read_time;		/* time spent reading */
+	double write_bytes;		/* bytes written */
+	double write_time;		/* time spent writing */
+	double loads;			/* dependent loads */
+	double load_time;		/* time spent on dependent loads */
+} stress_numa_perf_t;
+
+/* accumulated page migration throughput */
+typedef struct {
+	double pages;			/* pages migrated */
+	double time;			/* time spent migrating */
+} stress_numa_migrate_t;
+
+/*
+ *  stress_numa_bind()
+ *	bind and move a region to a memory node and fault it in
+ */
+static int stress_numa_bind(
+	uint8_t *buf,
+	const size_t size,
+	const unsigned long node_id,
+	unsigned long *node_mask,
+	const size_t mask_elements,
+	const unsigned long max_nodes)
+{
+	stress_set_numa_array(node_mask, 0x00, mask_elements, sizeof(*node_mask));
+	STRESS_SETBIT(node_mask, node_id);
+	if (shim_mbind((void *)buf, size, MPOL_BIND, node_mask,
+			max_nodes, MPOL_MF_STRICT | MPOL_MF_MOVE) < 0)
+		return -1;
+	(void)shim_memset(buf, 0xa5, size);
+	return 0;
+}
+
+/*
+ *  stress_numa_read()
+ *	read bandwidth, sum the region
+ */
+static void OPTIMIZE3 stress_numa_read(const uint8_t *buf, const size_t size)
+{
+	register const uint64_t *ptr = (const uint64_t *)buf;
+	register const uint64_t *end = (const uint64_t *)(buf + size);
+	register uint64_t sum0 = 0, sum1 = 0, sum2 = 0, sum3 = 0;
+
+	while (ptr < end) {
+		sum0 += ptr[0];
+		sum1 += ptr[1];
+		sum2 += ptr[2];
+		sum3 += ptr[3];
+		sum0 += ptr[4];
+		sum1 += ptr[5];
+		sum2 += ptr[6];
+		sum3 += ptr[7];
+		ptr += 8;
+	}
+	stress_uint64_put(sum0 + sum1 + sum2 + sum3);
+}
+
+/*
+ *  stress_numa_write()
+ *	write bandwidth, fill the region
+ */
+static void OPTIMIZE3 stress_numa_write(uint8_t *buf, const size_t size, const uint64_t val)
+{
+	register volatile uint64_t *ptr = (volatile uint64_t *)buf;
+	register const volatile uint64_t *end = (volatile uint64_t *)(buf + size);
+
+	while (ptr < end) {
+		ptr[0] = val;
+		ptr[1] = val;
+		ptr[2] = val;
+		ptr[3] = val;
+		ptr[4] = val;
+		ptr[5] = val;
+		ptr[6] = val;
+		ptr[7] = val;
+		ptr += 8;
+	}
+}
+
+/*
+ *  stress_numa_chase_init()
+ *	link the cache lines of the region into a random
+ *	cyclic chain (Sattolo's shuffle) to defeat prefetching
+ */
+static int stress_numa_chase_init(uint8_t *buf, const size_t size)
+{
+	const size_t lines = size / NUMA_CACHE_LINE;
+	size_t i, *idx;
+
+	idx = (size_t *)calloc(lines, sizeof(*idx));
+	if (!idx)
+		return -1;
+	for (i = 0; i < lines; i++)
+		idx[i] = i;
+	for (i = lines - 1; i > 0; i--) {
+		const size_t j = (size_t)stress_mwc64modn((uint64_t)i);
+		const size_t tmp = idx[i];
+
+		idx[i] = idx[j];
+		idx[j] = tmp;
+	}
+	for (i = 0; i < lines; i++) {
+		void **line = (void **)(buf + (idx[i] * NUMA_CACHE_LINE));
+
+		*line = (void *)(buf + (idx[(i + 1) % lines] * NUMA_CACHE_LINE));
+	}
+	free(idx);
+	return 0;
+}
+
+/*
+ *  stress_numa_chase()
+ *	dependent loads around the chain
+ */
+static void * OPTIMIZE3 stress_numa_chase(void *start, const size_t loads)
+{
+	register void **ptr = (void **)start;
+	register size_t i;
+
+	for (i = 0; i < loads; i++)
+		ptr = (void **)*ptr;
+	return (void *)ptr;
+}
+
+/*
+ *  stress_numa_matrix_measure()
+ *	measure read/write bandwidth and dependent load latency
+ *	from the CPUs of each node to the memory of each node
+ */
+static int stress_numa_matrix_measure(
+	stress_args_t *args,
+	uint8_t *buf,
+	const size_t size,
+	const unsigned long *node_ids,
+	const size_t n_nodes,
+	const cpu_set_t *node_cpus,
+	unsigned long *node_mask,
+	const size_t mask_elements,
+	const unsigned long max_nodes,
+	stress_numa_perf_t *perf)
+{
+	size_t c, m;
+
+	for (c = 0; c < n_nodes; c++) {
+		if (!CPU_COUNT(&node_cpus[c]))
+			continue;
+		if (sched_setaffinity(0, sizeof(node_cpus[c]), &node_cpus[c]) < 0)
+			continue;
+
+		for (m = 0; m < n_nodes; m++) {
+			stress_numa_perf_t *p = &perf[(c * n_nodes) + m];
+			const size_t loads = size / NUMA_CACHE_LINE;
+			double t;
+			int i;
+
+			if (!stress_continue_flag())
+				return 0;
+			if (stress_numa_bind(buf, size, node_ids[m], node_mask,
+					     mask_elements, max_nodes) < 0) {
+				if ((errno != EIO) && (errno != ENOSYS)) {
+					pr_fail("%s: mbind to node %lu failed, errno=%d (%s)\n",
+						args->name, node_ids[m], errno, strerror(errno));
+					return -1;
+				}
+				continue;
+			}
+
+			t = stress_time_now();
+			for (i = 0; i < 4; i++)
+				stress_numa_write(buf, size, (uint64_t)i);
+			p->write_time += stress_time_now() - t;
+			p->write_bytes += 4.0 * (double)size;
+
+			t = stress_time_now();
+			for (i = 0; i < 4; i++)
+				stress_numa_read(buf, size);
+			p->read_time += stress_time_now() - t;
+			p->read_bytes += 4.0 * (double)size;
+
+			if (stress_numa_chase_init(buf, size) < 0)
+				continue;
+			t = stress_time_now();
+			stress_void_ptr_put(stress_numa_chase(buf, loads));
+			p->load_time += stress_time_now() - t;
+			p->loads += (double)loads;
+		}
+	}
+	return 0;
+}
+
+/*
+ *  stress_numa_node_pages()
+ *	count the pages of the process on a node from
+ *	/proc/self/numa_maps in units of page_size, huge
+ *	pages are scaled by their kernel page size, returns
+ *	-1.0 if the count is not available
+ */
+static double stress_numa_node_pages(const unsigned long node, const size_t page_size)
+{
+	FILE *fp;
+	char buffer[4096], name[32];
+	double pages = 0.0;
+	const size_t len = (size_t)snprintf(name, sizeof(name), " N%lu=", node);
+
+	fp = fopen("/proc/self/numa_maps", "r");
+	if (!fp)
+		return -1.0;
+
+	while (fgets(buffer, sizeof(buffer), fp)) {
+		const char *ptr;
+		unsigned long count;
+		uint64_t kb = (uint64_t)page_size / 1024;
+
+		ptr = strstr(buffer, "kernelpagesize_kB=");
+		if (ptr)
+			(void)sscanf(ptr + 18, "%" SCNu64, &kb);
+		ptr = strstr(buffer, name);
+		if (ptr && (sscanf(ptr + len, "%lu", &count) == 1))
+			pages += (double)count * (double)kb * 1024.0 / (double)page_size;
+	}
+	(void)fclose(fp);
+
+	return pages;
+}
+
+/*
+ *  stress_numa_migrate_measure()
+ *	time move_pages() for batches of 1 to 4096 pages and
+ *	migrate_pages() for all the process pages on a node
+ */
+static int stress_numa_migrate_measure(
+	stress_args_t *args,
+	uint8_t *buf,
+	const size_t n_pages,
+	const unsigned long node_a,
+	const unsigned long node_b,
+	void **pages,
+	int *dest_nodes,
+	int *status,
+	unsigned long *node_mask,
+	unsigned long *old_node_mask,
+	const size_t mask_elements,
+	const unsigned long max_nodes,
+	stress_numa_migrate_t *migrate)
+{
+	const size_t page_size = args->page_size;
+	unsigned long dest = node_b, src;
+	size_t i, batch, b;
+	double t, before;
+	long lret;
+
+	for (i = 0; i < n_pages; i++)
+		pages[i] = (void *)(buf + (i * page_size));
+
+	for (b = 0, batch = 1; batch <= NUMA_MIGRATE_MAX_BATCH; b++, batch <<= 1) {
+		size_t moved = 0;
+
+		for (i = 0; i < n_pages; i++)
+			dest_nodes[i] = (int)dest;
+		t = stress_time_now();
+		for (i = 0; i < n_pages; i += batch) {
+			const size_t n = STRESS_MINIMUM(batch, n_pages - i);
+			size_t j;
+
+			lret = shim_move_pages(args->pid, n, pages + i,
+				dest_nodes + i, status + i, MPOL_MF_MOVE);
+			if (UNLIKELY(lret < 0)) {
+				if (errno == ENOSYS)
+					return 0;
+				pr_fail("%s: move_pages failed, errno=%d (%s)\n",
+					args->name, errno, strerror(errno));
+				return -1;
+			}
+			for (j = i; j < i + n; j++)
+				moved += (status[j] == (int)dest);
+		}
+		migrate[b].time += stress_time_now() - t;
+		migrate[b].pages += (double)moved;
+		dest = (dest == node_b) ? node_a : node_b;
+		if (!stress_continue_flag())
+			return 0;
+	}
+
+	/*
+	 *  migrate the whole process from the node the region is on,
+	 *  this moves all of the process pages on that node and not
+	 *  just the region, so count the pages that left the node
+	 */
+	src = (dest == node_b) ? node_a : node_b;
+	before = stress_numa_node_pages(src, page_size);
+	if (before < 0.0)
+		return 0;
+	stress_set_numa_array(old_node_mask, 0x00, mask_elements, sizeof(*old_node_mask));
+	stress_set_numa_array(node_mask, 0x00, mask_elements, sizeof(*node_mask));
+	STRESS_SETBIT(old_node_mask, src);
+	STRESS_SETBIT(node_mask, dest);
+	t = stress_time_now();
+	lret = shim_migrate_pages(args->pid, max_nodes, old_node_mask, node_mask);
+	t = stress_time_now() - t;
+	if (lret >= 0) {
+		const double after = stress_numa_node_pages(src, page_size);
+
+		if ((after >= 0.0) && (before > after)) {
+			migrate[NUMA_MIGRATE_BATCHES].time += t;
+			migrate[NUMA_MIGRATE_BATCHES].pages += before - after;
+		}
+	}
+	return 0;
+}
+
+/*
+ *  stress_numa_matrix_report()
+ *	report the node-to-node matrix and migration rates
+ */
+static void stress_numa_matrix_report(
+	stress_args_t *args,
+	const unsigned long *node_ids,
+	const size_t n_nodes,
+	const cpu_set_t *node_cpus,
+	const stress_numa_perf_t *perf,
+	const stress_numa_migrate_t *migrate,
+	const bool migrated)
+{
+	static const char * const titles[] = {
+		"read bandwidth (GB/s)",
+		"write bandwidth (GB/s)",
+		"dependent load latency (ns)",
+	};
+	const size_t page_size = args->page_size;
+	const bool per_pair = ((n_nodes * n_nodes * 3) + NUMA_MIGRATE_BATCHES + 1) <= STRESS_MISC_METRICS_MAX;
+	double local[3] = { 0.0, 0.0, 0.0 }, remote[3] = { 0.0, 0.0, 0.0 };
+	size_t n_local = 0, n_remote = 0, idx = 0, c, m, t, b;
+	char str[64];
+
+	for (c = 0; c < n_nodes; c++) {
+		for (m = 0; m < n_nodes; m++) {
+			const stress_numa_perf_t *p = &perf[(c * n_nodes) + m];
+			double val[3];
+
+			if (!CPU_COUNT(&node_cpus[c]) || (p->loads <= 0.0))
+				continue;
+			val[0] = (p->read_time > 0.0) ? p->read_bytes / (p->read_time * GB) : 0.0;
+			val[1] = (p->write_time > 0.0) ? p->write_bytes / (p->write_time * GB) : 0.0;
+			val[2] = (p->load_time * STRESS_DBL_NANOSECOND) / p->loads;
+			for (t = 0; t < 3; t++) {
+				if (c == m)
+					local[t] += val[t];
+				else
+					remote[t] += val[t];
+				if (per_pair) {
+					(void)snprintf(str, sizeof(str), "cpu node %lu mem node %lu %s",
+						node_ids[c], node_ids[m], titles[t]);
+					stress_metrics_set(args, idx++, str, val[t],
+						(t == 2) ? STRESS_GEOMETRIC_MEAN : STRESS_HARMONIC_MEAN);
+				}
+			}
+			if (c == m)
+				n_local++;
+			else
+				n_remote++;
+		}
+	}
+	if (!per_pair) {
+		for (t = 0; t < 3; t++) {
+			if (n_local) {
+				(void)snprintf(str, sizeof(str), "local %s", titles[t]);
+				stress_metrics_set(args, idx++, str, local[t] / (double)n_local,
+					(t == 2) ? STRESS_GEOMETRIC_MEAN : STRESS_HARMONIC_MEAN);
+			}
+			if (n_remote) {
+				(void)snprintf(str, sizeof(str), "remote %s", titles[t]);
+				stress_metrics_set(args, idx++, str, remote[t] / (double)n_remote,
+					(t == 2) ? STRESS_GEOMETRIC_MEAN : STRESS_HARMONIC_MEAN);
+			}
+		}
+	}
+	if (migrated) {
+		for (b = 0; b <= NUMA_MIGRATE_BATCHES; b++) {
+			const double rate = (migrate[b].time > 0.0) ?
+				((migrate[b].pages * (double)page_size) / migrate[b].time) / (double)GB : 0.0;
+
+			if (b < NUMA_MIGRATE_BATCHES)
+				(void)snprintf(str, sizeof(str), "move_pages %u page batch GB/s", 1U << b);
+			else
+				(void)shim_strscpy(str, "migrate_pages GB/s", sizeof(str));
+			stress_metrics_set(args, idx++, str, rate, STRESS_HARMONIC_MEAN);
+		}
+	}
+
+	if (args->instance != 0)
+		return;
+
+	pr_block_begin();
+	for (t = 0; t < 3; t++) {
+		char buf[256];
+		int len;
+
+		pr_inf("%s: %s, cpu node (rows) to memory node (columns):\n",
+			args->name, titles[t]);
+		len = snprintf(buf, sizeof(buf), "%8s", "node");
+		for (m = 0; (m < n_nodes) && (len < (int)sizeof(buf)); m++)
+			len += snprintf(buf + len, sizeof(buf) - (size_t)len, " %9lu", node_ids[m]);
+		pr_inf("%s: %s\n", args->name, buf);
+		for (c = 0; c < n_nodes; c++) {
+			if (!CPU_COUNT(&node_cpus[c]))
+				continue;
+			len = snprintf(buf, sizeof(buf), "%8lu", node_ids[c]);
+			for (m = 0; (m < n_nodes) && (len < (int)sizeof(buf)); m++) {
+				const stress_numa_perf_t *p = &perf[(c * n_nodes) + m];
+				double val;
+
+				if (p->loads <= 0.0) {
+					len += snprintf(buf + len, sizeof(buf) - (size_t)len, " %9s", "-");
+					continue;
+				}
+				switch (t) {
+				case 0:
+					val = (p->read_time > 0.0) ? p->read_bytes / (p->read_time * GB) : 0.0;
+					break;
+				case 1:
+					val = (p->write_time > 0.0) ? p->write_bytes / (p->write_time * GB) : 0.0;
+					break;
+				default:
+					val = (p->load_time * STRESS_DBL_NANOSECOND) / p->loads;
+					break;
+				}
+				len += snprintf(buf + len, sizeof(buf) - (size_t)len, " %9.2f", val);
+			}
+			pr_inf("%s: %s\n", args->name, buf);
+		}
+	}
+	if (migrated) {
+		pr_inf("%s: page migration between nodes %lu and %lu:\n",
+			args->name, node_ids[0], node_ids[1]);
+		pr_inf("%s: %-22s %12s %9s\n", args->name, "method", "pages/sec", "GB/s");
+		for (b = 0; b <= NUMA_MIGRATE_BATCHES; b++) {
+			const double pages_rate = (migrate[b].time > 0.0) ?
+				migrate[b].pages / migrate[b].time : 0.0;
+
+			if (b < NUMA_MIGRATE_BATCHES)
+				(void)snprintf(str, sizeof(str), "move_pages %u pages", 1U << b);
+			else
+				(void)shim_strscpy(str, "migrate_pages", sizeof(str));
+			pr_inf("%s: %-22s %12.0f %9.3f\n", args->name, str, pages_rate,
+				(pages_rate * (double)page_size) / (double)GB);
+		}
+	} else {
+		pr_inf("%s: page migration throughput needs at least 2 memory nodes\n",
+			args->name);
+	}
+	pr_block_end();
+}
+
+/*
+ *  stress_numa_matrix()
+ *	measure NUMA node-to-node bandwidth, latency and page
+ *	migration throughput rather than exercising the interfaces
+ */
+static int stress_numa_matrix(
+	stress_args_t *args,
+	stress_node_t *nodes,
+	const long numa_nodes,
+	const unsigned long max_nodes,
+	size_t numa_bytes)
+{
+	const size_t page_size = args->page_size;
+	const size_t n_nodes = (size_t)numa_nodes;
+	const size_t mask_elements = (max_nodes + NUMA_LONG_BITS - 1) / NUMA_LONG_BITS;
+	const size_t migrate_pages = NUMA_MIGRATE_MAX_BATCH;
+	const size_t migrate_bytes = migrate_pages * page_size;
+	unsigned long *node_ids = NULL, *node_mask = NULL, *old_node_mask = NULL;
+	cpu_set_t *node_cpus = NULL, allowed;
+	stress_numa_perf_t *perf = NULL;
+	stress_numa_migrate_t migrate[NUMA_MIGRATE_BATCHES + 1];
+	uint8_t *buf = MAP_FAILED, *migrate_buf = MAP_FAILED;
+	void **pages = NULL;
+	int *dest_nodes = NULL, *status = NULL;
+	stress_node_t *n = nodes;
+	int rc = EXIT_NO_RESOURCE;
+	size_t i;
+
+	numa_bytes &= ~(size_t)(page_size - 1);
+	if (sched_getaffinity(0, sizeof(allowed), &allowed) < 0) {
+		pr_inf_skip("%s: sched_getaffinity failed, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		return EXIT_NO_RESOURCE;
+	}
+
+	node_ids = (unsigned long *)calloc(n_nodes, sizeof(*node_ids));
+	node_cpus = (cpu_set_t *)calloc(n_nodes, sizeof(*node_cpus));
+	perf = (stress_numa_perf_t *)calloc(n_nodes * n_nodes, sizeof(*perf));
+	node_mask = (unsigned long *)calloc(mask_elements, sizeof(*node_mask));
+	old_node_mask = (unsigned long *)calloc(mask_elements, sizeof(*old_node_mask));
+	pages = (void **)calloc(migrate_pages, sizeof(*pages));
+	dest_nodes = (int *)calloc(migrate_pages, sizeof(*dest_nodes));
+	status = (int *)calloc(migrate_pages, sizeof(*status));
+	if (!node_ids || !node_cpus || !perf || !node_mask ||
+	    !old_node_mask || !pages || !dest_nodes || !status) {
+		pr_inf_skip("%s: cannot allocate NUMA measurement arrays, skipping stressor\n",
+			args->name);
+		goto tidy;
+	}
+	(void)shim_memset(migrate, 0, sizeof(migrate));
+
+	/* node list is circular, highest node first, so sort by node id */
+	for (i = 0; i < n_nodes; i++, n = n->next)
+		node_ids[n_nodes - 1 - i] = n->node_id;
+	for (i = 0; i < n_nodes; i++)
+		(void)stress_numa_node_cpus(node_ids[i], &allowed, &node_cpus[i]);
+
+	buf = (uint8_t *)mmap(NULL, numa_bytes, PROT_READ | PROT_WRITE,
+			MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (buf == MAP_FAILED) {
+		pr_inf_skip("%s: mmap'd region of %zu bytes failed, skipping stressor\n",
+			args->name, numa_bytes);
+		goto tidy;
+	}
+	if (n_nodes > 1) {
+		migrate_buf = (uint8_t *)stress_mmap_populate(NULL, migrate_bytes,
+				PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+		if (migrate_buf == MAP_FAILED) {
+			pr_inf_skip("%s: mmap'd region of %zu bytes failed, skipping stressor\n",
+				args->name, migrate_bytes);
+			goto tidy;
+		}
+		(void)shim_memset(migrate_buf, 0x5a, migrate_bytes);
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	rc = EXIT_SUCCESS;
+	do {
+		if (stress_numa_matrix_measure(args, buf, numa_bytes, node_ids, n_nodes,
+				node_cpus, node_mask, mask_elements, max_nodes, perf) < 0) {
+			rc = EXIT_FAILURE;
+			break;
+		}
+		(void)sched_setaffinity(0, sizeof(allowed), &allowed);
+		if ((migrate_buf != MAP_FAILED) &&
+		    (stress_numa_migrate_measure(args, migrate_buf, migrate_pages,
+				node_ids[0], node_ids[1], pages, dest_nodes, status,
+				node_mask, old_node_mask, mask_elements, max_nodes, migrate) < 0)) {
+			rc = EXIT_FAILURE;
+			break;
+		}
+		stress_bogo_inc(args);
+	} while (stress_continue(args));
+	(void)sched_setaffinity(0, sizeof(allowed), &allowed);
+
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	stress_numa_matrix_report(args, node_ids, n_nodes, node_cpus, perf,
+		migrate, migrate_buf != MAP_FAILED);
+tidy:
+	if (migrate_buf != MAP_FAILED)
+		(void)munmap((void *)migrate_buf, migrate_bytes);
+	if (buf != MAP_FAILED)
+		(void)munmap((void *)buf, numa_bytes);
+	free(status);
+	free(dest_nodes);
+	free(pages);
+	free(old_node_mask);
+	free(node_mask);
+	free(perf);
+	free(node_cpus);
+	free(node_ids);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_numa()
  *	stress the Linux NUMA interfaces
@@ -331,16 +925,21 @@ static int stress_numa(stress_args_t *args)
 	void **pages;
 	size_t mask_elements, k;
 	unsigned long *node_mask, *old_node_mask;
-	bool numa_shuffle_addr, numa_shuffle_node;
+	bool numa_shuffle_addr, numa_shuffle_node, numa_matrix = false;
 	stress_numa_stats_t stats_begin, stats_end;
 	double t, duration, rate;
 
 	(void)stress_get_setting("numa-bytes", &numa_bytes);
 	(void)stress_get_setting("numa-shuffle-addr", &numa_shuffle_addr);
 	(void)stress_get_setting("numa-shuffle-node", &numa_shuffle_node);
+	(void)stress_get_setting("numa-matrix", &numa_matrix);
 
 	if (numa_bytes == 0) {
+#if defined(HAVE_NUMA_MATRIX)
+		numa_bytes = numa_matrix ? NUMA_MATRIX_DEFAULT_BYTES : DEFAULT_NUMA_MMAP_BYTES;
+#else
 		numa_bytes = DEFAULT_NUMA_MMAP_BYTES;
+#endif
 	} else {
 		if (args->num_instances > 0) {
 			numa_bytes /= args->num_instances;
@@ -367,6 +966,17 @@ static int stress_numa(stress_args_t *args)
 			args->name, numa_nodes, max_nodes, str);
 	}
 
+	if (numa_matrix) {
+#if defined(HAVE_NUMA_MATRIX)
+		rc = stress_numa_matrix(args, n, numa_nodes, max_nodes, numa_bytes);
+		goto numa_free;
+#else
+		if (!args->instance)
+			pr_inf("%s: --numa-matrix requires sched_getaffinity() and sched_setaffinity(), ignoring option\n",
+				args->name);
+#endif
+	}
+
 	mask_elements = (max_nodes + NUMA_LONG_BITS - 1) / NUMA_LONG_BITS;
 	node_mask = (unsigned long *)calloc(mask_elements, sizeof(*node_mask));
 	if (!node_mask) {
@@ -20,6 +20,7 @@
 #include "stress-ng.h"
 #include "core-builtin.h"
 #include "core-killpid.h"
+#include "core-pthread.h"
 
 #if defined(HAVE_LINUX_OPENAT2_H)
 #include <linux/openat2.h>
@@ -29,13 +30,18 @@
 #include <utime.h>
 #endif
 
+#define MIN_OPEN_THREADS	(1)
+#define MAX_OPEN_THREADS	(1024)
+
 typedef int (*stress_open_func_t)(stress_args_t *args, const char *temp_dir, const pid_t pid, double *duration, double *count);
 
 static const stress_help_t help[] = {
 	{ "o N", "open N",		"start N workers exercising open/close" },
+	{ NULL,	"open-clone-files",	"use CLONE_FILES processes rather than threads for --open-threads" },
 	{ NULL, "open-fd",		"open files in /proc/$pid/fd" },
 	{ NULL,	"open-max N",		"specficify maximum number of files to open" },
 	{ NULL,	"open-ops N",		"stop after N open/close bogo operations" },
+	{ NULL,	"open-threads N",	"sweep 1 to N threads opening files on a shared fd table" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -190,10 +196,27 @@ static int stress_set_open_max(const char *opt)
         return stress_set_setting("open-max", TYPE_ID_SIZE_T, &open_max);
 }
 
+static int stress_set_open_threads(const char *opt)
+{
+	uint32_t open_threads;
+
+	open_threads = stress_get_uint32(opt);
+	stress_check_range("open-threads", (uint64_t)open_threads,
+		MIN_OPEN_THREADS, MAX_OPEN_THREADS);
+	return stress_set_setting("open-threads", TYPE_ID_UINT32, &open_threads);
+}
+
+static int stress_set_open_clone_files(const char *opt)
+{
+	return stress_set_setting_true("open-clone-files", opt);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
-	{ OPT_open_fd,	stress_set_open_fd, },
-	{ OPT_open_max,	stress_set_open_max },
-	{ 0,		NULL }
+	{ OPT_open_clone_files,	stress_set_open_clone_files },
+	{ OPT_open_fd,		stress_set_open_fd, },
+	{ OPT_open_max,		stress_set_open_max },
+	{ OPT_open_threads,	stress_set_open_threads },
+	{ 0,			NULL }
 };
 
 #if defined(HAVE_OPENAT) &&	\
@@ -1057,6 +1080,379 @@ static void stress_fd_dir(const char *path, double *duration, double *count)
 	}
 }
 
+#if defined(HAVE_LIB_PTHREAD)
+
+#define OPEN_THREADS_OPENS	(64)		/* opens per stop flag check */
+#define OPEN_THREADS_PHASE	(1.0)		/* default secs per sweep cell */
+#define OPEN_THREADS_STACK_SIZE	(64 * KB)	/* clone process stack size */
+
+#define OPEN_THREADS_RUN_FAILED		(-1)	/* a worker open failed */
+#define OPEN_THREADS_RUN_NOT_STARTED	(-2)	/* not all workers started */
+
+#if defined(__linux__) &&	\
+    defined(HAVE_CLONE) &&	\
+    defined(CLONE_FILES)
+#define STRESS_OPEN_CLONE_FILES	(1)
+#endif
+
+/* fd table sizes to sweep, limited to the open file limit */
+static const size_t open_threads_fd_table_sizes[] = {
+	64, 1024, 16384, 131072
+};
+
+/* a thread or CLONE_FILES process opening and closing files */
+typedef struct {
+	pthread_t pthread;		/* thread handle */
+	int ret;			/* pthread_create return */
+	pid_t pid;			/* clone process pid */
+	int dir_fd;			/* directory holding the file to open */
+	volatile bool *stop;		/* stop flag */
+	uint64_t opens;			/* opens completed */
+	double duration;		/* time spent opening and closing */
+	int err;			/* errno of a failed open */
+} stress_open_worker_t;
+
+/*
+ *  stress_open_worker()
+ *	open and close a file as fast as possible, all workers share
+ *	the same fd table so each open and close contends on the
+ *	fd table lock
+ */
+static void stress_open_worker(stress_open_worker_t *worker)
+{
+	const double t = stress_time_now();
+
+	while (!*worker->stop && stress_continue_flag()) {
+		int i;
+
+		for (i = 0; i < OPEN_THREADS_OPENS; i++) {
+			const int fd = openat(worker->dir_fd, "open_threads", O_RDONLY);
+
+			if (UNLIKELY(fd < 0)) {
+				if ((errno == EMFILE) || (errno == ENFILE) || (errno == EINTR))
+					continue;
+				worker->err = errno;
+				goto done;
+			}
+			(void)close(fd);
+			worker->opens++;
+		}
+	}
+done:
+	worker->duration = stress_time_now() - t;
+}
+
+static void *stress_open_worker_thread(void *arg)
+{
+	static void *nowt = NULL;
+
+	stress_open_worker((stress_open_worker_t *)arg);
+	return &nowt;
+}
+
+#if defined(STRESS_OPEN_CLONE_FILES)
+static int stress_open_worker_clone(void *arg)
+{
+	stress_open_worker((stress_open_worker_t *)arg);
+	_exit(0);
+	return 0;
+}
+#endif
+
+/*
+ *  stress_open_threads_run()
+ *	run n_workers concurrent openers for duration secs, the
+ *	aggregate opens per second are returned in *rate and the
+ *	opens are added to *opens, returns 0 on success,
+ *	OPEN_THREADS_RUN_FAILED if an open failed or
+ *	OPEN_THREADS_RUN_NOT_STARTED if not all workers started
+ */
+static int stress_open_threads_run(
+	stress_args_t *args,
+	stress_open_worker_t *workers,
+	volatile bool *stop,
+	char *stacks,
+	const size_t n_workers,
+	const bool clone_files,
+	const int dir_fd,
+	const double duration,
+	double *rate,
+	uint64_t *opens)
+{
+	size_t i, started = 0;
+	double t_end;
+	int err = 0, start_err = 0;
+
+#if !defined(STRESS_OPEN_CLONE_FILES)
+	(void)stacks;
+#endif
+	*rate = 0.0;
+	*stop = false;
+	for (i = 0; i < n_workers; i++) {
+		stress_open_worker_t *worker = &workers[i];
+
+		(void)shim_memset(worker, 0, sizeof(*worker));
+		worker->dir_fd = dir_fd;
+		worker->stop = stop;
+		worker->pid = -1;
+#if defined(STRESS_OPEN_CLONE_FILES)
+		if (clone_files) {
+			char *stack_top = (char *)stress_get_stack_top((void *)(stacks + (i * OPEN_THREADS_STACK_SIZE)),
+				OPEN_THREADS_STACK_SIZE);
+
+			worker->pid = clone(stress_open_worker_clone, stress_align_stack(stack_top),
+				CLONE_FILES | SIGCHLD, (void *)worker);
+			if (worker->pid < 0) {
+				start_err = errno;
+				break;
+			}
+		} else
+#else
+		(void)clone_files;
+#endif
+		{
+			worker->ret = pthread_create(&worker->pthread, NULL,
+				stress_open_worker_thread, (void *)worker);
+			if (worker->ret != 0) {
+				start_err = worker->ret;
+				break;
+			}
+		}
+		started++;
+	}
+	if (started < n_workers) {
+		*stop = true;
+	} else {
+		t_end = stress_time_now() + duration;
+		while (stress_continue(args) && (stress_time_now() < t_end))
+			(void)shim_usleep(10000);
+		*stop = true;
+	}
+
+	for (i = 0; i < started; i++) {
+		stress_open_worker_t *worker = &workers[i];
+
+		if (worker->pid > 0) {
+			int status;
+
+			(void)shim_waitpid(worker->pid, &status, 0);
+		} else {
+			(void)pthread_join(worker->pthread, NULL);
+		}
+		if (worker->duration > 0.0)
+			*rate += (double)worker->opens / worker->duration;
+		*opens += worker->opens;
+		if (worker->err && !err)
+			err = worker->err;
+	}
+	if (err) {
+		pr_fail("%s: open failed, errno=%d (%s)\n", args->name, err, strerror(err));
+		return OPEN_THREADS_RUN_FAILED;
+	}
+	if (started < n_workers) {
+		pr_inf_skip("%s: only %zu of %zu %s could be started, errno=%d (%s), "
+			"skipping stressor\n", args->name, started, n_workers,
+			clone_files ? "processes" : "threads", start_err, strerror(start_err));
+		return OPEN_THREADS_RUN_NOT_STARTED;
+	}
+	return 0;
+}
+
+/*
+ *  stress_open_threads()
+ *	sweep 1..open_threads threads (or CLONE_FILES processes) opening
+ *	and closing files on a shared fd table over a range of fd table
+ *	sizes and report the opens per second for each combination
+ */
+static int stress_open_threads(
+	stress_args_t *args,
+	const char *temp_dir,
+	const size_t open_max,
+	const uint32_t open_threads,
+	const bool open_clone_files)
+{
+	size_t thread_counts[32], n_threads = 0, n_sizes = 0, i, j, k;
+	size_t fd_table_sizes[SIZEOF_ARRAY(open_threads_fd_table_sizes)];
+	double rates[SIZEOF_ARRAY(open_threads_fd_table_sizes)][32];
+	double phase = OPEN_THREADS_PHASE;
+	stress_open_worker_t *workers;
+	volatile bool *stop;
+	char *stacks = NULL;
+	const size_t workers_sz = sizeof(*workers) * open_threads + sizeof(*stop);
+	size_t fd_limit = open_max, n_fds = 0, metrics_idx = 0;
+	int dir_fd, fd, rc = EXIT_SUCCESS, *fds = NULL;
+	uint64_t opens = 0;
+	bool clone_files = open_clone_files;
+	char filename[PATH_MAX];
+#if defined(RLIMIT_NOFILE)
+	struct rlimit rlim;
+#endif
+
+#if !defined(STRESS_OPEN_CLONE_FILES)
+	if (clone_files) {
+		if (args->instance == 0)
+			pr_inf("%s: clone() with CLONE_FILES not supported, using threads\n",
+				args->name);
+		clone_files = false;
+	}
+#endif
+
+	/* fd table size is limited by the open file limit */
+#if defined(RLIMIT_NOFILE)
+	if (getrlimit(RLIMIT_NOFILE, &rlim) == 0) {
+		rlim.rlim_cur = rlim.rlim_max;
+		(void)setrlimit(RLIMIT_NOFILE, &rlim);
+		if ((getrlimit(RLIMIT_NOFILE, &rlim) == 0) &&
+		    (rlim.rlim_cur != RLIM_INFINITY) &&
+		    ((size_t)rlim.rlim_cur < fd_limit))
+			fd_limit = (size_t)rlim.rlim_cur;
+	}
+#endif
+	/* leave room for stdio, the directory fd and one fd per worker */
+	fd_limit = (fd_limit > (size_t)open_threads + 32) ? fd_limit - open_threads - 32 : 0;
+	for (i = 0; i < SIZEOF_ARRAY(open_threads_fd_table_sizes); i++) {
+		if (open_threads_fd_table_sizes[i] <= fd_limit)
+			fd_table_sizes[n_sizes++] = open_threads_fd_table_sizes[i];
+	}
+	if (n_sizes == 0) {
+		pr_inf_skip("%s: open file limit too low for --open-threads, skipping stressor\n",
+			args->name);
+		return EXIT_NO_RESOURCE;
+	}
+
+	/* thread counts 1, 2, 4, .. up to and including open_threads */
+	for (k = 1; (k < open_threads) && (n_threads < SIZEOF_ARRAY(thread_counts) - 1); k <<= 1)
+		thread_counts[n_threads++] = k;
+	thread_counts[n_threads++] = open_threads;
+
+	(void)stress_mk_filename(filename, sizeof(filename), temp_dir, "open_threads");
+	fd = open(filename, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		pr_fail("%s: cannot create %s, errno=%d (%s)\n",
+			args->name, filename, errno, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	(void)close(fd);
+	dir_fd = open(temp_dir, O_RDONLY | O_DIRECTORY);
+	if (dir_fd < 0) {
+		pr_fail("%s: cannot open %s, errno=%d (%s)\n",
+			args->name, temp_dir, errno, strerror(errno));
+		rc = EXIT_FAILURE;
+		goto tidy_file;
+	}
+
+	/* workers and stop flag are shared with CLONE_FILES processes */
+	workers = (stress_open_worker_t *)stress_mmap_populate(NULL, workers_sz,
+		PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_SHARED, -1, 0);
+	if (workers == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes for worker state, skipping stressor\n",
+			args->name, workers_sz);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_dir_fd;
+	}
+	stop = (volatile bool *)(workers + open_threads);
+	fds = (int *)calloc(fd_table_sizes[n_sizes - 1], sizeof(*fds));
+	if (!fds) {
+		pr_inf_skip("%s: cannot allocate fd table, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_workers;
+	}
+#if defined(STRESS_OPEN_CLONE_FILES)
+	if (clone_files) {
+		stacks = (char *)malloc((size_t)open_threads * OPEN_THREADS_STACK_SIZE);
+		if (!stacks) {
+			pr_inf_skip("%s: cannot allocate clone stacks, skipping stressor\n", args->name);
+			rc = EXIT_NO_RESOURCE;
+			goto tidy_fds;
+		}
+	}
+#endif
+	if (g_opt_timeout > 0)
+		phase = (args->time_end - stress_time_now()) / (double)(n_sizes * n_threads);
+	if (args->instance == 0)
+		pr_inf("%s: sweeping 1 to %" PRIu32 " %s over %zu fd table sizes, %.2f secs per combination\n",
+			args->name, open_threads, clone_files ? "CLONE_FILES processes" : "threads",
+			n_sizes, phase);
+
+	(void)shim_memset(rates, 0, sizeof(rates));
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	for (i = 0; (i < n_sizes) && stress_continue(args); i++) {
+		/* grow the fd table by filling it with open fds */
+		while (n_fds < fd_table_sizes[i]) {
+			fds[n_fds] = open("/dev/null", O_RDONLY);
+			if (fds[n_fds] < 0)
+				break;
+			n_fds++;
+		}
+		if (n_fds < fd_table_sizes[i]) {
+			if (args->instance == 0)
+				pr_inf("%s: only %zu of %zu fds could be opened, errno=%d (%s), "
+					"ending sweep\n", args->name, n_fds, fd_table_sizes[i],
+					errno, strerror(errno));
+			n_sizes = i;
+			break;
+		}
+		for (j = 0; (j < n_threads) && stress_continue(args); j++) {
+			const int ret = stress_open_threads_run(args, workers, stop, stacks,
+				thread_counts[j], clone_files, dir_fd, phase, &rates[i][j], &opens);
+
+			stress_bogo_set(args, opens);
+			if (ret == OPEN_THREADS_RUN_NOT_STARTED) {
+				rc = EXIT_NO_RESOURCE;
+				goto tidy_stacks;
+			} else if (ret < 0) {
+				rc = EXIT_FAILURE;
+				goto tidy_stacks;
+			}
+		}
+	}
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0) {
+		pr_block_begin();
+		pr_inf("%s: opens/sec (and per worker opens/sec) by fd table size and %s\n",
+			args->name, clone_files ? "processes" : "threads");
+		for (i = 0; i < n_sizes; i++) {
+			for (j = 0; j < n_threads; j++) {
+				pr_inf("%s: %7zu fds %4zu %s %12.0f (%10.0f)\n",
+					args->name, fd_table_sizes[i], thread_counts[j],
+					clone_files ? "procs  " : "threads", rates[i][j],
+					rates[i][j] / (double)thread_counts[j]);
+			}
+		}
+		pr_block_end();
+	}
+	for (i = 0; i < n_sizes; i++) {
+		for (j = 0; j < n_threads; j++) {
+			char desc[64];
+
+			(void)snprintf(desc, sizeof(desc), "opens/sec %zu fds %zu %s",
+				fd_table_sizes[i], thread_counts[j],
+				clone_files ? "procs" : "threads");
+			stress_metrics_set(args, metrics_idx++, desc,
+				rates[i][j], STRESS_HARMONIC_MEAN);
+		}
+	}
+
+tidy_stacks:
+	free(stacks);
+#if defined(STRESS_OPEN_CLONE_FILES)
+tidy_fds:
+#endif
+	for (i = 0; i < n_fds; i++)
+		(void)close(fds[i]);
+	free(fds);
+tidy_workers:
+	(void)munmap((void *)workers, workers_sz);
+tidy_dir_fd:
+	(void)close(dir_fd);
+tidy_file:
+	(void)shim_unlink(filename);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_open()
  *	stress system by rapid open/close calls
@@ -1071,7 +1467,8 @@ static int stress_open(stress_args_t *args)
 	pid_t pid = -1;
 	const pid_t mypid = getpid();
 	struct stat statbuf;
-	bool open_fd = false;
+	bool open_fd = false, open_clone_files = false;
+	uint32_t open_threads = 0;
 	int all_open_flags;
 	double duration = 0.0, count = 0.0, rate;
 
@@ -1089,6 +1486,20 @@ static int stress_open(stress_args_t *args)
 
 	(void)stress_get_setting("open-max", &open_max);
 	(void)stress_get_setting("open-fd", &open_fd);
+	(void)stress_get_setting("open-threads", &open_threads);
+	(void)stress_get_setting("open-clone-files", &open_clone_files);
+
+	if (open_threads > 0) {
+#if defined(HAVE_LIB_PTHREAD)
+		ret = stress_open_threads(args, temp_dir, open_max, open_threads, open_clone_files);
+		(void)stress_temp_dir_rm_args(args);
+		return ret;
+#else
+		if (args->instance == 0)
+			pr_inf("%s: pthreads not supported, ignoring --open-threads option\n",
+				args->name);
+#endif
+	}
 
 	/* Limit to maximum size_t allocation size */
 	if (open_max > (max_size - 1) / sizeof(*fds))
@@ -18,7 +18,17 @@
  *
  */
 #include "stress-ng.h"
+#include "core-builtin.h"
 #include "core-pragma.h"
+#include "core-pthread.h"
+
+#if defined(HAVE_LINUX_FS_H)
+#include <linux/fs.h>
+#endif
+
+#if defined(HAVE_SYS_SYSMACROS_H)
+#include <sys/sysmacros.h>
+#endif
 
 #define MIN_READAHEAD_BYTES	(1 * MB)
 #define MAX_READAHEAD_BYTES	(MAX_FILE_LIMIT)
@@ -28,10 +38,14 @@
 #define BUF_SIZE		(4096)
 #define MAX_OFFSETS		(16)
 
+#define MIN_READAHEAD_STREAMS	(1)
+#define MAX_READAHEAD_STREAMS	(64)
+
 static const stress_help_t help[] = {
 	{ NULL,	"readahead N",		"start N workers exercising file readahead" },
 	{ NULL,	"readahead-bytes N",	"size of file to readahead on (default is 1GB)" },
 	{ NULL,	"readahead-ops N",	"stop after N readahead bogo operations" },
+	{ NULL,	"readahead-streams N",	"sweep readahead window sizes with N sequential readers" },
 	{ NULL,	NULL,			NULL }
 };
 
@@ -45,8 +59,19 @@ static int stress_set_readahead_bytes(const char *opt)
 	return stress_set_setting("readahead-bytes", TYPE_ID_UINT64, &readahead_bytes);
 }
 
+static int stress_set_readahead_streams(const char *opt)
+{
+	uint32_t readahead_streams;
+
+	readahead_streams = stress_get_uint32(opt);
+	stress_check_range("readahead-streams", (uint64_t)readahead_streams,
+		MIN_READAHEAD_STREAMS, MAX_READAHEAD_STREAMS);
+	return stress_set_setting("readahead-streams", TYPE_ID_UINT32, &readahead_streams);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_readahead_bytes,	stress_set_readahead_bytes },
+	{ OPT_readahead_streams,stress_set_readahead_streams },
 	{ 0,			NULL }
 };
 
@@ -91,6 +116,411 @@ static int do_readahead(
 	return 0;
 }
 
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_POSIX_FADVISE) &&	\
+    defined(POSIX_FADV_DONTNEED) &&	\
+    defined(POSIX_FADV_WILLNEED) &&	\
+    defined(POSIX_FADV_RANDOM) &&	\
+    defined(POSIX_FADV_NORMAL)
+
+#define HAVE_READAHEAD_STREAMS
+
+#define READAHEAD_STREAMS_SLOT		(0.5)	/* seconds of reading per window */
+#define READAHEAD_STREAMS_CHUNK		(4 * BUF_SIZE)	/* largest read size */
+
+/* readahead windows swept, 0 is no readahead at all */
+static const size_t readahead_windows[] = {
+	0, 16 * KB, 32 * KB, 64 * KB, 128 * KB, 256 * KB, 512 * KB, 1 * MB, 2 * MB, 4 * MB
+};
+
+#define READAHEAD_WINDOWS	(SIZEOF_ARRAY(readahead_windows))
+
+/* a sequential reader */
+typedef struct {
+	stress_args_t *args;
+	const char *filename;		/* file to read */
+	const char *fs_type;		/* file system type */
+	off_t start;			/* start of region to read */
+	off_t end;			/* end of region to read */
+	size_t rsize;			/* read size */
+	size_t stride;			/* distance between reads */
+	size_t window;			/* readahead window */
+	bool hint;			/* emulate window with POSIX_FADV_WILLNEED */
+	uint64_t bytes;			/* bytes read in a pass */
+	double duration;		/* time taken for a pass */
+	uint64_t baddata;		/* verify failures */
+	int ret;			/* -1 on failure */
+	pthread_t pthread;
+	int create_ret;
+} stress_readahead_reader_t;
+
+static void *nowt = NULL;
+
+/*
+ *  stress_readahead_reader()
+ *	read a region of the file sequentially, with a forward stride
+ *	for odd numbered readers. When the device readahead can't be
+ *	set the window is emulated by disabling kernel readahead and
+ *	issuing POSIX_FADV_WILLNEED hints of the window size ahead of
+ *	the reader
+ */
+static void *stress_readahead_reader(void *arg)
+{
+	stress_readahead_reader_t *reader = (stress_readahead_reader_t *)arg;
+	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	buffer_t buf[READAHEAD_STREAMS_CHUNK / sizeof(buffer_t)] ALIGN64;
+	off_t pos, hint_end = reader->start;
+	double t;
+	int fd;
+
+	reader->bytes = 0;
+	reader->duration = 0.0;
+	reader->ret = 0;
+
+	/* open per pass so the file picks up the current device readahead */
+	fd = open(reader->filename, O_RDONLY);
+	if (fd < 0) {
+		pr_fail("%s: open %s failed, errno=%d (%s)%s\n",
+			reader->args->name, reader->filename, errno, strerror(errno), reader->fs_type);
+		reader->ret = -1;
+		return &nowt;
+	}
+	(void)posix_fadvise(fd, 0, 0, reader->hint ? POSIX_FADV_RANDOM : POSIX_FADV_NORMAL);
+
+	t = stress_time_now();
+	for (pos = reader->start; pos + (off_t)reader->rsize <= reader->end; pos += (off_t)reader->stride) {
+		ssize_t ret;
+
+		if (UNLIKELY(!stress_continue_flag()))
+			break;
+		if (reader->hint && reader->window &&
+		    (pos + (off_t)(reader->window / 2) >= hint_end)) {
+			if (hint_end < pos)
+				hint_end = pos;
+			(void)posix_fadvise(fd, hint_end, (off_t)reader->window, POSIX_FADV_WILLNEED);
+			hint_end += (off_t)reader->window;
+		}
+		ret = pread(fd, buf, reader->rsize, pos);
+		if (UNLIKELY(ret < 0)) {
+			if ((errno == EINTR) || (errno == EAGAIN))
+				continue;
+			pr_fail("%s: pread failed, errno=%d (%s)%s\n",
+				reader->args->name, errno, strerror(errno), reader->fs_type);
+			reader->ret = -1;
+			break;
+		}
+		reader->bytes += (uint64_t)ret;
+
+		if (verify) {
+			size_t i;
+
+			for (i = 0; i < (size_t)ret / sizeof(buffer_t); i++) {
+				const off_t o = (pos + (off_t)(i * sizeof(buffer_t))) / BUF_SIZE;
+				const size_t j = i % (BUF_SIZE / sizeof(buffer_t));
+
+				if (UNLIKELY(buf[i] != (buffer_t)o + j))
+					reader->baddata++;
+			}
+		}
+	}
+	reader->duration = stress_time_now() - t;
+	(void)close(fd);
+
+	return &nowt;
+}
+
+/*
+ *  stress_readahead_blkdev()
+ *	open the block device a file lives on, -1 if it can't be found
+ */
+static int stress_readahead_blkdev(const dev_t dev)
+{
+	char path[PATH_MAX], buf[4096];
+	const char *ptr;
+	int fd;
+
+	(void)snprintf(path, sizeof(path), "/dev/block/%u:%u", major(dev), minor(dev));
+	fd = open(path, O_RDONLY);
+	if (fd >= 0)
+		return fd;
+
+	(void)snprintf(path, sizeof(path), "/sys/dev/block/%u:%u/uevent", major(dev), minor(dev));
+	if (stress_system_read(path, buf, sizeof(buf)) <= 0)
+		return -1;
+	ptr = strstr(buf, "DEVNAME=");
+	if (!ptr)
+		return -1;
+	ptr += 8;
+	(void)snprintf(path, sizeof(path), "/dev/%.*s", (int)strcspn(ptr, "\n"), ptr);
+	return open(path, O_RDONLY);
+}
+
+/*
+ *  stress_readahead_streams()
+ *	run K concurrent sequential readers over a file, sweeping the
+ *	readahead window, report per reader and aggregate throughput
+ *	and the best window for this number of streams
+ */
+static int stress_readahead_streams(
+	stress_args_t *args,
+	const uint64_t readahead_bytes,
+	const uint32_t streams)
+{
+	stress_readahead_reader_t *readers;
+	uint64_t total_bytes[READAHEAD_WINDOWS];
+	double total_time[READAHEAD_WINDOWS];
+	double reader_rate_min[READAHEAD_WINDOWS], reader_rate_max[READAHEAD_WINDOWS];
+	double reader_rate_sum[READAHEAD_WINDOWS];
+	uint64_t reader_passes[READAHEAD_WINDOWS];
+	buffer_t *buf = NULL;
+	char filename[PATH_MAX];
+	const char *fs_type;
+	struct stat statbuf;
+	uint64_t i, region, baddata = 0;
+	unsigned long ra_orig = 0;
+	int fd, blk_fd = -1, ret, rc = EXIT_SUCCESS;
+	size_t w, best = 0;
+	uint32_t s;
+	bool hint = true;
+
+	readers = (stress_readahead_reader_t *)calloc(streams, sizeof(*readers));
+	if (!readers) {
+		pr_inf_skip("%s: cannot allocate %" PRIu32 " readers, skipping stressor\n",
+			args->name, streams);
+		return EXIT_NO_RESOURCE;
+	}
+	ret = posix_memalign((void **)&buf, BUF_ALIGNMENT, BUF_SIZE);
+	if (ret || !buf) {
+		pr_inf_skip("%s: cannot allocate buffer, skipping stressor\n", args->name);
+		free(readers);
+		return EXIT_NO_RESOURCE;
+	}
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0) {
+		free(buf);
+		free(readers);
+		return stress_exit_status(-ret);
+	}
+	(void)stress_temp_filename_args(args, filename, sizeof(filename), stress_mwc32());
+	fd = open(filename, O_CREAT | O_RDWR | O_TRUNC, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		rc = stress_exit_status(errno);
+		pr_fail("%s: open %s failed, errno=%d (%s)\n",
+			args->name, filename, errno, strerror(errno));
+		goto finish;
+	}
+	fs_type = stress_get_fs_type(filename);
+
+	/* Sequential write of the same data pattern as the default mode */
+	for (i = 0; i < readahead_bytes; i += BUF_SIZE) {
+		const off_t o = (off_t)(i / BUF_SIZE);
+		size_t j;
+
+		if (!stress_continue_flag())
+			goto close_finish;
+		for (j = 0; j < (BUF_SIZE / sizeof(*buf)); j++)
+			buf[j] = (buffer_t)o + j;
+		if (pwrite(fd, buf, BUF_SIZE, (off_t)i) != BUF_SIZE) {
+			if (errno == ENOSPC)
+				break;
+			pr_fail("%s: pwrite failed, errno=%d (%s)%s\n",
+				args->name, errno, strerror(errno), fs_type);
+			rc = EXIT_FAILURE;
+			goto close_finish;
+		}
+	}
+	(void)shim_fsync(fd);
+	if (shim_fstat(fd, &statbuf) < 0) {
+		pr_fail("%s: fstat failed, errno=%d (%s)%s\n",
+			args->name, errno, strerror(errno), fs_type);
+		rc = EXIT_FAILURE;
+		goto close_finish;
+	}
+	region = ((uint64_t)statbuf.st_size / streams) & ~(uint64_t)(BUF_SIZE - 1);
+	if (region < READAHEAD_STREAMS_CHUNK * 2) {
+		pr_inf_skip("%s: %jd byte file too small for %" PRIu32 " readers, skipping stressor\n",
+			args->name, (intmax_t)statbuf.st_size, streams);
+		rc = EXIT_NO_RESOURCE;
+		goto close_finish;
+	}
+
+#if defined(BLKRAGET) &&	\
+    defined(BLKRASET)
+	/*
+	 *  The device readahead is shared by everything on the device,
+	 *  so only the first instance changes it, and only if permitted
+	 */
+	if (args->instance == 0) {
+		blk_fd = stress_readahead_blkdev(statbuf.st_dev);
+		if (blk_fd >= 0) {
+			if ((ioctl(blk_fd, BLKRAGET, &ra_orig) == 0) &&
+			    (ioctl(blk_fd, BLKRASET, ra_orig) == 0)) {
+				hint = false;
+			} else {
+				(void)close(blk_fd);
+				blk_fd = -1;
+			}
+		}
+	}
+#endif
+	if (args->instance == 0)
+		pr_inf("%s: %" PRIu32 " sequential readers over %jd bytes, %s%s\n",
+			args->name, streams, (intmax_t)statbuf.st_size,
+			hint ? "window set by POSIX_FADV_WILLNEED hints" :
+			       "window set with BLKRASET", fs_type);
+
+	(void)shim_memset(total_bytes, 0, sizeof(total_bytes));
+	(void)shim_memset(total_time, 0, sizeof(total_time));
+	(void)shim_memset(reader_rate_sum, 0, sizeof(reader_rate_sum));
+	(void)shim_memset(reader_rate_max, 0, sizeof(reader_rate_max));
+	(void)shim_memset(reader_passes, 0, sizeof(reader_passes));
+	for (w = 0; w < READAHEAD_WINDOWS; w++)
+		reader_rate_min[w] = -1.0;
+
+	for (s = 0; s < streams; s++) {
+		stress_readahead_reader_t *reader = &readers[s];
+
+		reader->args = args;
+		reader->filename = filename;
+		reader->fs_type = fs_type;
+		reader->start = (off_t)(region * s);
+		reader->end = reader->start + (off_t)region;
+		/* 4K, 8K, 16K reads, odd readers skip every other read */
+		reader->rsize = BUF_SIZE << (s % 3);
+		reader->stride = (s & 1) ? reader->rsize * 2 : reader->rsize;
+		reader->hint = hint;
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (w = 0; (w < READAHEAD_WINDOWS) && stress_continue(args); w++) {
+			double t_start = stress_time_now();
+
+#if defined(BLKRASET)
+			if (blk_fd >= 0)
+				(void)ioctl(blk_fd, BLKRASET, (unsigned long)(readahead_windows[w] / 512));
+#endif
+			do {
+				uint64_t bytes = 0;
+				double t;
+				uint32_t started = 0;
+
+				/* start each pass from a cold page cache */
+				(void)posix_fadvise(fd, 0, statbuf.st_size, POSIX_FADV_DONTNEED);
+
+				t = stress_time_now();
+				for (s = 0; s < streams; s++) {
+					readers[s].window = readahead_windows[w];
+					readers[s].create_ret = pthread_create(&readers[s].pthread, NULL,
+						stress_readahead_reader, (void *)&readers[s]);
+					if (readers[s].create_ret == 0)
+						started++;
+				}
+				for (s = 0; s < streams; s++) {
+					stress_readahead_reader_t *reader = &readers[s];
+
+					if (reader->create_ret != 0)
+						continue;
+					(void)pthread_join(reader->pthread, NULL);
+					if (reader->ret < 0)
+						rc = EXIT_FAILURE;
+					baddata += reader->baddata;
+					bytes += reader->bytes;
+					if (reader->duration > 0.0) {
+						const double rate = (double)reader->bytes / reader->duration;
+
+						reader_rate_sum[w] += rate;
+						reader_passes[w]++;
+						if ((reader_rate_min[w] < 0.0) || (rate < reader_rate_min[w]))
+							reader_rate_min[w] = rate;
+						if (rate > reader_rate_max[w])
+							reader_rate_max[w] = rate;
+					}
+				}
+				t = stress_time_now() - t;
+				if (started < streams) {
+					pr_inf_skip("%s: could only start %" PRIu32 " of %" PRIu32 " readers, "
+						"skipping stressor\n", args->name, started, streams);
+					rc = EXIT_NO_RESOURCE;
+				}
+				if (rc != EXIT_SUCCESS)
+					goto restore;
+				/* don't count a pass cut short by the end of the run */
+				if (!stress_continue_flag())
+					break;
+				total_bytes[w] += bytes;
+				total_time[w] += t;
+				stress_bogo_inc(args);
+			} while (stress_continue(args) &&
+				 (stress_time_now() - t_start < READAHEAD_STREAMS_SLOT));
+		}
+	} while (stress_continue(args));
+
+restore:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+#if defined(BLKRASET)
+	if (blk_fd >= 0) {
+		(void)ioctl(blk_fd, BLKRASET, ra_orig);
+		(void)close(blk_fd);
+	}
+#endif
+	if (baddata) {
+		pr_fail("%s: %" PRIu64 " unexpected data values read back\n",
+			args->name, baddata);
+		rc = EXIT_FAILURE;
+	}
+
+	for (w = 0; w < READAHEAD_WINDOWS; w++) {
+		if (total_time[w] <= 0.0)
+			continue;
+		if ((total_time[best] <= 0.0) ||
+		    ((double)total_bytes[w] / total_time[w] > (double)total_bytes[best] / total_time[best]))
+			best = w;
+	}
+	if ((rc == EXIT_SUCCESS) && (total_time[best] > 0.0)) {
+		if (args->instance == 0) {
+			pr_block_begin();
+			pr_inf("%s: %10s %12s %12s %12s %12s\n", args->name, "window",
+				"total MB/s", "reader MB/s", "min MB/s", "max MB/s");
+			for (w = 0; w < READAHEAD_WINDOWS; w++) {
+				if ((total_time[w] <= 0.0) || (reader_passes[w] == 0))
+					continue;
+				pr_inf("%s: %9zuK %12.2f %12.2f %12.2f %12.2f\n", args->name,
+					(size_t)(readahead_windows[w] / KB),
+					(double)total_bytes[w] / total_time[w] / (double)MB,
+					reader_rate_sum[w] / (double)reader_passes[w] / (double)MB,
+					reader_rate_min[w] / (double)MB,
+					reader_rate_max[w] / (double)MB);
+			}
+			pr_inf("%s: best readahead window for %" PRIu32 " readers is %zuK%s\n",
+				args->name, streams, (size_t)(readahead_windows[best] / KB),
+				hint ? " (emulated with POSIX_FADV_WILLNEED hints)" : "");
+			pr_block_end();
+		}
+		for (w = 0; w < READAHEAD_WINDOWS; w++) {
+			char str[64];
+
+			if (total_time[w] <= 0.0)
+				continue;
+			(void)snprintf(str, sizeof(str), "MB/s total for %zuK window", (size_t)(readahead_windows[w] / KB));
+			stress_metrics_set(args, w, str,
+				(double)total_bytes[w] / total_time[w] / (double)MB, STRESS_HARMONIC_MEAN);
+		}
+		stress_metrics_set(args, READAHEAD_WINDOWS, "KB best readahead window",
+			(double)readahead_windows[best] / (double)KB, STRESS_GEOMETRIC_MEAN);
+	}
+
+close_finish:
+	(void)close(fd);
+	(void)shim_unlink(filename);
+finish:
+	(void)stress_temp_dir_rm_args(args);
+	free(buf);
+	free(readers);
+	return rc;
+}
+#endif
+
 /*
  *  stress_readahead
  *	stress file system cache via readahead calls
@@ -111,6 +541,7 @@ static int stress_readahead(stress_args_t *args)
 	off_t offsets[MAX_OFFSETS] ALIGN64;
 	int generate_offsets = 0;
 	const bool verify = !!(g_opt_flags & OPT_FLAGS_VERIFY);
+	uint32_t readahead_streams;
 
 	if (!stress_get_setting("readahead-bytes", &readahead_bytes)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
@@ -122,6 +553,16 @@ static int stress_readahead(stress_args_t *args)
 	if (readahead_bytes < MIN_READAHEAD_BYTES)
 		readahead_bytes = MIN_READAHEAD_BYTES;
 
+	if (stress_get_setting("readahead-streams", &readahead_streams)) {
+#if defined(HAVE_READAHEAD_STREAMS)
+		return stress_readahead_streams(args, readahead_bytes, readahead_streams);
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --readahead-streams requires pthreads and posix_fadvise(), ignoring option\n",
+				args->name);
+#endif
+	}
+
 	ret = stress_temp_dir_mk_args(args);
 	if (ret < 0)
 		return stress_exit_status(-rc);
@@ -35,10 +35,86 @@
 #define SHIM_EXT2_IOC_SETFLAGS		_IOW('f', 2, long)
 #define SHIM_FS_NOCOW_FL		0x00800000 /* No Copy-on-Write file */
 
+#if defined(__linux__) &&	\
+    !defined(MADV_PAGEOUT)
+#define MADV_PAGEOUT			(21)
+#endif
+
 static const stress_help_t help[] = {
-	{ NULL,	"swap N",	"start N workers exercising swapon/swapoff" },
-	{ NULL,	"swap-ops N",	"stop after N swapon/swapoff operations" },
-	{ NULL,	NULL,		NULL }
+	{ NULL,	"swap N",	  "start N workers exercising swapon/swapoff" },
+	{ NULL,	"swap-bytes N",	  "swap out and in N bytes per worker in throughput mode" },
+	{ NULL,	"swap-compress N","make N% of each page compressible in throughput mode" },
+	{ NULL,	"swap-ops N",	  "stop after N swapon/swapoff operations" },
+	{ NULL,	"swap-pageout M", "page out with madvise or process-madvise" },
+	{ NULL,	"swap-throughput","measure swap out and swap in rates and latencies" },
+	{ NULL,	NULL,		  NULL }
+};
+
+#define MIN_SWAP_BYTES		(1 * MB)
+#define MAX_SWAP_BYTES		(MAX_MEM_LIMIT)
+#define DEFAULT_SWAP_BYTES	(64 * MB)
+
+#define SWAP_PAGEOUT_MADVISE		(0)
+#define SWAP_PAGEOUT_PROCESS_MADVISE	(1)
+
+typedef struct {
+	const char *name;
+	const int pageout;
+} stress_swap_pageout_t;
+
+static const stress_swap_pageout_t swap_pageouts[] = {
+	{ "madvise",		SWAP_PAGEOUT_MADVISE },
+	{ "process-madvise",	SWAP_PAGEOUT_PROCESS_MADVISE },
+};
+
+static int stress_set_swap_bytes(const char *opt)
+{
+	size_t swap_bytes;
+
+	swap_bytes = (size_t)stress_get_uint64_byte_memory(opt, 1);
+	stress_check_range_bytes("swap-bytes", swap_bytes,
+		MIN_SWAP_BYTES, MAX_SWAP_BYTES);
+	return stress_set_setting("swap-bytes", TYPE_ID_SIZE_T, &swap_bytes);
+}
+
+static int stress_set_swap_compress(const char *opt)
+{
+	uint32_t swap_compress;
+
+	swap_compress = stress_get_uint32(opt);
+	stress_check_range("swap-compress", (uint64_t)swap_compress, 0, 100);
+	return stress_set_setting("swap-compress", TYPE_ID_UINT32, &swap_compress);
+}
+
+static int stress_set_swap_pageout(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(swap_pageouts); i++) {
+		if (!strcmp(swap_pageouts[i].name, opt)) {
+			int pageout = swap_pageouts[i].pageout;
+
+			return stress_set_setting("swap-pageout", TYPE_ID_INT, &pageout);
+		}
+	}
+	(void)fprintf(stderr, "swap-pageout must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(swap_pageouts); i++)
+		(void)fprintf(stderr, " %s", swap_pageouts[i].name);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_swap_throughput(const char *opt)
+{
+	return stress_set_setting_true("swap-throughput", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_swap_bytes,	stress_set_swap_bytes },
+	{ OPT_swap_compress,	stress_set_swap_compress },
+	{ OPT_swap_pageout,	stress_set_swap_pageout },
+	{ OPT_swap_throughput,	stress_set_swap_throughput },
+	{ 0,			NULL }
 };
 
 #if defined(HAVE_SYS_SWAP_H) &&	\
@@ -221,6 +297,26 @@ static void stress_swap_check_swapped(
 	free(vec);
 }
 
+/*
+ *  stress_swap_nocow()
+ *	disable Copy-on-Write on file where possible, since
+ *	file systems such as btrfs have CoW enabled by default
+ *	and swap does not support this feature.
+ */
+static void stress_swap_nocow(const int fd)
+{
+#if defined(__linux__)
+	unsigned long flags;
+
+	if (ioctl(fd, SHIM_EXT2_IOC_GETFLAGS, &flags) == 0) {
+		flags |= SHIM_FS_NOCOW_FL;
+		VOID_RET(int, ioctl(fd, SHIM_EXT2_IOC_SETFLAGS, &flags));
+	}
+#else
+	(void)fd;
+#endif
+}
+
 static void stress_swap_clean_dir(stress_args_t *args)
 {
 	char path[PATH_MAX];
@@ -292,21 +388,7 @@ static int stress_swap_child(stress_args_t *args, void *context)
 		goto tidy_rm;
 	}
 
-#if defined(__linux__)
-	{
-		unsigned long flags;
-
-		/*
-		 *  Disable Copy-on-Write on file where possible, since
-		 *  file systems such as btrfs have CoW enabled by default
-		 *  and we swap does not support this feature.
-		 */
-		if (ioctl(fd, SHIM_EXT2_IOC_GETFLAGS, &flags) == 0) {
-			flags |= SHIM_FS_NOCOW_FL;
-			VOID_RET(int, ioctl(fd, SHIM_EXT2_IOC_SETFLAGS, &flags));
-		}
-	}
-#endif
+	stress_swap_nocow(fd);
 
 	max_swap_pages = stress_swap_zero(args, fd, MAX_SWAP_PAGES, page);
 	if (max_swap_pages < 0) {
@@ -465,9 +547,387 @@ tidy_ret:
 	return ret;
 }
 
+#if defined(MADV_PAGEOUT)
+
+#define SWAP_LATENCY_SAMPLES	(16384)	/* reservoir of fault-in latencies */
+#define SWAP_STAMP		(0x5eed5a9e00000000ULL)
+
+typedef struct {
+	uint64_t faults;		/* pages faulted back in */
+	double latencies[SWAP_LATENCY_SAMPLES];	/* fault-in latencies in ns */
+} stress_swap_latency_t;
+
+/*
+ *  stress_swap_fill_page()
+ *	fill a page with a check stamp, then random data for
+ *	(100 - compress)% of the page and zeros for the rest
+ *	so the compressibility of the page can be controlled
+ */
+static void stress_swap_fill_page(
+	uint8_t *page,
+	const size_t page_size,
+	const size_t index,
+	const uint32_t compress)
+{
+	uint64_t *ptr = (uint64_t *)page;
+	const size_t words = page_size / sizeof(*ptr);
+	const size_t random_words = ((words - 1) * (100 - (size_t)compress)) / 100;
+	size_t i;
+
+	ptr[0] = SWAP_STAMP ^ (uint64_t)index;
+	for (i = 1; i <= random_words; i++)
+		ptr[i] = stress_mwc64();
+	for (; i < words; i++)
+		ptr[i] = 0;
+}
+
+/*
+ *  stress_swap_pageout()
+ *	force the pages out to swap with madvise or process_madvise
+ */
+static int stress_swap_pageout(void *addr, const size_t size, const int pidfd)
+{
+	if (pidfd >= 0) {
+		size_t done = 0;
+
+		/* process_madvise may advise less than requested */
+		while (done < size) {
+			struct iovec vec;
+			ssize_t ret;
+
+			vec.iov_base = (uint8_t *)addr + done;
+			vec.iov_len = size - done;
+			ret = shim_process_madvise(pidfd, &vec, 1, MADV_PAGEOUT, 0);
+			if (ret <= 0)
+				return -1;
+			done += (size_t)ret;
+		}
+		return 0;
+	}
+	return shim_madvise(addr, size, MADV_PAGEOUT);
+}
+
+/*
+ *  stress_swap_resident()
+ *	set vec[i] bit 0 for pages that will not fault on access. Pages
+ *	still in the swap cache while written back show as resident to
+ *	mincore() so use the pagemap present bit where possible
+ */
+static void stress_swap_resident(
+	const uint8_t *mem,
+	const size_t size,
+	const size_t page_size,
+	const int pagemap_fd,
+	unsigned char *vec)
+{
+	const size_t npages = size / page_size;
+
+	if (pagemap_fd >= 0) {
+		const off_t offset = (off_t)(((uintptr_t)mem / page_size) * sizeof(uint64_t));
+		uint64_t entries[512];
+		size_t i, j;
+
+		for (i = 0; i < npages; i += SIZEOF_ARRAY(entries)) {
+			const size_t n = STRESS_MINIMUM(npages - i, SIZEOF_ARRAY(entries));
+			const ssize_t len = (ssize_t)(n * sizeof(entries[0]));
+
+			if (pread(pagemap_fd, entries, (size_t)len,
+				  offset + (off_t)(i * sizeof(entries[0]))) != len)
+				break;
+			for (j = 0; j < n; j++)
+				vec[i + j] = (entries[j] >> 63) & 1;	/* page present */
+		}
+		if (i >= npages)
+			return;
+	}
+	if (shim_mincore((void *)mem, size, vec) < 0)
+		(void)shim_memset(vec, 0, npages);
+}
+
+/*
+ *  stress_swap_vmstat()
+ *	get system wide pages read from and written to swap devices,
+ *	pages faulted back from the swap cache are not counted
+ */
+static void stress_swap_vmstat(uint64_t *pswpin, uint64_t *pswpout)
+{
+	FILE *fp;
+	char buffer[128];
+
+	*pswpin = 0;
+	*pswpout = 0;
+	fp = fopen("/proc/vmstat", "r");
+	if (!fp)
+		return;
+	while (fgets(buffer, sizeof(buffer), fp)) {
+		if (!strncmp(buffer, "pswpin ", 7))
+			*pswpin = (uint64_t)strtoull(buffer + 7, NULL, 10);
+		else if (!strncmp(buffer, "pswpout ", 8))
+			*pswpout = (uint64_t)strtoull(buffer + 8, NULL, 10);
+	}
+	(void)fclose(fp);
+}
+
+/*
+ *  stress_swap_throughput_child()
+ *	fill memory with data of a given compressibility, force it
+ *	out to swap and fault it back in, measuring the swap out and
+ *	swap in rates and fault-in latencies
+ */
+static int stress_swap_throughput_child(stress_args_t *args, void *context)
+{
+	static const double percentiles[] = { 50.0, 99.0, 99.9 };
+	const size_t page_size = args->page_size;
+	size_t swap_bytes = DEFAULT_SWAP_BYTES, npages, i, size;
+	size_t shmall, freemem, totalmem, freeswap, totalswap;
+	uint32_t swap_compress = 50;
+	int swap_pageout = SWAP_PAGEOUT_MADVISE, pidfd = -1, fd = -1, pagemap_fd, ret, rc = EXIT_SUCCESS;
+	uint64_t pages_out = 0, pages_resident = 0, pages_in = 0;
+	uint64_t pswpin_begin, pswpout_begin, pswpin_end, pswpout_end;
+	double t_out = 0.0, t_in = 0.0;
+	stress_swap_latency_t *latency;
+	char filename[PATH_MAX];
+	unsigned char *vec;
+	uint8_t *mem, *page;
+
+	(void)context;
+
+	(void)stress_get_setting("swap-bytes", &swap_bytes);
+	(void)stress_get_setting("swap-compress", &swap_compress);
+	(void)stress_get_setting("swap-pageout", &swap_pageout);
+
+	swap_bytes /= args->num_instances;
+	if (swap_bytes < MIN_SWAP_BYTES)
+		swap_bytes = MIN_SWAP_BYTES;
+	npages = swap_bytes / page_size;
+	size = npages * page_size;
+	*filename = '\0';
+
+	vec = (unsigned char *)calloc(npages, sizeof(*vec));
+	latency = (stress_swap_latency_t *)calloc(1, sizeof(*latency));
+	page = (uint8_t *)calloc(1, page_size);
+	if (!vec || !latency || !page) {
+		pr_inf_skip("%s: cannot allocate page status arrays, skipping stressor\n",
+			args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_free;
+	}
+
+	/*
+	 *  Use the system's swap (and hence its zswap/zram setup) if
+	 *  there is enough of it, otherwise add a swap file for the run
+	 */
+	stress_get_memlimits(&shmall, &freemem, &totalmem, &freeswap, &totalswap);
+	if (freeswap < size) {
+		const uint32_t swap_pages = (uint32_t)STRESS_MINIMUM(npages + 1, UINT32_MAX);
+
+		ret = stress_temp_dir_mk_args(args);
+		if (ret < 0) {
+			rc = stress_exit_status(-ret);
+			goto tidy_free;
+		}
+		(void)stress_temp_filename_args(args,
+			filename, sizeof(filename), stress_mwc32());
+		fd = open(filename, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+		if (fd < 0) {
+			rc = stress_exit_status(errno);
+			pr_fail("%s: open swap file %s failed, errno=%d (%s)\n",
+				args->name, filename, errno, strerror(errno));
+			goto tidy_rm;
+		}
+		stress_swap_nocow(fd);
+		ret = stress_swap_zero(args, fd, swap_pages, page);
+		if ((ret < 0) || ((uint32_t)ret < swap_pages)) {
+			rc = (ret < 0) ? EXIT_FAILURE : EXIT_NO_RESOURCE;
+			goto tidy_close;
+		}
+		if (stress_swap_set_size(args, fd, swap_pages, SWAP_HDR_SANE) < 0) {
+			rc = EXIT_FAILURE;
+			goto tidy_close;
+		}
+		(void)fsync(fd);
+		if (swapon(filename, 0) < 0) {
+			pr_inf_skip("%s: cannot enable swap file on the filesystem '%s', "
+				"errno=%d (%s), skipping stressor\n",
+				args->name, stress_get_fs_type(filename), errno, strerror(errno));
+			rc = EXIT_NO_RESOURCE;
+			goto tidy_close;
+		}
+	}
+
+	if (swap_pageout == SWAP_PAGEOUT_PROCESS_MADVISE) {
+		pidfd = shim_pidfd_open(getpid(), 0);
+		if (pidfd < 0) {
+			if (args->instance == 0)
+				pr_inf("%s: pidfd_open failed, errno=%d (%s), using madvise instead\n",
+					args->name, errno, strerror(errno));
+		} else if (shim_process_madvise(pidfd, NULL, 0, MADV_PAGEOUT, 0) < 0 &&
+			   (errno == ENOSYS)) {
+			if (args->instance == 0)
+				pr_inf("%s: process_madvise not available, using madvise instead\n",
+					args->name);
+			(void)close(pidfd);
+			pidfd = -1;
+		}
+	}
+
+	mem = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (mem == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu bytes, errno=%d (%s), skipping stressor\n",
+			args->name, size, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_swapoff;
+	}
+	pagemap_fd = open("/proc/self/pagemap", O_RDONLY);
+	/* huge pages are split on swap out, keep to base pages */
+	(void)shim_madvise((void *)mem, size, MADV_NOHUGEPAGE);
+	for (i = 0; i < npages; i++)
+		stress_swap_fill_page(mem + (i * page_size), page_size, i, swap_compress);
+
+	stress_swap_vmstat(&pswpin_begin, &pswpout_begin);
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		double t;
+
+		t = stress_time_now();
+		ret = stress_swap_pageout((void *)mem, size, pidfd);
+		t_out += stress_time_now() - t;
+		if (ret < 0) {
+			if ((errno == EINVAL) || (errno == ENOSYS)) {
+				/* MADV_PAGEOUT needs Linux 5.4, process_madvise 5.10 */
+				pr_inf_skip("%s: %s MADV_PAGEOUT is not supported, "
+					"skipping stressor\n", args->name,
+					(pidfd >= 0) ? "process_madvise" : "madvise");
+				rc = EXIT_NOT_IMPLEMENTED;
+				break;
+			}
+			pr_fail("%s: %s MADV_PAGEOUT failed, errno=%d (%s)\n",
+				args->name, (pidfd >= 0) ? "process_madvise" : "madvise",
+				errno, strerror(errno));
+			rc = EXIT_FAILURE;
+			break;
+		}
+		stress_swap_resident(mem, size, page_size, pagemap_fd, vec);
+
+		t = stress_time_now();
+		for (i = 0; i < npages; i++) {
+			const uint64_t *ptr = (const uint64_t *)(mem + (i * page_size));
+			uint64_t val;
+
+			if (vec[i] & 1) {
+				val = *(volatile const uint64_t *)ptr;
+				pages_resident++;
+			} else {
+				const uint64_t t1 = stress_time_now_ns();
+				uint64_t n;
+
+				val = *(volatile const uint64_t *)ptr;
+				n = latency->faults++;
+				if (n < SWAP_LATENCY_SAMPLES) {
+					latency->latencies[n] = (double)(stress_time_now_ns() - t1);
+				} else {
+					const uint64_t j = stress_mwc64modn(n + 1);
+
+					if (j < SWAP_LATENCY_SAMPLES)
+						latency->latencies[j] = (double)(stress_time_now_ns() - t1);
+				}
+				pages_out++;
+			}
+			if (UNLIKELY(val != (SWAP_STAMP ^ (uint64_t)i))) {
+				pr_fail("%s: page %zu contains 0x%" PRIx64 " after swap in, expected 0x%" PRIx64 "\n",
+					args->name, i, val, (uint64_t)(SWAP_STAMP ^ (uint64_t)i));
+				rc = EXIT_FAILURE;
+			}
+		}
+		t_in += stress_time_now() - t;
+		pages_in = latency->faults;
+		stress_bogo_inc(args);
+	} while ((rc == EXIT_SUCCESS) && stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	if (rc == EXIT_NOT_IMPLEMENTED)
+		goto tidy_munmap;
+	stress_swap_vmstat(&pswpin_end, &pswpout_end);
+
+	if (args->instance == 0) {
+		const uint64_t total = pages_out + pages_resident;
+
+		pr_inf("%s: %" PRIu64 " of %" PRIu64 " (%.2f%%) pages were swapped out, "
+			"%" PRIu32 "%% compressible data, paged out with %s\n",
+			args->name, pages_out, total,
+			total ? (100.0 * (double)pages_out) / (double)total : 0.0,
+			swap_compress, (pidfd >= 0) ? "process_madvise" : "madvise");
+		pr_inf("%s: system wide %" PRIu64 " pages written to and %" PRIu64
+			" pages read from swap devices, other swap ins were from the swap cache\n",
+			args->name, pswpout_end - pswpout_begin, pswpin_end - pswpin_begin);
+	}
+	stress_metrics_set(args, 0, "pages swapped out per sec",
+		t_out > 0.0 ? (double)pages_out / t_out : 0.0, STRESS_HARMONIC_MEAN);
+	stress_metrics_set(args, 1, "pages swapped in per sec",
+		t_in > 0.0 ? (double)pages_in / t_in : 0.0, STRESS_HARMONIC_MEAN);
+	stress_metrics_set(args, 2, "swap device pages written per sec",
+		(t_out + t_in) > 0.0 ? (double)(pswpout_end - pswpout_begin) / (t_out + t_in) : 0.0,
+		STRESS_HARMONIC_MEAN);
+	stress_metrics_set(args, 3, "swap device pages read per sec",
+		(t_out + t_in) > 0.0 ? (double)(pswpin_end - pswpin_begin) / (t_out + t_in) : 0.0,
+		STRESS_HARMONIC_MEAN);
+	if (latency->faults) {
+		const size_t n = (size_t)STRESS_MINIMUM(latency->faults, SWAP_LATENCY_SAMPLES);
+
+		qsort(latency->latencies, n, sizeof(*latency->latencies), stress_metrics_cmp_double);
+		for (i = 0; i < SIZEOF_ARRAY(percentiles); i++) {
+			const size_t idx = (size_t)((percentiles[i] / 100.0) * (double)(n - 1));
+			char str[40];
+
+			(void)snprintf(str, sizeof(str), "nanosecs p%g swap in latency", percentiles[i]);
+			stress_metrics_set(args, 4 + i, str, latency->latencies[idx],
+				STRESS_GEOMETRIC_MEAN);
+		}
+	}
+
+tidy_munmap:
+	if (pagemap_fd >= 0)
+		(void)close(pagemap_fd);
+	(void)munmap((void *)mem, size);
+tidy_swapoff:
+	if (pidfd >= 0)
+		(void)close(pidfd);
+	if (fd >= 0)
+		(void)stress_swapoff(filename);
+tidy_close:
+	if (fd >= 0)
+		(void)close(fd);
+tidy_rm:
+	if (*filename) {
+		(void)shim_unlink(filename);
+		(void)stress_temp_dir_rm_args(args);
+	}
+tidy_free:
+	free(page);
+	free(latency);
+	free(vec);
+
+	return rc;
+}
+#endif
+
 static int stress_swap(stress_args_t *args)
 {
 	int ret;
+	bool swap_throughput = false;
+
+	(void)stress_get_setting("swap-throughput", &swap_throughput);
+	if (swap_throughput) {
+#if defined(MADV_PAGEOUT)
+		ret = stress_oomable_child(args, NULL, stress_swap_throughput_child, STRESS_OOMABLE_NORMAL);
+		stress_swap_clean_dir(args);
+		return ret;
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --swap-throughput requires MADV_PAGEOUT, ignoring option\n",
+				args->name);
+#endif
+	}
 
 	ret = stress_oomable_child(args, NULL, stress_swap_child, STRESS_OOMABLE_NORMAL);
 	stress_swap_clean_dir(args);
@@ -478,6 +938,7 @@ stressor_info_t stress_swap_info = {
 	.stressor = stress_swap,
 	.supported = stress_swap_supported,
 	.class = CLASS_VM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help
 };
@@ -485,6 +946,7 @@ stressor_info_t stress_swap_info = {
 stressor_info_t stress_swap_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_VM | CLASS_OS,
+	.opt_set_funcs = opt_set_funcs,
 	.verify = VERIFY_ALWAYS,
 	.help = help,
 	.unimplemented_reason = "built without sys/swap.h or swap() system call"
@@ -20,18 +20,32 @@
 #include "stress-ng.h"
 #include "core-builtin.h"
 #include "core-cpu-cache.h"
+#include "core-interrupts.h"
 #include "core-killpid.h"
+#include "core-mmap.h"
 #include "core-out-of-memory.h"
 #include "core-pragma.h"
+#include "core-pthread.h"
 
 #include <sched.h>
 
 static const stress_help_t help[] = {
 	{ NULL,	"tlb-shootdown N",	"start N workers that force TLB shootdowns" },
+	{ NULL,	"tlb-shootdown-measure", "measure munmap, mprotect and madvise cost versus CPUs sharing the mm" },
 	{ NULL,	"tlb-shootdown-ops N",	"stop after N TLB shootdown bogo ops" },
 	{ NULL,	NULL,			NULL }
 };
 
+static int stress_set_tlb_shootdown_measure(const char *opt)
+{
+	return stress_set_setting_true("tlb-shootdown-measure", opt);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_tlb_shootdown_measure,	stress_set_tlb_shootdown_measure },
+	{ 0,				NULL }
+};
+
 #if defined(HAVE_SCHED_GETAFFINITY) && 	\
     defined(HAVE_MPROTECT)
 
@@ -141,6 +155,321 @@ static void *stress_tlb_shootdown_mmap(
 	return mem;
 }
 
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_SCHED_SETAFFINITY)
+
+#define TLB_MEASURE_OPS		(3)	/* munmap, mprotect, madvise */
+#define TLB_MEASURE_ITERATIONS	(64)	/* timed calls per op per CPU count */
+#define TLB_MEASURE_PAGES	(64)	/* pages per timed call */
+#define TLB_MEASURE_MAX_COUNTS	(64)	/* maximum CPU counts in the sweep */
+
+/* cumulative cost of an op for a given number of CPUs sharing the mm */
+typedef struct {
+	uint64_t calls;			/* timed calls */
+	double duration;		/* total time of timed calls */
+	uint64_t ipis;			/* TLB shootdown interrupts */
+} stress_tlb_measure_t;
+
+/* CPU pinned thread keeping the mm active on a CPU */
+typedef struct {
+	volatile bool *stop;		/* stop the thread */
+	volatile int32_t *active;	/* number of CPUs that should be busy */
+	int32_t index;			/* CPU index, 0 is the measuring thread */
+	int32_t cpu;			/* CPU to run on */
+	uint8_t *mem;			/* memory to keep touching */
+	size_t size;
+	pthread_t pthread;
+	int ret;
+} stress_tlb_thread_t;
+
+static const char * const tlb_measure_ops[TLB_MEASURE_OPS] = {
+	"munmap", "mprotect", "madvise",
+};
+
+static void *nowt = NULL;
+
+/*
+ *  stress_tlb_measure_thread()
+ *	keep the mm active on a CPU by touching memory while
+ *	this CPU is one of the active CPUs, otherwise idle
+ */
+static void *stress_tlb_measure_thread(void *arg)
+{
+	stress_tlb_thread_t *thread = (stress_tlb_thread_t *)arg;
+	cpu_set_t mask;
+
+	CPU_ZERO(&mask);
+	CPU_SET(thread->cpu, &mask);
+	(void)sched_setaffinity(0, sizeof(mask), &mask);
+
+	while (!*thread->stop) {
+		if (thread->index < *thread->active) {
+			volatile uint8_t *ptr;
+
+			for (ptr = thread->mem; ptr < thread->mem + thread->size; ptr += STRESS_CACHE_LINE_SIZE)
+				(*ptr)++;
+		} else {
+			(void)shim_usleep(10000);
+		}
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_tlb_measure_tlb_ipis()
+ *	TLB shootdown interrupts so far, 0 if not available
+ */
+static inline uint64_t stress_tlb_measure_tlb_ipis(void)
+{
+	uint64_t count;
+
+	return (stress_interrupts_type_count("TLB:", &count) < 0) ? 0 : count;
+}
+
+/*
+ *  stress_tlb_measure_op()
+ *	time TLB_MEASURE_ITERATIONS calls of an op on a region
+ *	that has been touched to populate the TLB
+ */
+static int stress_tlb_measure_op(
+	stress_args_t *args,
+	const int op,
+	stress_tlb_measure_t *measure)
+{
+	const size_t size = args->page_size * TLB_MEASURE_PAGES;
+	uint8_t *mem = MAP_FAILED;
+	uint64_t ipis;
+	int i, ret;
+
+	ipis = stress_tlb_measure_tlb_ipis();
+	for (i = 0; i < TLB_MEASURE_ITERATIONS; i++) {
+		double t;
+
+		if (mem == MAP_FAILED) {
+			mem = (uint8_t *)mmap(NULL, size, PROT_READ | PROT_WRITE,
+					MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (mem == MAP_FAILED) {
+				pr_inf_skip("%s: mmap failed, errno=%d (%s), skipping stressor\n",
+					args->name, errno, strerror(errno));
+				return -1;
+			}
+		}
+		stress_tlb_shootdown_write_mem(mem, size, args->page_size);
+
+		switch (op) {
+		case 0:
+			t = stress_time_now();
+			ret = munmap((void *)mem, size);
+			t = stress_time_now() - t;
+			mem = MAP_FAILED;
+			break;
+		case 1:
+			t = stress_time_now();
+			ret = mprotect((void *)mem, size, PROT_READ);
+			t = stress_time_now() - t;
+			(void)mprotect((void *)mem, size, PROT_READ | PROT_WRITE);
+			break;
+		default:
+#if defined(HAVE_MADVISE) &&	\
+    defined(MADV_DONTNEED)
+			t = stress_time_now();
+			ret = madvise((void *)mem, size, MADV_DONTNEED);
+			t = stress_time_now() - t;
+#else
+			t = 0.0;
+			ret = 0;
+#endif
+			break;
+		}
+		if (UNLIKELY(ret < 0)) {
+			pr_fail("%s: %s failed, errno=%d (%s)\n",
+				args->name, tlb_measure_ops[op], errno, strerror(errno));
+			if (mem != MAP_FAILED)
+				(void)munmap((void *)mem, size);
+			return -1;
+		}
+		measure->duration += t;
+		measure->calls++;
+	}
+	measure->ipis += stress_tlb_measure_tlb_ipis() - ipis;
+	if (mem != MAP_FAILED)
+		(void)munmap((void *)mem, size);
+	stress_bogo_add(args, TLB_MEASURE_ITERATIONS);
+	return 0;
+}
+
+/*
+ *  stress_tlb_shootdown_measure()
+ *	measure the cost of munmap, mprotect and madvise and the
+ *	TLB shootdown interrupts they cause as a function of the
+ *	number of CPUs that have the mm active
+ */
+static int stress_tlb_shootdown_measure(stress_args_t *args)
+{
+	const size_t thread_mem_size = args->page_size * 16;
+	const int32_t max_cpus = stress_get_processors_configured();
+	stress_tlb_thread_t *threads;
+	stress_tlb_measure_t *measures;
+	int32_t *cpus, counts[TLB_MEASURE_MAX_COUNTS];
+	volatile bool stop = false;
+	volatile int32_t active = 0;
+	cpu_set_t mask, initial_mask;
+	int32_t i, n_cpus = 0, n_counts = 0, c;
+	uint8_t *thread_mem;
+	uint64_t ipis;
+	int rc = EXIT_SUCCESS, op;
+	bool has_ipis;
+
+	if (sched_getaffinity(0, sizeof(initial_mask), &initial_mask) < 0) {
+		pr_fail("%s: sched_getaffinity could not get CPU affinity, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return EXIT_FAILURE;
+	}
+	has_ipis = (stress_interrupts_type_count("TLB:", &ipis) == 0);
+
+	cpus = (int32_t *)calloc((size_t)max_cpus, sizeof(*cpus));
+	threads = (stress_tlb_thread_t *)calloc((size_t)max_cpus, sizeof(*threads));
+	measures = (stress_tlb_measure_t *)calloc(TLB_MEASURE_MAX_COUNTS * TLB_MEASURE_OPS, sizeof(*measures));
+	if (!cpus || !threads || !measures) {
+		pr_inf_skip("%s: cannot allocate measurement arrays, skipping stressor\n",
+			args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto free_arrays;
+	}
+	for (i = 0; (i < max_cpus) && (i < CPU_SETSIZE); i++) {
+		if (CPU_ISSET(i, &initial_mask))
+			cpus[n_cpus++] = i;
+	}
+	if (n_cpus < 1) {
+		pr_inf_skip("%s: no usable CPUs, skipping stressor\n", args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto free_arrays;
+	}
+
+	/* every CPU count up to 8, then doubling, then all CPUs */
+	for (c = 1; (c <= n_cpus) && (n_counts < TLB_MEASURE_MAX_COUNTS - 1); c = (c < 8) ? c + 1 : c * 2)
+		counts[n_counts++] = c;
+	if (counts[n_counts - 1] != n_cpus)
+		counts[n_counts++] = n_cpus;
+
+	thread_mem = (uint8_t *)stress_mmap_populate(NULL, thread_mem_size * (size_t)n_cpus,
+			PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (thread_mem == MAP_FAILED) {
+		pr_inf_skip("%s: mmap failed, errno=%d (%s), skipping stressor\n",
+			args->name, errno, strerror(errno));
+		rc = EXIT_NO_RESOURCE;
+		goto free_arrays;
+	}
+
+	/* thread 0 is this thread, it does the measuring on the first CPU */
+	CPU_ZERO(&mask);
+	CPU_SET(cpus[0], &mask);
+	(void)sched_setaffinity(0, sizeof(mask), &mask);
+	for (i = 1; i < n_cpus; i++) {
+		threads[i].stop = &stop;
+		threads[i].active = &active;
+		threads[i].index = i;
+		threads[i].cpu = cpus[i];
+		threads[i].mem = thread_mem + (thread_mem_size * (size_t)i);
+		threads[i].size = thread_mem_size;
+		threads[i].ret = pthread_create(&threads[i].pthread, NULL,
+					stress_tlb_measure_thread, (void *)&threads[i]);
+	}
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (c = 0; (c < n_counts) && stress_continue(args); c++) {
+			active = counts[c];
+			/* let the other CPUs get busy in the mm */
+			(void)shim_usleep(20000);
+			for (op = 0; op < TLB_MEASURE_OPS; op++) {
+				if (stress_tlb_measure_op(args, op, &measures[(c * TLB_MEASURE_OPS) + op]) < 0) {
+					rc = EXIT_FAILURE;
+					goto stop_threads;
+				}
+			}
+		}
+		active = 0;
+	} while (stress_continue(args));
+
+stop_threads:
+	stop = true;
+	for (i = 1; i < n_cpus; i++) {
+		if (threads[i].ret == 0)
+			(void)pthread_join(threads[i].pthread, NULL);
+	}
+	(void)sched_setaffinity(0, sizeof(initial_mask), &initial_mask);
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (rc == EXIT_SUCCESS) {
+		int32_t ends[2];
+		size_t idx = 0, e;
+
+		if (args->instance == 0) {
+			pr_block_begin();
+			pr_inf("%s: cost per call of %d pages with N CPUs active in the mm%s:\n",
+				args->name, TLB_MEASURE_PAGES,
+				has_ipis ? "" : " (no TLB shootdown interrupt counts available)");
+			pr_inf("%s: %5s %14s %14s %14s %9s %9s %9s\n", args->name, "CPUs",
+				"munmap ns", "mprotect ns", "madvise ns",
+				"munmap", "mprotect", "madvise");
+			pr_inf("%s: %5s %14s %14s %14s %9s %9s %9s\n", args->name, "",
+				"", "", "", "IPIs", "IPIs", "IPIs");
+			for (c = 0; c < n_counts; c++) {
+				const stress_tlb_measure_t *m = &measures[c * TLB_MEASURE_OPS];
+				double ns[TLB_MEASURE_OPS], ipi[TLB_MEASURE_OPS];
+
+				if (!m[0].calls)
+					break;
+				for (op = 0; op < TLB_MEASURE_OPS; op++) {
+					ns[op] = m[op].calls ? (m[op].duration * STRESS_DBL_NANOSECOND) / (double)m[op].calls : 0.0;
+					ipi[op] = m[op].calls ? (double)m[op].ipis / (double)m[op].calls : 0.0;
+				}
+				pr_inf("%s: %5" PRId32 " %14.1f %14.1f %14.1f %9.2f %9.2f %9.2f\n",
+					args->name, counts[c], ns[0], ns[1], ns[2],
+					ipi[0], ipi[1], ipi[2]);
+			}
+			pr_block_end();
+		}
+
+		/* metrics for the ends of the curve, 1 CPU and all CPUs */
+		ends[0] = 0;
+		ends[1] = n_counts - 1;
+		for (e = 0; e < SIZEOF_ARRAY(ends); e++) {
+			const stress_tlb_measure_t *m = &measures[ends[e] * TLB_MEASURE_OPS];
+
+			if ((e > 0) && (ends[e] == ends[0]))
+				break;
+			for (op = 0; op < TLB_MEASURE_OPS; op++) {
+				char str[64];
+
+				if (!m[op].calls)
+					continue;
+				(void)snprintf(str, sizeof(str), "nanosecs per %s with %" PRId32 " CPU%s",
+					tlb_measure_ops[op], counts[ends[e]], counts[ends[e]] > 1 ? "s" : "");
+				stress_metrics_set(args, idx++, str,
+					(m[op].duration * STRESS_DBL_NANOSECOND) / (double)m[op].calls,
+					STRESS_HARMONIC_MEAN);
+				if (!has_ipis)
+					continue;
+				(void)snprintf(str, sizeof(str), "TLB shootdowns per %s with %" PRId32 " CPU%s",
+					tlb_measure_ops[op], counts[ends[e]], counts[ends[e]] > 1 ? "s" : "");
+				stress_metrics_set(args, idx++, str,
+					(double)m[op].ipis / (double)m[op].calls,
+					STRESS_HARMONIC_MEAN);
+			}
+		}
+	}
+	(void)munmap((void *)thread_mem, thread_mem_size * (size_t)n_cpus);
+free_arrays:
+	free(measures);
+	free(threads);
+	free(cpus);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_tlb_shootdown()
  *	stress out TLB shootdowns
@@ -165,6 +494,19 @@ static int stress_tlb_shootdown(stress_args_t *args)
 	const size_t mmapfd_size = page_size * 4;
 	char filename[PATH_MAX];
 #endif
+	bool tlb_shootdown_measure = false;
+
+	(void)stress_get_setting("tlb-shootdown-measure", &tlb_shootdown_measure);
+	if (tlb_shootdown_measure) {
+#if defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_SCHED_SETAFFINITY)
+		return stress_tlb_shootdown_measure(args);
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --tlb-shootdown-measure requires pthreads and sched_setaffinity(), ignoring option\n",
+				args->name);
+#endif
+	}
 
 #if defined(HAVE_MADVISE) &&	\
     defined(MADV_DONTNEED)
@@ -356,12 +698,14 @@ err_rmdir:
 stressor_info_t stress_tlb_shootdown_info = {
 	.stressor = stress_tlb_shootdown,
 	.class = CLASS_OS | CLASS_MEMORY,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help
 };
 #else
 stressor_info_t stress_tlb_shootdown_info = {
 	.stressor = stress_unimplemented,
 	.class = CLASS_OS | CLASS_MEMORY,
+	.opt_set_funcs = opt_set_funcs,
 	.help = help,
 	.unimplemented_reason = "built without sched_getaffinity() or mprotect() system calls"
 };
@@ -23,6 +23,7 @@
 #include "core-cpu.h"
 #include "core-killpid.h"
 #include "core-net.h"
+#include "core-pthread.h"
 
 #if defined(HAVE_LINUX_SOCKIOS_H)
 #include <linux/sockios.h>
@@ -50,6 +51,13 @@ UNEXPECTED
 
 #define UDP_BUF			(1024)	/* UDP I/O buffer size */
 
+#define MIN_UDP_BATCH		(1)
+#define MAX_UDP_BATCH		(256)
+#define MIN_UDP_SOCKETS		(1)
+#define MAX_UDP_SOCKETS		(64)
+#define MIN_UDP_BUF_SIZE	(4 * KB)
+#define MAX_UDP_BUF_SIZE	(1 * GB)
+
 /* See bugs section of udplite(7) */
 #if !defined(SOL_UDPLITE)
 #define SOL_UDPLITE		(136)
@@ -60,15 +68,30 @@ UNEXPECTED
 #if !defined(UDPLITE_RECV_CSCOV)
 #define UDPLITE_RECV_CSCOV	(11)
 #endif
+#if !defined(SOL_UDP)
+#define SOL_UDP			(17)
+#endif
+
+#if defined(__linux__) &&		\
+    defined(HAVE_LIB_PTHREAD) &&	\
+    defined(HAVE_SENDMMSG) &&		\
+    defined(HAVE_RECVMMSG)
+#define STRESS_UDP_BENCH	(1)
+#endif
 
 static const stress_help_t help[] = {
 	{ NULL,	"udp N",	"start N workers performing UDP send/receives " },
+	{ NULL,	"udp-batch N",	"sweep sendmmsg/recvmmsg batch sizes up to N and report packet rates" },
 	{ NULL,	"udp-domain D",	"specify domain, default is ipv4" },
 	{ NULL, "udp-gro",	"enable UDP-GRO" },
+	{ NULL, "udp-gso",	"send UDP_SEGMENT GSO super-packets with --udp-batch" },
 	{ NULL,	"udp-if I",	"use network interface I, e.g. lo, eth0, etc." },
 	{ NULL,	"udp-lite",	"use the UDP-Lite (RFC 3828) protocol" },
 	{ NULL,	"udp-ops N",	"stop after N udp bogo operations" },
 	{ NULL,	"udp-port P",	"use ports P to P + number of workers - 1" },
+	{ NULL,	"udp-rcvbuf N",	"set SO_RCVBUF to N bytes with --udp-batch" },
+	{ NULL,	"udp-sndbuf N",	"set SO_SNDBUF to N bytes with --udp-batch" },
+	{ NULL,	"udp-sockets N","use N pinned socket pairs with --udp-batch" },
 	{ NULL,	NULL,		NULL }
 };
 
@@ -110,6 +133,51 @@ static int stress_set_udp_if(const char *name)
 	return stress_set_setting("udp-if", TYPE_ID_STR, name);
 }
 
+static int stress_set_udp_batch(const char *opt)
+{
+	uint32_t udp_batch;
+
+	udp_batch = stress_get_uint32(opt);
+	stress_check_range("udp-batch", (uint64_t)udp_batch,
+		MIN_UDP_BATCH, MAX_UDP_BATCH);
+	return stress_set_setting("udp-batch", TYPE_ID_UINT32, &udp_batch);
+}
+
+static int stress_set_udp_gso(const char *opt)
+{
+	return stress_set_setting_true("udp-gso", opt);
+}
+
+static int stress_set_udp_sockets(const char *opt)
+{
+	uint32_t udp_sockets;
+
+	udp_sockets = stress_get_uint32(opt);
+	stress_check_range("udp-sockets", (uint64_t)udp_sockets,
+		MIN_UDP_SOCKETS, MAX_UDP_SOCKETS);
+	return stress_set_setting("udp-sockets", TYPE_ID_UINT32, &udp_sockets);
+}
+
+static int stress_set_udp_rcvbuf(const char *opt)
+{
+	uint64_t udp_rcvbuf;
+
+	udp_rcvbuf = stress_get_uint64_byte(opt);
+	stress_check_range_bytes("udp-rcvbuf", udp_rcvbuf,
+		MIN_UDP_BUF_SIZE, MAX_UDP_BUF_SIZE);
+	return stress_set_setting("udp-rcvbuf", TYPE_ID_UINT64, &udp_rcvbuf);
+}
+
+static int stress_set_udp_sndbuf(const char *opt)
+{
+	uint64_t udp_sndbuf;
+
+	udp_sndbuf = stress_get_uint64_byte(opt);
+	stress_check_range_bytes("udp-sndbuf", udp_sndbuf,
+		MIN_UDP_BUF_SIZE, MAX_UDP_BUF_SIZE);
+	return stress_set_setting("udp-sndbuf", TYPE_ID_UINT64, &udp_sndbuf);
+}
+
 static int OPTIMIZE3 stress_udp_client(
 	stress_args_t *args,
 	const pid_t mypid,
@@ -441,6 +509,573 @@ die:
 	return rc;
 }
 
+#if defined(STRESS_UDP_BENCH)
+
+#define UDP_BENCH_MAX_GSO_SEGS	(64)		/* kernel UDP_MAX_SEGMENTS */
+#define UDP_BENCH_MAX_PAYLOAD	(65000)		/* maximum GSO send size */
+#define UDP_BENCH_GRO_BUF	(65536)		/* GRO receive buffer size */
+#define UDP_BENCH_PHASE		(1.0)		/* default secs per sweep cell */
+#define UDP_BENCH_MAGIC		(0x55445042U)	/* start of each segment */
+
+/* segment (datagram payload) sizes to sweep, 1472 fills a 1500 byte MTU */
+static const size_t udp_bench_seg_sizes[] = {
+	64, 512, 1200, 1472
+};
+
+typedef struct stress_udp_bench stress_udp_bench_t;
+
+/* a receiving and sending socket pair, each serviced by a pinned thread */
+typedef struct {
+	pthread_t rx_pthread;		/* receiver thread */
+	pthread_t tx_pthread;		/* sender thread */
+	int rx_ret;			/* receiver pthread_create return */
+	int tx_ret;			/* sender pthread_create return */
+	int rx_fd;			/* receiving socket */
+	int tx_fd;			/* sending socket */
+	int rx_cpu;			/* receiver CPU, -1 = not pinned */
+	int tx_cpu;			/* sender CPU, -1 = not pinned */
+	uint64_t rx_segs;		/* segments (datagrams) received */
+	uint64_t rx_bytes;		/* payload bytes received */
+	uint64_t rx_bad;		/* received data corrupted */
+	uint64_t tx_segs;		/* segments (datagrams) sent */
+	int rx_err;			/* receiver errno */
+	int tx_err;			/* sender errno */
+	stress_udp_bench_t *bench;	/* benchmark state */
+} stress_udp_bench_sock_t;
+
+struct stress_udp_bench {
+	volatile bool stop;		/* stop all threads */
+	size_t batch;			/* sendmmsg/recvmmsg batch size */
+	size_t seg_size;		/* segment size */
+	size_t segs;			/* segments per send */
+	bool gso;			/* send with UDP_SEGMENT */
+	bool gro;			/* receive with UDP_GRO */
+};
+
+/*
+ *  stress_udp_bench_pin()
+ *	pin the calling thread to a CPU
+ */
+static void stress_udp_bench_pin(const int cpu)
+{
+#if defined(HAVE_SCHED_SETAFFINITY)
+	cpu_set_t mask;
+
+	if (cpu < 0)
+		return;
+	CPU_ZERO(&mask);
+	CPU_SET(cpu, &mask);
+	VOID_RET(int, sched_setaffinity(0, sizeof(mask), &mask));
+#else
+	(void)cpu;
+#endif
+}
+
+/*
+ *  stress_udp_bench_sender()
+ *	send batches of datagrams with sendmmsg, with GSO each datagram
+ *	is a super-packet that is segmented into segs datagrams
+ */
+static void *stress_udp_bench_sender(void *arg)
+{
+	static void *nowt = NULL;
+	stress_udp_bench_sock_t *sock = (stress_udp_bench_sock_t *)arg;
+	const stress_udp_bench_t *bench = sock->bench;
+	const size_t len = bench->seg_size * bench->segs;
+	struct mmsghdr *msgs;
+	struct iovec iov;
+	char *buf;
+	size_t i;
+#if defined(UDP_SEGMENT)
+	char ALIGN64 control[CMSG_SPACE(sizeof(uint16_t))];
+#endif
+
+	stress_udp_bench_pin(sock->tx_cpu);
+
+	msgs = (struct mmsghdr *)calloc(bench->batch, sizeof(*msgs));
+	buf = (char *)malloc(len);
+	if (!msgs || !buf) {
+		sock->tx_err = ENOMEM;
+		goto free_bufs;
+	}
+	(void)shim_memset(buf, stress_mwc8(), len);
+	for (i = 0; i < len; i += bench->seg_size) {
+		const uint32_t magic = UDP_BENCH_MAGIC;
+
+		(void)memcpy(buf + i, &magic, sizeof(magic));
+	}
+	iov.iov_base = buf;
+	iov.iov_len = len;
+
+	/* every message sends the same buffer */
+	for (i = 0; i < bench->batch; i++) {
+		msgs[i].msg_hdr.msg_iov = &iov;
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+#if defined(UDP_SEGMENT)
+	if (bench->gso) {
+		struct cmsghdr *cmsg;
+		const uint16_t gso_size = (uint16_t)bench->seg_size;
+
+		(void)shim_memset(control, 0, sizeof(control));
+		cmsg = (struct cmsghdr *)(void *)control;
+		cmsg->cmsg_level = SOL_UDP;
+		cmsg->cmsg_type = UDP_SEGMENT;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(gso_size));
+		(void)memcpy(CMSG_DATA(cmsg), &gso_size, sizeof(gso_size));
+		for (i = 0; i < bench->batch; i++) {
+			msgs[i].msg_hdr.msg_control = control;
+			msgs[i].msg_hdr.msg_controllen = sizeof(control);
+		}
+	}
+#endif
+
+	while (!bench->stop && stress_continue_flag()) {
+		const int n = sendmmsg(sock->tx_fd, msgs, (unsigned int)bench->batch, 0);
+
+		if (UNLIKELY(n < 0)) {
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR) ||
+			    (errno == ENOBUFS) || (errno == ECONNREFUSED)) {
+				(void)shim_sched_yield();
+				continue;
+			}
+			sock->tx_err = errno;
+			break;
+		}
+		sock->tx_segs += (uint64_t)n * bench->segs;
+	}
+
+free_bufs:
+	free(buf);
+	free(msgs);
+	return &nowt;
+}
+
+/*
+ *  stress_udp_bench_receiver()
+ *	receive batches of datagrams with recvmmsg, with GRO the kernel
+ *	may coalesce segments into one datagram and reports the segment
+ *	size in a UDP_GRO control message
+ */
+static void *stress_udp_bench_receiver(void *arg)
+{
+	static void *nowt = NULL;
+	stress_udp_bench_sock_t *sock = (stress_udp_bench_sock_t *)arg;
+	const stress_udp_bench_t *bench = sock->bench;
+	const size_t buf_len = bench->gro ? UDP_BENCH_GRO_BUF : bench->seg_size;
+	const size_t control_len = CMSG_SPACE(sizeof(int));
+	struct mmsghdr *msgs;
+	struct iovec *iovs;
+	char *bufs, *controls;
+	size_t i;
+
+	stress_udp_bench_pin(sock->rx_cpu);
+
+	msgs = (struct mmsghdr *)calloc(bench->batch, sizeof(*msgs));
+	iovs = (struct iovec *)calloc(bench->batch, sizeof(*iovs));
+	bufs = (char *)malloc(bench->batch * buf_len);
+	controls = (char *)calloc(bench->batch, control_len);
+	if (!msgs || !iovs || !bufs || !controls) {
+		sock->rx_err = ENOMEM;
+		goto free_bufs;
+	}
+	for (i = 0; i < bench->batch; i++) {
+		iovs[i].iov_base = bufs + (i * buf_len);
+		iovs[i].iov_len = buf_len;
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	while (!bench->stop && stress_continue_flag()) {
+		int j, n;
+
+		if (bench->gro) {
+			for (i = 0; i < bench->batch; i++) {
+				msgs[i].msg_hdr.msg_control = controls + (i * control_len);
+				msgs[i].msg_hdr.msg_controllen = control_len;
+			}
+		}
+		/*
+		 *  woken by a shutdown at the stop, the receive timeout
+		 *  is a backstop should the shutdown not wake us
+		 */
+		n = recvmmsg(sock->rx_fd, msgs, (unsigned int)bench->batch, 0, NULL);
+		if (UNLIKELY(n < 0)) {
+			if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR))
+				continue;
+			sock->rx_err = errno;
+			break;
+		}
+		for (j = 0; j < n; j++) {
+			const size_t len = (size_t)msgs[j].msg_len;
+			size_t seg_size = len;
+			uint32_t magic;
+#if defined(UDP_GRO)
+			const struct cmsghdr *cmsg;
+
+			for (cmsg = CMSG_FIRSTHDR(&msgs[j].msg_hdr); cmsg;
+			     cmsg = CMSG_NXTHDR(&msgs[j].msg_hdr, (struct cmsghdr *)cmsg)) {
+				if ((cmsg->cmsg_level == SOL_UDP) && (cmsg->cmsg_type == UDP_GRO)) {
+					int gso_size;
+
+					(void)memcpy(&gso_size, CMSG_DATA(cmsg), sizeof(gso_size));
+					if (gso_size > 0)
+						seg_size = (size_t)gso_size;
+				}
+			}
+#endif
+			if (UNLIKELY(len < sizeof(magic)))
+				continue;
+			(void)memcpy(&magic, iovs[j].iov_base, sizeof(magic));
+			if (UNLIKELY(magic != UDP_BENCH_MAGIC))
+				sock->rx_bad++;
+			sock->rx_segs += (seg_size > 0) ? (len + seg_size - 1) / seg_size : 1;
+			sock->rx_bytes += len;
+		}
+	}
+
+free_bufs:
+	free(controls);
+	free(bufs);
+	free(iovs);
+	free(msgs);
+	return &nowt;
+}
+
+/*
+ *  stress_udp_bench_socket()
+ *	create a UDP socket with optional buffer sizing
+ */
+static int stress_udp_bench_socket(
+	const int udp_domain,
+	const int udp_proto,
+	const int buf_opt,
+	const int buf_size)
+{
+	int fd;
+
+	fd = socket(udp_domain, SOCK_DGRAM, udp_proto);
+	if (fd < 0)
+		return -1;
+	if (buf_size > 0)
+		VOID_RET(int, setsockopt(fd, SOL_SOCKET, buf_opt, &buf_size, sizeof(buf_size)));
+	return fd;
+}
+
+/*
+ *  stress_udp_bench()
+ *	sweep sendmmsg/recvmmsg batch sizes and segment sizes over
+ *	udp_sockets socket pairs, each pair serviced by pinned sender
+ *	and receiver threads, and report packet and bit rates
+ */
+static int stress_udp_bench(
+	stress_args_t *args,
+	const pid_t mypid,
+	const int udp_domain,
+	const int udp_proto,
+	const int udp_port,
+	const bool udp_gro,
+	const char *udp_if,
+	const uint32_t udp_batch,
+	const bool udp_gso,
+	const uint32_t udp_sockets,
+	const uint64_t udp_rcvbuf,
+	const uint64_t udp_sndbuf)
+{
+	stress_udp_bench_t bench;
+	stress_udp_bench_sock_t *socks;
+	size_t batches[8], n_batches = 0, b, s, i;
+	double rx_segs[SIZEOF_ARRAY(udp_bench_seg_sizes)][8];
+	double rx_bytes[SIZEOF_ARRAY(udp_bench_seg_sizes)][8];
+	double durations[SIZEOF_ARRAY(udp_bench_seg_sizes)][8];
+	double tx_segs[SIZEOF_ARRAY(udp_bench_seg_sizes)][8];
+	double phase = UDP_BENCH_PHASE;
+	struct sockaddr_storage addr;
+	struct sockaddr *sa = NULL;
+	socklen_t addr_len = 0;
+	int cpus[128], n_cpus = 0, rc = EXIT_SUCCESS, rcvbuf = 0, sndbuf = 0;
+	size_t n_socks = (size_t)udp_sockets, metrics_idx = 0, n_cells, cell = 0;
+	uint64_t total_segs = 0;
+	bool gso = udp_gso;
+
+#if !defined(UDP_SEGMENT)
+	if (gso) {
+		if (args->instance == 0)
+			pr_inf("%s: UDP_SEGMENT not supported, disabling --udp-gso\n", args->name);
+		gso = false;
+	}
+#endif
+#if defined(IPPROTO_UDPLITE)
+	if (gso && (udp_proto == IPPROTO_UDPLITE)) {
+		if (args->instance == 0)
+			pr_inf("%s: GSO is not available for UDP-Lite, disabling --udp-gso\n", args->name);
+		gso = false;
+	}
+#endif
+#if !defined(SO_REUSEPORT)
+	if (n_socks > 1) {
+		if (args->instance == 0)
+			pr_inf("%s: SO_REUSEPORT not supported, using 1 socket\n", args->name);
+		n_socks = 1;
+	}
+#endif
+
+	/* batch sizes 1, 4, 16 .. up to and including udp_batch */
+	for (b = 1; (b < udp_batch) && (n_batches < SIZEOF_ARRAY(batches) - 1); b <<= 2)
+		batches[n_batches++] = b;
+	batches[n_batches++] = udp_batch;
+
+	if (stress_set_sockaddr_if(args->name, args->instance, mypid,
+			udp_domain, udp_port, udp_if, &sa, &addr_len, NET_ADDR_LOOPBACK) < 0)
+		return EXIT_NO_RESOURCE;
+	(void)memcpy(&addr, sa, addr_len);
+
+	/* pin socket pairs round robin over the CPUs we are allowed to use */
+#if defined(HAVE_SCHED_GETAFFINITY)
+	{
+		cpu_set_t mask;
+
+		if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+			int cpu;
+
+			for (cpu = 0; (cpu < CPU_SETSIZE) && (n_cpus < (int)SIZEOF_ARRAY(cpus)); cpu++) {
+				if (CPU_ISSET(cpu, &mask))
+					cpus[n_cpus++] = cpu;
+			}
+		}
+	}
+#endif
+
+	socks = (stress_udp_bench_sock_t *)calloc(n_socks, sizeof(*socks));
+	if (!socks) {
+		pr_inf_skip("%s: cannot allocate socket state, skipping stressor\n", args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	for (i = 0; i < n_socks; i++) {
+		socks[i].rx_fd = -1;
+		socks[i].tx_fd = -1;
+	}
+	(void)shim_memset(&bench, 0, sizeof(bench));
+	bench.gso = gso;
+	bench.gro = udp_gro;
+	(void)shim_memset(rx_segs, 0, sizeof(rx_segs));
+	(void)shim_memset(rx_bytes, 0, sizeof(rx_bytes));
+	(void)shim_memset(tx_segs, 0, sizeof(tx_segs));
+	(void)shim_memset(durations, 0, sizeof(durations));
+
+	n_cells = SIZEOF_ARRAY(udp_bench_seg_sizes) * n_batches;
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (s = 0; (s < SIZEOF_ARRAY(udp_bench_seg_sizes)) && stress_continue(args); s++) {
+			for (b = 0; (b < n_batches) && stress_continue(args); b++) {
+				size_t rx_started = 0, tx_started = 0;
+				double t_start, t;
+				int err = 0;
+
+				/*
+				 *  share the time left between the combinations left so
+				 *  set up and tear down overruns do not starve the last
+				 */
+				if (g_opt_timeout > 0)
+					phase = (args->time_end - stress_time_now()) /
+						(double)(n_cells - (cell % n_cells));
+				cell++;
+
+				bench.stop = false;
+				bench.batch = batches[b];
+				bench.seg_size = udp_bench_seg_sizes[s];
+				bench.segs = gso ? STRESS_MINIMUM((size_t)UDP_BENCH_MAX_GSO_SEGS,
+					UDP_BENCH_MAX_PAYLOAD / bench.seg_size) : 1;
+
+				for (i = 0; i < n_socks; i++) {
+					stress_udp_bench_sock_t *sock = &socks[i];
+					struct timeval tv;
+					int one = 1;
+
+					(void)shim_memset(sock, 0, sizeof(*sock));
+					sock->bench = &bench;
+					sock->rx_cpu = n_cpus ? cpus[(2 * i) % (size_t)n_cpus] : -1;
+					sock->tx_cpu = n_cpus ? cpus[((2 * i) + 1) % (size_t)n_cpus] : -1;
+					sock->tx_fd = -1;
+					sock->rx_fd = stress_udp_bench_socket(udp_domain, udp_proto,
+						SO_RCVBUF, (int)udp_rcvbuf);
+					if (sock->rx_fd < 0) {
+						err = errno;
+						break;
+					}
+					(void)setsockopt(sock->rx_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+#if defined(SO_REUSEPORT)
+					(void)setsockopt(sock->rx_fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+#endif
+#if defined(UDP_GRO)
+					if (udp_gro)
+						(void)setsockopt(sock->rx_fd, SOL_UDP, UDP_GRO, &one, sizeof(one));
+#endif
+					tv.tv_sec = 0;
+					tv.tv_usec = 100000;
+					(void)setsockopt(sock->rx_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+					if (bind(sock->rx_fd, (struct sockaddr *)&addr, addr_len) < 0) {
+						err = errno;
+						break;
+					}
+					sock->tx_fd = stress_udp_bench_socket(udp_domain, udp_proto,
+						SO_SNDBUF, (int)udp_sndbuf);
+					if (sock->tx_fd < 0) {
+						err = errno;
+						break;
+					}
+					if (connect(sock->tx_fd, (struct sockaddr *)&addr, addr_len) < 0) {
+						err = errno;
+						break;
+					}
+				}
+				if (err) {
+					pr_inf_skip("%s: cannot set up UDP sockets, errno=%d (%s), skipping stressor\n",
+						args->name, err, strerror(err));
+					rc = EXIT_NO_RESOURCE;
+					goto close_socks;
+				}
+				if ((s == 0) && (b == 0) && (args->instance == 0)) {
+					socklen_t len = sizeof(rcvbuf);
+
+					(void)getsockopt(socks[0].rx_fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, &len);
+					len = sizeof(sndbuf);
+					(void)getsockopt(socks[0].tx_fd, SOL_SOCKET, SO_SNDBUF, &sndbuf, &len);
+					pr_inf("%s: %zu socket pair%s, GSO %s, GRO %s, SO_RCVBUF %d, SO_SNDBUF %d, "
+						"%.2f secs per batch and segment size\n", args->name,
+						n_socks, (n_socks > 1) ? "s" : "", gso ? "on" : "off",
+						udp_gro ? "on" : "off", rcvbuf, sndbuf, phase);
+				}
+
+				/* receivers first so no datagrams are refused */
+				for (i = 0; i < n_socks; i++) {
+					socks[i].rx_ret = pthread_create(&socks[i].rx_pthread, NULL,
+						stress_udp_bench_receiver, (void *)&socks[i]);
+					if (socks[i].rx_ret != 0)
+						break;
+					rx_started++;
+				}
+				for (i = 0; (rx_started == n_socks) && (i < n_socks); i++) {
+					socks[i].tx_ret = pthread_create(&socks[i].tx_pthread, NULL,
+						stress_udp_bench_sender, (void *)&socks[i]);
+					if (socks[i].tx_ret != 0)
+						break;
+					tx_started++;
+				}
+				t_start = stress_time_now();
+				if (tx_started == n_socks) {
+					const double t_end = t_start + phase;
+
+					while (stress_continue(args) && (stress_time_now() < t_end))
+						(void)shim_usleep(10000);
+				}
+				t = stress_time_now() - t_start;
+				bench.stop = true;
+				for (i = 0; i < tx_started; i++)
+					(void)pthread_join(socks[i].tx_pthread, NULL);
+				/* wake receivers blocked in recvmmsg, they then see the stop flag */
+				for (i = 0; i < rx_started; i++)
+					(void)shutdown(socks[i].rx_fd, SHUT_RD);
+				for (i = 0; i < rx_started; i++)
+					(void)pthread_join(socks[i].rx_pthread, NULL);
+
+				if ((rx_started < n_socks) || (tx_started < n_socks)) {
+					pr_inf_skip("%s: cannot create sender and receiver threads, skipping stressor\n",
+						args->name);
+					rc = EXIT_NO_RESOURCE;
+					goto close_socks;
+				}
+				for (i = 0; i < n_socks; i++) {
+					const stress_udp_bench_sock_t *sock = &socks[i];
+
+					err = sock->tx_err ? sock->tx_err : sock->rx_err;
+					if (err) {
+						if (gso && ((err == EINVAL) || (err == EIO))) {
+							pr_inf_skip("%s: UDP_SEGMENT send failed, errno=%d (%s), "
+								"skipping stressor\n", args->name, err, strerror(err));
+							rc = EXIT_NOT_IMPLEMENTED;
+						} else {
+							pr_fail("%s: UDP %s failed, errno=%d (%s)\n", args->name,
+								sock->tx_err ? "sendmmsg" : "recvmmsg", err, strerror(err));
+							rc = EXIT_FAILURE;
+						}
+						goto close_socks;
+					}
+					if (sock->rx_bad) {
+						pr_fail("%s: %" PRIu64 " received datagrams contained unexpected data\n",
+							args->name, sock->rx_bad);
+						rc = EXIT_FAILURE;
+						goto close_socks;
+					}
+					rx_segs[s][b] += (double)sock->rx_segs;
+					rx_bytes[s][b] += (double)sock->rx_bytes;
+					tx_segs[s][b] += (double)sock->tx_segs;
+					total_segs += sock->rx_segs;
+				}
+				durations[s][b] += t;
+				stress_bogo_set(args, total_segs);
+
+				for (i = 0; i < n_socks; i++) {
+					(void)close(socks[i].rx_fd);
+					(void)close(socks[i].tx_fd);
+					socks[i].rx_fd = -1;
+					socks[i].tx_fd = -1;
+				}
+			}
+		}
+	} while (stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if (args->instance == 0) {
+		pr_block_begin();
+		pr_inf("%s: received Mpps, Gbit/s and %% datagrams delivered by segment size and batch size\n",
+			args->name);
+		for (s = 0; s < SIZEOF_ARRAY(udp_bench_seg_sizes); s++) {
+			for (b = 0; b < n_batches; b++) {
+				const double d = durations[s][b];
+
+				if (d <= 0.0)
+					continue;
+				pr_inf("%s: seg %4zu batch %4zu %9.3f Mpps %8.3f Gbit/s %7.2f%%\n",
+					args->name, udp_bench_seg_sizes[s], batches[b],
+					rx_segs[s][b] / d / 1.0E6, rx_bytes[s][b] * 8.0 / d / 1.0E9,
+					(tx_segs[s][b] > 0.0) ? 100.0 * rx_segs[s][b] / tx_segs[s][b] : 0.0);
+			}
+		}
+		pr_block_end();
+	}
+	for (s = 0; s < SIZEOF_ARRAY(udp_bench_seg_sizes); s++) {
+		for (b = 0; b < n_batches; b++) {
+			const double d = durations[s][b];
+			char desc[64];
+
+			if (d <= 0.0)
+				continue;
+			(void)snprintf(desc, sizeof(desc), "Mpps seg %zu batch %zu",
+				udp_bench_seg_sizes[s], batches[b]);
+			stress_metrics_set(args, metrics_idx++, desc,
+				rx_segs[s][b] / d / 1.0E6, STRESS_HARMONIC_MEAN);
+			(void)snprintf(desc, sizeof(desc), "Gbit/s seg %zu batch %zu",
+				udp_bench_seg_sizes[s], batches[b]);
+			stress_metrics_set(args, metrics_idx++, desc,
+				rx_bytes[s][b] * 8.0 / d / 1.0E9, STRESS_HARMONIC_MEAN);
+		}
+	}
+
+close_socks:
+	for (i = 0; i < n_socks; i++) {
+		if (socks[i].rx_fd >= 0)
+			(void)close(socks[i].rx_fd);
+		if (socks[i].tx_fd >= 0)
+			(void)close(socks[i].tx_fd);
+	}
+	free(socks);
+
+	return rc;
+}
+#endif
+
 /*
  *  stress_udp
  *	stress by heavy udp ops
@@ -455,8 +1090,10 @@ static int stress_udp(stress_args_t *args)
 #if defined(IPPROTO_UDPLITE)
 	bool udp_lite = false;
 #endif
-	bool udp_gro = false;
+	bool udp_gro = false, udp_gso = false;
 	char *udp_if = NULL;
+	uint32_t udp_batch = 0, udp_sockets = 1;
+	uint64_t udp_rcvbuf = 0, udp_sndbuf = 0;
 
 	if (stress_sigchld_set_handler(args) < 0)
 		return EXIT_NO_RESOURCE;
@@ -464,6 +1101,11 @@ static int stress_udp(stress_args_t *args)
 	(void)stress_get_setting("udp-if", &udp_if);
 	(void)stress_get_setting("udp-port", &udp_port);
 	(void)stress_get_setting("udp-domain", &udp_domain);
+	(void)stress_get_setting("udp-batch", &udp_batch);
+	(void)stress_get_setting("udp-gso", &udp_gso);
+	(void)stress_get_setting("udp-sockets", &udp_sockets);
+	(void)stress_get_setting("udp-rcvbuf", &udp_rcvbuf);
+	(void)stress_get_setting("udp-sndbuf", &udp_sndbuf);
 #if defined(IPPROTO_UDPLITE)
 	(void)stress_get_setting("udp-lite", &udp_lite);
 
@@ -505,6 +1147,19 @@ static int stress_udp(stress_args_t *args)
 		}
 	}
 
+	if (udp_batch > 0) {
+#if defined(STRESS_UDP_BENCH)
+		rc = stress_udp_bench(args, mypid, udp_domain, udp_proto, udp_port, udp_gro,
+			udp_if, udp_batch, udp_gso, udp_sockets, udp_rcvbuf, udp_sndbuf);
+		stress_net_release_ports(udp_port, udp_port);
+		return rc;
+#else
+		if (args->instance == 0)
+			pr_inf("%s: pthreads, sendmmsg or recvmmsg not supported, "
+				"ignoring --udp-batch option\n", args->name);
+#endif
+	}
+
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 again:
 	parent_cpu = stress_get_cpu();
@@ -537,6 +1192,11 @@ static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_udp_lite,		stress_set_udp_lite },
 	{ OPT_udp_gro,		stress_set_udp_gro },
 	{ OPT_udp_if,		stress_set_udp_if },
+	{ OPT_udp_batch,	stress_set_udp_batch },
+	{ OPT_udp_gso,		stress_set_udp_gso },
+	{ OPT_udp_sockets,	stress_set_udp_sockets },
+	{ OPT_udp_rcvbuf,	stress_set_udp_rcvbuf },
+	{ OPT_udp_sndbuf,	stress_set_udp_sndbuf },
 	{ 0,			NULL }
 };
 
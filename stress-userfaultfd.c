@@ -21,6 +21,7 @@
 #include "core-builtin.h"
 #include "core-killpid.h"
 #include "core-out-of-memory.h"
+#include "core-pthread.h"
 
 #include <sched.h>
 
@@ -42,8 +43,37 @@ UNEXPECTED
 #define MAX_USERFAULT_BYTES	(MAX_MEM_LIMIT)
 #define DEFAULT_USERFAULT_BYTES	(256 * MB)
 
+#define MAX_USERFAULT_THREADS	(64)
+#define MAX_USERFAULT_BATCH	(512)
+#define DEFAULT_USERFAULT_BATCH	(16)
+
+#define USERFAULT_MODE_MISSING	(0)	/* UFFDIO_COPY a page per fault */
+#define USERFAULT_MODE_BATCH	(1)	/* UFFDIO_COPY a range per fault */
+#define USERFAULT_MODE_CONTINUE	(2)	/* UFFDIO_CONTINUE shmem minor faults */
+#define USERFAULT_MODE_WP	(3)	/* write-protect tracking */
+#define USERFAULT_MODE_MAX	(4)
+#define USERFAULT_MODE_ALL	(USERFAULT_MODE_MAX)
+
+typedef struct {
+	const char *name;	/* mode name */
+	const int mode;		/* USERFAULT_MODE_* */
+} stress_userfaultfd_mode_t;
+
+static const stress_userfaultfd_mode_t userfaultfd_modes[] = {
+	{ "missing",	USERFAULT_MODE_MISSING },
+	{ "copy-batch",	USERFAULT_MODE_BATCH },
+	{ "continue",	USERFAULT_MODE_CONTINUE },
+	{ "wp",		USERFAULT_MODE_WP },
+	{ "all",	USERFAULT_MODE_ALL },
+};
+
 static const stress_help_t help[] = {
 	{ NULL,	"userfaultfd N",	"start N page faulting workers with userspace handling" },
+	{ NULL,	"userfaultfd-batch N",	"number of pages to copy per fault in copy-batch mode" },
+	{ NULL,	"userfaultfd-bytes N",	"size of mmap'd region to page fault on" },
+	{ NULL,	"userfaultfd-fault-threads N", "number of faulting threads" },
+	{ NULL,	"userfaultfd-handler-threads N", "number of fault handling threads" },
+	{ NULL,	"userfaultfd-mode M",	"fault service mode: missing, copy-batch, continue, wp or all" },
 	{ NULL,	"userfaultfd-ops N",	"stop after N page faults have been handled" },
 	{ NULL,	NULL,			NULL }
 };
@@ -77,9 +107,61 @@ static int stress_set_userfaultfd_bytes(const char *opt)
 	return stress_set_setting("userfaultfd-bytes", TYPE_ID_SIZE_T, &userfaultfd_bytes);
 }
 
+static int stress_set_userfaultfd_batch(const char *opt)
+{
+	size_t userfaultfd_batch;
+
+	userfaultfd_batch = (size_t)stress_get_uint64(opt);
+	stress_check_range("userfaultfd-batch", userfaultfd_batch,
+		1, MAX_USERFAULT_BATCH);
+	return stress_set_setting("userfaultfd-batch", TYPE_ID_SIZE_T, &userfaultfd_batch);
+}
+
+static int stress_set_userfaultfd_fault_threads(const char *opt)
+{
+	size_t userfaultfd_fault_threads;
+
+	userfaultfd_fault_threads = (size_t)stress_get_uint64(opt);
+	stress_check_range("userfaultfd-fault-threads", userfaultfd_fault_threads,
+		1, MAX_USERFAULT_THREADS);
+	return stress_set_setting("userfaultfd-fault-threads", TYPE_ID_SIZE_T, &userfaultfd_fault_threads);
+}
+
+static int stress_set_userfaultfd_handler_threads(const char *opt)
+{
+	size_t userfaultfd_handler_threads;
+
+	userfaultfd_handler_threads = (size_t)stress_get_uint64(opt);
+	stress_check_range("userfaultfd-handler-threads", userfaultfd_handler_threads,
+		1, MAX_USERFAULT_THREADS);
+	return stress_set_setting("userfaultfd-handler-threads", TYPE_ID_SIZE_T, &userfaultfd_handler_threads);
+}
+
+static int stress_set_userfaultfd_mode(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(userfaultfd_modes); i++) {
+		if (!strcmp(userfaultfd_modes[i].name, opt)) {
+			int mode = userfaultfd_modes[i].mode;
+
+			return stress_set_setting("userfaultfd-mode", TYPE_ID_INT, &mode);
+		}
+	}
+	(void)fprintf(stderr, "userfaultfd-mode must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(userfaultfd_modes); i++)
+		(void)fprintf(stderr, " %s", userfaultfd_modes[i].name);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
-	{ OPT_userfaultfd_bytes,	stress_set_userfaultfd_bytes },
-	{ 0,				NULL }
+	{ OPT_userfaultfd_batch,		stress_set_userfaultfd_batch },
+	{ OPT_userfaultfd_bytes,		stress_set_userfaultfd_bytes },
+	{ OPT_userfaultfd_fault_threads,	stress_set_userfaultfd_fault_threads },
+	{ OPT_userfaultfd_handler_threads,	stress_set_userfaultfd_handler_threads },
+	{ OPT_userfaultfd_mode,			stress_set_userfaultfd_mode },
+	{ 0,					NULL }
 };
 
 #if defined(HAVE_USERFAULTFD) && 		\
@@ -237,6 +319,688 @@ static inline int handle_page_fault(
 	return 0;
 }
 
+#if defined(HAVE_LIB_PTHREAD)
+
+#if !defined(UFFD_FEATURE_WP_UNPOPULATED)
+#define UFFD_FEATURE_WP_UNPOPULATED	(1 << 13)
+#endif
+
+#if defined(UFFDIO_CONTINUE) &&			\
+    defined(UFFDIO_REGISTER_MODE_MINOR) &&	\
+    defined(UFFD_FEATURE_MINOR_SHMEM) &&	\
+    defined(HAVE_MEMFD_CREATE)
+#define HAVE_USERFAULTFD_CONTINUE
+#endif
+
+#if defined(UFFDIO_WRITEPROTECT) &&		\
+    defined(UFFDIO_REGISTER_MODE_WP) &&		\
+    defined(UFFD_FEATURE_PAGEFAULT_FLAG_WP)
+#define HAVE_USERFAULTFD_WP
+#endif
+
+#define USERFAULT_LATENCY_SAMPLES	(4096)
+#define USERFAULT_UNSUPPORTED		(-2)
+
+/* per faulting thread, per mode fault statistics */
+typedef struct {
+	uint64_t faults;		/* timed faults */
+	double duration;		/* total nanosecs spent faulting */
+	double latencies[USERFAULT_LATENCY_SAMPLES]; /* reservoir of fault latencies */
+} stress_userfaultfd_stats_t;
+
+/* state shared by the faulting and fault handling threads of a mode phase */
+typedef struct {
+	stress_args_t *args;
+	int fd;				/* userfaultfd */
+	int mode;			/* USERFAULT_MODE_* */
+	uint8_t *data;			/* registered region */
+	uint8_t *dirty;			/* wp mode per page dirty tracking */
+	const uint8_t *src;		/* UFFDIO_COPY source pages */
+	size_t sz;			/* size of region */
+	size_t slice_sz;		/* size of region per faulting thread */
+	size_t batch;			/* pages per UFFDIO_COPY in copy-batch mode */
+	uint64_t max_faults;		/* faults per faulting thread, 0 = no limit */
+	bool wp_unpopulated;		/* UFFD_FEATURE_WP_UNPOPULATED available */
+	volatile bool stop;		/* tell handlers to stop */
+	volatile bool failed;		/* a thread failed */
+} stress_userfaultfd_shared_t;
+
+typedef struct {
+	stress_userfaultfd_shared_t *shared;
+	stress_userfaultfd_stats_t *stats; /* faulting thread statistics */
+	uint64_t serviced;		/* faults serviced by a handler thread */
+	size_t index;			/* thread index */
+	pthread_t pthread;
+	int ret;			/* pthread_create return */
+} stress_userfaultfd_thread_t;
+
+static void *nowt = NULL;
+
+/*
+ *  stress_userfaultfd_stats_add()
+ *	account for a fault, keep a reservoir of fault
+ *	latencies in nanosecs for the percentile metrics
+ */
+static inline void stress_userfaultfd_stats_add(
+	stress_userfaultfd_stats_t *stats,
+	const double latency)
+{
+	const uint64_t n = stats->faults++;
+
+	stats->duration += latency;
+	if (n < USERFAULT_LATENCY_SAMPLES) {
+		stats->latencies[n] = latency;
+	} else {
+		const uint64_t j = stress_mwc64modn(n + 1);
+
+		if (j < USERFAULT_LATENCY_SAMPLES)
+			stats->latencies[j] = latency;
+	}
+}
+
+/*
+ *  stress_userfaultfd_service()
+ *	resolve a fault at page aligned address addr
+ */
+static int stress_userfaultfd_service(
+	stress_userfaultfd_shared_t *shared,
+	uint8_t *addr,
+	const uint64_t flags)
+{
+	stress_args_t *args = shared->args;
+	const size_t page_size = args->page_size;
+
+	if (UNLIKELY((addr < shared->data) || (addr >= shared->data + shared->sz))) {
+		pr_fail("%s: page fault address is out of range\n", args->name);
+		return -1;
+	}
+
+	switch (shared->mode) {
+	case USERFAULT_MODE_MISSING:
+	case USERFAULT_MODE_BATCH: {
+		struct uffdio_copy copy;
+		size_t len = page_size;
+
+		if (shared->mode == USERFAULT_MODE_BATCH) {
+			/* copy up to batch pages, but not beyond the faulting slice */
+			const size_t offset = (size_t)(addr - shared->data);
+			size_t end = ((offset / shared->slice_sz) + 1) * shared->slice_sz;
+
+			if (end > shared->sz)
+				end = shared->sz;
+			len = STRESS_MINIMUM(shared->batch * page_size, end - offset);
+		}
+		copy.copy = 0;
+		copy.mode = 0;
+		copy.dst = (unsigned long)addr;
+		copy.src = (unsigned long)shared->src;
+		copy.len = len;
+		if (ioctl(shared->fd, UFFDIO_COPY, &copy) < 0) {
+			/* already resolved by a racing handler, just wake */
+			if ((errno == EEXIST) || (errno == EAGAIN))
+				break;
+			pr_fail("%s: page fault ioctl UFFDIO_COPY failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			return -1;
+		}
+		return 0;
+	}
+#if defined(HAVE_USERFAULTFD_CONTINUE)
+	case USERFAULT_MODE_CONTINUE: {
+		struct uffdio_continue cont;
+
+		(void)shim_memset(&cont, 0, sizeof(cont));
+		cont.range.start = (unsigned long)addr;
+		cont.range.len = page_size;
+		cont.mode = 0;
+		if (ioctl(shared->fd, UFFDIO_CONTINUE, &cont) < 0) {
+			if ((errno == EEXIST) || (errno == EAGAIN))
+				break;
+			pr_fail("%s: page fault ioctl UFFDIO_CONTINUE failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			return -1;
+		}
+		return 0;
+	}
+#endif
+#if defined(HAVE_USERFAULTFD_WP)
+	case USERFAULT_MODE_WP: {
+		struct uffdio_writeprotect wp;
+
+		if (UNLIKELY(!(flags & UFFD_PAGEFAULT_FLAG_WP))) {
+			pr_fail("%s: msg event not a write-protect page fault event\n",
+				args->name);
+			return -1;
+		}
+		/* track the page as dirty and let the write proceed */
+		shared->dirty[(size_t)(addr - shared->data) / page_size] = 1;
+		wp.range.start = (unsigned long)addr;
+		wp.range.len = page_size;
+		wp.mode = 0;
+		if (ioctl(shared->fd, UFFDIO_WRITEPROTECT, &wp) < 0) {
+			pr_fail("%s: page fault ioctl UFFDIO_WRITEPROTECT failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			return -1;
+		}
+		return 0;
+	}
+#endif
+	default:
+		break;
+	}
+	(void)flags;
+
+	{
+		struct uffdio_range wake;
+
+		wake.start = (unsigned long)addr;
+		wake.len = page_size;
+		VOID_RET(int, ioctl(shared->fd, UFFDIO_WAKE, &wake));
+	}
+	return 0;
+}
+
+/*
+ *  stress_userfaultfd_handler()
+ *	fault handling thread, many of these may read
+ *	fault events from the same userfaultfd
+ */
+static void *stress_userfaultfd_handler(void *arg)
+{
+	stress_userfaultfd_thread_t *thread = (stress_userfaultfd_thread_t *)arg;
+	stress_userfaultfd_shared_t *shared = thread->shared;
+	stress_args_t *args = shared->args;
+	const uintptr_t page_mask = ~(uintptr_t)(args->page_size - 1);
+
+	while (!shared->stop) {
+		struct pollfd fds[1];
+		struct uffd_msg msg;
+		ssize_t ret;
+
+		fds[0].fd = shared->fd;
+		fds[0].events = POLLIN;
+		fds[0].revents = 0;
+		ret = poll(fds, 1, 100);
+		if (ret <= 0)
+			continue;
+
+		/* non-blocking, another handler may have taken the event */
+		ret = read(shared->fd, &msg, sizeof(msg));
+		if (ret < (ssize_t)sizeof(msg))
+			continue;
+		if (msg.event != UFFD_EVENT_PAGEFAULT)
+			continue;
+		if (stress_userfaultfd_service(shared,
+				(uint8_t *)(uintptr_t)(msg.arg.pagefault.address & page_mask),
+				msg.arg.pagefault.flags) < 0) {
+			/* keep servicing, faulting threads stop on failure */
+			shared->failed = true;
+			continue;
+		}
+		thread->serviced++;
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_userfaultfd_faulter()
+ *	faulting thread, reset and then touch each page of
+ *	its slice of the region, timing each fault round trip
+ */
+static void *stress_userfaultfd_faulter(void *arg)
+{
+	stress_userfaultfd_thread_t *thread = (stress_userfaultfd_thread_t *)arg;
+	stress_userfaultfd_shared_t *shared = thread->shared;
+	stress_args_t *args = shared->args;
+	const size_t page_size = args->page_size;
+	const size_t offset = thread->index * shared->slice_sz;
+	const size_t len = STRESS_MINIMUM(shared->slice_sz, shared->sz - offset);
+	const size_t pages = len / page_size;
+	const size_t stride = (shared->mode == USERFAULT_MODE_BATCH) ? shared->batch : 1;
+	uint8_t *slice = shared->data + offset;
+	uint64_t faults = 0;
+	const uint8_t check = (shared->mode == USERFAULT_MODE_CONTINUE) ? 0xa5 : 0x5a;
+	size_t i;
+
+	if (!len)
+		return &nowt;
+
+	/* reset the slice so the next touches fault */
+	switch (shared->mode) {
+#if defined(HAVE_USERFAULTFD_WP)
+	case USERFAULT_MODE_WP: {
+		struct uffdio_writeprotect wp;
+
+		if (shared->wp_unpopulated)
+			(void)shim_madvise(slice, len, MADV_DONTNEED);
+		(void)shim_memset(shared->dirty + (offset / page_size), 0, pages);
+		wp.range.start = (unsigned long)slice;
+		wp.range.len = len;
+		wp.mode = UFFDIO_WRITEPROTECT_MODE_WP;
+		if (ioctl(shared->fd, UFFDIO_WRITEPROTECT, &wp) < 0) {
+			pr_fail("%s: ioctl UFFDIO_WRITEPROTECT failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			shared->failed = true;
+			return &nowt;
+		}
+		break;
+	}
+#endif
+	default:
+		if (shim_madvise(slice, len, MADV_DONTNEED) < 0) {
+			pr_fail("%s: madvise failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+			shared->failed = true;
+			return &nowt;
+		}
+		break;
+	}
+
+	for (i = 0; i < pages; i++) {
+		volatile uint8_t *ptr = slice + (i * page_size);
+
+		if (UNLIKELY(!stress_continue_flag() || shared->failed))
+			break;
+		if ((i % stride) == 0) {
+			uint64_t t;
+
+			if (shared->max_faults && (faults++ >= shared->max_faults))
+				break;
+			t = stress_time_now_ns();
+
+			*ptr = 0xff;
+			stress_userfaultfd_stats_add(thread->stats,
+				(double)(stress_time_now_ns() - t));
+		} else {
+			*ptr = 0xff;
+		}
+		if ((shared->mode != USERFAULT_MODE_WP) &&
+		    UNLIKELY(ptr[page_size - 1] != check)) {
+			pr_fail("%s: page %zu contains 0x%2.2x, expected 0x%2.2x\n",
+				args->name, (offset / page_size) + i, ptr[page_size - 1], check);
+			shared->failed = true;
+			break;
+		}
+	}
+
+	if (shared->mode == USERFAULT_MODE_WP) {
+		size_t j;
+
+		for (j = 0; j < i; j++) {
+			const size_t page = (offset / page_size) + j;
+
+			if (UNLIKELY(!shared->dirty[page])) {
+				pr_fail("%s: write to page %zu (offset 0x%zx) was not tracked by write-protect fault\n",
+					args->name, page, page * page_size);
+				shared->failed = true;
+				break;
+			}
+		}
+	}
+	return &nowt;
+}
+
+/*
+ *  stress_userfaultfd_api()
+ *	open a userfaultfd and enable the wanted features that
+ *	are supported, returns fd or -1 and the features enabled
+ */
+static int stress_userfaultfd_api(const uint64_t wanted, uint64_t *features)
+{
+	struct uffdio_api api;
+	int fd;
+
+	/* a userfaultfd can only be handshaken once, so probe first */
+	fd = shim_userfaultfd(0);
+	if (fd < 0)
+		return -1;
+	(void)shim_memset(&api, 0, sizeof(api));
+	api.api = UFFD_API;
+	if (ioctl(fd, UFFDIO_API, &api) < 0) {
+		(void)close(fd);
+		return -1;
+	}
+	(void)close(fd);
+
+	fd = shim_userfaultfd(0);
+	if (fd < 0)
+		return -1;
+	*features = api.features & wanted;
+	(void)shim_memset(&api, 0, sizeof(api));
+	api.api = UFFD_API;
+	api.features = *features;
+	if (ioctl(fd, UFFDIO_API, &api) < 0) {
+		(void)close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/*
+ *  stress_userfaultfd_phase()
+ *	set up a region for a mode, fault it in with the faulting
+ *	threads while the handler threads service the faults.
+ *	returns faults serviced, USERFAULT_UNSUPPORTED if the
+ *	mode is not supported and -1 on failure
+ */
+static int64_t stress_userfaultfd_phase(
+	stress_args_t *args,
+	const int mode,
+	const size_t sz,
+	const size_t batch,
+	const uint8_t *src,
+	stress_userfaultfd_thread_t *faulters,
+	const size_t n_faulters,
+	stress_userfaultfd_thread_t *handlers,
+	const size_t n_handlers,
+	double *duration)
+{
+	const size_t page_size = args->page_size;
+	stress_userfaultfd_shared_t shared;
+	struct uffdio_register reg;
+	uint64_t wanted = 0, features = 0, serviced = 0;
+	uint8_t *fill = MAP_FAILED;
+	int memfd = -1;
+	int64_t ret = -1;
+	size_t i;
+	double t;
+
+	(void)shim_memset(&shared, 0, sizeof(shared));
+	shared.args = args;
+	shared.mode = mode;
+	shared.sz = sz;
+	shared.batch = batch;
+	shared.src = src;
+	shared.slice_sz = ((sz / n_faulters) + page_size - 1) & ~(page_size - 1);
+	if (args->max_ops) {
+		const uint64_t done = stress_bogo_get(args);
+		const uint64_t left = (args->max_ops > done) ? args->max_ops - done : 1;
+
+		shared.max_faults = (left + n_faulters - 1) / n_faulters;
+	}
+	shared.data = MAP_FAILED;
+
+	(void)shim_memset(&reg, 0, sizeof(reg));
+	switch (mode) {
+#if defined(HAVE_USERFAULTFD_CONTINUE)
+	case USERFAULT_MODE_CONTINUE:
+		wanted = UFFD_FEATURE_MINOR_SHMEM;
+		reg.mode = UFFDIO_REGISTER_MODE_MINOR;
+		break;
+#endif
+#if defined(HAVE_USERFAULTFD_WP)
+	case USERFAULT_MODE_WP:
+		wanted = UFFD_FEATURE_PAGEFAULT_FLAG_WP | UFFD_FEATURE_WP_UNPOPULATED;
+		reg.mode = UFFDIO_REGISTER_MODE_WP;
+		break;
+#endif
+	case USERFAULT_MODE_MISSING:
+	case USERFAULT_MODE_BATCH:
+		reg.mode = UFFDIO_REGISTER_MODE_MISSING;
+		break;
+	default:
+		return USERFAULT_UNSUPPORTED;
+	}
+
+	shared.fd = stress_userfaultfd_api(wanted, &features);
+	if (shared.fd < 0) {
+		pr_fail("%s: userfaultfd setup failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		return -1;
+	}
+	/* WP_UNPOPULATED is optional, all other wanted features are required */
+	if ((features | UFFD_FEATURE_WP_UNPOPULATED) != (wanted | UFFD_FEATURE_WP_UNPOPULATED)) {
+		ret = USERFAULT_UNSUPPORTED;
+		goto close_fd;
+	}
+	shared.wp_unpopulated = !!(features & UFFD_FEATURE_WP_UNPOPULATED);
+	if (stress_set_nonblock(shared.fd) < 0)
+		goto close_fd;
+
+#if defined(HAVE_USERFAULTFD_CONTINUE)
+	if (mode == USERFAULT_MODE_CONTINUE) {
+		/*
+		 *  the page cache is populated via a second unregistered
+		 *  mapping so the registered mapping takes minor faults
+		 */
+		memfd = shim_memfd_create("stress-ng-userfaultfd", 0);
+		if (memfd < 0) {
+			ret = USERFAULT_UNSUPPORTED;
+			goto close_fd;
+		}
+		if (ftruncate(memfd, (off_t)sz) < 0) {
+			ret = USERFAULT_UNSUPPORTED;
+			goto close_fd;
+		}
+		fill = (uint8_t *)mmap(NULL, sz, PROT_READ | PROT_WRITE,
+				MAP_SHARED, memfd, 0);
+		if (fill == MAP_FAILED) {
+			ret = USERFAULT_UNSUPPORTED;
+			goto close_fd;
+		}
+		(void)shim_memset(fill, 0xa5, sz);
+		shared.data = (uint8_t *)mmap(NULL, sz, PROT_READ | PROT_WRITE,
+				MAP_SHARED, memfd, 0);
+	} else
+#endif
+	{
+		shared.data = (uint8_t *)mmap(NULL, sz, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	}
+	if (shared.data == MAP_FAILED) {
+		ret = USERFAULT_UNSUPPORTED;
+		goto unmap;
+	}
+	if (mode == USERFAULT_MODE_WP) {
+		shared.dirty = (uint8_t *)calloc(sz / page_size, sizeof(*shared.dirty));
+		if (!shared.dirty) {
+			ret = USERFAULT_UNSUPPORTED;
+			goto unmap;
+		}
+		/* without WP_UNPOPULATED only present pages can be protected */
+		if (!shared.wp_unpopulated)
+			(void)shim_memset(shared.data, 0x5a, sz);
+	}
+
+	reg.range.start = (unsigned long)shared.data;
+	reg.range.len = sz;
+	if (ioctl(shared.fd, UFFDIO_REGISTER, &reg) < 0) {
+		/* e.g. shmem minor faults or wp not supported by the kernel */
+		ret = ((errno == EINVAL) && (mode >= USERFAULT_MODE_CONTINUE)) ? USERFAULT_UNSUPPORTED : -1;
+		if (ret < 0)
+			pr_fail("%s: ioctl UFFDIO_REGISTER failed, errno=%d (%s)\n",
+				args->name, errno, strerror(errno));
+		goto unmap;
+	}
+
+	for (i = 0; i < n_handlers; i++) {
+		handlers[i].shared = &shared;
+		handlers[i].serviced = 0;
+		handlers[i].index = i;
+		handlers[i].ret = pthread_create(&handlers[i].pthread, NULL,
+					stress_userfaultfd_handler, (void *)&handlers[i]);
+	}
+	t = stress_time_now();
+	for (i = 0; i < n_faulters; i++) {
+		faulters[i].shared = &shared;
+		faulters[i].index = i;
+		faulters[i].ret = pthread_create(&faulters[i].pthread, NULL,
+					stress_userfaultfd_faulter, (void *)&faulters[i]);
+	}
+	for (i = 0; i < n_faulters; i++) {
+		if (faulters[i].ret == 0)
+			(void)pthread_join(faulters[i].pthread, NULL);
+	}
+	*duration += stress_time_now() - t;
+	shared.stop = true;
+	for (i = 0; i < n_handlers; i++) {
+		if (handlers[i].ret == 0) {
+			(void)pthread_join(handlers[i].pthread, NULL);
+			serviced += handlers[i].serviced;
+		}
+	}
+	ret = shared.failed ? -1 : (int64_t)serviced;
+
+	if (ioctl(shared.fd, UFFDIO_UNREGISTER, &reg.range) < 0) {
+		pr_fail("%s: ioctl UFFDIO_UNREGISTER failed, errno=%d (%s)\n",
+			args->name, errno, strerror(errno));
+		ret = -1;
+	}
+unmap:
+	free(shared.dirty);
+	if (shared.data != MAP_FAILED)
+		(void)munmap((void *)shared.data, sz);
+	if (fill != MAP_FAILED)
+		(void)munmap((void *)fill, sz);
+close_fd:
+	if (memfd >= 0)
+		(void)close(memfd);
+	(void)close(shared.fd);
+	return ret;
+}
+
+/*
+ *  stress_userfaultfd_threaded()
+ *	service faults from many faulting threads with many fault
+ *	handling threads, for one or all fault service modes
+ */
+static int stress_userfaultfd_threaded(stress_args_t *args, const size_t sz)
+{
+	const size_t page_size = args->page_size;
+	size_t n_faulters = 1, n_handlers = 1, batch = DEFAULT_USERFAULT_BATCH;
+	size_t i, m, metric = 0;
+	int userfaultfd_mode = USERFAULT_MODE_MISSING;
+	stress_userfaultfd_thread_t faulters[MAX_USERFAULT_THREADS];
+	stress_userfaultfd_thread_t handlers[MAX_USERFAULT_THREADS];
+	stress_userfaultfd_stats_t *stats;
+	uint64_t faults[USERFAULT_MODE_MAX];
+	double durations[USERFAULT_MODE_MAX], *latencies;
+	bool supported[USERFAULT_MODE_MAX];
+	uint8_t *src;
+	int rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("userfaultfd-fault-threads", &n_faulters);
+	(void)stress_get_setting("userfaultfd-handler-threads", &n_handlers);
+	(void)stress_get_setting("userfaultfd-batch", &batch);
+	(void)stress_get_setting("userfaultfd-mode", &userfaultfd_mode);
+
+	if (n_faulters > sz / page_size)
+		n_faulters = sz / page_size;
+
+	src = (uint8_t *)mmap(NULL, batch * page_size, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (src == MAP_FAILED) {
+		pr_inf_skip("%s: cannot mmap %zu byte copy buffer, skipping stressor\n",
+			args->name, batch * page_size);
+		return EXIT_NO_RESOURCE;
+	}
+	(void)shim_memset(src, 0x5a, batch * page_size);
+
+	stats = (stress_userfaultfd_stats_t *)calloc(USERFAULT_MODE_MAX * n_faulters, sizeof(*stats));
+	latencies = (double *)calloc(n_faulters * USERFAULT_LATENCY_SAMPLES, sizeof(*latencies));
+	if (!stats || !latencies) {
+		pr_inf_skip("%s: cannot allocate fault statistics, skipping stressor\n",
+			args->name);
+		free(latencies);
+		free(stats);
+		(void)munmap((void *)src, batch * page_size);
+		return EXIT_NO_RESOURCE;
+	}
+	for (m = 0; m < USERFAULT_MODE_MAX; m++) {
+		faults[m] = 0;
+		durations[m] = 0.0;
+		supported[m] = true;
+	}
+
+	if (args->instance == 0)
+		pr_dbg("%s: %zu faulting threads, %zu fault handling threads\n",
+			args->name, n_faulters, n_handlers);
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		bool ran = false;
+
+		for (m = 0; m < USERFAULT_MODE_MAX; m++) {
+			int64_t ret;
+
+			if ((userfaultfd_mode != USERFAULT_MODE_ALL) && (userfaultfd_mode != (int)m))
+				continue;
+			if (!supported[m])
+				continue;
+			for (i = 0; i < n_faulters; i++)
+				faulters[i].stats = &stats[(m * n_faulters) + i];
+			ret = stress_userfaultfd_phase(args, (int)m, sz, batch, src,
+				faulters, n_faulters, handlers, n_handlers, &durations[m]);
+			if (ret == USERFAULT_UNSUPPORTED) {
+				supported[m] = false;
+				if (args->instance == 0)
+					pr_inf("%s: %s mode is not supported, skipping it\n",
+						args->name, userfaultfd_modes[m].name);
+				continue;
+			}
+			if (ret < 0) {
+				rc = EXIT_FAILURE;
+				break;
+			}
+			ran = true;
+			faults[m] += (uint64_t)ret;
+			stress_bogo_add(args, (uint64_t)ret);
+			if (!stress_continue(args))
+				break;
+		}
+		if ((rc != EXIT_SUCCESS) || !ran)
+			break;
+	} while (stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+	if (args->max_ops && (stress_bogo_get(args) > args->max_ops))
+		stress_bogo_set(args, args->max_ops);
+
+	for (m = 0; m < USERFAULT_MODE_MAX; m++) {
+		static const double percentiles[] = { 50.0, 99.0, 99.9 };
+		const char *name = userfaultfd_modes[m].name;
+		size_t n = 0, p;
+		char str[64];
+
+		if (!faults[m])
+			continue;
+		for (i = 0; i < n_faulters; i++) {
+			const stress_userfaultfd_stats_t *st = &stats[(m * n_faulters) + i];
+			const size_t samples = (size_t)STRESS_MINIMUM(st->faults, USERFAULT_LATENCY_SAMPLES);
+
+			(void)shim_memcpy(latencies + n, st->latencies, samples * sizeof(*latencies));
+			n += samples;
+		}
+		(void)snprintf(str, sizeof(str), "%s faults serviced per sec", name);
+		stress_metrics_set(args, metric++, str,
+			durations[m] > 0.0 ? (double)faults[m] / durations[m] : 0.0,
+			STRESS_HARMONIC_MEAN);
+		if (!n)
+			continue;
+		qsort(latencies, n, sizeof(*latencies), stress_metrics_cmp_double);
+		for (p = 0; p < SIZEOF_ARRAY(percentiles); p++) {
+			const size_t idx = (size_t)((percentiles[p] / 100.0) * (double)(n - 1));
+
+			(void)snprintf(str, sizeof(str), "%s nanosecs p%g fault latency",
+				name, percentiles[p]);
+			stress_metrics_set(args, metric++, str, latencies[idx],
+				STRESS_GEOMETRIC_MEAN);
+		}
+	}
+
+	free(latencies);
+	free(stats);
+	(void)munmap((void *)src, batch * page_size);
+
+	if ((rc == EXIT_SUCCESS) && !metric) {
+		if (args->instance == 0)
+			pr_inf_skip("%s: no userfaultfd modes are supported, skipping stressor\n",
+				args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	return rc;
+}
+#endif
+
 /*
  *  stress_userfaultfd_oomable()
  *	stress userfaultfd system call, this
@@ -283,6 +1047,20 @@ static int stress_userfaultfd_child(stress_args_t *args, void *context)
 
 	sz = userfaultfd_bytes & ~(page_size - 1);
 
+#if defined(HAVE_LIB_PTHREAD)
+	{
+		size_t val;
+		int mode;
+
+		/* any of the threaded options selects the threaded fault service */
+		if (stress_get_setting("userfaultfd-mode", &mode) ||
+		    stress_get_setting("userfaultfd-fault-threads", &val) ||
+		    stress_get_setting("userfaultfd-handler-threads", &val) ||
+		    stress_get_setting("userfaultfd-batch", &val))
+			return stress_userfaultfd_threaded(args, sz);
+	}
+#endif
+
 	if (posix_memalign(&zero_page, page_size, page_size)) {
 		pr_err("%s: zero page allocation failed\n", args->name);
 		return EXIT_NO_RESOURCE;
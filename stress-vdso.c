@@ -490,6 +490,7 @@ static int stress_vdso(stress_args_t *args)
 	uint64_t counter;
 	int n_vdso = 0;
 	register stress_vdso_sym_t *vdso_sym;
+	stress_bogo_batch_t bb;
 
 	if (!vdso_sym_list) {
 		/* Should not fail, but worth checking to avoid breakage */
@@ -519,14 +520,16 @@ static int stress_vdso(stress_args_t *args)
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	stress_bogo_batch_init(&bb, args, STRESS_BOGO_BATCH_DEFAULT);
 	t1 = stress_time_now();
 	do {
 		for (vdso_sym = vdso_sym_list; vdso_sym; vdso_sym = vdso_sym->next) {
 			vdso_sym->func(vdso_sym->addr);
 		}
-		stress_bogo_add(args, n_vdso);
-	} while (stress_continue(args));
+		stress_bogo_batch_add(&bb, (uint64_t)n_vdso);
+	} while (stress_bogo_batch_continue(&bb));
 	t2 = stress_time_now();
+	stress_bogo_batch_flush(&bb);
 
 	counter = stress_bogo_get(args);
 
@@ -537,10 +540,11 @@ static int stress_vdso(stress_args_t *args)
 			for (vdso_sym = vdso_sym_list; vdso_sym; vdso_sym = vdso_sym->next) {
 				vdso_sym->dummy_func(vdso_sym->addr);
 			}
-			stress_bogo_add(args, n_vdso);
+			stress_bogo_batch_add(&bb, (uint64_t)n_vdso);
 		}
 		t3 = stress_time_now();
 	} while ((t3 - t2) < 0.1);
+	stress_bogo_batch_flush(&bb);
 
 	overhead_ns = (double)STRESS_NANOSECOND * ((t3 - t2) / (double)(stress_bogo_get(args) - counter));
 	stress_bogo_set(args, counter);
@@ -19,7 +19,9 @@
  */
 #include "stress-ng.h"
 #include "core-builtin.h"
+#include "core-cpu-cache.h"
 #include "core-killpid.h"
+#include "core-perf.h"
 
 #include <sched.h>
 
@@ -36,6 +38,8 @@ UNEXPECTED
 static const stress_help_t help[] = {
 	{ NULL,	"vm-rw N",	 "start N vm read/write process_vm* copy workers" },
 	{ NULL,	"vm-rw-bytes N", "transfer N bytes of memory per bogo operation" },
+	{ NULL,	"vm-rw-compare", "compare process_vm*, vmsplice, memfd and pipe transfers" },
+	{ NULL,	"vm-rw-iovecs N","number of iovecs per process_vm* message in compare mode" },
 	{ NULL,	"vm-rw-ops N",	 "stop after N vm process_vm* copy bogo operations" },
 	{ NULL,	NULL,		 NULL }
 };
@@ -74,8 +78,24 @@ static int stress_set_vm_rw_bytes(const char *opt)
 	return stress_set_setting("vm-rw-bytes", TYPE_ID_SIZE_T, &vm_rw_bytes);
 }
 
+static int stress_set_vm_rw_compare(const char *opt)
+{
+	return stress_set_setting_true("vm-rw-compare", opt);
+}
+
+static int stress_set_vm_rw_iovecs(const char *opt)
+{
+	size_t vm_rw_iovecs;
+
+	vm_rw_iovecs = (size_t)stress_get_uint64(opt);
+	stress_check_range("vm-rw-iovecs", (uint64_t)vm_rw_iovecs, 1, 1024);
+	return stress_set_setting("vm-rw-iovecs", TYPE_ID_SIZE_T, &vm_rw_iovecs);
+}
+
 static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_vm_rw_bytes,	stress_set_vm_rw_bytes },
+	{ OPT_vm_rw_compare,	stress_set_vm_rw_compare },
+	{ OPT_vm_rw_iovecs,	stress_set_vm_rw_iovecs },
 	{ 0,			NULL }
 };
 
@@ -359,6 +379,678 @@ fail:
 	return EXIT_SUCCESS;
 }
 
+#define VM_RW_COMPARE_MIN_BYTES		(64 * MB)	/* minimum bytes per transfer run */
+#define VM_RW_COMPARE_MIN_MSGS		(16)		/* minimum messages per transfer run */
+#define VM_RW_COMPARE_RING_SLOTS	(4)		/* memfd ring slots */
+#define VM_RW_COMPARE_PIPE_SIZE		(1 * MB)	/* pipe size to try for */
+#define VM_RW_COMPARE_SIZES		(4)		/* message sizes swept */
+
+#define VM_RW_TRANSPORT_WRITEV		(0)
+#define VM_RW_TRANSPORT_READV		(1)
+#define VM_RW_TRANSPORT_VMSPLICE	(2)
+#define VM_RW_TRANSPORT_MEMFD		(3)
+#define VM_RW_TRANSPORT_PIPE		(4)
+#define VM_RW_TRANSPORTS		(5)
+
+static const char * const vm_rw_transports[VM_RW_TRANSPORTS] = {
+	"process_vm_writev",
+	"process_vm_readv",
+	"vmsplice+splice",
+	"memfd ring",
+	"pipe",
+};
+
+static const size_t vm_rw_compare_sizes[VM_RW_COMPARE_SIZES] = {
+	4 * KB, 64 * KB, 1 * MB, 16 * MB,
+};
+
+/*
+ *  shared transfer header, the memfd ring slots follow on the next
+ *  page. head and tail count messages produced and consumed, every
+ *  transport keeps at most VM_RW_COMPARE_RING_SLOTS messages in flight
+ */
+typedef struct {
+	volatile uint64_t head;		/* messages produced */
+	volatile uint64_t tail;		/* messages consumed */
+	double cpu_time;		/* child CPU time of the transfer */
+	uint64_t cycles;		/* child CPU cycles of the transfer */
+	bool has_cycles;		/* child cycles are valid */
+} stress_vm_rw_ring_t;
+
+/* state of one transfer run, shared over fork by value */
+typedef struct {
+	stress_args_t *args;
+	int transport;			/* VM_RW_TRANSPORT_* */
+	size_t msg_sz;			/* message size */
+	size_t msgs;			/* messages to transfer */
+	size_t iovecs;			/* process_vm iovecs per message */
+	uint8_t *src;			/* sender buffer */
+	uint8_t *dst;			/* receiver buffer */
+	uint8_t *ring;			/* shared header and memfd ring */
+	int data[2];			/* data pipe */
+	int ready[2];			/* child is ready pipe */
+} stress_vm_rw_run_t;
+
+/* accumulated results of a transport and message size */
+typedef struct {
+	double bytes;			/* bytes transferred */
+	double duration;		/* wall clock time */
+	double cpu_time;		/* CPU time of both processes */
+	double cycles;			/* CPU cycles of both processes */
+	double cycles_bytes;		/* bytes transferred while cycles were counted */
+	bool failed;			/* transport not available */
+} stress_vm_rw_result_t;
+
+/*
+ *  stress_vm_rw_produce_wait()
+ *	wait for a free message slot, -1 if stopped
+ */
+static int stress_vm_rw_produce_wait(const stress_vm_rw_ring_t *hdr)
+{
+	while ((hdr->head - hdr->tail) >= VM_RW_COMPARE_RING_SLOTS) {
+		if (UNLIKELY(!stress_continue_flag()))
+			return -1;
+		(void)shim_sched_yield();
+	}
+	return 0;
+}
+
+/*
+ *  stress_vm_rw_consume_wait()
+ *	wait for a produced message, -1 if stopped
+ */
+static int stress_vm_rw_consume_wait(const stress_vm_rw_ring_t *hdr)
+{
+	while (hdr->head == hdr->tail) {
+		if (UNLIKELY(!stress_continue_flag()))
+			return -1;
+		(void)shim_sched_yield();
+	}
+	shim_mfence();
+	return 0;
+}
+
+/*
+ *  stress_vm_rw_pvm()
+ *	process_vm_readv/writev a message scattered over run->iovecs
+ *	iovecs, the remote buffer is at the same address in the child
+ */
+static ssize_t stress_vm_rw_pvm(const stress_vm_rw_run_t *run, const pid_t pid, struct iovec *local, struct iovec *remote)
+{
+	const size_t n = STRESS_MINIMUM(run->iovecs, run->msg_sz);
+	const size_t chunk = run->msg_sz / n;
+	size_t i;
+
+	for (i = 0; i < n; i++) {
+		const size_t len = (i == n - 1) ? run->msg_sz - (chunk * i) : chunk;
+
+		local[i].iov_base = run->src + (chunk * i);
+		local[i].iov_len = len;
+		remote[i].iov_base = run->dst + (chunk * i);
+		remote[i].iov_len = len;
+	}
+	if (run->transport == VM_RW_TRANSPORT_WRITEV)
+		return process_vm_writev(pid, local, n, remote, n, 0);
+	/* readv pulls from the child's src into our dst */
+	for (i = 0; i < n; i++) {
+		void *tmp = local[i].iov_base;
+
+		local[i].iov_base = remote[i].iov_base;
+		remote[i].iov_base = tmp;
+	}
+	return process_vm_readv(pid, local, n, remote, n, 0);
+}
+
+/*
+ *  stress_vm_rw_write_all()
+ *	write or vmsplice all of a message into the data pipe
+ */
+static int stress_vm_rw_write_all(const stress_vm_rw_run_t *run)
+{
+	size_t done = 0;
+
+	while (done < run->msg_sz) {
+		ssize_t ret;
+
+#if defined(HAVE_VMSPLICE)
+		if (run->transport == VM_RW_TRANSPORT_VMSPLICE) {
+			struct iovec iov;
+
+			iov.iov_base = run->src + done;
+			iov.iov_len = run->msg_sz - done;
+			ret = vmsplice(run->data[1], &iov, 1, 0);
+		} else
+#endif
+		{
+			ret = write(run->data[1], run->src + done, run->msg_sz - done);
+		}
+		if (ret <= 0) {
+			if ((ret < 0) && (errno == EINTR) && stress_continue_flag())
+				continue;
+			return -1;
+		}
+		done += (size_t)ret;
+	}
+	return 0;
+}
+
+/*
+ *  stress_vm_rw_cpu_time()
+ *	CPU time used by the calling process
+ */
+static double stress_vm_rw_cpu_time(void)
+{
+	struct rusage usage;
+
+	if (getrusage(RUSAGE_SELF, &usage) < 0)
+		return 0.0;
+	return stress_timeval_to_double(&usage.ru_utime) +
+	       stress_timeval_to_double(&usage.ru_stime);
+}
+
+/*
+ *  stress_vm_rw_cycles_open()
+ *	open a CPU cycles counter for the calling process and read
+ *	the initial count, -1 if not available
+ */
+static int stress_vm_rw_cycles_open(uint64_t *cycles)
+{
+#if defined(STRESS_PERF_STATS)
+	int fd;
+
+	fd = stress_perf_event_open_by_label("CPU Cycles", false);
+	if ((fd >= 0) && (stress_perf_event_read(fd, cycles) < 0)) {
+		(void)close(fd);
+		fd = -1;
+	}
+	return fd;
+#else
+	*cycles = 0;
+	return -1;
+#endif
+}
+
+/*
+ *  stress_vm_rw_cycles_close()
+ *	read the cycles used since stress_vm_rw_cycles_open
+ *	and close the counter, false if not available
+ */
+static bool stress_vm_rw_cycles_close(const int fd, const uint64_t begin, uint64_t *cycles)
+{
+	bool ok = false;
+
+	*cycles = 0;
+	if (fd < 0)
+		return false;
+#if defined(STRESS_PERF_STATS)
+	{
+		uint64_t end;
+
+		if (stress_perf_event_read(fd, &end) == 0) {
+			*cycles = end - begin;
+			ok = true;
+		}
+	}
+#else
+	(void)begin;
+#endif
+	(void)close(fd);
+	return ok;
+}
+
+/*
+ *  stress_vm_rw_receiver()
+ *	child, receive run->msgs messages into the receive buffer,
+ *	for process_vm_readv the child produces the messages
+ */
+static int stress_vm_rw_receiver(stress_vm_rw_run_t *run)
+{
+	stress_vm_rw_ring_t *hdr = (stress_vm_rw_ring_t *)run->ring;
+	int memfd = -1, cycles_fd;
+	uint64_t cycles_begin;
+	double cpu;
+	size_t i;
+
+	(void)close(run->data[1]);
+	(void)close(run->ready[0]);
+
+	/* make the receive buffer private to the child */
+	(void)shim_memset(run->dst, 0, run->msg_sz);
+
+#if defined(HAVE_VMSPLICE) &&	\
+    defined(HAVE_SPLICE) &&	\
+    defined(HAVE_MEMFD_CREATE)
+	if (run->transport == VM_RW_TRANSPORT_VMSPLICE) {
+		/* splice into a memfd that backs the receive buffer */
+		memfd = shim_memfd_create("stress-ng-vm-rw", 0);
+		if ((memfd < 0) || (ftruncate(memfd, (off_t)run->msg_sz) < 0))
+			return EXIT_NO_RESOURCE;
+		if (mmap((void *)run->dst, run->msg_sz, PROT_READ | PROT_WRITE,
+			 MAP_SHARED | MAP_FIXED, memfd, 0) == MAP_FAILED)
+			return EXIT_NO_RESOURCE;
+	}
+#endif
+
+	/* setup done, only the transfer is measured from here */
+	cycles_fd = stress_vm_rw_cycles_open(&cycles_begin);
+	cpu = stress_vm_rw_cpu_time();
+	if (write(run->ready[1], "r", 1) != 1)
+		return EXIT_FAILURE;
+
+	for (i = 0; i < run->msgs; i++) {
+		size_t done = 0;
+
+		if (run->transport == VM_RW_TRANSPORT_READV) {
+			/* message is in src, the parent reads it */
+			if (stress_vm_rw_produce_wait(hdr) < 0)
+				return EXIT_FAILURE;
+			shim_mfence();
+			hdr->head++;
+			continue;
+		}
+
+		if (stress_vm_rw_consume_wait(hdr) < 0)
+			return EXIT_FAILURE;
+		switch (run->transport) {
+		case VM_RW_TRANSPORT_WRITEV:
+			/* parent has already written the message into dst */
+			break;
+		case VM_RW_TRANSPORT_MEMFD: {
+			const uint8_t *slot = run->ring + run->args->page_size +
+				(run->msg_sz * (hdr->tail % VM_RW_COMPARE_RING_SLOTS));
+
+			(void)shim_memcpy(run->dst, slot, run->msg_sz);
+			break;
+		}
+		default:
+			while (done < run->msg_sz) {
+				ssize_t ret;
+
+#if defined(HAVE_SPLICE)
+				if (memfd >= 0) {
+					off_t off = (off_t)done;
+
+					ret = splice(run->data[0], NULL, memfd, &off,
+						run->msg_sz - done, SPLICE_F_MOVE);
+				} else
+#endif
+				{
+					ret = read(run->data[0], run->dst + done, run->msg_sz - done);
+				}
+				if (ret <= 0) {
+					if ((ret < 0) && (errno == EINTR) && stress_continue_flag())
+						continue;
+					return EXIT_FAILURE;
+				}
+				done += (size_t)ret;
+			}
+			break;
+		}
+		shim_mfence();
+		hdr->tail++;
+	}
+	hdr->cpu_time = stress_vm_rw_cpu_time() - cpu;
+	hdr->has_cycles = stress_vm_rw_cycles_close(cycles_fd, cycles_begin, &hdr->cycles);
+
+	/* process_vm_readv needs the child until the parent has read all of src */
+	while (hdr->tail < run->msgs) {
+		if (!stress_continue_flag())
+			return EXIT_FAILURE;
+		(void)shim_sched_yield();
+	}
+	if (memfd >= 0)
+		(void)close(memfd);
+	return EXIT_SUCCESS;
+}
+
+/*
+ *  stress_vm_rw_compare_run()
+ *	transfer messages of one size over one transport to a child
+ *	process, returns 0 on success, 1 if not available, -1 on failure
+ */
+static int stress_vm_rw_compare_run(
+	stress_vm_rw_run_t *run,
+	stress_vm_rw_result_t *result,
+	struct iovec *local,
+	struct iovec *remote)
+{
+	stress_args_t *args = run->args;
+	stress_vm_rw_ring_t *hdr = (stress_vm_rw_ring_t *)run->ring;
+	int status, rc = 0, cycles_fd;
+	uint64_t cycles_begin, cycles;
+	double t, cpu;
+	bool has_cycles;
+	char token;
+	pid_t pid;
+	size_t i;
+
+	run->data[0] = run->data[1] = -1;
+	run->ready[0] = run->ready[1] = -1;
+	if ((pipe(run->data) < 0) || (pipe(run->ready) < 0)) {
+		rc = 1;
+		goto close_pipes;
+	}
+#if defined(F_SETPIPE_SZ)
+	(void)fcntl(run->data[1], F_SETPIPE_SZ, VM_RW_COMPARE_PIPE_SIZE);
+#endif
+	(void)shim_memset((void *)hdr, 0, sizeof(*hdr));
+
+	pid = fork();
+	if (pid < 0) {
+		rc = 1;
+		goto close_pipes;
+	} else if (pid == 0) {
+		stress_parent_died_alarm();
+		_exit(stress_vm_rw_receiver(run));
+	}
+	(void)close(run->data[0]);
+	run->data[0] = -1;
+	(void)close(run->ready[1]);
+	run->ready[1] = -1;
+
+	/* start measuring once the child has set up its receive buffer */
+	if (read(run->ready[0], &token, 1) != 1)
+		goto reap_status;
+	cycles_fd = stress_vm_rw_cycles_open(&cycles_begin);
+	cpu = stress_vm_rw_cpu_time();
+	t = stress_time_now();
+
+	for (i = 0; i < run->msgs; i++) {
+		if (run->transport == VM_RW_TRANSPORT_READV) {
+			if (stress_vm_rw_consume_wait(hdr) < 0)
+				goto reap_cycles;
+			if (stress_vm_rw_pvm(run, pid, local, remote) < 0) {
+				rc = (errno == ENOSYS) || (errno == EPERM) ? 1 : -1;
+				goto reap_cycles;
+			}
+			shim_mfence();
+			hdr->tail++;
+			continue;
+		}
+
+		if (stress_vm_rw_produce_wait(hdr) < 0)
+			goto reap_cycles;
+		switch (run->transport) {
+		case VM_RW_TRANSPORT_WRITEV:
+			if (stress_vm_rw_pvm(run, pid, local, remote) < 0) {
+				rc = (errno == ENOSYS) || (errno == EPERM) ? 1 : -1;
+				goto reap_cycles;
+			}
+			break;
+		case VM_RW_TRANSPORT_MEMFD: {
+			uint8_t *slot = run->ring + args->page_size +
+				(run->msg_sz * (hdr->head % VM_RW_COMPARE_RING_SLOTS));
+
+			(void)shim_memcpy(slot, run->src, run->msg_sz);
+			break;
+		}
+		default:
+			/* announce first, a message may not fit in the pipe */
+			hdr->head++;
+			if (stress_vm_rw_write_all(run) < 0) {
+				if (!stress_continue_flag())
+					goto reap_cycles;
+				rc = ((run->transport == VM_RW_TRANSPORT_VMSPLICE) &&
+				      (errno == ENOSYS)) ? 1 : -1;
+				goto reap_cycles;
+			}
+			continue;
+		}
+		shim_mfence();
+		hdr->head++;
+	}
+	/* wait for the child to consume the messages still in flight */
+	while (hdr->tail < run->msgs) {
+		if (!stress_continue_flag())
+			goto reap_cycles;
+		(void)shim_sched_yield();
+	}
+	t = stress_time_now() - t;
+	cpu = stress_vm_rw_cpu_time() - cpu;
+	has_cycles = stress_vm_rw_cycles_close(cycles_fd, cycles_begin, &cycles);
+
+	if (waitpid(pid, &status, 0) < 0) {
+		rc = -1;
+		goto reap;
+	}
+	if (!WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS)) {
+		rc = -1;
+		goto close_pipes;
+	}
+	result->duration += t;
+	result->cpu_time += cpu + hdr->cpu_time;
+	result->bytes += (double)(run->msg_sz * run->msgs);
+	if (has_cycles && hdr->has_cycles) {
+		result->cycles += (double)(cycles + hdr->cycles);
+		result->cycles_bytes += (double)(run->msg_sz * run->msgs);
+	}
+	stress_bogo_inc(args);
+	goto close_pipes;
+
+reap_status:
+	/* receiver could not set up, e.g. no memfd or splice */
+	if ((waitpid(pid, &status, 0) == pid) && WIFEXITED(status) &&
+	    (WEXITSTATUS(status) == EXIT_NO_RESOURCE)) {
+		rc = 1;
+		goto close_pipes;
+	}
+	rc = -1;
+	goto reap;
+reap_cycles:
+	(void)stress_vm_rw_cycles_close(cycles_fd, cycles_begin, &cycles);
+	if (!stress_continue_flag() && (rc == 0))
+		goto reap;
+	if (rc == 0)
+		rc = -1;
+reap:
+	if (rc < 0)
+		pr_fail("%s: %s transfer of %zu byte messages failed, errno=%d (%s)\n",
+			args->name, vm_rw_transports[run->transport], run->msg_sz,
+			errno, strerror(errno));
+	(void)stress_kill_pid_wait(pid, NULL);
+close_pipes:
+	for (i = 0; i < 2; i++) {
+		if (run->data[i] >= 0)
+			(void)close(run->data[i]);
+		if (run->ready[i] >= 0)
+			(void)close(run->ready[i]);
+	}
+	return rc;
+}
+
+/*
+ *  stress_vm_rw_compare()
+ *	compare bulk transfer between processes with process_vm_*v,
+ *	vmsplice+splice, a shared memfd ring and a pipe over a range
+ *	of message sizes
+ */
+static int stress_vm_rw_compare(stress_args_t *args, const size_t vm_rw_bytes)
+{
+	const size_t page_size = args->page_size;
+	stress_vm_rw_result_t results[VM_RW_TRANSPORTS][VM_RW_COMPARE_SIZES];
+	struct iovec *local, *remote;
+	stress_vm_rw_run_t run;
+	size_t max_sz = 0, n_sizes = 0, vm_rw_iovecs = 256, s, idx = 0;
+	size_t ring_sz;
+	int tr, rc = EXIT_SUCCESS;
+	bool row_cycles[VM_RW_TRANSPORTS];
+
+	(void)stress_get_setting("vm-rw-iovecs", &vm_rw_iovecs);
+	for (s = 0; s < VM_RW_COMPARE_SIZES; s++) {
+		if ((vm_rw_compare_sizes[s] <= vm_rw_bytes) || (s == 0)) {
+			max_sz = vm_rw_compare_sizes[s];
+			n_sizes = s + 1;
+		}
+	}
+	ring_sz = page_size + (max_sz * VM_RW_COMPARE_RING_SLOTS);
+
+	(void)shim_memset(&run, 0, sizeof(run));
+	(void)shim_memset(results, 0, sizeof(results));
+	run.args = args;
+	run.iovecs = vm_rw_iovecs;
+	run.src = run.dst = run.ring = MAP_FAILED;
+	local = (struct iovec *)calloc(vm_rw_iovecs, sizeof(*local));
+	remote = (struct iovec *)calloc(vm_rw_iovecs, sizeof(*remote));
+	run.src = (uint8_t *)stress_mmap_populate(NULL, max_sz, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	run.dst = (uint8_t *)stress_mmap_populate(NULL, max_sz, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#if defined(HAVE_MEMFD_CREATE)
+	{
+		const int fd = shim_memfd_create("stress-ng-vm-rw-ring", 0);
+
+		if (fd >= 0) {
+			if (ftruncate(fd, (off_t)ring_sz) == 0)
+				run.ring = (uint8_t *)mmap(NULL, ring_sz, PROT_READ | PROT_WRITE,
+						MAP_SHARED, fd, 0);
+			(void)close(fd);
+		}
+	}
+#endif
+	if (run.ring == MAP_FAILED) {
+		/* no memfd, a shared anonymous mapping is the same underneath */
+		run.ring = (uint8_t *)mmap(NULL, ring_sz, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	}
+	if (!local || !remote || (run.src == MAP_FAILED) ||
+	    (run.dst == MAP_FAILED) || (run.ring == MAP_FAILED)) {
+		pr_inf_skip("%s: cannot allocate transfer buffers, skipping stressor\n",
+			args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+	(void)shim_memset(run.src, 0x5a, max_sz);
+
+#if !defined(HAVE_VMSPLICE) ||	\
+    !defined(HAVE_SPLICE) ||	\
+    !defined(HAVE_MEMFD_CREATE)
+	for (s = 0; s < VM_RW_COMPARE_SIZES; s++)
+		results[VM_RW_TRANSPORT_VMSPLICE][s].failed = true;
+#endif
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	do {
+		for (s = 0; s < n_sizes; s++) {
+			run.msg_sz = vm_rw_compare_sizes[s];
+			run.msgs = STRESS_MAXIMUM(VM_RW_COMPARE_MIN_BYTES / run.msg_sz,
+						  VM_RW_COMPARE_MIN_MSGS);
+			for (tr = 0; tr < VM_RW_TRANSPORTS; tr++) {
+				int ret;
+
+				if (!stress_continue(args))
+					goto finish;
+				if (results[tr][s].failed)
+					continue;
+				run.transport = tr;
+				ret = stress_vm_rw_compare_run(&run, &results[tr][s], local, remote);
+				if (ret < 0) {
+					rc = EXIT_FAILURE;
+					goto finish;
+				}
+				if (ret > 0)
+					results[tr][s].failed = true;
+			}
+		}
+	} while (stress_continue(args));
+finish:
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	/* report a transport in cycles only if every size was measured in cycles */
+	for (tr = 0; tr < VM_RW_TRANSPORTS; tr++) {
+		size_t measured = 0;
+
+		row_cycles[tr] = true;
+		for (s = 0; s < n_sizes; s++) {
+			const stress_vm_rw_result_t *r = &results[tr][s];
+
+			if (r->failed || (r->bytes <= 0.0))
+				continue;
+			measured++;
+			if (r->cycles_bytes <= 0.0)
+				row_cycles[tr] = false;
+		}
+		row_cycles[tr] &= (measured > 0);
+	}
+
+	if (args->instance == 0) {
+		int table;
+
+		pr_block_begin();
+		for (table = 0; table < 2; table++) {
+			char buf[128];
+			int len;
+
+			pr_inf("%s: %s by message size, %zu iovecs for process_vm_*v:\n", args->name,
+				table ? "CPU cost per byte" : "GB/s", vm_rw_iovecs);
+			len = snprintf(buf, sizeof(buf), "%-18s", "transport");
+			for (s = 0; (s < n_sizes) && (len < (int)sizeof(buf)); s++) {
+				char str[16];
+
+				len += snprintf(buf + len, sizeof(buf) - (size_t)len, " %9sB",
+					stress_uint64_to_str(str, sizeof(str), (uint64_t)vm_rw_compare_sizes[s]));
+			}
+			if (table && (len < (int)sizeof(buf)))
+				(void)snprintf(buf + len, sizeof(buf) - (size_t)len, " %-8s", "unit");
+			pr_inf("%s: %s\n", args->name, buf);
+			for (tr = 0; tr < VM_RW_TRANSPORTS; tr++) {
+				len = snprintf(buf, sizeof(buf), "%-18s", vm_rw_transports[tr]);
+				for (s = 0; (s < n_sizes) && (len < (int)sizeof(buf)); s++) {
+					const stress_vm_rw_result_t *r = &results[tr][s];
+					double val;
+
+					if (r->failed || (r->bytes <= 0.0)) {
+						len += snprintf(buf + len, sizeof(buf) - (size_t)len, " %10s", "n/a");
+						continue;
+					}
+					if (table == 0)
+						val = r->bytes / (r->duration * GB);
+					else if (row_cycles[tr])
+						val = r->cycles / r->cycles_bytes;
+					else
+						val = (r->cpu_time * STRESS_DBL_NANOSECOND) / r->bytes;
+					len += snprintf(buf + len, sizeof(buf) - (size_t)len, " %10.3f", val);
+				}
+				if (table && (len < (int)sizeof(buf)))
+					(void)snprintf(buf + len, sizeof(buf) - (size_t)len, " %-8s",
+						row_cycles[tr] ? "cycles" : "nanosecs");
+				pr_inf("%s: %s\n", args->name, buf);
+			}
+		}
+		pr_block_end();
+	}
+
+	for (tr = 0; tr < VM_RW_TRANSPORTS; tr++) {
+		for (s = 0; s < n_sizes; s++) {
+			const stress_vm_rw_result_t *r = &results[tr][s];
+			char str[64], size_str[16];
+
+			if (r->failed || (r->bytes <= 0.0))
+				continue;
+			(void)stress_uint64_to_str(size_str, sizeof(size_str), (uint64_t)vm_rw_compare_sizes[s]);
+			(void)snprintf(str, sizeof(str), "%s %sB GB/s", vm_rw_transports[tr], size_str);
+			stress_metrics_set(args, idx++, str, r->bytes / (r->duration * GB),
+				STRESS_HARMONIC_MEAN);
+			(void)snprintf(str, sizeof(str), "%s %sB CPU %s per byte",
+				vm_rw_transports[tr], size_str, row_cycles[tr] ? "cycles" : "nanosecs");
+			stress_metrics_set(args, idx++, str,
+				row_cycles[tr] ? r->cycles / r->cycles_bytes :
+					(r->cpu_time * STRESS_DBL_NANOSECOND) / r->bytes,
+				STRESS_GEOMETRIC_MEAN);
+		}
+	}
+tidy:
+	if (run.ring != MAP_FAILED)
+		(void)munmap((void *)run.ring, ring_sz);
+	if (run.dst != MAP_FAILED)
+		(void)munmap((void *)run.dst, max_sz);
+	if (run.src != MAP_FAILED)
+		(void)munmap((void *)run.src, max_sz);
+	free(remote);
+	free(local);
+
+	return rc;
+}
+
 /*
  *  stress_vm_rw
  *	stress vm_read_v/vm_write_v
@@ -370,7 +1062,9 @@ static int stress_vm_rw(stress_args_t *args)
 	uint8_t *stack_top = (uint8_t *)stress_get_stack_top((void *)stack, STACK_SIZE);
 	size_t vm_rw_bytes = DEFAULT_VM_RW_BYTES;
 	int rc;
+	bool vm_rw_compare = false;
 
+	(void)stress_get_setting("vm-rw-compare", &vm_rw_compare);
 	if (!stress_get_setting("vm-rw-bytes", &vm_rw_bytes)) {
 		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
 			vm_rw_bytes = MAX_32;
@@ -382,6 +1076,9 @@ static int stress_vm_rw(stress_args_t *args)
 		vm_rw_bytes = MIN_VM_RW_BYTES;
 	if (vm_rw_bytes < args->page_size)
 		vm_rw_bytes = args->page_size;
+	if (vm_rw_compare)
+		return stress_vm_rw_compare(args, vm_rw_bytes);
+
 	ctxt.args = args;
 	ctxt.sz = vm_rw_bytes & ~(args->page_size - 1);
 	ctxt.iov_count = (ctxt.sz + CHUNK_SIZE - 1) / CHUNK_SIZE;
@@ -22,11 +22,13 @@
 #include "core-attribute.h"
 #include "core-builtin.h"
 #include "core-cpu-cache.h"
+#include "core-killpid.h"
 #include "core-target-clones.h"
 #include "core-madvise.h"
 #include "core-mincore.h"
 #include "core-nt-load.h"
 #include "core-nt-store.h"
+#include "core-numa.h"
 #include "core-out-of-memory.h"
 #include "core-pragma.h"
 #include "core-vecmath.h"
@@ -47,6 +49,8 @@
 
 #define NO_MEM_RETRIES_MAX	(100)
 
+#define MAX_VM_THREADS		(4096)
+
 static size_t stress_vm_cache_line_size;
 
 /*
@@ -84,6 +88,7 @@ static const stress_help_t help[] = {
 #if defined(MAP_POPULATE)
 	{ NULL,	 "vm-populate",	 "populate (prefault) page tables for a mapping" },
 #endif
+	{ NULL,	 "vm-threads N", "test the mapping in N node local chunks in parallel" },
 	{ NULL,	 NULL,		 NULL }
 };
 
@@ -209,6 +214,15 @@ static int stress_set_vm_keep(const char *opt)
 	return stress_set_setting_true("vm-keep", opt);
 }
 
+static int stress_set_vm_threads(const char *opt)
+{
+	size_t vm_threads;
+
+	vm_threads = (size_t)stress_get_uint64(opt);
+	stress_check_range("vm-threads", vm_threads, 1, MAX_VM_THREADS);
+	return stress_set_setting("vm-threads", TYPE_ID_SIZE_T, &vm_threads);
+}
+
 #define SET_AND_TEST(ptr, val, bit_errors)	\
 do {						\
 	*ptr = val;				\
@@ -3313,6 +3327,254 @@ static int stress_set_vm_method(const char *name)
 	return -1;
 }
 
+#if defined(HAVE_SCHED_GETAFFINITY) &&	\
+    defined(HAVE_SCHED_SETAFFINITY)
+#define HAVE_VM_THREADS
+
+/* per worker results, shared with the worker processes */
+typedef struct {
+	volatile bool ready;		/* memory touched, ready to go */
+	volatile double t_end;		/* time method completed */
+	volatile uint64_t counter;	/* bogo counter of the worker */
+	volatile uint64_t bit_errors;	/* bit errors found */
+} stress_vm_worker_t;
+
+/* accumulated memory tested per method */
+typedef struct {
+	double bytes;			/* bytes of memory tested */
+	double duration;		/* wall clock time of the passes */
+	uint64_t passes;		/* passes over all the memory */
+} stress_vm_method_stats_t;
+
+/*
+ *  stress_vm_worker()
+ *	test a chunk of the mapping with one method, the chunk is
+ *	first touched on the worker's node so it is node local
+ */
+static void NORETURN stress_vm_worker(
+	stress_args_t *args,
+	const stress_vm_func func,
+	uint8_t *chunk,
+	const size_t chunk_sz,
+	const cpu_set_t *node_cpus,
+	volatile bool *go,
+	stress_vm_worker_t *worker)
+{
+	stress_args_t worker_args = *args;
+	size_t bit_errors;
+
+	stress_parent_died_alarm();
+	if (node_cpus && CPU_COUNT(node_cpus))
+		(void)sched_setaffinity(0, sizeof(*node_cpus), node_cpus);
+	/* the bogo counter is private, the parent sums them */
+	worker_args.ci.counter = 0;
+	(void)shim_memset(chunk, 0, chunk_sz);
+	worker->ready = true;
+	while (!*go && stress_continue_flag())
+		(void)shim_sched_yield();
+
+	bit_errors = func((void *)chunk, (void *)(chunk + chunk_sz), chunk_sz, &worker_args, 0);
+	worker->t_end = stress_time_now();
+	worker->counter = stress_bogo_get(&worker_args);
+	worker->bit_errors = bit_errors;
+	_exit(0);
+}
+
+/*
+ *  stress_vm_threads()
+ *	split the mapping into vm_threads chunks spread over the NUMA
+ *	nodes and test them in parallel with concurrent workers, one
+ *	method at a time, measuring the time for a pass over all of
+ *	the memory
+ */
+static int stress_vm_threads(
+	stress_args_t *args,
+	stress_vm_context_t *context,
+	const size_t buf_sz,
+	const size_t vm_threads,
+	const int vm_flags,
+	const int vm_madvise)
+{
+	const size_t page_size = args->page_size;
+	const size_t n_methods = SIZEOF_ARRAY(vm_methods);
+	const bool all = (context->vm_method == &vm_methods[0]);
+	const size_t shared_sz = sizeof(stress_vm_worker_t) * vm_threads + sizeof(bool);
+	stress_vm_method_stats_t *stats;
+	stress_vm_worker_t *workers;
+	volatile bool *go;
+	cpu_set_t *node_cpus = NULL;
+	size_t n_nodes = 0, n_threads = vm_threads, chunk_sz, i, method, idx = 0;
+	pid_t *pids;
+	uint8_t *buf;
+	int rc = EXIT_SUCCESS;
+	double total_pass = 0.0;
+	size_t n_run = 0;
+
+	if (n_threads > buf_sz / page_size)
+		n_threads = buf_sz / page_size;
+	chunk_sz = (buf_sz / n_threads) & ~(page_size - 1);
+
+	stats = (stress_vm_method_stats_t *)calloc(n_methods, sizeof(*stats));
+	pids = (pid_t *)calloc(n_threads, sizeof(*pids));
+	workers = (stress_vm_worker_t *)mmap(NULL, shared_sz, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	buf = (uint8_t *)mmap(NULL, buf_sz, PROT_READ | PROT_WRITE,
+			MAP_PRIVATE | MAP_ANONYMOUS | vm_flags, -1, 0);
+	if (!stats || !pids || (workers == MAP_FAILED) || (buf == MAP_FAILED)) {
+		pr_inf_skip("%s: cannot allocate %zu bytes and %zu worker contexts, skipping stressor\n",
+			args->name, buf_sz, n_threads);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy;
+	}
+	go = (volatile bool *)(workers + vm_threads);
+	if (vm_madvise >= 0)
+		(void)shim_madvise(buf, buf_sz, vm_madvise);
+
+	{
+		unsigned long max_node = 0, node;
+		cpu_set_t allowed;
+
+		/* nodes with usable CPUs, workers are spread over these */
+		if ((stress_numa_count_mem_nodes(&max_node) > 1) &&
+		    (sched_getaffinity(0, sizeof(allowed), &allowed) == 0)) {
+			node_cpus = (cpu_set_t *)calloc((size_t)max_node, sizeof(*node_cpus));
+			for (node = 0; node_cpus && (node < max_node); node++) {
+				if (stress_numa_node_cpus(node, &allowed, &node_cpus[n_nodes]) > 0)
+					n_nodes++;
+			}
+		}
+	}
+	if (args->instance == 0)
+		pr_dbg("%s: testing %zu bytes with %zu workers over %zu NUMA node%s\n",
+			args->name, buf_sz, n_threads, STRESS_MAXIMUM(n_nodes, 1),
+			n_nodes > 1 ? "s" : "");
+
+	method = all ? 1 : (size_t)(context->vm_method - vm_methods);
+	do {
+		const stress_vm_func func = vm_methods[method].func;
+		size_t started, bytes = 0;
+		double t_start, t_end;
+
+		(void)shim_memset((void *)workers, 0, shared_sz);
+		for (started = 0; started < n_threads; started++) {
+			const size_t sz = (started == n_threads - 1) ?
+				buf_sz - (chunk_sz * started) : chunk_sz;
+
+			pids[started] = fork();
+			if (pids[started] < 0)
+				break;
+			if (pids[started] == 0) {
+				stress_vm_worker(args, func, buf + (chunk_sz * started), sz,
+					n_nodes ? &node_cpus[started % n_nodes] : NULL,
+					go, &workers[started]);
+			}
+			bytes += sz;
+		}
+		if (started < n_threads) {
+			pr_inf_skip("%s: fork failed after %zu of %zu workers, errno=%d (%s), "
+				"skipping stressor\n", args->name, started, n_threads,
+				errno, strerror(errno));
+			*go = true;
+			for (i = 0; i < started; i++)
+				(void)stress_kill_pid_wait(pids[i], NULL);
+			rc = EXIT_NO_RESOURCE;
+			break;
+		}
+
+		/* wait for all the chunks to be faulted in */
+		for (i = 0; i < n_threads; ) {
+			if (!stress_continue_flag())
+				break;
+			if (workers[i].ready)
+				i++;
+			else
+				(void)shim_usleep(1000);
+		}
+		t_start = stress_time_now();
+		*go = true;
+
+		t_end = t_start;
+		for (i = 0; i < n_threads; i++) {
+			int status;
+
+			if (waitpid(pids[i], &status, 0) < 0) {
+				(void)stress_kill_pid_wait(pids[i], NULL);
+				bytes = 0;
+				continue;
+			}
+			if (!WIFEXITED(status) || (workers[i].t_end <= 0.0)) {
+				/* killed by OOM or SIGALRM, pass is incomplete */
+				bytes = 0;
+				continue;
+			}
+			if (workers[i].t_end > t_end)
+				t_end = workers[i].t_end;
+			stress_bogo_add(args, workers[i].counter);
+			*(context->bit_error_count) += workers[i].bit_errors;
+		}
+		if (args->max_ops && ((stress_bogo_get(args) >> VM_BOGO_SHIFT) > args->max_ops))
+			stress_bogo_set(args, args->max_ops << VM_BOGO_SHIFT);
+		/* a pass cut short by the end of the run is not counted */
+		if (bytes && (t_end > t_start) && stress_continue_flag()) {
+			stats[method].bytes += (double)bytes;
+			stats[method].duration += t_end - t_start;
+			stats[method].passes++;
+		}
+		if (all) {
+			method++;
+			if (method >= n_methods)
+				method = 1;
+		}
+	} while (stress_continue_vm(args));
+
+	if (args->instance == 0) {
+		pr_block_begin();
+		pr_inf("%s: %zu workers testing %zu MB%s:\n", args->name, n_threads,
+			buf_sz / (size_t)MB, n_nodes > 1 ? ", node local chunks" : "");
+		pr_inf("%s: %-14s %10s %12s\n", args->name, "method", "GB/s", "pass secs");
+		for (i = 1; i < n_methods; i++) {
+			const stress_vm_method_stats_t *s = &stats[i];
+
+			if (!s->passes)
+				continue;
+			pr_inf("%s: %-14s %10.3f %12.3f\n", args->name, vm_methods[i].name,
+				s->bytes / (s->duration * GB), s->duration / (double)s->passes);
+		}
+	}
+	for (i = 1; i < n_methods; i++) {
+		const stress_vm_method_stats_t *s = &stats[i];
+		char str[64];
+
+		if (!s->passes)
+			continue;
+		total_pass += s->duration / (double)s->passes;
+		n_run++;
+		(void)snprintf(str, sizeof(str), "GB/s %s", vm_methods[i].name);
+		stress_metrics_set(args, idx++, str, s->bytes / (s->duration * GB),
+			STRESS_HARMONIC_MEAN);
+	}
+	if (total_pass > 0.0) {
+		if (args->instance == 0)
+			pr_inf("%s: time for a pass over memory with %zu method%s: %.3f secs\n",
+				args->name, n_run, n_run > 1 ? "s" : "", total_pass);
+		stress_metrics_set(args, idx, n_run > 1 ? "secs per pass over memory, all methods run" :
+			"secs per pass over memory", total_pass, STRESS_HARMONIC_MEAN);
+	}
+	if (args->instance == 0)
+		pr_block_end();
+tidy:
+	free(node_cpus);
+	if (buf != MAP_FAILED)
+		(void)munmap((void *)buf, buf_sz);
+	if (workers != MAP_FAILED)
+		(void)munmap((void *)workers, shared_sz);
+	free(pids);
+	free(stats);
+
+	return rc;
+}
+#endif
+
 static int stress_vm_child(stress_args_t *args, void *ctxt)
 {
 	int no_mem_retries = 0;
@@ -3325,6 +3587,7 @@ static int stress_vm_child(stress_args_t *args, void *ctxt)
 	size_t buf_sz;
 	size_t vm_bytes = DEFAULT_VM_BYTES;
 	const size_t page_size = args->page_size;
+	size_t vm_threads = 0;
 	bool vm_keep = false;
 	stress_vm_context_t *context = (stress_vm_context_t *)ctxt;
 	const stress_vm_func func = context->vm_method->func;
@@ -3347,6 +3610,16 @@ static int stress_vm_child(stress_args_t *args, void *ctxt)
 	buf_sz = vm_bytes & ~(page_size - 1);
 	(void)stress_get_setting("vm-madvise", &vm_madvise);
 
+	if (stress_get_setting("vm-threads", &vm_threads)) {
+#if defined(HAVE_VM_THREADS)
+		return stress_vm_threads(args, context, buf_sz, vm_threads, vm_flags, vm_madvise);
+#else
+		if (args->instance == 0)
+			pr_inf("%s: --vm-threads requires sched_setaffinity(), ignoring option\n",
+				args->name);
+#endif
+	}
+
 	do {
 		if (no_mem_retries >= NO_MEM_RETRIES_MAX) {
 			pr_inf_skip("%s: gave up trying to mmap, no available memory, skipping stressor\n",
@@ -3538,6 +3811,7 @@ static const stress_opt_set_func_t opt_set_funcs[] = {
 	{ OPT_vm_method,	stress_set_vm_method },
 	{ OPT_vm_mmap_locked,	stress_set_vm_mmap_locked },
 	{ OPT_vm_mmap_populate,	stress_set_vm_mmap_populate },
+	{ OPT_vm_threads,	stress_set_vm_threads },
 	{ 0,			NULL }
 };
 
@@ -0,0 +1,915 @@
+/*
+ * Copyright (C) 2024      Colin Ian King.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ */
+#include "stress-ng.h"
+#include "core-builtin.h"
+#include "core-io-uring.h"
+#include "core-pthread.h"
+#include "io-uring.h"
+
+#define MIN_WAL_FILES		(1)
+#define MAX_WAL_FILES		(16)
+#define DEFAULT_WAL_FILES	(1)
+
+#define MIN_WAL_RECORD		(64)
+#define MAX_WAL_RECORD		(1 * MB)
+#define DEFAULT_WAL_RECORD	(4 * KB)
+
+#define MIN_WAL_THREADS		(1)
+#define MAX_WAL_THREADS		(64)
+#define DEFAULT_WAL_THREADS	(4)
+
+#define WAL_FILE_MAX		(64 * MB)	/* log is recycled after this */
+#define WAL_MAX_SAMPLES		(65536)		/* latency samples per thread */
+#define WAL_PHASE		(30.0)		/* default secs per method */
+
+#define WAL_METHOD_ALL		(0)
+#define WAL_METHOD_FSYNC	(1)
+#define WAL_METHOD_FDATASYNC	(2)
+#define WAL_METHOD_ODSYNC	(3)
+#define WAL_METHOD_SYNC_FILE_RANGE (4)
+#define WAL_METHOD_IO_URING	(5)
+
+static const stress_help_t help[] = {
+	{ NULL,	"wal N",		"start N workers appending and committing write-ahead log records" },
+	{ NULL,	"wal-files N",		"number of log files the threads append to (1..16)" },
+	{ NULL,	"wal-group-commit",	"commit each batch of pending records with one sync" },
+	{ NULL,	"wal-method M",		"commit method, fsync, fdatasync, odsync, sync-file-range, io-uring or all" },
+	{ NULL,	"wal-ops N",		"stop after N wal record commits" },
+	{ NULL,	"wal-record N",		"size of each log record in bytes (64..1M)" },
+	{ NULL,	"wal-threads N",	"number of appending threads (1..64)" },
+	{ NULL,	NULL,			NULL }
+};
+
+/* indexed by WAL_METHOD_* */
+static const char * const wal_methods[] = {
+	"all",
+	"fsync",
+	"fdatasync",
+	"odsync",
+	"sync-file-range",
+	"io-uring",
+};
+
+static int stress_set_wal_files(const char *opt)
+{
+	uint32_t wal_files;
+
+	wal_files = stress_get_uint32(opt);
+	stress_check_range("wal-files", (uint64_t)wal_files,
+		MIN_WAL_FILES, MAX_WAL_FILES);
+	return stress_set_setting("wal-files", TYPE_ID_UINT32, &wal_files);
+}
+
+static int stress_set_wal_group_commit(const char *opt)
+{
+	return stress_set_setting_true("wal-group-commit", opt);
+}
+
+static int stress_set_wal_method(const char *opt)
+{
+	size_t i;
+
+	for (i = 0; i < SIZEOF_ARRAY(wal_methods); i++) {
+		if (!strcmp(opt, wal_methods[i]))
+			return stress_set_setting("wal-method", TYPE_ID_SIZE_T, &i);
+	}
+	(void)fprintf(stderr, "wal-method must be one of:");
+	for (i = 0; i < SIZEOF_ARRAY(wal_methods); i++)
+		(void)fprintf(stderr, " %s", wal_methods[i]);
+	(void)fprintf(stderr, "\n");
+	return -1;
+}
+
+static int stress_set_wal_record(const char *opt)
+{
+	uint64_t wal_record;
+
+	wal_record = stress_get_uint64_byte(opt);
+	stress_check_range_bytes("wal-record", wal_record,
+		MIN_WAL_RECORD, MAX_WAL_RECORD);
+	return stress_set_setting("wal-record", TYPE_ID_UINT64, &wal_record);
+}
+
+static int stress_set_wal_threads(const char *opt)
+{
+	uint32_t wal_threads;
+
+	wal_threads = stress_get_uint32(opt);
+	stress_check_range("wal-threads", (uint64_t)wal_threads,
+		MIN_WAL_THREADS, MAX_WAL_THREADS);
+	return stress_set_setting("wal-threads", TYPE_ID_UINT32, &wal_threads);
+}
+
+static const stress_opt_set_func_t opt_set_funcs[] = {
+	{ OPT_wal_files,	stress_set_wal_files },
+	{ OPT_wal_group_commit,	stress_set_wal_group_commit },
+	{ OPT_wal_method,	stress_set_wal_method },
+	{ OPT_wal_record,	stress_set_wal_record },
+	{ OPT_wal_threads,	stress_set_wal_threads },
+	{ 0,			NULL }
+};
+
+#if defined(HAVE_LIB_PTHREAD)
+
+#if defined(HAVE_STRESS_IO_URING_RING) &&	\
+    defined(IORING_ENTER_GETEVENTS) &&	\
+    defined(IORING_FSYNC_DATASYNC) &&	\
+    defined(IOSQE_IO_LINK) &&		\
+    defined(HAVE_IORING_OP_WRITE) &&	\
+    defined(HAVE_IORING_OP_FSYNC)
+#define HAVE_WAL_IO_URING
+#endif
+
+#if !defined(O_DSYNC)
+#define O_DSYNC		(0)
+#endif
+
+/* a log file shared by one or more appending threads */
+typedef struct {
+	pthread_mutex_t lock;		/* protects everything below */
+	pthread_cond_t cond;		/* signals commits to followers */
+	int fd;				/* log file */
+	uint64_t next_off;		/* where the next record goes */
+	uint64_t appended;		/* bytes appended (log sequence number) */
+	uint64_t committed;		/* bytes written and synced */
+	uint8_t *pending;		/* group commit, records not yet written */
+	uint8_t *flushing;		/* group commit, records being written */
+	size_t pending_len;		/* bytes in pending */
+	size_t buf_size;		/* size of pending and flushing buffers */
+	bool leader;			/* group commit leader active */
+	int err;			/* errno of a failed group commit */
+} stress_wal_file_t;
+
+typedef struct stress_wal_thread {
+	pthread_t pthread;		/* thread handle */
+	int ret;			/* pthread_create return */
+	volatile bool *go;		/* start flag */
+	volatile bool *stop;		/* stop flag */
+	size_t method;			/* commit method */
+	bool group_commit;		/* group commit enabled */
+	size_t record_size;		/* bytes per record */
+	stress_wal_file_t *file;	/* log file appended to */
+#if defined(HAVE_WAL_IO_URING)
+	stress_io_uring_submit_t ring;	/* io-uring commit ring */
+#endif
+	uint8_t *record;		/* record data */
+	double *latencies;		/* commit latency samples */
+	uint64_t samples;		/* latency samples taken */
+	volatile uint64_t commits;	/* records committed */
+	uint64_t syncs;			/* sync operations issued */
+	uint64_t rnd;			/* xorshift state, mwc is not thread safe */
+	int err;			/* errno of a failed commit */
+} stress_wal_thread_t;
+
+/* per commit method results */
+typedef struct {
+	uint64_t commits;		/* records committed */
+	uint64_t syncs;			/* syncs issued */
+	double duration;		/* run time */
+	double p50, p90, p99, p999, max;/* commit latencies in seconds */
+	bool supported;			/* method worked */
+} stress_wal_result_t;
+
+#if defined(HAVE_WAL_IO_URING)
+/*
+ *  stress_wal_ring_commit()
+ *	submit a write linked to an fdatasync and wait for both
+ */
+static int stress_wal_ring_commit(
+	stress_io_uring_submit_t *ring,
+	const int fd,
+	const void *buf,
+	const size_t len,
+	const uint64_t off)
+{
+	const unsigned sq_mask = *ring->sq_ring.ring_mask;
+	const unsigned cq_mask = *ring->cq_ring.ring_mask;
+	unsigned tail = *ring->sq_ring.tail, head, i;
+	struct io_uring_sqe *sqe;
+	int ret, err = 0;
+
+	sqe = &ring->sqes_mmap[tail & sq_mask];
+	(void)shim_memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_WRITE;
+	sqe->flags = IOSQE_IO_LINK;
+	sqe->fd = fd;
+	sqe->addr = (uint64_t)(uintptr_t)buf;
+	sqe->len = (uint32_t)len;
+	sqe->off = off;
+	sqe->user_data = IORING_OP_WRITE;
+	ring->sq_ring.array[tail & sq_mask] = tail & sq_mask;
+	tail++;
+
+	sqe = &ring->sqes_mmap[tail & sq_mask];
+	(void)shim_memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_FSYNC;
+	sqe->fd = fd;
+	sqe->fsync_flags = IORING_FSYNC_DATASYNC;
+	sqe->user_data = IORING_OP_FSYNC;
+	ring->sq_ring.array[tail & sq_mask] = tail & sq_mask;
+	tail++;
+
+	stress_asm_mb();
+	*ring->sq_ring.tail = tail;
+	stress_asm_mb();
+
+	do {
+		ret = shim_io_uring_enter(ring->io_uring_fd, 2, 2, IORING_ENTER_GETEVENTS);
+	} while ((ret < 0) && (errno == EINTR));
+	if (ret < 0)
+		return -1;
+
+	/* reap the write and fsync completions */
+	head = *ring->cq_ring.head;
+	for (i = 0; i < 2; ) {
+		const struct io_uring_cqe *cqe;
+
+		stress_asm_mb();
+		if (head == *ring->cq_ring.tail) {
+			ret = shim_io_uring_enter(ring->io_uring_fd, 0, 1, IORING_ENTER_GETEVENTS);
+			if ((ret < 0) && (errno != EINTR))
+				return -1;
+			continue;
+		}
+		cqe = &ring->cq_ring.cqes[head & cq_mask];
+		if (cqe->res < 0) {
+			/* a failed or short write cancels the linked fsync */
+			if (!err)
+				err = -cqe->res;
+		} else if ((cqe->user_data == IORING_OP_WRITE) && ((size_t)cqe->res != len)) {
+			/* short write, the record is not fully in the log */
+			err = EIO;
+		}
+		head++;
+		i++;
+	}
+	*ring->cq_ring.head = head;
+	stress_asm_mb();
+	if (err) {
+		errno = err;
+		return -1;
+	}
+	return 0;
+}
+#endif
+
+/*
+ *  stress_wal_write()
+ *	write a record or batch and make it durable with the
+ *	selected commit method
+ */
+static int stress_wal_write(
+	stress_wal_thread_t *thread,
+	const void *buf,
+	const size_t len,
+	const uint64_t off)
+{
+	const int fd = thread->file->fd;
+
+	thread->syncs++;
+	switch (thread->method) {
+#if defined(HAVE_WAL_IO_URING)
+	case WAL_METHOD_IO_URING:
+		/* io-uring write linked to an fdatasync */
+		return stress_wal_ring_commit(&thread->ring, fd, buf, len, off);
+#else
+	case WAL_METHOD_IO_URING:
+		errno = ENOSYS;
+		return -1;
+#endif
+	case WAL_METHOD_ODSYNC:
+		/* O_DSYNC, the write is the commit */
+		return (pwrite(fd, buf, len, (off_t)off) == (ssize_t)len) ? 0 : -1;
+	default:
+		break;
+	}
+
+	if (pwrite(fd, buf, len, (off_t)off) != (ssize_t)len)
+		return -1;
+	switch (thread->method) {
+	case WAL_METHOD_FSYNC:
+		return shim_fsync(fd);
+	case WAL_METHOD_SYNC_FILE_RANGE:
+#if defined(SYNC_FILE_RANGE_WAIT_BEFORE) &&	\
+    defined(SYNC_FILE_RANGE_WRITE) &&		\
+    defined(SYNC_FILE_RANGE_WAIT_AFTER)
+		/* start and wait for the data writeback, then flush the metadata */
+		if (shim_sync_file_range(fd, (shim_off64_t)off, (shim_off64_t)len,
+				SYNC_FILE_RANGE_WAIT_BEFORE |
+				SYNC_FILE_RANGE_WRITE |
+				SYNC_FILE_RANGE_WAIT_AFTER) < 0)
+			return -1;
+#endif
+		return shim_fdatasync(fd);
+	case WAL_METHOD_FDATASYNC:
+	default:
+		return shim_fdatasync(fd);
+	}
+}
+
+/*
+ *  stress_wal_reserve()
+ *	reserve space for len bytes in the log, the log is recycled
+ *	from the start once it reaches WAL_FILE_MAX, file lock held
+ */
+static inline uint64_t stress_wal_reserve(stress_wal_file_t *file, const size_t len)
+{
+	uint64_t off;
+
+	if (file->next_off + len > WAL_FILE_MAX)
+		file->next_off = 0;
+	off = file->next_off;
+	file->next_off += len;
+	return off;
+}
+
+/*
+ *  stress_wal_commit()
+ *	append a record and wait until it is durable
+ */
+static int stress_wal_commit(stress_wal_thread_t *thread)
+{
+	stress_wal_file_t *file = thread->file;
+	const size_t len = thread->record_size;
+	uint64_t lsn;
+
+	if (!thread->group_commit) {
+		/* every record is written and synced by its own thread */
+		uint64_t off;
+
+		(void)pthread_mutex_lock(&file->lock);
+		off = stress_wal_reserve(file, len);
+		(void)pthread_mutex_unlock(&file->lock);
+		return stress_wal_write(thread, thread->record, len, off);
+	}
+
+	/*
+	 *  Group commit, copy the record into the pending buffer, the
+	 *  first thread to find no leader writes and syncs everything
+	 *  pending in one go, the others wait for it to cover their record
+	 */
+	(void)pthread_mutex_lock(&file->lock);
+	(void)shim_memcpy(file->pending + file->pending_len, thread->record, len);
+	file->pending_len += len;
+	file->appended += len;
+	lsn = file->appended;
+
+	while (file->committed < lsn) {
+		uint8_t *tmp;
+		size_t batch_len;
+		uint64_t batch_lsn, off;
+		int ret;
+
+		if (file->err) {
+			/* the batch holding this record failed */
+			const int err = file->err;
+
+			(void)pthread_mutex_unlock(&file->lock);
+			errno = err;
+			return -1;
+		}
+		if (file->leader) {
+			(void)pthread_cond_wait(&file->cond, &file->lock);
+			continue;
+		}
+		/* become the leader, take the pending batch */
+		file->leader = true;
+		tmp = file->flushing;
+		file->flushing = file->pending;
+		file->pending = tmp;
+		batch_len = file->pending_len;
+		batch_lsn = file->appended;
+		file->pending_len = 0;
+		off = stress_wal_reserve(file, batch_len);
+		(void)pthread_mutex_unlock(&file->lock);
+
+		ret = stress_wal_write(thread, file->flushing, batch_len, off);
+
+		(void)pthread_mutex_lock(&file->lock);
+		file->leader = false;
+		if (ret < 0) {
+			const int err = errno;
+
+			file->err = err;
+			(void)pthread_cond_broadcast(&file->cond);
+			(void)pthread_mutex_unlock(&file->lock);
+			errno = err;
+			return -1;
+		}
+		file->committed = batch_lsn;
+		(void)pthread_cond_broadcast(&file->cond);
+	}
+	(void)pthread_mutex_unlock(&file->lock);
+	return 0;
+}
+
+/*
+ *  stress_wal_thread()
+ *	append and commit records, sampling commit latencies
+ */
+static void *stress_wal_thread(void *arg)
+{
+	static void *nowt = NULL;
+	stress_wal_thread_t *thread = (stress_wal_thread_t *)arg;
+
+	while (!*thread->go && !*thread->stop)
+		shim_sched_yield();
+
+	while (!*thread->stop && stress_continue_flag()) {
+		const double t = stress_time_now();
+		double latency;
+		uint64_t n;
+
+		if (stress_wal_commit(thread) < 0) {
+			thread->err = errno;
+			break;
+		}
+		latency = stress_time_now() - t;
+
+		/* reservoir sample the latencies once the buffer is full */
+		n = thread->commits;
+		if (n < WAL_MAX_SAMPLES) {
+			thread->latencies[n] = latency;
+			thread->samples++;
+		} else {
+			uint64_t r;
+
+			thread->rnd ^= thread->rnd << 13;
+			thread->rnd ^= thread->rnd >> 7;
+			thread->rnd ^= thread->rnd << 17;
+			r = thread->rnd % (n + 1);
+			if (r < WAL_MAX_SAMPLES)
+				thread->latencies[r] = latency;
+		}
+		thread->commits = n + 1;
+	}
+
+	/* wake up any followers left waiting on a leader that stopped */
+	(void)pthread_mutex_lock(&thread->file->lock);
+	(void)pthread_cond_broadcast(&thread->file->cond);
+	(void)pthread_mutex_unlock(&thread->file->lock);
+
+	return &nowt;
+}
+
+static inline double stress_wal_percentile(const double *latencies, const size_t n, const double pc)
+{
+	size_t i = (size_t)(((double)n * pc) / 100.0);
+
+	if (i >= n)
+		i = n - 1;
+	return latencies[i];
+}
+
+/*
+ *  stress_wal_files_create()
+ *	create the log files and zero fill them to WAL_FILE_MAX so
+ *	that commits overwrite allocated blocks and never extend the
+ *	file, as a database recycles preallocated log segments
+ */
+static int stress_wal_files_create(stress_args_t *args, const size_t n_files)
+{
+	char filename[PATH_MAX];
+	const size_t chunk = 1 * MB;
+	uint8_t *zero;
+	size_t i;
+	int rc = EXIT_SUCCESS;
+
+	zero = (uint8_t *)calloc(chunk, 1);
+	if (!zero) {
+		pr_inf_skip("%s: cannot allocate log fill buffer, skipping stressor\n",
+			args->name);
+		return EXIT_NO_RESOURCE;
+	}
+	for (i = 0; (i < n_files) && (rc == EXIT_SUCCESS); i++) {
+		off_t off;
+		int fd;
+
+		(void)stress_temp_filename_args(args, filename, sizeof(filename), (uint32_t)i);
+		fd = open(filename, O_CREAT | O_RDWR | O_TRUNC, S_IRUSR | S_IWUSR);
+		if (fd < 0) {
+			rc = stress_exit_status(errno);
+			if (rc == EXIT_FAILURE)
+				pr_fail("%s: open %s failed, errno=%d (%s)\n",
+					args->name, filename, errno, strerror(errno));
+			break;
+		}
+		(void)shim_fallocate(fd, 0, 0, (off_t)WAL_FILE_MAX);
+		for (off = 0; off < (off_t)WAL_FILE_MAX; off += (off_t)chunk) {
+			if (!stress_continue_flag()) {
+				rc = EXIT_NO_RESOURCE;
+				break;
+			}
+			if (pwrite(fd, zero, chunk, off) != (ssize_t)chunk) {
+				if (errno == ENOSPC) {
+					pr_inf_skip("%s: out of file system space for %zu %" PRIu64 "MB "
+						"log files, skipping stressor\n",
+						args->name, n_files, (uint64_t)(WAL_FILE_MAX / MB));
+					rc = EXIT_NO_RESOURCE;
+				} else {
+					pr_fail("%s: write %s failed, errno=%d (%s)\n",
+						args->name, filename, errno, strerror(errno));
+					rc = EXIT_FAILURE;
+				}
+				break;
+			}
+		}
+		if ((rc == EXIT_SUCCESS) && (shim_fsync(fd) < 0)) {
+			pr_fail("%s: fsync %s failed, errno=%d (%s)\n",
+				args->name, filename, errno, strerror(errno));
+			rc = EXIT_FAILURE;
+		}
+		(void)close(fd);
+	}
+	free(zero);
+	return rc;
+}
+
+/*
+ *  stress_wal_files_unlink()
+ *	remove the log files
+ */
+static void stress_wal_files_unlink(stress_args_t *args, const size_t n_files)
+{
+	char filename[PATH_MAX];
+	size_t i;
+
+	for (i = 0; i < n_files; i++) {
+		(void)stress_temp_filename_args(args, filename, sizeof(filename), (uint32_t)i);
+		(void)shim_unlink(filename);
+	}
+}
+
+/*
+ *  stress_wal_files_open()
+ *	open the preallocated log files for a commit method
+ */
+static int stress_wal_files_open(
+	stress_args_t *args,
+	stress_wal_file_t *files,
+	const size_t n_files,
+	const size_t method)
+{
+	char filename[PATH_MAX];
+	const int flags = O_RDWR | ((method == WAL_METHOD_ODSYNC) ? O_DSYNC : 0);
+	size_t i;
+
+	for (i = 0; i < n_files; i++) {
+		stress_wal_file_t *file = &files[i];
+
+		(void)stress_temp_filename_args(args, filename, sizeof(filename), (uint32_t)i);
+		file->fd = open(filename, flags);
+		if (file->fd < 0) {
+			pr_fail("%s: open %s failed, errno=%d (%s)\n",
+				args->name, filename, errno, strerror(errno));
+			return -1;
+		}
+		file->next_off = 0;
+		file->appended = 0;
+		file->committed = 0;
+		file->pending_len = 0;
+		file->leader = false;
+		file->err = 0;
+	}
+	return 0;
+}
+
+static void stress_wal_files_close(stress_wal_file_t *files, const size_t n_files)
+{
+	size_t i;
+
+	for (i = 0; i < n_files; i++) {
+		if (files[i].fd >= 0) {
+			(void)close(files[i].fd);
+			files[i].fd = -1;
+		}
+	}
+}
+
+/*
+ *  stress_wal_run()
+ *	run the appending threads for a phase with the given commit method
+ */
+static int stress_wal_run(
+	stress_args_t *args,
+	stress_wal_file_t *files,
+	const size_t n_files,
+	stress_wal_thread_t *threads,
+	const size_t n_threads,
+	const size_t method,
+	const double phase,
+	double *latencies,
+	stress_wal_result_t *result)
+{
+	volatile bool go = false, stop = false;
+	const uint64_t bogo_base = stress_bogo_get(args);
+	uint64_t commits = 0;
+	size_t i, started = 0, n_samples = 0;
+	int rc = EXIT_SUCCESS, err = 0;
+	double t, t_end;
+
+	if (stress_wal_files_open(args, files, n_files, method) < 0) {
+		stress_wal_files_close(files, n_files);
+		return EXIT_FAILURE;
+	}
+
+	for (i = 0; i < n_threads; i++) {
+		stress_wal_thread_t *thread = &threads[i];
+
+		thread->go = &go;
+		thread->stop = &stop;
+		thread->method = method;
+		thread->file = &files[i % n_files];
+		thread->samples = 0;
+		thread->commits = 0;
+		thread->syncs = 0;
+		thread->rnd = stress_mwc64() | 1;
+		thread->err = 0;
+#if defined(HAVE_WAL_IO_URING)
+		thread->ring.io_uring_fd = -1;
+		if ((method == WAL_METHOD_IO_URING) &&
+		    (stress_io_uring_ring_setup(4, &thread->ring) < 0)) {
+			err = errno;
+			break;
+		}
+#endif
+		thread->ret = pthread_create(&thread->pthread, NULL,
+				stress_wal_thread, (void *)thread);
+		if (thread->ret != 0) {
+#if defined(HAVE_WAL_IO_URING)
+			if (method == WAL_METHOD_IO_URING)
+				stress_io_uring_ring_close(&thread->ring);
+#endif
+			break;
+		}
+		started++;
+	}
+
+	t = stress_time_now();
+	t_end = t + phase;
+	go = true;
+	while ((started == n_threads) && stress_continue(args)) {
+		(void)shim_usleep(50000);
+		for (commits = 0, i = 0; i < started; i++) {
+			commits += threads[i].commits;
+			if (threads[i].err)
+				break;
+		}
+		stress_bogo_set(args, bogo_base + commits);
+		if ((i < started) || (stress_time_now() >= t_end))
+			break;
+	}
+	stop = true;
+	t = stress_time_now() - t;
+
+	for (commits = 0, i = 0; i < started; i++) {
+		stress_wal_thread_t *thread = &threads[i];
+
+		(void)pthread_join(thread->pthread, NULL);
+#if defined(HAVE_WAL_IO_URING)
+		if (method == WAL_METHOD_IO_URING)
+			stress_io_uring_ring_close(&thread->ring);
+#endif
+		commits += thread->commits;
+		result->syncs += thread->syncs;
+		(void)shim_memcpy(latencies + n_samples, thread->latencies,
+			(size_t)thread->samples * sizeof(*latencies));
+		n_samples += (size_t)thread->samples;
+		if (thread->err && !err)
+			err = thread->err;
+	}
+	stress_wal_files_close(files, n_files);
+	stress_bogo_set(args, bogo_base + commits);
+	result->commits += commits;
+
+	if (err) {
+		if ((err == ENOSYS) || (err == EOPNOTSUPP) || (err == EINVAL)) {
+			if (args->instance == 0)
+				pr_inf("%s: %s commits not supported, errno=%d (%s)\n",
+					args->name, wal_methods[method], err, strerror(err));
+			return EXIT_SUCCESS;
+		}
+		if (err == ENOSPC) {
+			pr_inf_skip("%s: out of file system space, skipping stressor\n",
+				args->name);
+			return EXIT_NO_RESOURCE;
+		}
+		pr_fail("%s: %s commit failed, errno=%d (%s)\n",
+			args->name, wal_methods[method], err, strerror(err));
+		rc = EXIT_FAILURE;
+	}
+	if (started < n_threads) {
+		pr_inf("%s: only started %zu of %zu threads\n",
+			args->name, started, n_threads);
+	}
+
+	result->duration += t;
+	if (n_samples > 0) {
+		qsort(latencies, n_samples, sizeof(*latencies), stress_metrics_cmp_double);
+		result->p50 = stress_wal_percentile(latencies, n_samples, 50.0);
+		result->p90 = stress_wal_percentile(latencies, n_samples, 90.0);
+		result->p99 = stress_wal_percentile(latencies, n_samples, 99.0);
+		result->p999 = stress_wal_percentile(latencies, n_samples, 99.9);
+		if (latencies[n_samples - 1] > result->max)
+			result->max = latencies[n_samples - 1];
+		result->supported = true;
+	}
+	return rc;
+}
+
+/*
+ *  stress_wal()
+ *	model a write-ahead log, threads append records to log files
+ *	and commit them with fsync, fdatasync, O_DSYNC, sync_file_range
+ *	or io-uring, optionally batched with group commit
+ */
+static int stress_wal(stress_args_t *args)
+{
+	stress_wal_file_t files[MAX_WAL_FILES];
+	stress_wal_thread_t *threads;
+	stress_wal_result_t results[SIZEOF_ARRAY(wal_methods)];
+	uint32_t wal_files = DEFAULT_WAL_FILES;
+	uint32_t wal_threads = DEFAULT_WAL_THREADS;
+	uint64_t wal_record = DEFAULT_WAL_RECORD;
+	size_t wal_method = WAL_METHOD_ALL;
+	bool wal_group_commit = false;
+	size_t i, n_files, first, last, method, buf_size, idx;
+	double *latencies, phase;
+	uint8_t *bufs;
+	int ret, rc = EXIT_SUCCESS;
+
+	(void)stress_get_setting("wal-files", &wal_files);
+	(void)stress_get_setting("wal-group-commit", &wal_group_commit);
+	(void)stress_get_setting("wal-method", &wal_method);
+	(void)stress_get_setting("wal-record", &wal_record);
+	if (!stress_get_setting("wal-threads", &wal_threads)) {
+		if (g_opt_flags & OPT_FLAGS_MAXIMIZE)
+			wal_threads = MAX_WAL_THREADS;
+		if (g_opt_flags & OPT_FLAGS_MINIMIZE)
+			wal_threads = MIN_WAL_THREADS;
+	}
+	n_files = (size_t)STRESS_MINIMUM(wal_files, wal_threads);
+
+	/* each thread has at most one record pending in a group commit */
+	buf_size = (size_t)wal_record * ((wal_threads + n_files - 1) / n_files);
+
+	(void)shim_memset(files, 0, sizeof(files));
+	(void)shim_memset(results, 0, sizeof(results));
+	threads = (stress_wal_thread_t *)calloc(wal_threads, sizeof(*threads));
+	latencies = (double *)calloc((size_t)wal_threads * WAL_MAX_SAMPLES, sizeof(*latencies));
+	bufs = (uint8_t *)calloc((n_files * 2 * buf_size) + (wal_threads * wal_record), 1);
+	if (!threads || !latencies || !bufs) {
+		pr_inf_skip("%s: cannot allocate thread and buffer state, skipping stressor\n",
+			args->name);
+		rc = EXIT_NO_RESOURCE;
+		goto tidy_free;
+	}
+	for (i = 0; i < n_files; i++) {
+		files[i].fd = -1;
+		files[i].pending = bufs + (i * 2 * buf_size);
+		files[i].flushing = files[i].pending + buf_size;
+		files[i].buf_size = buf_size;
+		(void)pthread_mutex_init(&files[i].lock, NULL);
+		(void)pthread_cond_init(&files[i].cond, NULL);
+	}
+	for (i = 0; i < wal_threads; i++) {
+		threads[i].record = bufs + (n_files * 2 * buf_size) + (i * wal_record);
+		threads[i].record_size = (size_t)wal_record;
+		threads[i].group_commit = wal_group_commit;
+		threads[i].latencies = latencies + (i * WAL_MAX_SAMPLES);
+		stress_rndbuf(threads[i].record, (size_t)wal_record);
+	}
+
+	ret = stress_temp_dir_mk_args(args);
+	if (ret < 0) {
+		rc = stress_exit_status(-ret);
+		goto tidy_sync;
+	}
+	rc = stress_wal_files_create(args, n_files);
+	if (rc != EXIT_SUCCESS)
+		goto tidy_files;
+
+	if (wal_method == WAL_METHOD_ALL) {
+		first = 1;
+		last = SIZEOF_ARRAY(wal_methods) - 1;
+	} else {
+		first = wal_method;
+		last = wal_method;
+	}
+	/* share the run time between the methods */
+	phase = WAL_PHASE;
+	if (g_opt_timeout > 0) {
+		phase = (args->time_end - stress_time_now()) / (double)(last - first + 1);
+		if (phase < 1.0)
+			phase = 1.0;
+	}
+	if (args->instance == 0)
+		pr_inf("%s: %" PRIu32 " threads appending %" PRIu64 " byte records to %zu "
+			"log file%s%s\n", args->name, wal_threads, wal_record, n_files,
+			(n_files == 1) ? "" : "s",
+			wal_group_commit ? " with group commit" : "");
+
+	stress_set_proc_state(args->name, STRESS_STATE_RUN);
+	method = first;
+	do {
+		rc = stress_wal_run(args, files, n_files, threads, (size_t)wal_threads,
+			method, phase, latencies, &results[method]);
+		if (rc != EXIT_SUCCESS)
+			break;
+		method = (method >= last) ? first : method + 1;
+	} while (stress_continue(args));
+	stress_set_proc_state(args->name, STRESS_STATE_DEINIT);
+
+	if ((args->instance == 0) && (rc == EXIT_SUCCESS)) {
+		pr_block_begin();
+		pr_inf("%s: %-15s %10s %10s %10s %10s %10s %10s %10s\n",
+			args->name, "method", "commits/s", "recs/sync",
+			"p50 usec", "p90 usec", "p99 usec", "p99.9 usec", "max usec");
+		for (method = first; method <= last; method++) {
+			const stress_wal_result_t *r = &results[method];
+
+			if (!r->supported || (r->duration <= 0.0))
+				continue;
+			pr_inf("%s: %-15s %10.1f %10.2f %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+				args->name, wal_methods[method],
+				(double)r->commits / r->duration,
+				r->syncs ? (double)r->commits / (double)r->syncs : 0.0,
+				r->p50 * STRESS_DBL_MICROSECOND, r->p90 * STRESS_DBL_MICROSECOND,
+				r->p99 * STRESS_DBL_MICROSECOND, r->p999 * STRESS_DBL_MICROSECOND,
+				r->max * STRESS_DBL_MICROSECOND);
+		}
+		pr_block_end();
+	}
+	for (idx = 0, method = first; method <= last; method++) {
+		const stress_wal_result_t *r = &results[method];
+		char str[64];
+
+		if (!r->supported || (r->duration <= 0.0))
+			continue;
+		(void)snprintf(str, sizeof(str), "commits per sec %s", wal_methods[method]);
+		stress_metrics_set(args, idx++, str,
+			(double)r->commits / r->duration, STRESS_HARMONIC_MEAN);
+		(void)snprintf(str, sizeof(str), "usec p50 commit latency %s", wal_methods[method]);
+		stress_metrics_set(args, idx++, str,
+			r->p50 * STRESS_DBL_MICROSECOND, STRESS_GEOMETRIC_MEAN);
+		(void)snprintf(str, sizeof(str), "usec p90 commit latency %s", wal_methods[method]);
+		stress_metrics_set(args, idx++, str,
+			r->p90 * STRESS_DBL_MICROSECOND, STRESS_GEOMETRIC_MEAN);
+		(void)snprintf(str, sizeof(str), "usec p99 commit latency %s", wal_methods[method]);
+		stress_metrics_set(args, idx++, str,
+			r->p99 * STRESS_DBL_MICROSECOND, STRESS_GEOMETRIC_MEAN);
+		(void)snprintf(str, sizeof(str), "usec p99.9 commit latency %s", wal_methods[method]);
+		stress_metrics_set(args, idx++, str,
+			r->p999 * STRESS_DBL_MICROSECOND, STRESS_GEOMETRIC_MEAN);
+		(void)snprintf(str, sizeof(str), "usec max commit latency %s", wal_methods[method]);
+		stress_metrics_set(args, idx++, str,
+			r->max * STRESS_DBL_MICROSECOND, STRESS_GEOMETRIC_MEAN);
+	}
+
+tidy_files:
+	stress_wal_files_unlink(args, n_files);
+	(void)stress_temp_dir_rm_args(args);
+tidy_sync:
+	for (i = 0; i < n_files; i++) {
+		(void)pthread_cond_destroy(&files[i].cond);
+		(void)pthread_mutex_destroy(&files[i].lock);
+	}
+tidy_free:
+	free(bufs);
+	free(latencies);
+	free(threads);
+
+	return rc;
+}
+
+stressor_info_t stress_wal_info = {
+	.stressor = stress_wal,
+	.class = CLASS_IO | CLASS_FILESYSTEM,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help
+};
+#else
+stressor_info_t stress_wal_info = {
+	.stressor = stress_unimplemented,
+	.class = CLASS_IO | CLASS_FILESYSTEM,
+	.opt_set_funcs = opt_set_funcs,
+	.help = help,
+	.unimplemented_reason = "built without pthread support"
+};
+#endif
@@ -379,6 +379,7 @@ static int stress_x86syscall(stress_args_t *args)
 	stress_wfunc_t x86syscall_funcs[SIZEOF_ARRAY(x86syscalls)] ALIGN64;
 	register size_t i, n;
 	int rc = EXIT_SUCCESS;
+	stress_bogo_batch_t bb;
 
 	if (x86syscall_check_x86syscall_func() < 0)
 		return EXIT_FAILURE;
@@ -400,13 +401,15 @@ static int stress_x86syscall(stress_args_t *args)
 
 	stress_set_proc_state(args->name, STRESS_STATE_RUN);
 
+	stress_bogo_batch_init(&bb, args, STRESS_BOGO_BATCH_DEFAULT);
 	t1 = stress_time_now();
 	do {
 		for (i = 0; i < n; i++)
 			x86syscall_funcs[i]();
-		stress_bogo_add(args, n);
-	} while (stress_continue(args));
+		stress_bogo_batch_add(&bb, n);
+	} while (stress_bogo_batch_continue(&bb));
 	t2 = stress_time_now();
+	stress_bogo_batch_flush(&bb);
 
 	/*
 	 *  And spend 1/10th of a second measuring overhead of
@@ -423,10 +426,11 @@ static int stress_x86syscall(stress_args_t *args)
 		for (j = 0; j < 1000000; j++) {
 			for (i = 0; i < n; i++)
 				x86syscall_funcs[i]();
-			stress_bogo_add(args, n);
+			stress_bogo_batch_add(&bb, n);
 		}
 		t4 = stress_time_now();
 	} while (t4 - t3 < 0.1);
+	stress_bogo_batch_flush(&bb);
 
 	overhead_ns = (double)STRESS_NANOSECOND * ((t4 - t3) / (double)(stress_bogo_get(args) - counter));
 	stress_bogo_set(args, counter);